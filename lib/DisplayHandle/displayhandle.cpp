@@ -0,0 +1,93 @@
+#include "displayhandle.h"
+#include <stdarg.h>
+
+CharDisplay* DisplayHandle::display = nullptr;
+char DisplayHandle::frame[DISPLAY_ROWS][DISPLAY_COLUMNS];
+char DisplayHandle::glass[DISPLAY_ROWS][DISPLAY_COLUMNS];
+portMUX_TYPE DisplayHandle::frameLock = portMUX_INITIALIZER_UNLOCKED;
+uint32_t DisplayHandle::cellsWritten = 0;
+
+void DisplayHandle::begin(CharDisplay* output) {
+    display = output;
+    display->clear();
+    memset(glass, ' ', sizeof(glass));
+    clear();
+
+    xTaskCreatePinnedToCore(
+        displayTask,
+        "Display_Task",
+        2048,
+        NULL,
+        1,
+        NULL,
+        1
+    );
+}
+
+void DisplayHandle::print(uint8_t column, uint8_t row, const char* text) {
+    write(column, row, text, strlen(text));
+}
+
+// Text past the end of the row is cut, the LCD would wrap it elsewhere
+void DisplayHandle::write(uint8_t column, uint8_t row, const char* text, size_t length) {
+    if (row >= DISPLAY_ROWS) return;
+
+    portENTER_CRITICAL(&frameLock);
+    for (size_t i = 0; column + i < DISPLAY_COLUMNS && i < length; i++) {
+        frame[row][column + i] = text[i];
+    }
+    portEXIT_CRITICAL(&frameLock);
+}
+
+void DisplayHandle::printf(uint8_t column, uint8_t row, const char* format, ...) {
+    char text[DISPLAY_COLUMNS + 1];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    print(column, row, text);
+}
+
+void DisplayHandle::clear() {
+    portENTER_CRITICAL(&frameLock);
+    memset(frame, ' ', sizeof(frame));
+    portEXIT_CRITICAL(&frameLock);
+}
+
+void DisplayHandle::displayTask(void* pvParameters) {
+    TickType_t lastWake = xTaskGetTickCount();
+    for(;;) {
+        refresh();
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(DISPLAY_REFRESH_MS));
+    }
+}
+
+// Only runs of cells that differ from the glass are sent, one write each
+void DisplayHandle::refresh() {
+    char next[DISPLAY_ROWS][DISPLAY_COLUMNS];
+    portENTER_CRITICAL(&frameLock);
+    memcpy(next, frame, sizeof(next));
+    portEXIT_CRITICAL(&frameLock);
+
+    for (uint8_t row = 0; row < DISPLAY_ROWS; row++) {
+        uint8_t column = 0;
+        while (column < DISPLAY_COLUMNS) {
+            if (next[row][column] == glass[row][column]) {
+                column++;
+                continue;
+            }
+
+            uint8_t end = column;
+            while (end < DISPLAY_COLUMNS && next[row][end] != glass[row][end]) end++;
+
+            display->write(column, row, &next[row][column], end - column);
+            memcpy(&glass[row][column], &next[row][column], end - column);
+            cellsWritten += end - column;
+            column = end;
+        }
+    }
+}
+
+uint32_t DisplayHandle::getCellsWritten() {
+    return cellsWritten;
+}
@@ -0,0 +1,46 @@
+#ifndef DISPLAYHANDLE_H
+#define DISPLAYHANDLE_H
+
+#include <Arduino.h>
+#include <chardisplay.h>
+
+#define DISPLAY_COLUMNS 16
+#define DISPLAY_ROWS 2
+#define DISPLAY_REFRESH_MS 100
+
+// Shadow framebuffer for the 16x2 LCD (any CharDisplay). Writers only touch RAM; a low
+// priority task compares the frame with what is on the glass and sends the
+// changed runs over I2C, at most every DISPLAY_REFRESH_MS.
+class DisplayHandle {
+private:
+    static CharDisplay* display;
+    static char frame[DISPLAY_ROWS][DISPLAY_COLUMNS];
+    static char glass[DISPLAY_ROWS][DISPLAY_COLUMNS];
+    static portMUX_TYPE frameLock;
+    static uint32_t cellsWritten;
+
+    static void displayTask(void* pvParameters);
+    static void refresh();
+
+public:
+    static void begin(CharDisplay* output);
+    static void print(uint8_t column, uint8_t row, const char* text);
+    static void write(uint8_t column, uint8_t row, const char* text, size_t length);
+    static void printf(uint8_t column, uint8_t row, const char* format, ...);
+    static void clear();
+    static uint32_t getCellsWritten();
+};
+
+// The framebuffer as a CharDisplay, for code shared with the native build
+class FrameDisplay : public CharDisplay {
+public:
+    void clear() override {
+        DisplayHandle::clear();
+    }
+
+    void write(uint8_t column, uint8_t row, const char* text, size_t length) override {
+        DisplayHandle::write(column, row, text, length);
+    }
+};
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef LCDDISPLAY_H
+#define LCDDISPLAY_H
+
+#include <LiquidCrystal_I2C.h>
+#include <chardisplay.h>
+
+// The I2C LCD behind the CharDisplay interface
+class LCDDisplay : public CharDisplay {
+public:
+    explicit LCDDisplay(LiquidCrystal_I2C& lcd) : lcd(lcd) {}
+
+    void clear() override {
+        lcd.clear();
+    }
+
+    void write(uint8_t column, uint8_t row, const char* text, size_t length) override {
+        lcd.setCursor(column, row);
+        lcd.write((const uint8_t*)text, length);
+    }
+
+private:
+    LiquidCrystal_I2C& lcd;
+};
+
+#endif
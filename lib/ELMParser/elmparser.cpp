@@ -0,0 +1,203 @@
+#include "elmparser.h"
+#include <string.h>
+
+const int8_t ELMParser::NIBBLE[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+bool ELMParser::contains(const char* line, const char* end, const char* text) {
+    for (; line < end; line++) {
+        const char* a = line;
+        const char* b = text;
+        while (a < end && *b != '\0' && *a == *b) {
+            a++;
+            b++;
+        }
+        if (*b == '\0') return true;
+    }
+    return false;
+}
+
+uint8_t ELMParser::classifyStatus(const char* line, const char* end) {
+    if (contains(line, end, "NO DATA")) return ELM_STATUS_NO_DATA;
+    if (contains(line, end, "ERROR")) return ELM_STATUS_ERROR;
+    // Fixed protocol (ATSPn) the car does not speak; only ever at the start of the line
+    if (*line == 'U' && contains(line, end, "UNABLE TO CONNECT")) return ELM_STATUS_ERROR;
+    if (contains(line, end, "?")) return ELM_STATUS_UNKNOWN_COMMAND;
+    return 0;  // "SEARCHING...", "BUS INIT: ...OK" and other progress text
+}
+
+// Walks one "41 PID data [PID data ...]" frame and routes every pair to the handler.
+uint8_t ELMParser::walkFrame(const uint8_t* bytes, size_t length, uint16_t ecu, ELMPIDLengthFunction pidLength, ELMPIDHandler handler, void* context, uint8_t* mode) {
+    if (length < 2) return 0;
+    *mode = bytes[0];
+    if (bytes[0] != 0x41) return 0;
+
+    uint8_t decoded = 0;
+    size_t i = 1;
+    while (i < length) {
+        uint8_t pid = bytes[i];
+        uint8_t dataLength = pidLength(pid);
+        if (dataLength == 0 || i + 1 + dataLength > length) break;
+
+        handler(pid, &bytes[i + 1], ecu, context);
+        decoded++;
+        i += 1 + dataLength;
+    }
+    return decoded;
+}
+
+// Response layouts handled:
+//   single frame:  "41 0C 1A F8"
+//   several lines: "41 0C 1A F8\r41 0D 32"            (one frame per line)
+//   CAN multi:     "00A\r0: 41 0C 1A F8 0D 32\r1: 04 3F 00 ..."
+//   CAN headers:   "7E8 06 41 00 BE 3F A8 13\r7E9 06 41 00 98 18 80 01"
+//                  "7E8 10 0A 41 0C 1A F8 0D 32\r7E8 21 04 3F 05 82 00 00 00"
+// The 3-digit CAN byte count, or the length in the ISO-TP first frame, trims
+// the padding of the last segment. With headers, single frames of several
+// ECUs may be interleaved, but only one ECU's multi-frame answer is assembled
+// at a time: consecutive frames of another ECU are dropped.
+ELMResponse ELMParser::parse(char* buffer, size_t length, ELMPIDLengthFunction pidLength, ELMPIDHandler handler, void* context) {
+    ELMResponse response = { 0, 0, 0 };
+    uint8_t* bytes = (uint8_t*)buffer;
+    size_t frameLength = 0;
+    size_t expectedLength = 0;
+    bool multiFrame = false;
+    uint16_t frameECU = ELM_NO_HEADER;
+
+    const char* end = buffer + length;
+    const char* line = buffer;
+    while (line < end) {
+        const char* lineEnd = line;
+        while (lineEnd < end && *lineEnd != '\r' && *lineEnd != '\n') lineEnd++;
+
+        const char* p = line;
+        while (p < lineEnd && (*p == ' ' || *p == '>')) p++;
+
+        if (p < lineEnd) {
+            int8_t first = NIBBLE[(uint8_t)p[0]];
+            bool segment = first >= 0 && p + 1 < lineEnd && p[1] == ':';
+            bool byteCount = first >= 0 && p + 2 < lineEnd && NIBBLE[(uint8_t)p[1]] >= 0 && NIBBLE[(uint8_t)p[2]] >= 0;
+            for (const char* q = p + 3; byteCount && q < lineEnd; q++) {
+                if (*q != ' ') byteCount = false;
+            }
+            // Three hex digits followed by bytes: the 11-bit CAN ID printed with ATH1
+            bool header = first >= 0 && p + 4 < lineEnd && NIBBLE[(uint8_t)p[1]] >= 0 && NIBBLE[(uint8_t)p[2]] >= 0
+                          && p[3] == ' ' && !byteCount;
+            uint16_t ecu = ELM_NO_HEADER;
+
+            if (header) {
+                ecu = (first << 8) | (NIBBLE[(uint8_t)p[1]] << 4) | NIBBLE[(uint8_t)p[2]];
+                p += 4;
+            } else if (segment) {
+                // Numbered segment of a multi-frame CAN response
+                if (first == 0) frameLength = 0;
+                multiFrame = true;
+                p += 2;
+            } else if (byteCount) {
+                // Byte count header of a multi-frame CAN response
+                expectedLength = (first << 8) | (NIBBLE[(uint8_t)p[1]] << 4) | NIBBLE[(uint8_t)p[2]];
+                frameLength = 0;
+                multiFrame = true;
+                p = lineEnd;
+            } else {
+                if (multiFrame) {
+                    size_t used = (expectedLength > 0 && expectedLength < frameLength) ? expectedLength : frameLength;
+                    response.decodedPIDs += walkFrame(bytes, used, frameECU, pidLength, handler, context, &response.mode);
+                    multiFrame = false;
+                    expectedLength = 0;
+                }
+                frameLength = 0;
+                frameECU = ELM_NO_HEADER;
+            }
+
+            size_t lineStartLength = frameLength;
+            int8_t high = -1;
+            for (; p < lineEnd; p++) {
+                int8_t value = NIBBLE[(uint8_t)*p];
+                if (value < 0) {
+                    if (*p == ' ') continue;
+                    response.status |= classifyStatus(line, lineEnd);
+                    frameLength = lineStartLength;
+                    break;
+                }
+                if (high < 0) {
+                    high = value;
+                } else {
+                    bytes[frameLength++] = (uint8_t)((high << 4) | value);
+                    high = -1;
+                }
+            }
+
+            if (header) {
+                frameLength = assembleHeaderFrame(bytes, lineStartLength, frameLength, ecu, frameECU, expectedLength, multiFrame,
+                                                  pidLength, handler, context, response);
+            } else if (!multiFrame && frameLength > 0) {
+                response.decodedPIDs += walkFrame(bytes, frameLength, ELM_NO_HEADER, pidLength, handler, context, &response.mode);
+                frameLength = 0;
+            }
+        }
+
+        line = lineEnd + 1;
+    }
+
+    if (multiFrame && frameLength > 0) {
+        size_t used = (expectedLength > 0 && expectedLength < frameLength) ? expectedLength : frameLength;
+        response.decodedPIDs += walkFrame(bytes, used, frameECU, pidLength, handler, context, &response.mode);
+    }
+    return response;
+}
+
+// One ATH1 line, already decoded to bytes[lineStart..lineEnd): the ISO-TP PCI
+// byte, then the data. A single frame is walked on the spot, a first frame
+// (flushing the frame in progress) starts the assembly at bytes[0] and
+// consecutive frames of the same ECU are appended. Returns the new frame length.
+size_t ELMParser::assembleHeaderFrame(uint8_t* bytes, size_t lineStart, size_t lineEnd, uint16_t ecu, uint16_t& frameECU,
+                                      size_t& expectedLength, bool& multiFrame, ELMPIDLengthFunction pidLength,
+                                      ELMPIDHandler handler, void* context, ELMResponse& response) {
+    if (lineEnd <= lineStart) return lineStart;
+    uint8_t pci = bytes[lineStart];
+    uint8_t* data = bytes + lineStart + 1;
+    size_t dataLength = lineEnd - lineStart - 1;
+
+    switch (pci >> 4) {
+        case 0: {
+            size_t used = (pci & 0x0F) < dataLength ? (pci & 0x0F) : dataLength;
+            response.decodedPIDs += walkFrame(data, used, ecu, pidLength, handler, context, &response.mode);
+            return lineStart;
+        }
+        case 1: {
+            if (dataLength < 1) return lineStart;
+            if (multiFrame && lineStart > 0) {
+                size_t used = (expectedLength > 0 && expectedLength < lineStart) ? expectedLength : lineStart;
+                response.decodedPIDs += walkFrame(bytes, used, frameECU, pidLength, handler, context, &response.mode);
+            }
+            expectedLength = ((size_t)(pci & 0x0F) << 8) | data[0];
+            memmove(bytes, data + 1, dataLength - 1);
+            multiFrame = true;
+            frameECU = ecu;
+            return dataLength - 1;
+        }
+        case 2:
+            if (!multiFrame || ecu != frameECU) return lineStart;
+            memmove(bytes + lineStart, data, dataLength);
+            return lineStart + dataLength;
+        default:
+            return lineStart;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef ELMPARSER_H
+#define ELMPARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ELM_STATUS_NO_DATA 0x01
+#define ELM_STATUS_ERROR 0x02
+#define ELM_STATUS_UNKNOWN_COMMAND 0x04
+
+// Sender of a frame printed without headers (ATH0)
+#define ELM_NO_HEADER 0
+
+// Number of data bytes that follow a PID, 0 when the PID is unknown
+typedef uint8_t (*ELMPIDLengthFunction)(uint8_t pid);
+// ecu is the 11-bit CAN ID of the sender (0x7E8...) with headers on, ELM_NO_HEADER otherwise
+typedef void (*ELMPIDHandler)(uint8_t pid, const uint8_t* data, uint16_t ecu, void* context);
+
+struct ELMResponse {
+    uint8_t status;         // ELM_STATUS_* flags of the status lines found
+    uint8_t mode;           // mode byte of the last frame, 0x41 for current data
+    uint8_t decodedPIDs;    // PID/data pairs routed to the handler
+};
+
+// Single-pass, allocation-free ELM327 response decoder. The hex text is
+// decoded in place (every byte needs two characters, so the write cursor
+// always stays behind the read cursor) and every PID/data pair of a mode 01
+// response is handed to the handler.
+class ELMParser {
+private:
+    static const int8_t NIBBLE[256];
+
+    static uint8_t classifyStatus(const char* line, const char* end);
+    static bool contains(const char* line, const char* end, const char* text);
+    static size_t assembleHeaderFrame(uint8_t* bytes, size_t lineStart, size_t lineEnd, uint16_t ecu, uint16_t& frameECU,
+                                      size_t& expectedLength, bool& multiFrame, ELMPIDLengthFunction pidLength,
+                                      ELMPIDHandler handler, void* context, ELMResponse& response);
+    static uint8_t walkFrame(const uint8_t* bytes, size_t length, uint16_t ecu, ELMPIDLengthFunction pidLength, ELMPIDHandler handler, void* context, uint8_t* mode);
+
+public:
+    static ELMResponse parse(char* buffer, size_t length, ELMPIDLengthFunction pidLength, ELMPIDHandler handler, void* context);
+    static int8_t nibble(char c) { return NIBBLE[(uint8_t)c]; }
+};
+
+#endif
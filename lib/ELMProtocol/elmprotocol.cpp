@@ -0,0 +1,202 @@
+#include "elmprotocol.h"
+#include <stdio.h>
+#include <string.h>
+
+uint8_t ELMProtocol::protocol = ELM_PROTOCOL_AUTO;
+uint16_t ELMProtocol::ecuAddress = ELM_NO_HEADER;
+bool ELMProtocol::confirmed = false;
+bool ELMProtocol::changed = false;
+ELMResponder ELMProtocol::responders[ELM_PROTOCOL_MAX_RESPONDERS];
+uint8_t ELMProtocol::responderCount = 0;
+
+static const char* const protocolNames[ELM_PROTOCOL_MAX + 1] = {
+    "automatic",
+    "SAE J1850 PWM",
+    "SAE J1850 VPW",
+    "ISO 9141-2",
+    "ISO 14230-4 KWP (5 baud init)",
+    "ISO 14230-4 KWP (fast init)",
+    "ISO 15765-4 CAN (11 bit, 500 kbaud)",
+    "ISO 15765-4 CAN (29 bit, 500 kbaud)",
+    "ISO 15765-4 CAN (11 bit, 250 kbaud)",
+    "ISO 15765-4 CAN (29 bit, 250 kbaud)",
+    "SAE J1939 CAN",
+    "USER1 CAN",
+    "USER2 CAN"
+};
+
+// Unknown car: search on the next request
+void ELMProtocol::reset() {
+    protocol = ELM_PROTOCOL_AUTO;
+    ecuAddress = ELM_NO_HEADER;
+    confirmed = false;
+    responderCount = 0;
+    changed = true;
+}
+
+// The ATDPN reply: "A6" while the adapter is in automatic mode, "6" when the
+// protocol was set. An echoed "ATDPN" line is skipped.
+bool ELMProtocol::parseDescribe(const char* reply, uint8_t& number) {
+    const char* line = reply;
+    while (*line != '\0') {
+        const char* end = line;
+        while (*end != '\0' && *end != '\r' && *end != '\n') end++;
+
+        const char* p = line;
+        while (p < end && *p == ' ') p++;
+        if (p < end && *p == 'A' && end - p == 2) p++;
+        if (end - p == 1) {
+            int8_t value = ELMParser::nibble(*p);
+            if (value > ELM_PROTOCOL_AUTO && value <= ELM_PROTOCOL_MAX) {
+                number = (uint8_t)value;
+                return true;
+            }
+        }
+        line = *end != '\0' ? end + 1 : end;
+    }
+    return false;
+}
+
+// A different protocol than the cached one is another car: its ECU is unknown
+void ELMProtocol::setProtocol(uint8_t number) {
+    if (number == protocol) return;
+    protocol = number;
+    ecuAddress = ELM_NO_HEADER;
+    changed = true;
+}
+
+uint8_t ELMProtocol::getProtocol() {
+    return protocol;
+}
+
+const char* ELMProtocol::getName(uint8_t number) {
+    return number <= ELM_PROTOCOL_MAX ? protocolNames[number] : "unknown";
+}
+
+bool ELMProtocol::isCAN(uint8_t number) {
+    return number >= 6 && number <= ELM_PROTOCOL_MAX;
+}
+
+// Headers and receive filters are only set up for 11-bit IDs (7DF, 7E0-7EF)
+bool ELMProtocol::hasShortHeaders(uint8_t number) {
+    return number == 6 || number == 8;
+}
+
+void ELMProtocol::setConfirmed(bool value) {
+    confirmed = value;
+}
+
+// The adapter read the protocol back on this connection
+bool ELMProtocol::isConfirmed() {
+    return confirmed;
+}
+
+// Until the protocol is confirmed the adapter may still be searching, and a
+// K-line bus is initialised again (about 3 s) when the ECU wakes up. Writing
+// the next command would abort either, so the probe waits for them.
+unsigned long ELMProtocol::probeTimeout(unsigned long defaultMs) {
+    if (!confirmed || !isCAN(protocol)) return ELM_PROTOCOL_SEARCH_TIMEOUT_MS;
+    return defaultMs;
+}
+
+void ELMProtocol::beginDiscovery() {
+    responderCount = 0;
+}
+
+// One 0100 answer read with headers on
+void ELMProtocol::onResponder(uint16_t address, const uint8_t* bitmap) {
+    uint8_t supported = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        for (uint8_t value = bitmap[i]; value != 0; value &= value - 1) supported++;
+    }
+    for (uint8_t i = 0; i < responderCount; i++) {
+        if (responders[i].address == address) {
+            responders[i].supportedPIDs = supported;
+            return;
+        }
+    }
+    if (responderCount >= ELM_PROTOCOL_MAX_RESPONDERS) return;
+    responders[responderCount].address = address;
+    responders[responderCount].supportedPIDs = supported;
+    responderCount++;
+}
+
+// The engine ECU if it answered, otherwise the one listing the most PIDs.
+// ELM_NO_HEADER when nobody answered with a header.
+uint16_t ELMProtocol::selectECU() {
+    uint16_t selected = ELM_NO_HEADER;
+    uint8_t best = 0;
+    for (uint8_t i = 0; i < responderCount; i++) {
+        if (responders[i].address == ELM_PROTOCOL_ENGINE_ECU) {
+            selected = ELM_PROTOCOL_ENGINE_ECU;
+            break;
+        }
+        if (selected == ELM_NO_HEADER || responders[i].supportedPIDs > best) {
+            selected = responders[i].address;
+            best = responders[i].supportedPIDs;
+        }
+    }
+    if (selected != ecuAddress) {
+        ecuAddress = selected;
+        changed = true;
+    }
+    return selected;
+}
+
+uint16_t ELMProtocol::getECU() {
+    return ecuAddress;
+}
+
+uint8_t ELMProtocol::getResponderCount() {
+    return responderCount;
+}
+
+// Values printed without headers are already filtered by the adapter. With
+// headers only the selected ECU counts; while none is selected (the 0100 that
+// lists the responders) nothing is taken, so two ECUs' bitmaps never mix.
+bool ELMProtocol::acceptsFrom(uint16_t address) {
+    return address == ELM_NO_HEADER || (ecuAddress != ELM_NO_HEADER && address == ecuAddress);
+}
+
+// "ATSP0" for an unknown car, "ATSPA6" (try 6 first, search if it fails) once known
+size_t ELMProtocol::selectCommand(char* text, size_t size) {
+    int length = protocol == ELM_PROTOCOL_AUTO ? snprintf(text, size, "ATSP0") : snprintf(text, size, "ATSPA%X", protocol);
+    return length > 0 ? (size_t)length : 0;
+}
+
+// Physical request to the selected ECU: responses come from 7E8-7EF for requests to 7E0-7E7
+size_t ELMProtocol::headerCommand(char* text, size_t size) {
+    if (!hasShortHeaders(protocol) || ecuAddress == ELM_NO_HEADER) return 0;
+    int length = snprintf(text, size, "ATSH%03X", ecuAddress - 8);
+    return length > 0 ? (size_t)length : 0;
+}
+
+size_t ELMProtocol::receiveCommand(char* text, size_t size) {
+    if (!hasShortHeaders(protocol) || ecuAddress == ELM_NO_HEADER) return 0;
+    int length = snprintf(text, size, "ATCRA%03X", ecuAddress);
+    return length > 0 ? (size_t)length : 0;
+}
+
+bool ELMProtocol::takeChanged() {
+    bool result = changed;
+    changed = false;
+    return result;
+}
+
+size_t ELMProtocol::save(uint8_t* cache, size_t size) {
+    if (size < ELM_PROTOCOL_CACHE_SIZE) return 0;
+    cache[0] = ELM_PROTOCOL_CACHE_VERSION;
+    cache[1] = protocol;
+    cache[2] = ecuAddress >> 8;
+    cache[3] = ecuAddress & 0xFF;
+    return ELM_PROTOCOL_CACHE_SIZE;
+}
+
+bool ELMProtocol::restore(const uint8_t* cache, size_t length) {
+    if (length < ELM_PROTOCOL_CACHE_SIZE || cache[0] != ELM_PROTOCOL_CACHE_VERSION || cache[1] > ELM_PROTOCOL_MAX) return false;
+    protocol = cache[1];
+    ecuAddress = ((uint16_t)cache[2] << 8) | cache[3];
+    confirmed = false;
+    changed = false;
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef ELMPROTOCOL_H
+#define ELMPROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <elmparser.h>
+
+#define ELM_PROTOCOL_AUTO 0
+#define ELM_PROTOCOL_MAX 0x0C
+#define ELM_PROTOCOL_MAX_RESPONDERS 4
+#define ELM_PROTOCOL_ENGINE_ECU 0x7E8       // OBD engine ECU, answers to 7E0
+#define ELM_PROTOCOL_FUNCTIONAL_HEADER 0x7DF
+#define ELM_PROTOCOL_SEARCH_TIMEOUT_MS 10000 // protocol search or K-line bus init before the first answer
+#define ELM_PROTOCOL_CACHE_VERSION 1
+#define ELM_PROTOCOL_CACHE_SIZE 4
+
+struct ELMResponder {
+    uint16_t address;
+    uint8_t supportedPIDs;      // PIDs set in its 0100 bitmap
+};
+
+// Which OBD protocol the car speaks and, on 11-bit CAN, which ECU to talk to.
+// The first connection to a car lets the adapter search (ATSP0) and reads the
+// result back with ATDPN; from then on the cached protocol is tried first
+// (ATSPAn, still searching if it fails). On 11-bit CAN the ECUs that answer a
+// functional 0100 are listed once with headers on; the engine ECU (or the one
+// with the most PIDs) is then addressed directly (ATSH7E0) and the adapter only
+// listens to it (ATCRA7E8), so a second ECU never doubles or delays a reply.
+// Plain C++, shared by the firmware and the native build.
+class ELMProtocol {
+private:
+    static uint8_t protocol;
+    static uint16_t ecuAddress;
+    static bool confirmed;
+    static bool changed;
+    static ELMResponder responders[ELM_PROTOCOL_MAX_RESPONDERS];
+    static uint8_t responderCount;
+
+public:
+    static void reset();
+    static bool parseDescribe(const char* reply, uint8_t& number);
+    static void setProtocol(uint8_t number);
+    static uint8_t getProtocol();
+    static const char* getName(uint8_t number);
+    static bool isCAN(uint8_t number);
+    static bool hasShortHeaders(uint8_t number);
+    static void setConfirmed(bool value);
+    static bool isConfirmed();
+    static unsigned long probeTimeout(unsigned long defaultMs);
+
+    static void beginDiscovery();
+    static void onResponder(uint16_t address, const uint8_t* bitmap);
+    static uint16_t selectECU();
+    static uint16_t getECU();
+    static uint8_t getResponderCount();
+    static bool acceptsFrom(uint16_t address);
+
+    static size_t selectCommand(char* text, size_t size);
+    static size_t headerCommand(char* text, size_t size);
+    static size_t receiveCommand(char* text, size_t size);
+
+    static bool takeChanged();
+    static size_t save(uint8_t* cache, size_t size);
+    static bool restore(const uint8_t* cache, size_t length);
+};
+
+#endif
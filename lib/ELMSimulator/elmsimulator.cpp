@@ -0,0 +1,481 @@
+#include "elmsimulator.h"
+#include <string.h>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+ELMSimulator::ELMSimulator()
+    : commandLength(0), responseLength(0), now(0), dueAt(0), pending(false), echo(true), spaces(true),
+      searchPending(false), protocolSetting(0), protocolAuto(true), protocolFound(0), headers(false),
+      requestHeader(ELM_SIMULATOR_FUNCTIONAL), receiveFilter(0), adaptiveTiming(1), timeoutMs(ELM_SIMULATOR_DEFAULT_ST * 4096 / 1000), learnedReplyMs(100),
+      randomState(0x2545F491), requests(0), noDataResponses(0) {
+    config.latencyMs = 40;
+    config.jitterMs = 20;
+    config.noDataPercent = 0;
+    config.searching = true;
+    config.searchMs = 1500;
+    config.bus = ELM_SIMULATOR_CAN;
+    config.chunkSize = 20;
+    config.responseCount = true;
+    config.secondECU = false;
+
+    engine.rpm = 800;
+    engine.speedKmh = 0;
+    engine.loadPercent = 20;
+    engine.coolantC = 90;
+    engine.awake = true;
+}
+
+void ELMSimulator::configure(const ELMSimulatorConfig& simulatorConfig) {
+    config = simulatorConfig;
+    if (config.chunkSize == 0) config.chunkSize = 1;
+}
+
+void ELMSimulator::setEngine(const ELMSimulatedEngine& state) {
+    engine = state;
+}
+
+void ELMSimulator::seed(uint32_t value) {
+    randomState = value != 0 ? value : 1;
+}
+
+// xorshift32, reproducible runs for a given seed
+uint32_t ELMSimulator::nextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+// Like the real adapter, bytes are collected until '\r'. A command written
+// while the previous one is still pending is refused.
+bool ELMSimulator::write(const uint8_t* data, size_t length) {
+    if (pending) return false;
+
+    for (size_t i = 0; i < length; i++) {
+        char c = (char)data[i];
+        if (c == '\r') {
+            command[commandLength] = '\0';
+            handleCommand();
+            commandLength = 0;
+        } else if (commandLength < ELM_SIMULATOR_COMMAND_SIZE - 1) {
+            command[commandLength++] = c;
+        }
+    }
+    return true;
+}
+
+void ELMSimulator::advance(uint32_t time) {
+    now = time;
+    if (!pending || (int32_t)(now - dueAt) < 0) return;
+
+    // Delivered from a copy, the receiver may already write the next command
+    char delivered[ELM_SIMULATOR_RESPONSE_SIZE];
+    size_t length = responseLength;
+    memcpy(delivered, response, length);
+    pending = false;
+
+    for (size_t offset = 0; offset < length; offset += config.chunkSize) {
+        size_t chunk = length - offset < config.chunkSize ? length - offset : config.chunkSize;
+        deliver((const uint8_t*)delivered + offset, chunk);
+    }
+}
+
+bool ELMSimulator::isBusy() const {
+    return pending;
+}
+
+uint32_t ELMSimulator::getResponseDueAt() const {
+    return dueAt;
+}
+
+uint32_t ELMSimulator::getRequests() const {
+    return requests;
+}
+
+uint32_t ELMSimulator::getNoDataResponses() const {
+    return noDataResponses;
+}
+
+// How long the adapter waits for a reply, and for more replies after one
+uint32_t ELMSimulator::getListenTimeout() const {
+    uint32_t adaptive;
+    if (adaptiveTiming == 2) {
+        adaptive = learnedReplyMs + learnedReplyMs / 4 + 10;
+    } else if (adaptiveTiming == 1) {
+        adaptive = learnedReplyMs * 2 + 30;
+    } else {
+        return timeoutMs;
+    }
+    return adaptive < timeoutMs ? adaptive : timeoutMs;
+}
+
+void ELMSimulator::handleCommand() {
+    char text[ELM_SIMULATOR_COMMAND_SIZE];
+    size_t length = 0;
+    for (size_t i = 0; i < commandLength; i++) {
+        char c = command[i];
+        if (c == ' ') continue;
+        if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+        text[length++] = c;
+    }
+    text[length] = '\0';
+    if (length == 0) return;
+
+    responseLength = 0;
+    dueAt = now + config.latencyMs + (config.jitterMs > 0 ? nextRandom() % (config.jitterMs + 1) : 0);
+    if (echo) {
+        appendText(command);
+        appendText("\r");
+    }
+
+    if (length >= 2 && text[0] == 'A' && text[1] == 'T') {
+        // Answered by the adapter itself, the car is not involved
+        dueAt = now + ELM_SIMULATOR_AT_MS;
+        handleATCommand(text + 2);
+    } else if (length >= 4 && text[0] == '0' && text[1] == '1') {
+        handlePIDRequest(text + 2, length - 2);
+    } else {
+        appendText("?\r");
+    }
+    appendText("\r>");
+    pending = true;
+}
+
+uint8_t ELMSimulator::vehicleProtocol() const {
+    return config.bus == ELM_SIMULATOR_KLINE ? 3 : 6;
+}
+
+// Whether the ECU hears the request (ATSH) and the adapter shows its reply (ATCRA)
+bool ELMSimulator::answers(uint16_t ecu) const {
+    // ATSH7E0/ATCRA7E8 make no K-line header, the ECU stays silent
+    if (config.bus == ELM_SIMULATOR_KLINE) {
+        return ecu == ELM_SIMULATOR_ENGINE_ECU && requestHeader == ELM_SIMULATOR_FUNCTIONAL && receiveFilter == 0;
+    }
+    if (ecu == ELM_SIMULATOR_SECOND_ECU && !config.secondECU) return false;
+    if (requestHeader != ELM_SIMULATOR_FUNCTIONAL && requestHeader != ecu - 8) return false;
+    return receiveFilter == 0 || receiveFilter == ecu;
+}
+
+void ELMSimulator::handleATCommand(const char* text) {
+    if (strcmp(text, "Z") == 0 || strcmp(text, "WS") == 0) {
+        // ATWS is the same reset without the power-on self test. The protocol
+        // setting is kept (ATSP stores it), the one found has to be found again.
+        echo = true;
+        spaces = true;
+        headers = false;
+        requestHeader = ELM_SIMULATOR_FUNCTIONAL;
+        receiveFilter = 0;
+        adaptiveTiming = 1;
+        timeoutMs = ELM_SIMULATOR_DEFAULT_ST * 4096 / 1000;
+        protocolFound = protocolAuto && protocolSetting == vehicleProtocol() ? protocolSetting : 0;
+        searchPending = protocolAuto && protocolFound == 0 && config.searching;
+        dueAt += text[0] == 'Z' ? ELM_SIMULATOR_ATZ_MS : ELM_SIMULATOR_ATWS_MS;
+        appendText("\rELM327 v2.1\r");
+        return;
+    }
+
+    if (strcmp(text, "E0") == 0) {
+        echo = false;
+    } else if (strcmp(text, "E1") == 0) {
+        echo = true;
+    } else if (strcmp(text, "S0") == 0) {
+        spaces = false;
+    } else if (strcmp(text, "S1") == 0) {
+        spaces = true;
+    } else if (strcmp(text, "H0") == 0) {
+        headers = false;
+    } else if (strcmp(text, "H1") == 0) {
+        headers = true;
+    } else if (text[0] == 'S' && text[1] == 'P' && text[2] != '\0') {
+        // SP0 searches, SPAn tries n first then searches, SPn only tries n
+        bool automatic = text[2] == 'A' && text[3] != '\0';
+        int value = hexValue(text[automatic ? 3 : 2]);
+        if (value < 0 || text[automatic ? 4 : 3] != '\0') {
+            appendText("?\r");
+            return;
+        }
+        protocolSetting = (uint8_t)value;
+        protocolAuto = automatic || value == 0;
+        protocolFound = protocolSetting == vehicleProtocol() ? protocolSetting : 0;
+        searchPending = protocolAuto && protocolFound == 0 && config.searching;
+    } else if (strcmp(text, "I") == 0) {
+        appendText("ELM327 v2.1\r");
+        return;
+    } else if (strcmp(text, "DPN") == 0) {
+        char number[4] = { 'A', HEX_DIGITS[(protocolFound != 0 ? protocolFound : protocolSetting) & 0x0F], '\r', '\0' };
+        appendText(protocolAuto ? number : number + 1);
+        return;
+    } else if (text[0] == 'S' && text[1] == 'H' && hexValue(text[2]) >= 0 && hexValue(text[3]) >= 0 && hexValue(text[4]) >= 0 && text[5] == '\0') {
+        requestHeader = (uint16_t)(hexValue(text[2]) << 8 | hexValue(text[3]) << 4 | hexValue(text[4]));
+    } else if (strcmp(text, "CRA") == 0) {
+        receiveFilter = 0;
+    } else if (text[0] == 'C' && text[1] == 'R' && text[2] == 'A' && hexValue(text[3]) >= 0 && hexValue(text[4]) >= 0 && hexValue(text[5]) >= 0 && text[6] == '\0') {
+        receiveFilter = (uint16_t)(hexValue(text[3]) << 8 | hexValue(text[4]) << 4 | hexValue(text[5]));
+    } else if (text[0] == 'A' && text[1] == 'T' && text[2] >= '0' && text[2] <= '2' && text[3] == '\0') {
+        adaptiveTiming = text[2] - '0';
+    } else if (text[0] == 'S' && text[1] == 'T' && hexValue(text[2]) >= 0 && hexValue(text[3]) >= 0 && text[4] == '\0') {
+        // Units of 4.096 ms, 00 restores the default
+        uint32_t value = hexValue(text[2]) << 4 | hexValue(text[3]);
+        timeoutMs = (value != 0 ? value : ELM_SIMULATOR_DEFAULT_ST) * 4096 / 1000;
+    } else if (text[0] == '\0') {
+        appendText("?\r");
+        return;
+    }
+    // ATL, ATCAF... are accepted and change nothing here
+    appendText("OK\r");
+}
+
+// text holds the PIDs after the "01", an odd trailing digit is the number of
+// replies to wait for. dueAt holds the ECU's reply time on entry.
+void ELMSimulator::handlePIDRequest(const char* text, size_t length) {
+    requests++;
+
+    bool expectedCount = length % 2 == 1;
+    uint8_t expectedReplies = 0;
+    if (expectedCount) {
+        if (!config.responseCount || hexValue(text[length - 1]) <= 0) {
+            appendText("?\r");
+            return;
+        }
+        expectedReplies = (uint8_t)hexValue(text[length - 1]);
+        length--;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (hexValue(text[i]) < 0) {
+            appendText("?\r");
+            return;
+        }
+    }
+
+    uint32_t replyMs = dueAt - now;
+    uint32_t listenMs = getListenTimeout();
+    dueAt = now;
+    if (!protocolAuto && protocolSetting != vehicleProtocol()) {
+        // A fixed protocol the car doesn't speak never gets an answer
+        dueAt += config.searchMs;
+        appendText("UNABLE TO CONNECT\r");
+        return;
+    }
+    if (searchPending) {
+        searchPending = false;
+        dueAt += config.searchMs;
+        appendText("SEARCHING...\r");
+    }
+    protocolFound = vehicleProtocol();
+    uint32_t start = dueAt;
+
+    if (!engine.awake || (config.noDataPercent > 0 && nextRandom() % 100 < config.noDataPercent)) {
+        noDataResponses++;
+        dueAt = start + listenMs;
+        appendText("NO DATA\r");
+        return;
+    }
+
+    // The engine ECU answers first, the second ECU a little later. A reply
+    // slower than the listen window is missed.
+    static const uint16_t ecus[] = { ELM_SIMULATOR_ENGINE_ECU, ELM_SIMULATOR_SECOND_ECU };
+    uint8_t replies = 0;
+    uint32_t lastReplyMs = 0;
+    for (uint8_t e = 0; e < sizeof(ecus) / sizeof(ecus[0]); e++) {
+        if (expectedCount && replies >= expectedReplies) break;
+        uint32_t ecuReplyMs = replyMs + (e > 0 ? ELM_SIMULATOR_SECOND_ECU_DELAY_MS : 0);
+        if (!answers(ecus[e]) || ecuReplyMs > listenMs) continue;
+
+        uint8_t bytes[1 + 6 * 5];
+        size_t frameLength = buildReply(ecus[e], text, length, bytes);
+        if (frameLength <= 1) continue;
+
+        if (headers && config.bus == ELM_SIMULATOR_CAN) {
+            appendHeaderFrame(ecus[e], bytes, frameLength);
+        } else {
+            appendFrame(bytes, frameLength);
+        }
+        if (e == 0) learnedReplyMs += ((int32_t)replyMs - (int32_t)learnedReplyMs) / 4;
+        replies++;
+        lastReplyMs = ecuReplyMs;
+    }
+
+    if (replies == 0) {
+        noDataResponses++;
+        dueAt = start + listenMs;
+        appendText("NO DATA\r");
+        return;
+    }
+    // With the count the prompt follows the last expected reply, without it
+    // the adapter listens for other ECUs first
+    dueAt = start + lastReplyMs + (expectedCount && replies >= expectedReplies ? 0 : listenMs);
+}
+
+// "41" and the PID/data pairs one ECU knows, the PIDs it doesn't are left out
+size_t ELMSimulator::buildReply(uint16_t ecu, const char* text, size_t length, uint8_t* bytes) {
+    size_t frameLength = 0;
+    bytes[frameLength++] = 0x41;
+
+    uint8_t pidCount = 0;
+    for (size_t i = 0; i + 1 < length && pidCount < 6; i += 2) {
+        pidCount++;
+        if (config.bus == ELM_SIMULATOR_KLINE && pidCount > 1) continue;
+
+        uint8_t pid = (uint8_t)(hexValue(text[i]) << 4 | hexValue(text[i + 1]));
+        uint8_t data[4];
+        uint8_t dataLength = ecu == ELM_SIMULATOR_ENGINE_ECU ? pidData(pid, data) : secondECUData(pid, data);
+        if (dataLength == 0) continue;
+
+        bytes[frameLength++] = pid;
+        memcpy(bytes + frameLength, data, dataLength);
+        frameLength += dataLength;
+    }
+    return frameLength;
+}
+
+uint8_t ELMSimulator::pidData(uint8_t pid, uint8_t* data) {
+    int value;
+    switch (pid) {
+        case 0x00: {
+            // Supported PIDs 01-20, bit 7 of the first byte is PID 01
+            uint8_t scratch[4];
+            memset(data, 0, 4);
+            for (uint8_t candidate = 0x01; candidate < 0x20; candidate++) {
+                if (pidData(candidate, scratch) > 0) {
+                    data[(candidate - 1) / 8] |= 0x80 >> ((candidate - 1) % 8);
+                }
+            }
+            return 4;
+        }
+        case 0x04:
+            value = (engine.loadPercent * 255 + 50) / 100;
+            data[0] = value < 0 ? 0 : (value > 255 ? 255 : value);
+            return 1;
+        case 0x05:
+            value = engine.coolantC + 40;
+            data[0] = value < 0 ? 0 : (value > 255 ? 255 : value);
+            return 1;
+        case 0x0C:
+            value = engine.rpm < 0 ? 0 : (engine.rpm > 16383 ? 16383 : engine.rpm) * 4;
+            data[0] = value >> 8;
+            data[1] = value & 0xFF;
+            return 2;
+        case 0x0D:
+            data[0] = engine.speedKmh < 0 ? 0 : (engine.speedKmh > 255 ? 255 : engine.speedKmh);
+            return 1;
+        // Plausible rather than physical values, derived from rpm and load
+        case 0x06:
+            data[0] = 128 + (engine.rpm / 100) % 7 - 3;     // short term fuel trim, -2.3..+2.3 %
+            return 1;
+        case 0x07:
+            data[0] = 131;                                  // long term fuel trim, +2.3 %
+            return 1;
+        case 0x0B:
+            value = 25 + engine.loadPercent * 75 / 100;     // manifold pressure, kPa
+            data[0] = value < 0 ? 0 : (value > 255 ? 255 : value);
+            return 1;
+        case 0x0E:
+            value = (10 + engine.rpm / 200 - engine.loadPercent / 10 + 64) * 2;
+            data[0] = value < 0 ? 0 : (value > 255 ? 255 : value);
+            return 1;
+        case 0x0F:
+            data[0] = 25 + 40;                              // intake air 25 C
+            return 1;
+        case 0x10:
+            value = engine.rpm < 0 ? 0 : engine.rpm * engine.loadPercent / 60;   // MAF in 0.01 g/s
+            if (value > 65535) value = 65535;
+            data[0] = value >> 8;
+            data[1] = value & 0xFF;
+            return 2;
+        case 0x11:
+            value = ((engine.loadPercent - 10) * 255 + 50) / 100;
+            data[0] = value < 0 ? 0 : (value > 255 ? 255 : value);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// The transmission ECU: its own bitmap and the vehicle speed
+uint8_t ELMSimulator::secondECUData(uint8_t pid, uint8_t* data) {
+    switch (pid) {
+        case 0x00:
+            data[0] = 0x00;
+            data[1] = 0x08;     // PID 0D
+            data[2] = 0x00;
+            data[3] = 0x00;
+            return 4;
+        case 0x0D:
+            return pidData(pid, data);
+        default:
+            return 0;
+    }
+}
+
+void ELMSimulator::appendText(const char* text) {
+    while (*text != '\0' && responseLength < ELM_SIMULATOR_RESPONSE_SIZE) {
+        response[responseLength++] = *text++;
+    }
+}
+
+void ELMSimulator::appendByte(uint8_t value) {
+    char text[4] = { HEX_DIGITS[value >> 4], HEX_DIGITS[value & 0x0F], '\0', '\0' };
+    if (spaces) text[2] = ' ';
+    appendText(text);
+}
+
+// Up to 7 bytes fit one CAN frame. Longer answers are printed the way the
+// ELM327 shows ISO-TP with headers off: the byte count, then numbered segments
+// of 6 and 7 bytes, the last one padded.
+void ELMSimulator::appendFrame(const uint8_t* bytes, size_t length) {
+    if (config.bus == ELM_SIMULATOR_KLINE || length <= 7) {
+        for (size_t i = 0; i < length; i++) appendByte(bytes[i]);
+        appendText("\r");
+        return;
+    }
+
+    char count[5] = { HEX_DIGITS[(length >> 8) & 0x0F], HEX_DIGITS[(length >> 4) & 0x0F], HEX_DIGITS[length & 0x0F], '\r', '\0' };
+    appendText(count);
+
+    size_t offset = 0;
+    for (uint8_t segment = 0; offset < length; segment++) {
+        char prefix[4] = { HEX_DIGITS[segment & 0x0F], ':', ' ', '\0' };
+        appendText(prefix);
+        size_t segmentLength = segment == 0 ? 6 : 7;
+        for (size_t i = 0; i < segmentLength; i++, offset++) {
+            appendByte(offset < length ? bytes[offset] : 0x00);
+        }
+        appendText("\r");
+    }
+}
+
+// ATH1 on CAN: the 11-bit ID, then the ISO-TP frames with their PCI byte. A
+// first frame carries the length and 6 bytes, consecutive frames 7 (padded).
+void ELMSimulator::appendHeaderFrame(uint16_t ecu, const uint8_t* bytes, size_t length) {
+    char id[5] = { HEX_DIGITS[(ecu >> 8) & 0x0F], HEX_DIGITS[(ecu >> 4) & 0x0F], HEX_DIGITS[ecu & 0x0F], '\0', '\0' };
+    if (spaces) id[3] = ' ';
+
+    if (length <= 7) {
+        appendText(id);
+        appendByte((uint8_t)length);
+        for (size_t i = 0; i < length; i++) appendByte(bytes[i]);
+        appendText("\r");
+        return;
+    }
+
+    appendText(id);
+    appendByte((uint8_t)(0x10 | ((length >> 8) & 0x0F)));
+    appendByte((uint8_t)(length & 0xFF));
+    size_t offset = 0;
+    for (; offset < 6; offset++) appendByte(bytes[offset]);
+    appendText("\r");
+    for (uint8_t sequence = 1; offset < length; sequence++) {
+        appendText(id);
+        appendByte((uint8_t)(0x20 | (sequence & 0x0F)));
+        for (size_t i = 0; i < 7; i++, offset++) {
+            appendByte(offset < length ? bytes[offset] : 0x00);
+        }
+        appendText("\r");
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef ELMSIMULATOR_H
+#define ELMSIMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <elmtransport.h>
+
+#define ELM_SIMULATOR_COMMAND_SIZE 32
+#define ELM_SIMULATOR_RESPONSE_SIZE 256
+#define ELM_SIMULATOR_ATZ_MS 500
+#define ELM_SIMULATOR_ATWS_MS 100
+#define ELM_SIMULATOR_AT_MS 2
+#define ELM_SIMULATOR_DEFAULT_ST 0x32
+#define ELM_SIMULATOR_ENGINE_ECU 0x7E8
+#define ELM_SIMULATOR_SECOND_ECU 0x7E9
+#define ELM_SIMULATOR_SECOND_ECU_DELAY_MS 8
+#define ELM_SIMULATOR_FUNCTIONAL 0x7DF
+
+enum ELM_SIMULATOR_BUS {
+    ELM_SIMULATOR_CAN,      // protocol 6: up to 6 PIDs per request, ISO-TP multi-frame answers
+    ELM_SIMULATOR_KLINE     // protocol 3, ISO 9141: only the first PID of a request is answered
+};
+
+struct ELMSimulatorConfig {
+    uint32_t latencyMs;         // time from the command to the ECU's reply (AT commands: ELM_SIMULATOR_AT_MS)
+    uint32_t jitterMs;          // 0..jitterMs added at random to every response
+    uint8_t noDataPercent;      // chance a PID request is answered NO DATA
+    bool searching;             // first request after ATZ/ATSP0 prints SEARCHING...
+    uint32_t searchMs;          // extra time that first request takes
+    ELM_SIMULATOR_BUS bus;
+    uint8_t chunkSize;          // bytes per delivered piece, 20 is one BLE notification
+    bool responseCount;         // understands the "010C1" response count digit, some clones answer '?'
+    bool secondECU;             // CAN: a transmission ECU (7E9) also answers 0100 and speed
+};
+
+struct ELMSimulatedEngine {
+    int rpm;
+    int speedKmh;
+    int loadPercent;
+    int coolantC;
+    bool awake;                 // false: every PID request is NO DATA
+};
+
+// In-process ELM327 for the native build. Answers AT commands and mode 01
+// requests from an engine state the caller sets, on a simulated clock: write()
+// schedules the response, advance() delivers it once it is due.
+//
+// Like the real adapter, after a reply it keeps listening for more ECUs until
+// its timeout runs out, unless the request said how many replies to expect.
+// The timeout is ATST, shortened by adaptive timing (ATAT1/ATAT2) towards the
+// measured reply time; a reply slower than the timeout is missed (NO DATA).
+// The adaptive part is a rough model, not the ELM327's exact algorithm.
+//
+// The car speaks one protocol: ATSP0/ATSPAn search for it (ATSPAn skips the
+// search when n is right), ATSPn with the wrong n can't connect, ATDPN tells
+// the result. On CAN, ATH1 prints the 11-bit ID and the ISO-TP PCI byte,
+// ATSH picks functional (7DF) or physical (7E0, 7E1) requests and ATCRA
+// filters the replies by sender.
+class ELMSimulator : public ELMTransport {
+public:
+    ELMSimulator();
+    void configure(const ELMSimulatorConfig& config);
+    void setEngine(const ELMSimulatedEngine& state);
+    void seed(uint32_t value);
+    bool write(const uint8_t* data, size_t length) override;
+    void advance(uint32_t now);
+    bool isBusy() const;
+    uint32_t getResponseDueAt() const;
+    uint32_t getRequests() const;
+    uint32_t getNoDataResponses() const;
+    uint32_t getListenTimeout() const;
+
+private:
+    ELMSimulatorConfig config;
+    ELMSimulatedEngine engine;
+    char command[ELM_SIMULATOR_COMMAND_SIZE];
+    size_t commandLength;
+    char response[ELM_SIMULATOR_RESPONSE_SIZE];
+    size_t responseLength;
+    uint32_t now;
+    uint32_t dueAt;
+    bool pending;
+    bool echo;
+    bool spaces;
+    bool searchPending;
+    uint8_t protocolSetting;
+    bool protocolAuto;
+    uint8_t protocolFound;
+    bool headers;
+    uint16_t requestHeader;
+    uint16_t receiveFilter;
+    uint8_t adaptiveTiming;
+    uint32_t timeoutMs;
+    uint32_t learnedReplyMs;
+    uint32_t randomState;
+    uint32_t requests;
+    uint32_t noDataResponses;
+
+    uint32_t nextRandom();
+    void handleCommand();
+    void handleATCommand(const char* text);
+    void handlePIDRequest(const char* text, size_t length);
+    uint8_t vehicleProtocol() const;
+    bool answers(uint16_t ecu) const;
+    size_t buildReply(uint16_t ecu, const char* text, size_t length, uint8_t* bytes);
+    uint8_t pidData(uint8_t pid, uint8_t* data);
+    uint8_t secondECUData(uint8_t pid, uint8_t* data);
+    void appendText(const char* text);
+    void appendByte(uint8_t value);
+    void appendFrame(const uint8_t* bytes, size_t length);
+    void appendHeaderFrame(uint16_t ecu, const uint8_t* bytes, size_t length);
+};
+
+#endif
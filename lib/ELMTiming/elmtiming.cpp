@@ -0,0 +1,195 @@
+#include "elmtiming.h"
+#include <stdio.h>
+#include <string.h>
+
+ELMLatencyWindow ELMTiming::windows[ELM_TIMING_MAX_PIDS];
+uint8_t ELMTiming::windowCount = 0;
+uint32_t ELMTiming::samplesSinceTune = 0;
+uint32_t ELMTiming::missesSinceTune = 0;
+uint8_t ELMTiming::timeoutSetting = ELM_TIMING_DEFAULT_ST;
+uint8_t ELMTiming::adaptiveTiming = 1;
+bool ELMTiming::aggressiveFailed = false;
+uint8_t ELMTiming::timeoutFloor = ELM_TIMING_MIN_ST;
+uint16_t ELMTiming::pooled[ELM_TIMING_MAX_PIDS * ELM_TIMING_WINDOW];
+
+// After ATZ/connect: the adapter is back to its defaults and the ATAT1 of the
+// init sequence. What was learned about the ECU is kept.
+void ELMTiming::reset() {
+    timeoutSetting = ELM_TIMING_DEFAULT_ST;
+    adaptiveTiming = 1;
+    aggressiveFailed = false;
+    timeoutFloor = ELM_TIMING_MIN_ST;
+    samplesSinceTune = 0;
+    missesSinceTune = 0;
+}
+
+// Another car: the round trips learned so far say nothing about its ECU
+void ELMTiming::clear() {
+    windowCount = 0;
+    reset();
+}
+
+ELMLatencyWindow* ELMTiming::find(uint8_t pid) {
+    for (uint8_t i = 0; i < windowCount; i++) {
+        if (windows[i].pid == pid) return &windows[i];
+    }
+    if (windowCount >= ELM_TIMING_MAX_PIDS) return nullptr;
+    ELMLatencyWindow& window = windows[windowCount++];
+    memset(&window, 0, sizeof(window));
+    window.pid = pid;
+    return &window;
+}
+
+// Nearest-rank percentile, sorts the samples in place
+uint16_t ELMTiming::percentile(uint16_t* samples, uint8_t count, uint8_t percent) {
+    for (uint8_t i = 1; i < count; i++) {
+        uint16_t value = samples[i];
+        uint8_t j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    uint16_t rank = (count * percent + 99) / 100;
+    return samples[rank > 0 ? rank - 1 : 0];
+}
+
+void ELMTiming::addSample(ELMLatencyWindow& window, uint32_t elapsedMs) {
+    window.samplesMs[window.next] = elapsedMs > 0xFFFF ? 0xFFFF : elapsedMs;
+    window.next = (window.next + 1) % ELM_TIMING_WINDOW;
+    if (window.count < ELM_TIMING_WINDOW) window.count++;
+
+    uint16_t sorted[ELM_TIMING_WINDOW];
+    memcpy(sorted, window.samplesMs, window.count * sizeof(uint16_t));
+    window.p99Ms = percentile(sorted, window.count, 99);
+}
+
+// A batch took elapsedMs for each of its PIDs
+void ELMTiming::recordReply(const uint8_t* pids, uint8_t count, uint32_t elapsedMs) {
+    for (uint8_t i = 0; i < count; i++) {
+        ELMLatencyWindow* window = find(pids[i]);
+        if (window != nullptr) addSample(*window, elapsedMs);
+    }
+    samplesSinceTune++;
+}
+
+// NO DATA says nothing about the reply time. A timeout goes in as a sample
+// of its own length, so a timeout that was too short grows the next one.
+void ELMTiming::recordMiss(const uint8_t* pids, uint8_t count, uint32_t elapsedMs, bool timedOut) {
+    if (timedOut) {
+        for (uint8_t i = 0; i < count; i++) {
+            ELMLatencyWindow* window = find(pids[i]);
+            if (window != nullptr) addSample(*window, elapsedMs);
+        }
+    }
+    missesSinceTune++;
+}
+
+// 1.5 x the slowest PID's p99 plus a margin for BLE scheduling, and never
+// shorter than the adapter's own ATST wait (its NO DATA has to arrive first)
+uint32_t ELMTiming::timeoutFor(const uint8_t* pids, uint8_t count, uint32_t fallbackMs) {
+    uint32_t p99 = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        ELMLatencyWindow* window = find(pids[i]);
+        if (window == nullptr || window->count < ELM_TIMING_MIN_SAMPLES) return fallbackMs;
+        if (window->p99Ms > p99) p99 = window->p99Ms;
+    }
+
+    uint32_t timeout = p99 + p99 / 2 + 50;
+    uint32_t listenMs = timeoutSetting * 4096UL / 1000 + 50;
+    if (timeout < listenMs) timeout = listenMs;
+    if (timeout < ELM_TIMING_MIN_TIMEOUT_MS) timeout = ELM_TIMING_MIN_TIMEOUT_MS;
+    return timeout < fallbackMs ? timeout : fallbackMs;
+}
+
+// Sorts in the static pool, only the engine task retunes
+uint16_t ELMTiming::pooledPercentile(uint8_t percent) {
+    uint16_t count = 0;
+    for (uint8_t i = 0; i < windowCount; i++) {
+        memcpy(pooled + count, windows[i].samplesMs, windows[i].count * sizeof(uint16_t));
+        count += windows[i].count;
+    }
+    if (count == 0) return 0;
+
+    // Shell sort, the pool is up to 512 samples and this runs once per retune
+    for (uint16_t gap = count / 2; gap > 0; gap /= 2) {
+        for (uint16_t i = gap; i < count; i++) {
+            uint16_t value = pooled[i];
+            uint16_t j = i;
+            for (; j >= gap && pooled[j - gap] > value; j -= gap) pooled[j] = pooled[j - gap];
+            pooled[j] = value;
+        }
+    }
+    uint32_t rank = ((uint32_t)count * percent + 99) / 100;
+    return pooled[rank > 0 ? rank - 1 : 0];
+}
+
+// One adjustment per ELM_TIMING_RETUNE_SAMPLES round trips, written into text
+// as an AT command for the caller to send. Returns false when nothing changes.
+bool ELMTiming::nextTuningCommand(char* text, size_t size) {
+    if (samplesSinceTune + missesSinceTune < ELM_TIMING_RETUNE_SAMPLES) return false;
+
+    uint32_t missPercent = missesSinceTune * 100 / (samplesSinceTune + missesSinceTune);
+    samplesSinceTune = 0;
+    missesSinceTune = 0;
+
+    uint16_t p50 = pooledPercentile(50);
+    uint16_t p99 = pooledPercentile(99);
+    uint32_t listenMs = timeoutSetting * 4096UL / 1000;
+
+    if (missPercent > ELM_TIMING_MISS_PERCENT) {
+        // Replies are being missed: undo the aggressive timing first, then listen
+        // longer, but only if the replies come close to the end of the window or
+        // hardly any arrive. Otherwise the ECU itself answers NO DATA and waiting
+        // longer won't help.
+        if (adaptiveTiming == 2) {
+            adaptiveTiming = 1;
+            aggressiveFailed = true;
+            snprintf(text, size, "ATAT1");
+            return true;
+        }
+        if (timeoutSetting < 0xFF && ((uint32_t)p99 * 3 > listenMs * 2 || missPercent >= 50)) {
+            uint16_t longer = timeoutSetting + timeoutSetting / 2 + 1;
+            timeoutSetting = longer > 0xFF ? 0xFF : longer;
+            timeoutFloor = timeoutSetting;
+            snprintf(text, size, "ATST%02X", timeoutSetting);
+            return true;
+        }
+        return false;
+    }
+
+    // Listen for twice the slowest usual reply, in the adapter's 4.096 ms units
+    uint32_t units = ((uint32_t)p99 * 2 * 1000 + 4095) / 4096;
+    if (units < timeoutFloor) units = timeoutFloor;
+    if (units > 0xFF) units = 0xFF;
+    uint32_t difference = units > timeoutSetting ? units - timeoutSetting : timeoutSetting - units;
+    if (difference * 10 > timeoutSetting) {
+        timeoutSetting = units;
+        snprintf(text, size, "ATST%02X", timeoutSetting);
+        return true;
+    }
+
+    // A steady ECU (narrow spread, nothing missed) gets the aggressive adaptive timing
+    if (adaptiveTiming == 1 && !aggressiveFailed && missPercent == 0 && p99 <= p50 * 2) {
+        adaptiveTiming = 2;
+        snprintf(text, size, "ATAT2");
+        return true;
+    }
+    return false;
+}
+
+uint16_t ELMTiming::getPercentile(uint8_t pid, uint8_t percent) {
+    for (uint8_t i = 0; i < windowCount; i++) {
+        if (windows[i].pid != pid) continue;
+        uint16_t sorted[ELM_TIMING_WINDOW];
+        memcpy(sorted, windows[i].samplesMs, windows[i].count * sizeof(uint16_t));
+        return windows[i].count > 0 ? percentile(sorted, windows[i].count, percent) : 0;
+    }
+    return 0;
+}
+
+uint8_t ELMTiming::getTimeoutSetting() {
+    return timeoutSetting;
+}
+
+uint8_t ELMTiming::getAdaptiveTiming() {
+    return adaptiveTiming;
+}
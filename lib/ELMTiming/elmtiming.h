@@ -0,0 +1,59 @@
+#ifndef ELMTIMING_H
+#define ELMTIMING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ELM_TIMING_MAX_PIDS 16
+#define ELM_TIMING_WINDOW 32            // latest round trips kept per PID
+#define ELM_TIMING_MIN_SAMPLES 16       // before that the caller's fixed timeout is used
+#define ELM_TIMING_MIN_TIMEOUT_MS 100
+#define ELM_TIMING_RETUNE_SAMPLES 64    // round trips between two ATST/ATAT decisions
+#define ELM_TIMING_MISS_PERCENT 5       // NO DATA/timeouts that make the timing back off
+#define ELM_TIMING_DEFAULT_ST 0x32      // ELM327 power-on ATST, in 4.096 ms units
+#define ELM_TIMING_MIN_ST 0x08
+
+struct ELMLatencyWindow {
+    uint8_t pid;
+    uint8_t next;
+    uint8_t count;
+    uint16_t samplesMs[ELM_TIMING_WINDOW];
+    uint16_t p99Ms;
+};
+
+// Learns how fast the ECU answers and tunes the adapter to it. Every PID keeps
+// its latest round trips; the p99 sets the timeout of the next request for it
+// and the pooled percentiles drive ATST (how long the adapter listens) and the
+// ATAT1 -> ATAT2 step. Misses (NO DATA, timeouts) above ELM_TIMING_MISS_PERCENT
+// undo the last step; a step that had to be undone (ATAT2, a shorter ATST) is
+// not tried again until the next connection. Plain C++, shared by the firmware and the native build.
+class ELMTiming {
+private:
+    static ELMLatencyWindow windows[ELM_TIMING_MAX_PIDS];
+    static uint8_t windowCount;
+    static uint32_t samplesSinceTune;
+    static uint32_t missesSinceTune;
+    static uint8_t timeoutSetting;
+    static uint8_t adaptiveTiming;
+    static bool aggressiveFailed;
+    static uint8_t timeoutFloor;
+    static uint16_t pooled[ELM_TIMING_MAX_PIDS * ELM_TIMING_WINDOW];   // 1 KB, too much for the engine task's stack
+
+    static ELMLatencyWindow* find(uint8_t pid);
+    static void addSample(ELMLatencyWindow& window, uint32_t elapsedMs);
+    static uint16_t percentile(uint16_t* samples, uint8_t count, uint8_t percent);
+    static uint16_t pooledPercentile(uint8_t percent);
+
+public:
+    static void reset();
+    static void clear();
+    static void recordReply(const uint8_t* pids, uint8_t count, uint32_t elapsedMs);
+    static void recordMiss(const uint8_t* pids, uint8_t count, uint32_t elapsedMs, bool timedOut);
+    static uint32_t timeoutFor(const uint8_t* pids, uint8_t count, uint32_t fallbackMs);
+    static bool nextTuningCommand(char* text, size_t size);
+    static uint16_t getPercentile(uint8_t pid, uint8_t percent);
+    static uint8_t getTimeoutSetting();
+    static uint8_t getAdaptiveTiming();
+};
+
+#endif
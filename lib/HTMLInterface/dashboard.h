@@ -0,0 +1,155 @@
+// Generated by tools/embed_dashboard.py from web/dashboard.html, do not edit.
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include <Arduino.h>
+
+#define DASHBOARD_ETAG "\"a6b219580f1967d0\""
+#define DASHBOARD_HTML_GZ_LENGTH 2257
+
+static const uint8_t DASHBOARD_HTML_GZ[] PROGMEM = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xad, 0x58, 0x5b, 0x6f, 0xe3, 0xb8,
+    0x15, 0x7e, 0xf7, 0xaf, 0x60, 0x31, 0xd8, 0x95, 0x8d, 0xda, 0xb2, 0x1d, 0x27, 0xd9, 0xac, 0x63,
+    0xbb, 0xf0, 0x66, 0x9c, 0x36, 0x85, 0xe7, 0xb2, 0x71, 0x66, 0x0b, 0xec, 0x60, 0x51, 0xd0, 0x12,
+    0x6d, 0xb1, 0x23, 0x91, 0x5a, 0x92, 0xb2, 0x93, 0x2e, 0xf2, 0x47, 0xfa, 0xd6, 0xf6, 0xa1, 0xe8,
+    0x43, 0x7f, 0x45, 0xfe, 0x58, 0xcf, 0xa1, 0x2e, 0x96, 0x6c, 0xd9, 0x1b, 0x14, 0x45, 0x90, 0x44,
+    0xe2, 0xb9, 0xf2, 0x5c, 0x3e, 0x1e, 0x6a, 0x14, 0x98, 0x28, 0x9c, 0x8c, 0x02, 0x46, 0xfd, 0xc9,
+    0x28, 0x62, 0x86, 0x12, 0x2f, 0xa0, 0x4a, 0x33, 0x33, 0x76, 0x3e, 0x3d, 0xdc, 0x76, 0xae, 0x9c,
+    0x6c, 0x55, 0xd0, 0x88, 0x8d, 0x9d, 0x0d, 0x67, 0xdb, 0x58, 0x2a, 0xe3, 0x10, 0x4f, 0x0a, 0xc3,
+    0x04, 0x70, 0x6d, 0xb9, 0x6f, 0x82, 0xb1, 0xcf, 0x36, 0xdc, 0x63, 0x1d, 0xfb, 0xd2, 0x26, 0x5c,
+    0x70, 0xc3, 0x69, 0xd8, 0xd1, 0x1e, 0x0d, 0xd9, 0xb8, 0xef, 0xf6, 0x9c, 0x49, 0x63, 0xa4, 0xcd,
+    0x53, 0xc8, 0x26, 0x8d, 0xa5, 0xf4, 0x9f, 0xc8, 0x2f, 0x64, 0x05, 0xf2, 0x9d, 0x15, 0x8d, 0x78,
+    0xf8, 0x34, 0x24, 0x1d, 0x1a, 0xc7, 0x21, 0xeb, 0xe8, 0x27, 0x6d, 0x58, 0xd4, 0x26, 0x9a, 0x0a,
+    0xdd, 0xd1, 0x4c, 0xf1, 0xd5, 0x35, 0x59, 0x52, 0xef, 0xcb, 0x5a, 0xc9, 0x44, 0xf8, 0x43, 0xf2,
+    0xa6, 0xef, 0xc1, 0x0f, 0xbb, 0x06, 0xe3, 0xa1, 0x54, 0x43, 0xb2, 0x0d, 0xb8, 0x81, 0x37, 0xc3,
+    0x1e, 0x4d, 0x87, 0x86, 0x7c, 0x2d, 0x86, 0xc4, 0x03, 0x9f, 0x98, 0xba, 0x26, 0x31, 0xf5, 0x7d,
+    0x2e, 0xd6, 0x43, 0x72, 0xd6, 0x8b, 0x1f, 0xaf, 0xc9, 0x73, 0xc3, 0xf5, 0xa8, 0xf2, 0xc1, 0x6e,
+    0x45, 0xdf, 0x99, 0x07, 0x3f, 0xec, 0x80, 0x7b, 0x29, 0x95, 0xcf, 0x54, 0x47, 0x51, 0x9f, 0x27,
+    0x3a, 0x5f, 0x8c, 0xa8, 0x5a, 0x73, 0xd1, 0x59, 0x4a, 0x63, 0x64, 0xb4, 0xe3, 0x7c, 0xec, 0xe8,
+    0x80, 0xfa, 0x72, 0x3b, 0x24, 0x3d, 0x72, 0x1e, 0x3f, 0x92, 0xfe, 0x05, 0xfc, 0x51, 0xeb, 0x25,
+    0x6d, 0xf6, 0xda, 0xf6, 0xc7, 0x1d, 0xb4, 0xac, 0xfd, 0x90, 0x1b, 0x25, 0x75, 0xbe, 0x73, 0xcd,
+    0xff, 0xca, 0x86, 0xe4, 0xfc, 0x0a, 0x95, 0xd8, 0x85, 0x2d, 0xe3, 0xeb, 0xc0, 0x0c, 0x41, 0x63,
+    0xe8, 0x17, 0x1b, 0x7c, 0x33, 0xe8, 0xf9, 0xfd, 0x8b, 0x2b, 0x94, 0x5f, 0x26, 0x60, 0x57, 0x80,
+    0xb8, 0x0d, 0xf1, 0x90, 0xf4, 0x7b, 0xbd, 0xaf, 0x4a, 0x8e, 0xa3, 0xd9, 0xdc, 0x47, 0x24, 0x82,
+    0x13, 0xbd, 0x7c, 0x23, 0x43, 0x22, 0xa4, 0x60, 0x07, 0xdb, 0xea, 0x9f, 0x15, 0xc6, 0x53, 0x6f,
+    0xfa, 0x47, 0xbd, 0x49, 0x94, 0x46, 0x77, 0x62, 0xc9, 0xd3, 0xe8, 0xc2, 0x76, 0x96, 0x46, 0x74,
+    0x14, 0x83, 0x3a, 0xd9, 0x8f, 0xe9, 0x6a, 0x35, 0x58, 0x0e, 0x7a, 0xfb, 0x39, 0xca, 0x24, 0xc0,
+    0xdd, 0x7d, 0xfe, 0x5e, 0xef, 0x1b, 0xba, 0x5a, 0x1d, 0xe1, 0xd7, 0x74, 0xc3, 0xf6, 0x05, 0x06,
+    0xe7, 0xde, 0x37, 0x17, 0xdf, 0x1e, 0x0a, 0x70, 0x11, 0x27, 0xe6, 0x78, 0x80, 0xce, 0x6a, 0x32,
+    0x7b, 0xb5, 0x5b, 0x03, 0x0e, 0x88, 0x99, 0x96, 0x21, 0xf7, 0xc1, 0x04, 0x85, 0x1f, 0xef, 0x55,
+    0xc5, 0x97, 0x95, 0x85, 0x91, 0x71, 0x1a, 0xf6, 0x6a, 0x44, 0x2f, 0xd3, 0xe2, 0x1b, 0x75, 0xd3,
+    0xe2, 0x1f, 0x75, 0xd3, 0x3e, 0xc3, 0x1e, 0x80, 0x8e, 0x08, 0xfa, 0x93, 0x5b, 0xce, 0x34, 0x74,
+    0xd7, 0xc2, 0x28, 0xc6, 0x0c, 0x90, 0xfb, 0xb0, 0xec, 0xf3, 0x0d, 0xf1, 0x42, 0xaa, 0xf5, 0xd8,
+    0xc1, 0xa2, 0x75, 0xb2, 0x25, 0xab, 0x62, 0xec, 0x94, 0xd4, 0x0f, 0xce, 0xea, 0x13, 0x06, 0x3d,
+    0xab, 0x63, 0x2a, 0x08, 0xf7, 0xc7, 0x8e, 0x8a, 0x23, 0x67, 0xd2, 0xe9, 0x80, 0x07, 0xb0, 0x32,
+    0x21, 0xf7, 0x1f, 0xdf, 0x8d, 0xba, 0xa0, 0xed, 0xa8, 0xce, 0xb3, 0x73, 0xd4, 0x99, 0xd7, 0x5f,
+    0x96, 0x9c, 0xb2, 0x42, 0x1d, 0x33, 0xe6, 0x97, 0x55, 0x7e, 0x89, 0xba, 0x41, 0x8d, 0xce, 0x5c,
+    0xc5, 0x15, 0xbb, 0x62, 0xdf, 0x0e, 0x40, 0xc5, 0x0d, 0x44, 0x8a, 0x92, 0x9d, 0xa2, 0x50, 0xd2,
+    0xb2, 0x9e, 0xaf, 0xc8, 0xd7, 0x11, 0xf7, 0x7d, 0x69, 0xae, 0xc9, 0x3b, 0x69, 0xa4, 0x2a, 0x71,
+    0x7a, 0x52, 0x86, 0x54, 0x98, 0x12, 0xf3, 0xd7, 0x3e, 0x5b, 0x5f, 0xdf, 0xe4, 0x56, 0x4b, 0xc6,
+    0x0f, 0xe3, 0x36, 0xb9, 0x91, 0xd1, 0x32, 0xd1, 0xe6, 0xe5, 0x3f, 0x1b, 0x16, 0x92, 0x99, 0x36,
+    0x3c, 0x82, 0x7e, 0xad, 0x91, 0x49, 0x1b, 0xb4, 0xbc, 0xd5, 0x55, 0xc2, 0xc2, 0x92, 0xd1, 0x79,
+    0x49, 0x68, 0x8f, 0xeb, 0x23, 0x53, 0x88, 0x3c, 0x95, 0xed, 0xf8, 0x92, 0x18, 0x2a, 0x7e, 0x4e,
+    0xd8, 0x9e, 0x9b, 0x2b, 0xa9, 0x22, 0x42, 0x3d, 0xc3, 0xa5, 0x18, 0x3b, 0x5d, 0xdb, 0x43, 0x0e,
+    0x01, 0x8c, 0x0d, 0x24, 0x28, 0xfb, 0xf8, 0x61, 0xf1, 0x00, 0x2e, 0x64, 0xdd, 0x9e, 0x79, 0x56,
+    0xf4, 0x9a, 0x33, 0xb9, 0x9f, 0x2d, 0x66, 0x0f, 0xa4, 0xf9, 0x30, 0x7d, 0xff, 0xfd, 0xa7, 0x19,
+    0xb9, 0xf9, 0xc3, 0xec, 0xee, 0x43, 0x6b, 0xd4, 0x4d, 0xd9, 0xa1, 0xbc, 0x50, 0xf7, 0x81, 0x09,
+    0x68, 0x81, 0x7e, 0xef, 0x15, 0x26, 0x80, 0xcf, 0x99, 0x4c, 0xdf, 0xde, 0xdd, 0xdc, 0x7d, 0x78,
+    0x3f, 0xbd, 0x87, 0x6a, 0x26, 0xf3, 0xbb, 0x87, 0xfb, 0x0f, 0x8b, 0x43, 0xfd, 0x35, 0x91, 0x0e,
+    0x06, 0x90, 0xe0, 0x90, 0x2f, 0x15, 0x55, 0xe4, 0x46, 0x0a, 0x9d, 0x44, 0x10, 0x63, 0x58, 0x6c,
+    0x8c, 0xe2, 0x9a, 0x2a, 0xeb, 0x0f, 0xca, 0x55, 0x96, 0x95, 0xc8, 0x3e, 0xc4, 0xda, 0x76, 0x72,
+    0x26, 0xdf, 0x27, 0x90, 0x7b, 0x49, 0x20, 0xbc, 0xd0, 0x89, 0xc4, 0x67, 0x64, 0x4d, 0xb1, 0x4d,
+    0x05, 0x9c, 0x49, 0x12, 0x20, 0x49, 0x1b, 0xf9, 0xbb, 0x51, 0x37, 0x3e, 0xd8, 0xf5, 0x0a, 0x9e,
+    0xa4, 0xca, 0x7c, 0xc2, 0xb5, 0xfd, 0x08, 0x34, 0x46, 0x29, 0x62, 0x98, 0xa7, 0x18, 0x9c, 0x13,
+    0x49, 0xb4, 0x64, 0xca, 0x01, 0x5f, 0x59, 0x3c, 0x76, 0x7a, 0x6e, 0xaf, 0xef, 0x64, 0x67, 0x1e,
+    0xd4, 0x05, 0x53, 0xfa, 0xcf, 0x3a, 0x81, 0x33, 0x8a, 0x43, 0xe9, 0x93, 0x38, 0xa4, 0x1e, 0x0b,
+    0xa0, 0xd1, 0x98, 0x1a, 0x3b, 0xb3, 0x47, 0x80, 0x71, 0xf7, 0x1c, 0xe2, 0xab, 0xd8, 0xcf, 0x09,
+    0x57, 0xcc, 0x07, 0xc5, 0x87, 0xb1, 0x45, 0x20, 0x83, 0x16, 0x98, 0xce, 0x6f, 0x3e, 0xcd, 0x21,
+    0xb6, 0x33, 0x32, 0x7d, 0xf8, 0x34, 0x9d, 0xdf, 0xfd, 0x38, 0xbd, 0xaf, 0x8f, 0x6e, 0x16, 0xb2,
+    0x0a, 0xba, 0x5c, 0xec, 0xa3, 0x4b, 0xbf, 0x1c, 0xc4, 0xcb, 0xcb, 0x4b, 0x08, 0xd6, 0x2d, 0xc5,
+    0xd6, 0xa1, 0x26, 0xa1, 0xe1, 0xb0, 0xd4, 0x41, 0x69, 0x30, 0x4a, 0xe5, 0xf9, 0xeb, 0xad, 0x03,
+    0xb9, 0x7b, 0x50, 0x3c, 0x26, 0xcd, 0x1f, 0x38, 0x5d, 0xb3, 0x88, 0x4c, 0x51, 0x67, 0x2b, 0xcb,
+    0x69, 0x4d, 0x9f, 0x17, 0x50, 0xf1, 0x96, 0x43, 0xb3, 0xfd, 0x43, 0x78, 0x9c, 0x96, 0x3d, 0xf0,
+    0x61, 0x95, 0x0a, 0x8f, 0x55, 0x91, 0xe3, 0x04, 0x6e, 0x64, 0x47, 0x9f, 0x33, 0xf9, 0x3d, 0x85,
+    0x14, 0x97, 0x55, 0x19, 0x70, 0xeb, 0xb6, 0xda, 0x9a, 0x64, 0xfe, 0x1a, 0x54, 0x2b, 0x45, 0x33,
+    0xab, 0xad, 0x77, 0x2f, 0xff, 0xf6, 0xab, 0x7e, 0x7e, 0x89, 0xa0, 0x97, 0xe7, 0x98, 0xf2, 0x3d,
+    0x8c, 0x9b, 0xbf, 0x06, 0xe3, 0x5e, 0xfe, 0x16, 0x02, 0xbe, 0x48, 0x12, 0x71, 0x91, 0x40, 0xcd,
+    0xd6, 0xa9, 0xed, 0x57, 0xf0, 0xb8, 0xc0, 0xbc, 0x54, 0x92, 0x92, 0x40, 0x2a, 0x5a, 0x2f, 0x17,
+    0x1c, 0x73, 0xa8, 0x06, 0x50, 0x30, 0x73, 0xaf, 0xec, 0xf8, 0x7c, 0x2f, 0xa5, 0xb3, 0xee, 0xcd,
+    0xc5, 0xd5, 0xc5, 0xa5, 0x7f, 0xe9, 0x4c, 0x7e, 0x9c, 0xdd, 0x43, 0xb1, 0x3e, 0xdc, 0xdf, 0x7d,
+    0x3c, 0x59, 0xa5, 0xbf, 0xd6, 0xd8, 0x00, 0x5b, 0x6c, 0x0d, 0xf9, 0x57, 0x92, 0xf8, 0x94, 0x6c,
+    0x6c, 0x3d, 0x41, 0xcc, 0x61, 0xb3, 0x8a, 0xad, 0xc0, 0x65, 0x4c, 0xa8, 0xeb, 0xe9, 0x8d, 0x73,
+    0x50, 0x53, 0xf4, 0xea, 0xdc, 0xd6, 0xd4, 0xcd, 0xe2, 0x87, 0x51, 0x97, 0x96, 0xc2, 0xb5, 0x27,
+    0xfc, 0x17, 0x8d, 0xfd, 0x7d, 0x4c, 0xfa, 0x8f, 0x8b, 0x0f, 0xef, 0x51, 0xfc, 0x55, 0x45, 0x0f,
+    0x27, 0x04, 0x85, 0xc3, 0x02, 0xce, 0x09, 0x8f, 0xea, 0xac, 0xdc, 0x0d, 0x5d, 0x86, 0x2c, 0x57,
+    0x5f, 0x99, 0x2f, 0xca, 0x5b, 0x3f, 0xaf, 0xdd, 0x3a, 0x48, 0xab, 0xc9, 0xc8, 0x04, 0x60, 0x1d,
+    0xff, 0xc0, 0x2f, 0x96, 0x7d, 0xf6, 0x38, 0x2f, 0x2d, 0x76, 0x2b, 0x2f, 0x41, 0xf1, 0xf2, 0x91,
+    0x2a, 0x7b, 0x60, 0xa5, 0x2a, 0x54, 0xae, 0xd0, 0x9f, 0xdc, 0xad, 0x05, 0x7f, 0xf9, 0xd7, 0xcb,
+    0x3f, 0x91, 0xe6, 0xe3, 0x4a, 0xda, 0x68, 0x8a, 0x6f, 0x58, 0xa7, 0xda, 0x6e, 0x07, 0xe4, 0xdd,
+    0xc9, 0x76, 0x40, 0xda, 0x6f, 0x80, 0x03, 0x06, 0xba, 0x59, 0x2f, 0x76, 0x33, 0xc0, 0x01, 0x99,
+    0xfb, 0x61, 0xc9, 0x6a, 0xc5, 0x61, 0xac, 0xca, 0x8a, 0x04, 0xe6, 0xee, 0xb8, 0xab, 0x96, 0x5a,
+    0xeb, 0xa9, 0xa5, 0x9c, 0x70, 0xd4, 0xd2, 0x8f, 0xfa, 0x69, 0xa9, 0xa7, 0xdc, 0xcc, 0x4e, 0xed,
+    0xb2, 0x08, 0x15, 0x5f, 0x4e, 0x38, 0x8a, 0xd4, 0x7a, 0x47, 0x91, 0x72, 0xca, 0x51, 0xa4, 0x1f,
+    0x77, 0x14, 0xa9, 0xa7, 0x1c, 0x95, 0x86, 0x86, 0x55, 0x09, 0x5c, 0x39, 0xe1, 0xa8, 0x25, 0xd7,
+    0x7b, 0x6a, 0x49, 0xa7, 0x5c, 0xb5, 0x0c, 0xc7, 0x7d, 0xb5, 0xe4, 0x3a, 0x67, 0xbb, 0xb6, 0x7b,
+    0x4e, 0x9c, 0x6b, 0x07, 0x53, 0x73, 0x3d, 0x86, 0x94, 0x11, 0x72, 0x88, 0x83, 0x2c, 0x89, 0x10,
+    0xbd, 0xcb, 0x28, 0x0b, 0xc3, 0x6e, 0x15, 0x26, 0x0b, 0xbc, 0x88, 0x5e, 0xfe, 0xfe, 0xe8, 0x92,
+    0xbd, 0x29, 0xf6, 0x1d, 0x7d, 0x3c, 0x40, 0xd5, 0x60, 0x0f, 0x24, 0xb4, 0x07, 0xd5, 0x62, 0x26,
+    0x8d, 0x55, 0x22, 0x2c, 0xc2, 0x12, 0x40, 0xd7, 0x26, 0xf7, 0xdb, 0xf6, 0xd6, 0xd9, 0x82, 0xeb,
+    0x86, 0x2f, 0xbd, 0x24, 0x82, 0xe1, 0xc4, 0x5d, 0x33, 0x33, 0x0b, 0x19, 0x3e, 0x7e, 0xf7, 0x74,
+    0xe7, 0x03, 0x4f, 0xcb, 0x45, 0x9e, 0x9b, 0xf4, 0xa2, 0x4c, 0xc6, 0x56, 0x02, 0x6f, 0x03, 0x3b,
+    0x55, 0x81, 0xdc, 0x36, 0x35, 0x28, 0x69, 0xa0, 0x52, 0x3b, 0xaa, 0xc3, 0xe5, 0xd7, 0x85, 0xff,
+    0xad, 0xeb, 0x74, 0x29, 0x1d, 0xb6, 0x71, 0xd1, 0x3e, 0xe5, 0xcb, 0x76, 0x74, 0xc6, 0x55, 0x7c,
+    0xc8, 0x17, 0xf3, 0x29, 0x19, 0xd7, 0xb3, 0xe7, 0x9c, 0x64, 0x33, 0x8e, 0xeb, 0xf8, 0xe0, 0x1a,
+    0x79, 0xcb, 0x1f, 0x99, 0xdf, 0xec, 0xb7, 0xca, 0xf4, 0x7c, 0x84, 0xcd, 0xd9, 0xb2, 0xf7, 0x82,
+    0xbb, 0xb7, 0xe3, 0x4e, 0x87, 0x09, 0xcb, 0x68, 0x1f, 0x77, 0x1a, 0xcf, 0x0a, 0xa6, 0xa2, 0x06,
+    0x91, 0x2d, 0x7f, 0x29, 0x18, 0x77, 0x7c, 0xc5, 0x61, 0x8e, 0x7c, 0xf9, 0x4b, 0xc1, 0x37, 0x28,
+    0xf8, 0x4a, 0x95, 0x89, 0x9c, 0xbb, 0xd7, 0x9a, 0xed, 0x54, 0x0e, 0xdb, 0x2a, 0x77, 0x3f, 0x3a,
+    0xcd, 0x1f, 0xec, 0xf3, 0x07, 0x55, 0xfe, 0xe7, 0x46, 0xb7, 0x4b, 0x16, 0xa1, 0xdc, 0x32, 0x45,
+    0x4c, 0x00, 0xc5, 0x64, 0x02, 0x46, 0x42, 0xc0, 0x3d, 0xb2, 0xa1, 0x61, 0xc2, 0xe0, 0x4e, 0x89,
+    0x0b, 0x3a, 0x94, 0x46, 0x93, 0x48, 0xc2, 0xf2, 0xf2, 0xc9, 0xae, 0xd8, 0x81, 0x80, 0x55, 0x53,
+    0xbf, 0x80, 0x83, 0x46, 0xa7, 0xf9, 0xff, 0x9c, 0x82, 0x27, 0x18, 0xb7, 0x01, 0xb1, 0xff, 0xa1,
+    0xf9, 0xed, 0x7f, 0x6c, 0x2c, 0xe7, 0x27, 0x17, 0x8e, 0xdd, 0x19, 0xf5, 0x82, 0x66, 0xae, 0xa2,
+    0x89, 0xd3, 0x29, 0xca, 0x6e, 0x60, 0xe2, 0x46, 0x83, 0x50, 0x61, 0x50, 0x26, 0x68, 0xf9, 0x33,
+    0x92, 0x7e, 0x4a, 0x37, 0x87, 0x8f, 0xe4, 0xb7, 0xc4, 0xe9, 0x94, 0x13, 0x02, 0x4c, 0x87, 0x39,
+    0x29, 0xe2, 0x51, 0x88, 0xe4, 0x65, 0x83, 0xec, 0x95, 0xca, 0x39, 0x3b, 0x60, 0xad, 0xa6, 0x07,
+    0x05, 0x4e, 0x65, 0xa8, 0x10, 0x2b, 0xe0, 0x24, 0x13, 0xca, 0xdf, 0x0f, 0xab, 0xae, 0x10, 0xb1,
+    0x10, 0xd3, 0x26, 0xef, 0xa8, 0x09, 0x5c, 0x3b, 0xae, 0x34, 0xad, 0x24, 0x2e, 0x93, 0x2e, 0xb9,
+    0xec, 0xb5, 0x90, 0x0b, 0xe3, 0xed, 0x60, 0xba, 0xf2, 0x14, 0xa7, 0xc8, 0x80, 0xb9, 0xdd, 0x72,
+    0xe1, 0xcb, 0xad, 0xfe, 0xec, 0xc0, 0xfb, 0x4f, 0xd8, 0x6b, 0x6e, 0xc4, 0xa8, 0xa8, 0x29, 0xf3,
+    0x12, 0x44, 0x1c, 0xca, 0x59, 0xa2, 0x1b, 0xd1, 0x47, 0x5b, 0x13, 0x45, 0x5a, 0x61, 0x24, 0x81,
+    0xf9, 0x2b, 0x48, 0x33, 0x8b, 0xc9, 0x59, 0x31, 0x03, 0x39, 0x83, 0x3b, 0x58, 0xcc, 0xbb, 0x38,
+    0x58, 0x68, 0x07, 0x50, 0x21, 0x60, 0x62, 0x97, 0x46, 0x85, 0x20, 0xa2, 0x98, 0x49, 0x14, 0x88,
+    0xdb, 0x41, 0xa6, 0x89, 0x1f, 0x8c, 0x32, 0xb6, 0xa2, 0x4e, 0x5a, 0xae, 0x47, 0x4d, 0x39, 0xfd,
+    0x20, 0xf6, 0x6c, 0x8d, 0x57, 0x6d, 0x5a, 0xe7, 0xef, 0xf0, 0x33, 0x0d, 0x14, 0x64, 0xb3, 0x4c,
+    0x6b, 0xe3, 0xc8, 0xd2, 0xeb, 0x01, 0xc7, 0xbe, 0xbb, 0xb5, 0x9e, 0xb2, 0xff, 0xc1, 0xd3, 0xe3,
+    0x4e, 0x42, 0xd7, 0x4c, 0xed, 0x92, 0x26, 0x54, 0x68, 0xec, 0x9e, 0x2d, 0x37, 0x81, 0x6d, 0x0d,
+    0xc1, 0xb6, 0xc4, 0x1a, 0x24, 0x5c, 0xc0, 0xed, 0x8b, 0xfa, 0x44, 0xae, 0xc0, 0x8c, 0x0f, 0x77,
+    0x29, 0x90, 0x10, 0x6b, 0x02, 0x83, 0x34, 0x25, 0xab, 0x24, 0x0c, 0x49, 0x0c, 0x93, 0x23, 0x41,
+    0xcc, 0x6b, 0x14, 0xa8, 0x0b, 0x27, 0xb5, 0x7a, 0x5a, 0xb0, 0x90, 0x21, 0x10, 0x4d, 0xc3, 0x10,
+    0xe0, 0x09, 0xe6, 0x53, 0xf0, 0xfd, 0xa0, 0x5f, 0x56, 0x76, 0x97, 0x2e, 0xcc, 0xbc, 0xb3, 0x0d,
+    0x48, 0xce, 0xa1, 0xfe, 0x99, 0x60, 0x0a, 0x12, 0x9d, 0x2c, 0x23, 0x8e, 0xc0, 0x57, 0xb0, 0xda,
+    0xbe, 0x62, 0x6e, 0xac, 0x18, 0x72, 0xbe, 0x65, 0x2b, 0x9a, 0x84, 0x06, 0x63, 0x9b, 0x06, 0x09,
+    0x94, 0x58, 0xbe, 0x36, 0xc4, 0x23, 0x9d, 0xb1, 0x87, 0x24, 0x1d, 0xb2, 0xdb, 0x04, 0x3f, 0xf0,
+    0xc0, 0x75, 0x71, 0x08, 0x24, 0x67, 0xea, 0x79, 0x2c, 0x36, 0x0e, 0x10, 0xf1, 0xfb, 0x26, 0xcc,
+    0x93, 0x28, 0xd4, 0x4d, 0x67, 0xd5, 0xe7, 0x36, 0xc1, 0xaf, 0x40, 0x43, 0xbb, 0xfd, 0x4f, 0xf7,
+    0xf3, 0x05, 0xa3, 0xca, 0x0b, 0x70, 0xd6, 0x8b, 0x74, 0x13, 0xd7, 0x6e, 0x61, 0x1b, 0x6f, 0xa9,
+    0xa1, 0xe0, 0x77, 0x0b, 0x82, 0xdc, 0xf8, 0xbf, 0x25, 0x63, 0xe5, 0xda, 0x2b, 0x42, 0x33, 0x6b,
+    0x0f, 0xfc, 0x2d, 0xea, 0xe0, 0x1a, 0x13, 0x35, 0x47, 0x38, 0x8b, 0x13, 0x1d, 0x10, 0x00, 0x30,
+    0xb8, 0x4c, 0x92, 0x3f, 0xb1, 0xe5, 0x42, 0x7a, 0x5f, 0x98, 0x69, 0xc3, 0x7d, 0x3b, 0x0c, 0x31,
+    0x27, 0xdb, 0x80, 0x43, 0xbf, 0x71, 0x43, 0xb8, 0x86, 0x13, 0x70, 0x2b, 0x2c, 0x0a, 0x21, 0x11,
+    0x50, 0x48, 0x40, 0xaa, 0x4a, 0x45, 0xe6, 0x49, 0x21, 0x20, 0x3b, 0xcd, 0x1c, 0xab, 0xb6, 0x1a,
+    0x79, 0x60, 0x87, 0x85, 0xda, 0xa6, 0xb3, 0xd5, 0xc3, 0x6e, 0xd7, 0x81, 0xce, 0x0d, 0x65, 0x1a,
+    0x25, 0x37, 0x80, 0x8b, 0x3d, 0x76, 0x72, 0x77, 0xab, 0xb1, 0x91, 0xb7, 0xda, 0x95, 0x42, 0xc6,
+    0x4c, 0x80, 0x6c, 0x79, 0x43, 0x30, 0xc0, 0x43, 0xe0, 0x8a, 0x7a, 0x47, 0x0f, 0x20, 0x0c, 0x65,
+    0x47, 0xc8, 0x73, 0x26, 0x1d, 0x31, 0xad, 0xb1, 0x7e, 0xc6, 0xd5, 0x3c, 0xa7, 0xa7, 0x30, 0x5e,
+    0x11, 0xdc, 0x18, 0x3f, 0x7c, 0x37, 0x99, 0xeb, 0x43, 0xd8, 0x5b, 0xad, 0x9d, 0xa4, 0x17, 0x4a,
+    0xcd, 0xf6, 0x0c, 0x37, 0xf8, 0x8a, 0x34, 0x7f, 0x63, 0xed, 0xe5, 0xe6, 0x6a, 0x1a, 0xaf, 0x4d,
+    0xce, 0xd2, 0x96, 0xc3, 0x3b, 0x19, 0x8f, 0x98, 0x4c, 0x4c, 0x33, 0x8b, 0x47, 0x9b, 0x0c, 0x52,
+    0xd2, 0x33, 0xf6, 0x07, 0x6a, 0x4b, 0x11, 0xc6, 0x2d, 0xc2, 0x82, 0x56, 0x8a, 0xe0, 0x01, 0x13,
+    0x61, 0x21, 0xb8, 0xf1, 0x4b, 0xe3, 0x15, 0xe6, 0xec, 0x27, 0xc7, 0x6c, 0x72, 0x81, 0xab, 0x1b,
+    0x7e, 0x6e, 0x84, 0xab, 0x0c, 0x7e, 0xe9, 0xff, 0x2f, 0x8f, 0x62, 0x37, 0xb5, 0xf0, 0x17, 0x00,
+    0x00
+};
+
+#endif
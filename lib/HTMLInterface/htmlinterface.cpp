@@ -1,76 +1,228 @@
     #include "htmlinterface.h"
+    #include "dashboard.h"
     
-    String HTMLInterface::getHTML() {
-    float meanTrip = (PreferencesHandle::getInstance().getTripFuelUsed() > 0.001) ? (PreferencesHandle::getInstance().getDistanceTraveled() / PreferencesHandle::getInstance().getTripFuelUsed()) : 0.0;
-
-    String html = "<html><head><meta charset='UTF-8'><meta name='viewport' content='width=device-width, initial-scale=1.0'>";
-    html += "<style>";
-    html += "body { font-family: -apple-system, sans-serif; background: #1c1c1e; color: white; text-align: center; padding: 20px; }";
-    html += ".card { background: #2c2c2e; padding: 20px; border-radius: 20px; margin-bottom: 20px; box-shadow: 0 4px 15px rgba(0,0,0,0.3); }";
-    html += ".litros { font-size: 48px; font-weight: bold; color: #30d158; }";
-    html += "button { width: 100%; padding: 15px; margin: 10px 0; border: none; border-radius: 12px; font-size: 18px; font-weight: bold; cursor: pointer; }";
-    html += ".btn-reset { background: #ff3b30; color: white; }"; // Vermelho
-    html += ".btn-add { background: #007aff; color: white; }";   // Azul
-    html += ".btn-save { background: #34c759; color: white; }";  // Verde
-    html += "input { width: 100%; padding: 12px; border-radius: 8px; border: 1px solid #3a3a3c; background: #1c1c1e; color: white; margin-top: 10px; font-size: 16px; }";
-    html += "</style></head><body>";
-
-    html += "<h1>Fiesta Street</h1>";
-    
-    html += "<div class='card'>";
-    html += "<div>Combustível Estimado</div>";
-    html += "<div class='litros'>" + String(PreferencesHandle::getInstance().getFuel(), 1) + "L</div>";
-    html += "<div>" + String((PreferencesHandle::getInstance().getFuel() / PreferencesHandle::getInstance().getTankCapacity()) * 100, 0) + "% do tanque</div>";
-    html += "</div>";
+    // Static page, gzip-compressed at build time. Browsers revalidate with the ETag
+    // and get a 304 until the firmware ships a different page.
+    void HTMLInterface::handleRoot(AsyncWebServerRequest* request) {
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == DASHBOARD_ETAG) {
+        AsyncWebServerResponse* response = request->beginResponse(304);
+        response->addHeader("ETag", DASHBOARD_ETAG);
+        request->send(response);
+        return;
+    }
+    AsyncWebServerResponse* response = request->beginResponse_P(200, "text/html", DASHBOARD_HTML_GZ, DASHBOARD_HTML_GZ_LENGTH);
+    response->addHeader("ETag", DASHBOARD_ETAG);
+    response->addHeader("Cache-Control", "no-cache");
+    response->addHeader("Content-Encoding", "gzip");
+    request->send(response);
+    }
 
-    html += "<form action='/reset' method='POST'><button class='btn-reset'>RESET (TANQUE CHEIO)</button></form>";
-    html += "<form action='/add10' method='POST'><button class='btn-add'>ADICIONAR 10 LITROS</button></form>";
+    size_t HTMLInterface::formatState(char* buffer, size_t size) {
+    return TelemetryFormat::toJSON(Telemetry::snapshot(), buffer, size);
+    }
 
-    html += "<div class='card'>";
-    html += "<h3>Calibrar Consumo</h3>";
-    html += "<p style='font-size: 13px; color: #8e8e93; margin-bottom: 10px;'>Quanto entrou de gasolina no posto?</p>";
-    html += "<form action='/factorCalibration' method='POST'>";
-    html += "<input type='number' step='0.01' name='liters_supplied' placeholder='Ex: 4.40' required>";
-    html += "<button class='btn-save'>CALCULAR E ATUALIZAR</button></form>";
-    html += "<div style='margin-top: 15px; font-size: 11px; color: #666;'>Fator atual: " + String(PreferencesHandle::getInstance().getConsumptionFactor(), 12) + "</div>";
-    html += "</div>";
+    // The response outlives the handler (it is sent asynchronously), so it gets
+    // its own copy of the formatted state instead of pointing at a shared buffer.
+    void HTMLInterface::sendState(AsyncWebServerRequest* request) {
+    char buffer[STATE_BUFFER_SIZE];
+    formatState(buffer, sizeof(buffer));
+    AsyncWebServerResponse* response = request->beginResponse(200, "application/json", buffer);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+    }
 
-    html += "<div class='card'>";
-    html += "<h3>Trip (Viagem Atual)</h3>";
-    html += "<div style='color: #007aff;'>Distância: " + String(PreferencesHandle::getInstance().getDistanceTraveled(), 2) + " km</div>";
-    html += "<div style='color: #30d158;'>Gasto: " + String(PreferencesHandle::getInstance().getTripFuelUsed(), 3) + " L</div>";
-    html += "<div style='font-size: 24px; margin-top:10px;'>Média: " + String(meanTrip, 1) + " km/L</div>";
+    void HTMLInterface::handleState(AsyncWebServerRequest* request) {
+    sendState(request);
+    }
 
-    // Botão de Reset agora zera os DOIS
-    html += "<form action='/resetTrip' method='POST'><button class='btn-add' style='background:#5856d6'>ZERAR TRIP</button></form>";
-    html += "</div>";
+    // Windows and trip slots as of the last decoded response, summarized by the decoder
+    void HTMLInterface::handleStats(AsyncWebServerRequest* request) {
+    char buffer[TRIP_STATS_JSON_SIZE];
+    TripStats::toJSON(Telemetry::statsSnapshot(), buffer, sizeof(buffer));
+    AsyncWebServerResponse* response = request->beginResponse(200, "application/json", buffer);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+    }
 
-    html += "</body></html>";
-    return html;
+    // Script-driven forms ask for JSON and get the new state right away,
+    // plain form posts keep the redirect back to the page.
+    void HTMLInterface::finishAction(AsyncWebServerRequest* request) {
+    if (request->hasHeader("Accept") && request->header("Accept").indexOf("application/json") != -1) {
+        sendState(request);
+        return;
+    }
+    AsyncWebServerResponse* response = request->beginResponse(303);
+    response->addHeader("Location", "/");
+    request->send(response);
     }
 
-    void HTMLInterface::handleRoot() {
-    server.send(200, "text/html", getHTML());
+    // ESPAsyncWebServer 1.2.3 takes no lock of its own: the async_tcp task
+    // runs a client's queue on every ack and poll, and on a disconnect frees it
+    // before WS_EVT_DISCONNECT arrives. Every callback of a /ws socket is
+    // rewrapped here to hold liveMutex, the one pushLive sends under. Recursive,
+    // a timeout closes the socket and runs the disconnect callback right away.
+    // Runs on the async_tcp task, in the client's constructor (WS_EVT_CONNECT),
+    // before any other callback of this socket can run.
+    void HTMLInterface::guardLiveClient(AsyncWebSocketClient* client) {
+    AsyncClient* socket = client->client();
+    SemaphoreHandle_t mutex = liveMutex;
+    socket->onAck([client, mutex](void* arg, AsyncClient* c, size_t length, uint32_t time) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        client->_onAck(length, time);
+        xSemaphoreGiveRecursive(mutex);
+    }, nullptr);
+    socket->onPoll([client, mutex](void* arg, AsyncClient* c) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        client->_onPoll();
+        xSemaphoreGiveRecursive(mutex);
+    }, nullptr);
+    socket->onData([client, mutex](void* arg, AsyncClient* c, void* data, size_t length) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        client->_onData(data, length);
+        xSemaphoreGiveRecursive(mutex);
+    }, nullptr);
+    socket->onTimeout([client, mutex](void* arg, AsyncClient* c, uint32_t time) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        client->_onTimeout(time);
+        xSemaphoreGiveRecursive(mutex);
+    }, nullptr);
+    socket->onError([client, mutex](void* arg, AsyncClient* c, int8_t error) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        client->_onError(error);
+        xSemaphoreGiveRecursive(mutex);
+    }, nullptr);
+    // Deletes client (WS_EVT_DISCONNECT) and the socket, same as the library's own
+    socket->onDisconnect([client, mutex](void* arg, AsyncClient* c) {
+        xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+        client->_onDisconnect();
+        delete c;
+        xSemaphoreGiveRecursive(mutex);
+    }, nullptr);
     }
 
-    void HTMLInterface::handleReset() {
-    PreferencesHandle::getInstance().setFuel(PreferencesHandle::getInstance().getTankCapacity());
-    server.sendHeader("Location", "/");
-    server.send(303);
+    // Runs on the async_tcp task
+    void HTMLInterface::onLiveEvent(AsyncWebSocketClient* client, AwsEventType type) {
+    if (type == WS_EVT_CONNECT) {
+        guardLiveClient(client);
+        xSemaphoreTakeRecursive(liveMutex, portMAX_DELAY);
+        portENTER_CRITICAL(&liveLock);
+        int slot = -1;
+        for (int i = 0; i < MAX_LIVE_CLIENTS && slot < 0; i++) {
+            if (!liveClients[i].active) slot = i;
+        }
+        if (slot >= 0) {
+            liveClients[slot].id = client->id();
+            liveClients[slot].client = client;
+            liveClients[slot].sentVersion = 0;
+            liveClients[slot].lastSent = 0;
+            liveClients[slot].active = true;
+        }
+        portEXIT_CRITICAL(&liveLock);
+        xSemaphoreGiveRecursive(liveMutex);
+
+        if (slot < 0) client->close(1013, "Too many listeners");
+        // Wake the push task so the new page gets the current values at once
+        Telemetry::notifyListener();
+    } else if (type == WS_EVT_DISCONNECT) {
+        // Inside the guarded disconnect callback, pushLive is not sending
+        xSemaphoreTakeRecursive(liveMutex, portMAX_DELAY);
+        portENTER_CRITICAL(&liveLock);
+        for (int i = 0; i < MAX_LIVE_CLIENTS; i++) {
+            if (liveClients[i].active && liveClients[i].id == client->id()) {
+                liveClients[i].active = false;
+                liveClients[i].client = nullptr;
+            }
+        }
+        portEXIT_CRITICAL(&liveLock);
+        xSemaphoreGiveRecursive(liveMutex);
+    }
+    }
+
+    // Sends the newest snapshot to every browser on /ws, at most once per
+    // LIVE_MIN_INTERVAL_MS each. A browser whose TCP window is still full is
+    // skipped and gets the newest values once it drains, older snapshots are
+    // dropped instead of queued. Returns how long the caller may sleep if no
+    // new telemetry is published meanwhile.
+    // Runs on WiFi_Task. The sends hold liveMutex, so the async_tcp task is not
+    // inside a /ws socket meanwhile and none of them is freed under it.
+    unsigned long HTMLInterface::pushLive() {
+    uint32_t version = Telemetry::version();
+    unsigned long now = millis();
+    unsigned long wait = LIVE_KEEPALIVE_MS;
+    size_t length = 0;
+
+    xSemaphoreTakeRecursive(liveMutex, portMAX_DELAY);
+    for (int i = 0; i < MAX_LIVE_CLIENTS; i++) {
+        portENTER_CRITICAL(&liveLock);
+        LiveClient listener = liveClients[i];
+        portEXIT_CRITICAL(&liveLock);
+        if (!listener.active) continue;
+
+        unsigned long elapsed = now - listener.lastSent;
+        bool stale = listener.sentVersion != version;
+        if (stale && elapsed < LIVE_MIN_INTERVAL_MS) {
+            wait = min(wait, LIVE_MIN_INTERVAL_MS - elapsed);
+            continue;
+        }
+        if (!stale && elapsed < LIVE_KEEPALIVE_MS) {
+            wait = min(wait, LIVE_KEEPALIVE_MS - elapsed);
+            continue;
+        }
+
+        AsyncWebSocketClient* client = listener.client;
+        if (client == nullptr) continue;
+        if (!client->canSend() || !client->client()->canSend()) {
+            wait = min(wait, (unsigned long)LIVE_MIN_INTERVAL_MS);
+            continue;
+        }
+
+        if (stale) {
+            if (length == 0) length = formatState(liveBuffer, sizeof(liveBuffer));
+            if (listener.sentVersion != 0 && version - listener.sentVersion > 1) {
+                droppedUpdates += version - listener.sentVersion - 1;
+            }
+            client->text(liveBuffer, length);
+        } else {
+            client->ping();
+        }
+
+        portENTER_CRITICAL(&liveLock);
+        if (liveClients[i].active && liveClients[i].id == listener.id) {
+            liveClients[i].sentVersion = version;
+            liveClients[i].lastSent = now;
+        }
+        portEXIT_CRITICAL(&liveLock);
+        wait = min(wait, (unsigned long)LIVE_MIN_INTERVAL_MS);
+    }
+    xSemaphoreGiveRecursive(liveMutex);
+    return wait;
     }
 
-    void HTMLInterface::handleAdd10() {
-    PreferencesHandle::getInstance().setFuel(PreferencesHandle::getInstance().getFuel() + 10);
-    if (PreferencesHandle::getInstance().getFuel() > PreferencesHandle::getInstance().getTankCapacity()) {
-        PreferencesHandle::getInstance().setFuel(PreferencesHandle::getInstance().getTankCapacity());
+    uint32_t HTMLInterface::getDroppedUpdates() {
+    return droppedUpdates;
+    }
+
+    void HTMLInterface::handleReset(AsyncWebServerRequest* request) {
+    PreferencesHandle::getInstance().setFuel(PreferencesHandle::getInstance().getTankCapacity());
+    PreferencesHandle::getInstance().flush();
+    TripStats::requestReset(TRIP_SLOT_TANK);
+    Telemetry::publishPreferences();
+    finishAction(request);
     }
-    server.sendHeader("Location", "/");
-    server.send(303);
+
+    void HTMLInterface::handleAdd10(AsyncWebServerRequest* request) {
+    // Added, not set: fuel the decoder burns meanwhile on the other core is kept
+    PreferencesHandle& prefs = PreferencesHandle::getInstance();
+    int64_t room = (int64_t)(prefs.getTankCapacity() * 1000000.0f) - prefs.getFuelMicroliters();
+    prefs.addFuelMicroliters(room < 10000000 ? room : 10000000);
+    prefs.flush();
+    Telemetry::publishPreferences();
+    finishAction(request);
     }
 
-    void HTMLInterface::handleFactorCalibration() {
-    if (server.hasArg("liters_supplied")) {
-        float realLitersSupplied = server.arg("liters_supplied").toFloat();
+    void HTMLInterface::handleFactorCalibration(AsyncWebServerRequest* request) {
+    if (request->hasParam("liters_supplied", true)) {
+        float realLitersSupplied = request->getParam("liters_supplied", true)->value().toFloat();
         
         float fullTank = PreferencesHandle::getInstance().getTankCapacity();
         float currentTank = PreferencesHandle::getInstance().getFuel();
@@ -83,33 +235,190 @@
 
             PreferencesHandle::getInstance().setConsumptionFactor(newFactor);
             PreferencesHandle::getInstance().setFuel(fullTank);
+            PreferencesHandle::getInstance().flush();
+            TripStats::requestReset(TRIP_SLOT_TANK);
+            Telemetry::publishPreferences();
         }
     }
-    server.sendHeader("Location", "/");
-    server.send(303);
+    finishAction(request);
 }
 
-void HTMLInterface::handleResetTrip() {
+void HTMLInterface::handleResetTrip(AsyncWebServerRequest* request) {
     PreferencesHandle::getInstance().setDistanceTraveled(0.0);
     PreferencesHandle::getInstance().setTripFuelUsed(0.0); // Zera o contador de consumo da viagem
-    server.sendHeader("Location", "/");
-    server.send(303);
+    PreferencesHandle::getInstance().flush();
+    TripLogger::reset();
+    TripStats::requestReset(TRIP_SLOT_TRIP);
+    Telemetry::publishPreferences();
+    finishAction(request);
+}
+
+// Streams the trip log converted on the fly. The exporter is owned by the
+// response's fill callback and freed with it when the download ends or aborts.
+void HTMLInterface::handleTripLog(AsyncWebServerRequest* request, TRIP_LOG_FORMAT format) {
+    std::shared_ptr<TripLogExport> exporter(new TripLogExport(format));
+    if (!exporter->open()) {
+        request->send(404, "text/plain", "No trip log");
+        return;
+    }
+
+    const char* contentType = format == TRIP_LOG_CSV ? "text/csv" : "application/json";
+    AsyncWebServerResponse* response = request->beginChunkedResponse(contentType, [exporter](uint8_t* buffer, size_t maxLength, size_t index) -> size_t {
+        return exporter->read(buffer, maxLength);
+    });
+    response->addHeader("Content-Disposition", format == TRIP_LOG_CSV ? "attachment; filename=trip.csv" : "attachment; filename=trip.json");
+    request->send(response);
+}
+
+// Counters the web side already knows about, appended after the OBD metrics
+size_t HTMLInterface::formatSystemMetrics(char* buffer, size_t size) {
+    int length = snprintf(buffer, size,
+        "# TYPE obd_free_heap_bytes gauge\n"
+        "obd_free_heap_bytes %u\n"
+        "# TYPE obd_live_dropped_updates_total counter\n"
+        "obd_live_dropped_updates_total %u\n"
+        "# TYPE obd_nvs_writes_total counter\n"
+        "obd_nvs_writes_total %u\n"
+        "# TYPE obd_trip_log_bytes gauge\n"
+        "obd_trip_log_bytes %u\n"
+        "# TYPE obd_trip_log_dropped_samples_total counter\n"
+        "obd_trip_log_dropped_samples_total %u\n"
+        "# TYPE obd_log_dropped_records_total counter\n"
+        "obd_log_dropped_records_total %u\n",
+        (unsigned)ESP.getFreeHeap(), (unsigned)droppedUpdates,
+        (unsigned)PreferencesHandle::getInstance().getFlashWriteCount(),
+        (unsigned)TripLogger::getLogSize(), (unsigned)TripLogger::getDroppedSamples(), (unsigned)LogRing::getDropped());
+    if (length < 0 || (size_t)length >= size) return (length < 0) ? 0 : size - 1;
+
+    length += snprintf(buffer + length, size - length,
+        "# TYPE obd_power_state_seconds_total counter\n");
+    for (int state = 0; state < POWER_STATE_COUNT && (size_t)length < size; state++) {
+        length += snprintf(buffer + length, size - length, "obd_power_state_seconds_total{state=\"%s\"} %.1f\n",
+            PowerManager::stateName((POWER_STATE)state), PowerManager::getTimeInState((POWER_STATE)state) / 1000.0);
+    }
+    if ((size_t)length < size) {
+        length += snprintf(buffer + length, size - length,
+            "# TYPE obd_ecu_probes_total counter\n"
+            "obd_ecu_probes_total %u\n",
+            (unsigned)PowerManager::getProbes());
+    }
+    return (size_t)length < size ? length : size - 1;
+}
+
+size_t HTMLInterface::readMetrics(MetricsPage& page, uint8_t* buffer, size_t maxLength) {
+    size_t written = 0;
+    while (written < maxLength) {
+        if (page.position == page.length) {
+            page.position = 0;
+            page.length = OBDMetrics::format(page.cursor, page.piece, sizeof(page.piece));
+            if (page.length == 0 && !page.systemDone) {
+                page.length = formatSystemMetrics(page.piece, sizeof(page.piece));
+                page.systemDone = true;
+            }
+            if (page.length == 0) break;
+        }
+        size_t count = page.length - page.position;
+        if (count > maxLength - written) count = maxLength - written;
+        memcpy(buffer + written, page.piece + page.position, count);
+        page.position += count;
+        written += count;
+    }
+    return written;
+}
+
+// type=ble|spp|tcp, address (MAC, or host:port for tcp), ssid and password of
+// a WiFi adapter. The Bluetooth stacks are started once per boot, so the
+// config is saved and the ESP32 restarts once the reply went out.
+void HTMLInterface::handleTransport(AsyncWebServerRequest* request) {
+    ELMAdapterConfig config;
+    memset(&config, 0, sizeof(config));
+    config.version = ELM_ADAPTER_CONFIG_VERSION;
+    config.kind = ELM_TRANSPORT_KIND_COUNT;
+    String type = request->hasParam("type", true) ? request->getParam("type", true)->value() : String();
+    for (uint8_t kind = 0; kind < ELM_TRANSPORT_KIND_COUNT; kind++) {
+        if (type == elmTransportName(kind)) config.kind = kind;
+    }
+    String address = request->hasParam("address", true) ? request->getParam("address", true)->value() : String();
+    if (address.length() == 0 && config.kind == ELM_TRANSPORT_TCP) address = ELM_TCP_DEFAULT_ADDRESS;
+    if (config.kind == ELM_TRANSPORT_KIND_COUNT || address.length() == 0 || address.length() >= sizeof(config.address)) {
+        request->send(400, "text/plain", "Expected type=ble|spp|tcp and the adapter address\n");
+        return;
+    }
+    strlcpy(config.address, address.c_str(), sizeof(config.address));
+    if (config.kind == ELM_TRANSPORT_TCP) {
+        String ssid = request->hasParam("ssid", true) ? request->getParam("ssid", true)->value() : String(ELM_TCP_DEFAULT_SSID);
+        strlcpy(config.ssid, ssid.c_str(), sizeof(config.ssid));
+        if (request->hasParam("password", true)) {
+            strlcpy(config.password, request->getParam("password", true)->value().c_str(), sizeof(config.password));
+        }
+    }
+
+    PreferencesHandle::getInstance().saveAdapterConfig(config);
+    PreferencesHandle::getInstance().flush();
+    request->onDisconnect([]() { ESP.restart(); });
+    request->send(200, "text/plain", String("Adapter set to ") + elmTransportName(config.kind) + " " + config.address + ", restarting\n");
+}
+
+// The last LOG_TAIL_SIZE bytes the log drain printed
+void HTMLInterface::handleLog(AsyncWebServerRequest* request) {
+    char buffer[LOG_TAIL_SIZE];
+    Logger::copyTail(buffer, sizeof(buffer));
+    AsyncWebServerResponse* response = request->beginResponse(200, "text/plain", buffer);
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
+}
+
+// level=error|warn|info|debug|verbose, capped by the level the firmware was built with
+void HTMLInterface::handleLogLevel(AsyncWebServerRequest* request) {
+    static const char* const LEVELS[] = { "none", "error", "warn", "info", "debug", "verbose" };
+    String level = request->hasParam("level", true) ? request->getParam("level", true)->value() : String();
+    for (uint8_t i = LOG_LEVEL_NONE; i <= LOG_LEVEL_VERBOSE; i++) {
+        if (level != LEVELS[i]) continue;
+        LogRing::setLevel(i);
+        request->send(200, "text/plain", String("Log level ") + LEVELS[i] + (i > LOG_LEVEL ? " (this build stops at " + String(LEVELS[LOG_LEVEL]) + ")\n" : "\n"));
+        return;
+    }
+    request->send(400, "text/plain", "Expected level=none|error|warn|info|debug|verbose\n");
+}
+
+// Prometheus text exposition, rendered a piece at a time like the trip log so
+// a scrape costs one small buffer whatever the number of PIDs.
+void HTMLInterface::handleMetrics(AsyncWebServerRequest* request) {
+    std::shared_ptr<MetricsPage> page(new MetricsPage());
+    AsyncWebServerResponse* response = request->beginChunkedResponse("text/plain; version=0.0.4", [this, page](uint8_t* buffer, size_t maxLength, size_t index) -> size_t {
+        return readMetrics(*page, buffer, maxLength);
+    });
+    response->addHeader("Cache-Control", "no-store");
+    request->send(response);
 }
 
     void HTMLInterface::begin() {
     WiFi.softAP("ESP32_PAINEL");
-    server.on("/", std::bind(&HTMLInterface::handleRoot, this));
-    server.on("/reset", HTTP_POST, std::bind(&HTMLInterface::handleReset, this));
-    server.on("/add10", HTTP_POST, std::bind(&HTMLInterface::handleAdd10, this));
-    server.on("/factorCalibration", HTTP_POST, std::bind(&HTMLInterface::handleFactorCalibration, this));
-    server.on("/resetTrip", HTTP_POST, std::bind(&HTMLInterface::handleResetTrip, this));
+    live.onEvent([this](AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type, void* arg, uint8_t* data, size_t length) {
+        onLiveEvent(client, type);
+    });
+    server.addHandler(&live);
+    server.on("/", HTTP_GET, std::bind(&HTMLInterface::handleRoot, this, std::placeholders::_1));
+    server.on("/api/state", HTTP_GET, std::bind(&HTMLInterface::handleState, this, std::placeholders::_1));
+    server.on("/api/stats", HTTP_GET, std::bind(&HTMLInterface::handleStats, this, std::placeholders::_1));
+    server.on("/reset", HTTP_POST, std::bind(&HTMLInterface::handleReset, this, std::placeholders::_1));
+    server.on("/add10", HTTP_POST, std::bind(&HTMLInterface::handleAdd10, this, std::placeholders::_1));
+    server.on("/factorCalibration", HTTP_POST, std::bind(&HTMLInterface::handleFactorCalibration, this, std::placeholders::_1));
+    server.on("/resetTrip", HTTP_POST, std::bind(&HTMLInterface::handleResetTrip, this, std::placeholders::_1));
+    server.on("/trip.csv", HTTP_GET, std::bind(&HTMLInterface::handleTripLog, this, std::placeholders::_1, TRIP_LOG_CSV));
+    server.on("/trip.json", HTTP_GET, std::bind(&HTMLInterface::handleTripLog, this, std::placeholders::_1, TRIP_LOG_JSON));
+    server.on("/metrics", HTTP_GET, std::bind(&HTMLInterface::handleMetrics, this, std::placeholders::_1));
+    server.on("/transport", HTTP_POST, std::bind(&HTMLInterface::handleTransport, this, std::placeholders::_1));
+    server.on("/log", HTTP_GET, std::bind(&HTMLInterface::handleLog, this, std::placeholders::_1));
+    server.on("/log", HTTP_POST, std::bind(&HTMLInterface::handleLogLevel, this, std::placeholders::_1));
     server.begin();
     }
 
-    void HTMLInterface::handleClient() {
-    server.handleClient();
+    HTMLInterface::HTMLInterface() : server(80), live("/ws") {
+    liveMutex = xSemaphoreCreateRecursiveMutex();
+    for (int i = 0; i < MAX_LIVE_CLIENTS; i++) {
+        liveClients[i].active = false;
+        liveClients[i].client = nullptr;
     }
-
-    HTMLInterface::HTMLInterface() {
+    droppedUpdates = 0;
     }
-
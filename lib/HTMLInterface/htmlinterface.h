@@ -3,26 +3,75 @@
 
 #include <Arduino.h>
 #include <WiFi.h>
-#include <WebServer.h>
+#include <ESPAsyncWebServer.h>
+#include <memory>
 #include "../datadefinition.h"
 #include <preferenceshandle.h>
+#include <telemetry.h>
+#include <triplogexport.h>
+#include <obdmetrics.h>
+#include <powermanager.h>
+#include <logger.h>
 
+#define MAX_LIVE_CLIENTS 4
+#define LIVE_MIN_INTERVAL_MS 100
+#define LIVE_KEEPALIVE_MS 15000
+#define STATE_BUFFER_SIZE 384
+
+// One browser connected to /ws. The socket object belongs to the server,
+// client is only used while holding liveMutex (see guardLiveClient).
+struct LiveClient {
+    uint32_t id;
+    AsyncWebSocketClient* client;
+    bool active;
+    uint32_t sentVersion;
+    unsigned long lastSent;
+};
+
+// One /metrics response being streamed, owned by its fill callback
+struct MetricsPage {
+    MetricsCursor cursor;
+    char piece[METRICS_PIECE_SIZE];
+    size_t length;
+    size_t position;
+    bool systemDone;
+};
 
 class HTMLInterface {
 public:
     HTMLInterface();
     void begin();
-    void handleClient();
+    unsigned long pushLive();
+    uint32_t getDroppedUpdates();
 
 private:
-    WebServer server;
-
-    String getHTML();
-    void handleRoot();
-    void handleReset();
-    void handleAdd10();
-    void handleFactorCalibration();
-    void handleResetTrip();
+    AsyncWebServer server;
+    AsyncWebSocket live;
+    LiveClient liveClients[MAX_LIVE_CLIENTS];
+    portMUX_TYPE liveLock = portMUX_INITIALIZER_UNLOCKED;
+    SemaphoreHandle_t liveMutex;
+    char liveBuffer[STATE_BUFFER_SIZE];
+    uint32_t droppedUpdates;
+
+    size_t formatState(char* buffer, size_t size);
+    void sendState(AsyncWebServerRequest* request);
+    void finishAction(AsyncWebServerRequest* request);
+    void onLiveEvent(AsyncWebSocketClient* client, AwsEventType type);
+    void guardLiveClient(AsyncWebSocketClient* client);
+    void handleRoot(AsyncWebServerRequest* request);
+    void handleState(AsyncWebServerRequest* request);
+    void handleStats(AsyncWebServerRequest* request);
+    void handleReset(AsyncWebServerRequest* request);
+    void handleAdd10(AsyncWebServerRequest* request);
+    void handleFactorCalibration(AsyncWebServerRequest* request);
+    void handleResetTrip(AsyncWebServerRequest* request);
+    void handleTripLog(AsyncWebServerRequest* request, TRIP_LOG_FORMAT format);
+    void handleTransport(AsyncWebServerRequest* request);
+    void handleLog(AsyncWebServerRequest* request);
+    void handleLogLevel(AsyncWebServerRequest* request);
+    size_t formatSystemMetrics(char* buffer, size_t size);
+    size_t readMetrics(MetricsPage& page, uint8_t* buffer, size_t maxLength);
+    void handleMetrics(AsyncWebServerRequest* request);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,71 @@
+#include "logring.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+LogRing::Slot LogRing::slots[LOG_RING_RECORDS];
+std::atomic<uint32_t> LogRing::head(0);
+std::atomic<uint32_t> LogRing::tail(0);
+std::atomic<uint32_t> LogRing::dropped(0);
+uint8_t LogRing::level = LOG_LEVEL_WARN;
+LogClockFunction LogRing::clock = nullptr;
+
+static const char* const LEVEL_NAMES[] = { "-", "E", "W", "I", "D", "V" };
+
+// Any task, the Bluetooth callbacks included. The slot belongs to this
+// producer from the CAS until the sequence store, the drain waits for it.
+void LogRing::write(uint8_t recordLevel, const char* tag, const char* format, ...) {
+    uint32_t index = head.load(std::memory_order_relaxed);
+    do {
+        if (index - tail.load(std::memory_order_acquire) >= LOG_RING_RECORDS) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!head.compare_exchange_weak(index, index + 1, std::memory_order_acquire, std::memory_order_relaxed));
+
+    Slot& slot = slots[index & (LOG_RING_RECORDS - 1)];
+    slot.record.timestampMs = clock != nullptr ? clock() : 0;
+    slot.record.level = recordLevel;
+    slot.record.tag = tag;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot.record.text, sizeof(slot.record.text), format, args);
+    va_end(args);
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+// Drain side. Stops at a slot still being written, its producer was
+// preempted between the claim and the publish.
+bool LogRing::read(LogRecord& record) {
+    uint32_t index = tail.load(std::memory_order_relaxed);
+    Slot& slot = slots[index & (LOG_RING_RECORDS - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != index + 1) return false;
+
+    record = slot.record;
+    tail.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+// "[  12.345] D OBDHandle: Sending: 010C1", with the newline
+size_t LogRing::formatLine(const LogRecord& record, char* buffer, size_t size) {
+    int length = snprintf(buffer, size, "[%4u.%03u] %s %s: %s\n", (unsigned)(record.timestampMs / 1000),
+                          (unsigned)(record.timestampMs % 1000), levelName(record.level), record.tag, record.text);
+    if (length < 0) return 0;
+    return (size_t)length < size ? (size_t)length : size - 1;
+}
+
+const char* LogRing::levelName(uint8_t recordLevel) {
+    return recordLevel <= LOG_LEVEL_VERBOSE ? LEVEL_NAMES[recordLevel] : "?";
+}
+
+// Runtime threshold, levels above LOG_LEVEL are compiled out whatever it says
+void LogRing::setLevel(uint8_t value) {
+    level = value;
+}
+
+void LogRing::setClock(LogClockFunction function) {
+    clock = function;
+}
+
+uint32_t LogRing::getDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,103 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_VERBOSE 5
+
+// Highest level compiled in, the build sets it with -DLOG_LEVEL=...
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_RECORDS 32         // power of two
+#define LOG_MESSAGE_SIZE 96
+#define LOG_LINE_SIZE (LOG_MESSAGE_SIZE + 32)
+
+typedef uint32_t (*LogClockFunction)();
+
+struct LogRecord {
+    uint32_t timestampMs;
+    uint8_t level;
+    const char* tag;            // string literal, only the pointer is kept
+    char text[LOG_MESSAGE_SIZE];
+};
+
+// Multi-producer/single-consumer ring of formatted log records. A producer
+// claims a slot with one compare-and-swap on the head, formats into it with
+// vsnprintf (no heap) and publishes it through the slot's sequence number;
+// the drain takes records out in order. A full ring drops the new record and
+// counts it, logging never blocks the task that logs.
+//
+// Plain C++, shared with the native build.
+class LogRing {
+private:
+    struct Slot {
+        std::atomic<uint32_t> sequence;     // index + 1 once the record is complete
+        LogRecord record;
+    };
+
+    static Slot slots[LOG_RING_RECORDS];
+    static std::atomic<uint32_t> head;
+    static std::atomic<uint32_t> tail;
+    static std::atomic<uint32_t> dropped;
+    static uint8_t level;
+    static LogClockFunction clock;
+
+public:
+    static void write(uint8_t level, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+    static bool read(LogRecord& record);
+    static size_t formatLine(const LogRecord& record, char* buffer, size_t size);
+    static const char* levelName(uint8_t level);
+    static void setLevel(uint8_t value);
+    static uint8_t getLevel() { return level; }
+    static void setClock(LogClockFunction function);
+    static uint32_t getDropped();
+
+    // Never called: keeps the format checked and the arguments "used" for a
+    // level that is compiled out
+    __attribute__((format(printf, 1, 2))) static void discard(const char* format, ...) {}
+};
+
+#define LOG_ENABLED(lvl) (LOG_LEVEL >= (lvl) && (lvl) <= LogRing::getLevel())
+#define LOG_AT(lvl, tag, ...) do { if (LOG_ENABLED(lvl)) LogRing::write(lvl, tag, __VA_ARGS__); } while (0)
+#define LOG_NONE(...) do { if (0) LogRing::discard(__VA_ARGS__); } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(tag, ...) LOG_AT(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define LOG_E(tag, ...) LOG_NONE(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(tag, ...) LOG_AT(LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#else
+#define LOG_W(tag, ...) LOG_NONE(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(tag, ...) LOG_AT(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define LOG_I(tag, ...) LOG_NONE(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(tag, ...) LOG_AT(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define LOG_D(tag, ...) LOG_NONE(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_VERBOSE
+#define LOG_V(tag, ...) LOG_AT(LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#else
+#define LOG_V(tag, ...) LOG_NONE(__VA_ARGS__)
+#endif
+
+#endif
@@ -0,0 +1,78 @@
+#include "logger.h"
+
+Print* Logger::output = nullptr;
+char Logger::tail[LOG_TAIL_SIZE];
+size_t Logger::tailHead = 0;
+bool Logger::tailWrapped = false;
+portMUX_TYPE Logger::tailLock = portMUX_INITIALIZER_UNLOCKED;
+
+uint32_t Logger::clockMs() {
+    return millis();
+}
+
+void Logger::begin(Print* serial) {
+    output = serial;
+    LogRing::setClock(clockMs);
+    xTaskCreatePinnedToCore(
+        drainTask,
+        "Log_Drain",
+        3072,
+        NULL,
+        1,
+        NULL,
+        0
+    );
+}
+
+void Logger::drainTask(void* pvParameters) {
+    LogRecord record;
+    char line[LOG_LINE_SIZE];
+    uint32_t reportedDrops = 0;
+    for (;;) {
+        while (LogRing::read(record)) {
+            size_t length = LogRing::formatLine(record, line, sizeof(line));
+            if (output != nullptr) output->write((const uint8_t*)line, length);
+            appendTail(line, length);
+        }
+        uint32_t dropped = LogRing::getDropped();
+        if (dropped != reportedDrops && output != nullptr) {
+            output->printf("[log] %u records dropped, ring full\n", (unsigned)(dropped - reportedDrops));
+            reportedDrops = dropped;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_INTERVAL_MS));
+    }
+}
+
+void Logger::appendTail(const char* line, size_t length) {
+    portENTER_CRITICAL(&tailLock);
+    for (size_t i = 0; i < length; i++) {
+        tail[tailHead++] = line[i];
+        if (tailHead == LOG_TAIL_SIZE) {
+            tailHead = 0;
+            tailWrapped = true;
+        }
+    }
+    portEXIT_CRITICAL(&tailLock);
+}
+
+// Oldest line first. Once the tail wrapped, the partly overwritten first
+// line is left out.
+size_t Logger::copyTail(char* buffer, size_t size) {
+    if (size == 0) return 0;
+    size_t length = 0;
+    portENTER_CRITICAL(&tailLock);
+    size_t start = tailWrapped ? tailHead : 0;
+    size_t available = tailWrapped ? LOG_TAIL_SIZE : tailHead;
+    bool skipping = tailWrapped;
+    for (size_t i = 0; i < available && length < size - 1; i++) {
+        char c = tail[(start + i) % LOG_TAIL_SIZE];
+        if (skipping) {
+            skipping = c != '\n';
+            continue;
+        }
+        buffer[length++] = c;
+    }
+    portEXIT_CRITICAL(&tailLock);
+    buffer[length] = '\0';
+    return length;
+}
@@ -0,0 +1,31 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+#include <logring.h>
+
+#define LOG_DRAIN_INTERVAL_MS 50
+#define LOG_TAIL_SIZE 2048
+
+// Firmware side of LogRing: a low-priority task on core 0 takes the records
+// out every LOG_DRAIN_INTERVAL_MS, prints them and keeps the last
+// LOG_TAIL_SIZE bytes of lines for GET /log. Printing to Serial happens
+// there, never in the task that logged.
+class Logger {
+private:
+    static Print* output;
+    static char tail[LOG_TAIL_SIZE];
+    static size_t tailHead;
+    static bool tailWrapped;
+    static portMUX_TYPE tailLock;
+
+    static void drainTask(void* pvParameters);
+    static void appendTail(const char* line, size_t length);
+    static uint32_t clockMs();
+
+public:
+    static void begin(Print* serial);
+    static size_t copyTail(char* buffer, size_t size);
+};
+
+#endif
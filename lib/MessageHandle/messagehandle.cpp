@@ -1,166 +1,77 @@
 #include "messagehandle.h"
 #include <ctime>
 
-LiquidCrystal_I2C* MessageHandle::lcd = nullptr;
-bool MessageHandle::debugEnabled = false;
-HardwareSerial* MessageHandle::debugSerial = nullptr;
-ECU_STATUS* MessageHandle::ecu_state = nullptr;
-unsigned long MessageHandle::lastEngineLoadRequestTime = 0;
-int MessageHandle::lastRPMValue = 0;
-unsigned long MessageHandle::lastSpeedRequestTime = 0;
-
-void MessageHandle::processRPMMessage(String message) {
-    int indexRPM = message.indexOf("410C");
-    if (indexRPM != -1 && message.length() >= indexRPM + 8 && lcd != nullptr) {
-        int A = strtol(message.substring(indexRPM + 4, indexRPM + 6).c_str(), NULL, 16);
-        int B = strtol(message.substring(indexRPM + 6, indexRPM + 8).c_str(), NULL, 16);
-        int rpm = ((A * 256) + B) / 4;
-        lcd->setCursor(0, 0);
-        debugPrint("Displaying RPM: " + String(rpm));
-        lcd->print("RPM: ");
-        if(rpm < 1000) lcd->print(" ");
-        lcd->print(rpm);
-        lastRPMValue = rpm;
-    }
-}
+static const char TAG[] = "MessageHandle";
 
-void MessageHandle::processTemperatureMessage(String message) {
-    int index = message.indexOf("4105");
-    
-    if (index != -1 && message.length() >= index + 6) {
-        String hexVal = message.substring(index + 4, index + 6);
-        int tempDecimal = strtol(hexVal.c_str(), NULL, 16);
-        int tempFinal = tempDecimal - 40;
-        
-        // Exibe no LCD
-        lcd->setCursor(11, 1);
-        if(tempFinal < 100) lcd->print(" ");
-        if(tempFinal < 10) lcd->print(" ");
-        lcd->print(tempFinal);
-        lcd->write(223); // Caractere de grau (°)
-        lcd->print("C");
-        debugPrint(">>> Temp: " + String(tempFinal) + " C\n");
-    }
-}
+ECU_STATUS* MessageHandle::ecu_state = nullptr;
+uint8_t MessageHandle::silentResponses = 0;
 
-void MessageHandle::processCheckECUMessage(String message) {
+// 0100 is both the wake-up probe and the first supported PID bitmap
+void MessageHandle::onECUAwake() {
     if(ecu_state == nullptr) return;
     *ecu_state = ECU_STATUS::AWAKE;
-    debugPrint("ECU is AWAKE.");
+    LOG_I(TAG, "ECU is awake");
 }
 
-void MessageHandle::processAndShowMessage(String message) {
-    
-    if(message.indexOf("NO DATA") != -1 || message.indexOf("ERROR") != -1) {
-        debugPrint("ECU Connection is OFF.");
-        if(ecu_state != nullptr) {
-            *ecu_state = ECU_STATUS::SLEEP;
-        }
-        return;
-    }
-    
-    int mux = strtol(message.substring(4, 6).c_str(), NULL, 16);
-
-    debugPrint("Processing message with MUX: " + String(mux));
-
-    String clearMessage = message;
-    clearMessage.replace(" ", "");
-    clearMessage.replace(">", "");
-    clearMessage.trim();
-    
-    switch (mux) {
-        case RPM_MUX:
-            processRPMMessage(clearMessage);
-            break;
-        case TEMP_MUX:
-            processTemperatureMessage(clearMessage);
-            break;
-        case CHECK_ECU_MUX:
-            processCheckECUMessage(clearMessage);
-            break;
-        case ENGINE_LOAD_MUX:
-            processEngineLoadMessage(clearMessage);
-            break;
-        case SPEED_MUX:
-            processSpeedMessage(clearMessage);
-            break;
-        default:
-        break;
+// Every value OBDSession decodes goes to the trip log
+void MessageHandle::onValue(const PIDDescriptor& descriptor, int32_t value, uint32_t receivedAt) {
+    TripLogger::record(descriptor.pid, value, receivedAt);
+    if (LOG_ENABLED(LOG_LEVEL_VERBOSE)) {
+        char text[PID_VALUE_TEXT_SIZE];
+        PIDTable::formatValue(descriptor, value, text, sizeof(text));
+        LOG_V(TAG, "%s: %s %s", descriptor.name, text, descriptor.unit);
     }
 }
 
-void MessageHandle::processSpeedMessage(String message) {
-    int index = message.indexOf("410D");
-    unsigned long currentTime = millis();
-    
-    if (index != -1 && message.length() >= index + 6) {
-        int speedKmh = strtol(message.substring(index + 4, index + 6).c_str(), NULL, 16);
-
-        lcd->setCursor(0, 1);
-        if(speedKmh < 100) lcd->print(" ");
-        if(speedKmh < 10) lcd->print(" ");
-        lcd->print(speedKmh);
-        lcd->print("km/h");
-        debugPrint(">>> Speed: " + String(speedKmh) + " km/h\n");
-
-        if (lastSpeedRequestTime > 0) {
-            double deltaTime = (currentTime - lastSpeedRequestTime) / 1000.0;
-            double metersTraveled = (speedKmh / 3.6) * deltaTime;
-            
-            float totalKm = PreferencesHandle::getInstance().getDistanceTraveled() + (metersTraveled / 1000.0);
-            PreferencesHandle::getInstance().setDistanceTraveled(totalKm);
-        }
-        lastSpeedRequestTime = currentTime;
-    }
-}
-
-void MessageHandle::processEngineLoadMessage(String message) {
-    int index = message.indexOf("4104");
-    unsigned long currentTime = millis();
-
-    if(lastEngineLoadRequestTime == 0) {
-        lastEngineLoadRequestTime = currentTime;
+// OBDSession decodes the response in place (the buffer is clobbered) into the
+// LCD, the trip computer and the statistics. What is left here is the
+// firmware's part: the ECU state, the saved statistics and the telemetry.
+void MessageHandle::processAndShowMessage(char* response, size_t length, unsigned long receivedAt) {
+    OBDSession::decodeResponse(response, length, receivedAt);
+    uint8_t decodedPIDs = OBDSession::getDecodedPIDCount();
+    uint8_t status = OBDSession::getLastStatus();
+    static const uint8_t probePID = CHECK_ECU_MUX;
+    if (OBDSession::getDecodedMask(&probePID, 1) != 0) onECUAwake();
+
+    bool noData = (status & (ELM_STATUS_NO_DATA | ELM_STATUS_ERROR)) != 0;
+
+    if(OBDSession::getExpectedPIDs() > 1 && decodedPIDs == 0 && status != 0) {
+        // A rejected batch says nothing about the ECU, the caller falls back to single PIDs
+        LOG_D(TAG, "Batched request rejected");
         return;
     }
-    
-    if (index != -1 && message.length() >= index + 6) {
-        String hexVal = message.substring(index + 4, index + 6);
-        int loadDecimal = strtol(hexVal.c_str(), NULL, 16);
-        int loadFinal = (loadDecimal * 100) / 255;
-        float deltaTime = (currentTime - lastEngineLoadRequestTime)/1000.0; 
 
-        float fuelConsumption = (lastRPMValue * loadFinal * (PreferencesHandle::getInstance().getConsumptionFactor())) * deltaTime;
-        PreferencesHandle::getInstance().setFuel(PreferencesHandle::getInstance().getFuel() - fuelConsumption);
-
-        float tripfuelConsumed = PreferencesHandle::getInstance().getTripFuelUsed() + fuelConsumption;
-        PreferencesHandle::getInstance().setTripFuelUsed(tripfuelConsumed);
-
-        lastEngineLoadRequestTime = currentTime;
-        debugPrint(">>> Engine Load: " + String(loadFinal) + " %\n");
-        lcd->setCursor(13, 0);
-        lcd->print(int(PreferencesHandle::getInstance().getFuel() * 100 / PreferencesHandle::getInstance().getTankCapacity()));
-        lcd->print("%");
+    // NO DATA for one request may only mean the ECU has no value for that PID
+    // right now. An adapter error (UNABLE TO CONNECT, BUS ERROR...) or nothing
+    // but NO DATA several times in a row is the ECU going to sleep.
+    if(noData && decodedPIDs == 0) {
+        silentResponses++;
+        if((status & ELM_STATUS_ERROR) || silentResponses >= ECU_SLEEP_SILENT_RESPONSES) {
+            LOG_I(TAG, "ECU is asleep");
+            silentResponses = 0;
+            if(ecu_state != nullptr) {
+                *ecu_state = ECU_STATUS::SLEEP;
+            }
+        }
     }
-}
-
-void MessageHandle::enableDebug(bool enable) {
-    debugEnabled = enable;
-}
+    if(decodedPIDs > 0) silentResponses = 0;
 
-void MessageHandle::setDebugSerial(HardwareSerial* serial) {
-    debugSerial = serial;
-}
-
-void MessageHandle::debugPrint(String message) {
-    if (debugEnabled && debugSerial != nullptr) {
-        debugSerial->println("[MessageHandle] " + message);
+    if(decodedPIDs > 0) {
+        // OBDSession handed the new totals to the statistics, publish the snapshot
+        if(TripStats::takeChanged()) {
+            uint8_t cache[TRIP_STATS_CACHE_SIZE];
+            PreferencesHandle::getInstance().setTripSlots(cache, TripStats::save(cache, sizeof(cache)));
+        }
+        Telemetry::publishLive(OBDSession::getLastValue(RPM_MUX), OBDSession::getLastValue(SPEED_MUX),
+                               OBDSession::getLastValue(ENGINE_LOAD_MUX), OBDSession::getLastValue(TEMP_MUX));
+    } else {
+        // A probe of the sleeping ECU: nothing to integrate, the windows still age
+        Telemetry::publishStats();
     }
 }
 
-void MessageHandle::setECUState(ECU_STATUS* state) {
+// Takes over the values OBDSession decodes, before it updates the live consumers
+void MessageHandle::begin(ECU_STATUS* state) {
     ecu_state = state;
+    OBDSession::setValueListener(onValue);
 }
-
-void MessageHandle::setLCD(LiquidCrystal_I2C* lcdInstance) {
-    lcd = lcdInstance;
-}
\ No newline at end of file
@@ -2,34 +2,32 @@
 #define MESSAGEHANDLE_H
 
 #include <Arduino.h>
-#include <LiquidCrystal_I2C.h>
+#include <displayhandle.h>
 #include "../datadefinition.h"
 #include <preferenceshandle.h>
+#include <elmparser.h>
+#include <telemetry.h>
+#include <triplogger.h>
+#include <tripstats.h>
+#include <pidtable.h>
+#include <obdsession.h>
+#include <logring.h>
+
+// Responses in a row without a single value (NO DATA) before the ECU is taken
+// as asleep. One PID the ECU does not answer must not stop the polling.
+#define ECU_SLEEP_SILENT_RESPONSES 3
 
 class MessageHandle {
 private:
-    static LiquidCrystal_I2C *lcd;
-    
-    static bool debugEnabled;
-    static HardwareSerial* debugSerial;
     static ECU_STATUS *ecu_state;
-    static unsigned long lastEngineLoadRequestTime;
-    static int lastRPMValue;
-    static unsigned long lastSpeedRequestTime;
+    static uint8_t silentResponses;
 
-    static void processRPMMessage(String message);
-    static void processTemperatureMessage(String message);
-    static void processCheckECUMessage(String message);
-    static void processEngineLoadMessage(String message);
-    static void processSpeedMessage(String message);
-    static void debugPrint(String message);
+    static void onECUAwake();
+    static void onValue(const PIDDescriptor& descriptor, int32_t value, uint32_t receivedAt);
     
 public:
-    static void setECUState(ECU_STATUS* state);
-    static void setLCD(LiquidCrystal_I2C *lcdInstance);
-    static void processAndShowMessage(String message);
-    static void enableDebug(bool enable);
-    static void setDebugSerial(HardwareSerial* serial);
+    static void begin(ECU_STATUS* state);
+    static void processAndShowMessage(char* response, size_t length, unsigned long receivedAt);
 };
 
 #endif
\ No newline at end of file
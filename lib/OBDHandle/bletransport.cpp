@@ -0,0 +1,144 @@
+#include "bletransport.h"
+
+static const char TAG[] = "BLETransport";
+
+BLETransport* BLETransport::active = nullptr;
+
+BLETransport::BLETransport()
+    : client(nullptr), handlesValid(false), handlesChanged(false), usingCachedHandles(false) {
+    memset(&handles, 0, sizeof(handles));
+}
+
+void BLETransport::begin(const char* deviceName) {
+    BLEDevice::init(deviceName);
+    client = BLEDevice::createClient();
+    active = this;
+    BLEDevice::setCustomGattcHandler(onGattcEvent);
+}
+
+// Sees every GATT client event on the BLE stack's task. Only the RX
+// notifications of the current connection are of interest.
+void BLETransport::onGattcEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattcIf, esp_ble_gattc_cb_param_t* param) {
+    BLETransport* transport = active;
+    if (transport == nullptr || event != ESP_GATTC_NOTIFY_EVT) return;
+    if (!transport->handlesValid || param->notify.handle != transport->handles.rx) return;
+    transport->deliver(param->notify.value, param->notify.value_len);
+}
+
+// Full service and characteristic discovery, a second or so on the clones
+bool BLETransport::discoverHandles() {
+    BLERemoteService* pRemoteService = client->getService(serviceUUID);
+    if (pRemoteService == nullptr) {
+        LOG_E(TAG, "Service not found");
+        return false;
+    }
+    LOG_D(TAG, "Service found");
+
+    BLERemoteCharacteristic* charTX = pRemoteService->getCharacteristic(charUUID_TX);
+    BLERemoteCharacteristic* charRX = pRemoteService->getCharacteristic(charUUID_RX);
+    if (charTX == nullptr || charRX == nullptr || !charRX->canNotify()) {
+        LOG_E(TAG, "Characteristics not found");
+        return false;
+    }
+    BLERemoteDescriptor* rxConfig = charRX->getDescriptor(BLEUUID((uint16_t)0x2902));
+    LOG_D(TAG, "Characteristics found");
+
+    BLEHandleCache found;
+    found.tx = charTX->getHandle();
+    found.rx = charRX->getHandle();
+    found.rxConfig = rxConfig != nullptr ? rxConfig->getHandle() : found.rx + 1;
+    if (!handlesValid || memcmp(&found, &handles, sizeof(found)) != 0) handlesChanged = true;
+    handles = found;
+    handlesValid = true;
+    return true;
+}
+
+bool BLETransport::enableNotifications(BLEAddress& address) {
+    uint8_t enable[2] = { 0x01, 0x00 };
+    if (esp_ble_gattc_register_for_notify(client->getGattcIf(), *address.getNative(), handles.rx) != ESP_OK) return false;
+    return esp_ble_gattc_write_char_descr(client->getGattcIf(), client->getConnId(), handles.rxConfig, sizeof(enable), enable,
+                                          ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
+}
+
+bool BLETransport::connect(const char* address) {
+    LOG_I(TAG, "Connecting to %s", address);
+
+    BLEAddress targetAddress(address);
+    if (!client->connect(targetAddress)) {
+        LOG_W(TAG, "BLE connection failed");
+        return false;
+    }
+    LOG_I(TAG, "BLE connection successful");
+
+    usingCachedHandles = handlesValid;
+    if (usingCachedHandles) {
+        LOG_D(TAG, "Using cached handles, skipping discovery");
+    } else if (!discoverHandles()) {
+        client->disconnect();
+        return false;
+    }
+
+    if (!enableNotifications(targetAddress)) {
+        LOG_E(TAG, "Could not enable notifications");
+        client->disconnect();
+        return false;
+    }
+    return true;
+}
+
+void BLETransport::disconnect() {
+    if (client != nullptr && client->isConnected()) client->disconnect();
+}
+
+bool BLETransport::isConnected() {
+    return client != nullptr && client->isConnected();
+}
+
+bool BLETransport::write(const uint8_t* data, size_t length) {
+    if (!handlesValid || !isConnected()) return false;
+    return esp_ble_gattc_write_char(client->getGattcIf(), client->getConnId(), handles.tx, length, (uint8_t*)data,
+                                    ESP_GATT_WRITE_TYPE_NO_RSP, ESP_GATT_AUTH_REQ_NONE) == ESP_OK;
+}
+
+const char* BLETransport::getName() const {
+    return "ble";
+}
+
+void BLETransport::setHandleCache(const BLEHandleCache& cache) {
+    handles = cache;
+    handlesValid = cache.tx != 0 && cache.rx != 0 && cache.rxConfig != 0;
+    handlesChanged = false;
+}
+
+const BLEHandleCache& BLETransport::getHandleCache() const {
+    return handles;
+}
+
+bool BLETransport::isUsingCachedHandles() const {
+    return usingCachedHandles;
+}
+
+// The cached handles did not work (the adapter got another firmware), the
+// next connect discovers them again
+void BLETransport::forgetHandles() {
+    handlesValid = false;
+    usingCachedHandles = false;
+}
+
+bool BLETransport::takeHandlesChanged() {
+    bool changed = handlesChanged;
+    handlesChanged = false;
+    return changed;
+}
+
+void BLETransport::setServiceUUID(const char* uuid) {
+    serviceUUID = BLEUUID(uuid);
+}
+
+void BLETransport::setCharUUID_TX(const char* uuid) {
+    charUUID_TX = BLEUUID(uuid);
+}
+
+void BLETransport::setCharUUID_RX(const char* uuid) {
+    charUUID_RX = BLEUUID(uuid);
+}
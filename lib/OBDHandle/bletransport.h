@@ -0,0 +1,57 @@
+#ifndef BLETRANSPORT_H
+#define BLETRANSPORT_H
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <elmtransport.h>
+#include <logring.h>
+
+// GATT handles of the adapter's characteristics. They only change with the
+// adapter's firmware, so they are kept per adapter and reused on reconnect.
+struct BLEHandleCache {
+    uint16_t tx;
+    uint16_t rx;
+    uint16_t rxConfig;      // Client Characteristic Configuration of rx
+};
+
+// ELM327 v2.1 BLE clone: commands go to the TX characteristic, responses
+// arrive as notifications on the RX characteristic.
+//
+// Writes and notifications use the raw GATT handles, so with a valid
+// BLEHandleCache a reconnect skips service and characteristic discovery.
+class BLETransport : public ELMTransport {
+public:
+    BLETransport();
+    void begin(const char* deviceName);
+    void setServiceUUID(const char* uuid);
+    void setCharUUID_TX(const char* uuid);
+    void setCharUUID_RX(const char* uuid);
+    bool connect(const char* address) override;
+    void disconnect() override;
+    bool isConnected() override;
+    bool write(const uint8_t* data, size_t length) override;
+    const char* getName() const override;
+    void setHandleCache(const BLEHandleCache& cache);
+    const BLEHandleCache& getHandleCache() const;
+    bool isUsingCachedHandles() const;
+    void forgetHandles();
+    bool takeHandlesChanged();
+
+private:
+    static BLETransport* active;
+
+    BLEUUID serviceUUID;
+    BLEUUID charUUID_TX;
+    BLEUUID charUUID_RX;
+    BLEClient* client;
+    BLEHandleCache handles;
+    bool handlesValid;
+    bool handlesChanged;
+    bool usingCachedHandles;
+
+    bool discoverHandles();
+    bool enableNotifications(BLEAddress& address);
+    static void onGattcEvent(esp_gattc_cb_event_t event, esp_gatt_if_t gattcIf, esp_ble_gattc_cb_param_t* param);
+};
+
+#endif
@@ -1,143 +1,485 @@
 #include "obdhandle.h"
 
+static const char TAG[] = "OBDHandle";
+
 // Definição das variáveis estáticas
-BLEUUID OBDHandle::serviceUUID;
-BLEUUID OBDHandle::charUUID_TX;
-BLEUUID OBDHandle::charUUID_RX;
-BLERemoteCharacteristic* OBDHandle::pCharTX = nullptr;
-BLERemoteCharacteristic* OBDHandle::pCharRX = nullptr;
+BLETransport OBDHandle::bleTransport;
+SPPTransport OBDHandle::sppTransport;
+TCPTransport OBDHandle::tcpTransport;
+ELMTransport* OBDHandle::transport = &OBDHandle::bleTransport;
+uint8_t OBDHandle::transportKind = ELM_TRANSPORT_BLE;
+char OBDHandle::adapterSSID[ELM_ADAPTER_SSID_SIZE] = "";
+char OBDHandle::adapterPassword[ELM_ADAPTER_PASSWORD_SIZE] = "";
+char OBDHandle::responseBuffer[RESPONSE_BUFFER_SIZE];
+size_t OBDHandle::responseLength = 0;
+bool OBDHandle::responseOverflow = false;
+volatile uint16_t OBDHandle::responseGeneration = 0;
+volatile uint16_t OBDHandle::completedGeneration = 0;
+volatile uint16_t OBDHandle::lostGeneration = 0;
+uint16_t OBDHandle::bufferGeneration = 0;
+uint32_t OBDHandle::droppedFrames = 0;
+ReceiveRing OBDHandle::receiveRing;
+OBDHandleLink OBDHandle::link;
+unsigned long OBDHandle::lastRoundTripMs = 0;
+volatile bool OBDHandle::lastResponseEchoed = false;
+volatile bool OBDHandle::rawResponse = false;
+char OBDHandle::blockingReply[AT_REPLY_SIZE];
 
-BLEClient* OBDHandle::pClient = nullptr;
-String OBDHandle::lastResponse = "";
-bool OBDHandle::debugEnabled = false;
-HardwareSerial* OBDHandle::debugSerial = nullptr;
-bool OBDHandle::messageReceived = false;
+QueueHandle_t OBDHandle::commandQueue = nullptr;
+TaskHandle_t OBDHandle::engineTask = nullptr;
+TaskHandle_t OBDHandle::decoderTask = nullptr;
+TaskHandle_t OBDHandle::socketTask = nullptr;
+SemaphoreHandle_t OBDHandle::blockingDone = nullptr;
+volatile bool OBDHandle::blockingResponded = false;
 
-void OBDHandle::debugPrint(String message) {
-    if (debugEnabled && debugSerial != nullptr) {
-        debugSerial->println("[OBDHandle] " + message);
-    }
+// Before begin(): only the chosen transport's stack is started, BLE and
+// classic Bluetooth together would not leave the web server enough heap
+void OBDHandle::setTransport(uint8_t kind) {
+    transportKind = kind < ELM_TRANSPORT_KIND_COUNT ? kind : (uint8_t)ELM_TRANSPORT_BLE;
+}
+
+uint8_t OBDHandle::getTransport() {
+    return transportKind;
+}
+
+const char* OBDHandle::getTransportName() {
+    return transport->getName();
+}
+
+// Access point of a WiFi adapter, joined by connect() before the socket
+void OBDHandle::setAdapterNetwork(const char* ssid, const char* password) {
+    strlcpy(adapterSSID, ssid, sizeof(adapterSSID));
+    strlcpy(adapterPassword, password, sizeof(adapterPassword));
 }
 
 bool OBDHandle::begin() {
-    BLEDevice::init("ESP32_PAINEL");
-    pClient = BLEDevice::createClient();
+    switch (transportKind) {
+        case ELM_TRANSPORT_SPP:
+            sppTransport.begin("ESP32_PAINEL");
+            transport = &sppTransport;
+            break;
+        case ELM_TRANSPORT_TCP:
+            transport = &tcpTransport;
+            break;
+        default:
+            bleTransport.begin("ESP32_PAINEL");
+            transport = &bleTransport;
+            break;
+    }
+    LOG_I(TAG, "Transport: %s", transport->getName());
+    transport->setReceiver(onTransportData, nullptr);
+
+    commandQueue = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(OBDCommand));
+    blockingDone = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(
+        commandEngineTask,
+        "OBD_Engine",
+        4096,
+        NULL,
+        2,
+        &engineTask,
+        1
+    );
+    xTaskCreatePinnedToCore(
+        responseDecoderTask,
+        "OBD_Decoder",
+        4096,
+        NULL,
+        3,
+        &decoderTask,
+        1
+    );
+    if (transport->needsPolling()) {
+        xTaskCreatePinnedToCore(
+            socketReaderTask,
+            "OBD_Socket",
+            3072,
+            NULL,
+            4,
+            &socketTask,
+            1
+        );
+    }
     return  true;
 }
-void OBDHandle::notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
-    if(messageReceived == true) {
-        debugPrint("Warning: Previous message still being processed. New message may be ignored.");
+
+// Stands in for the Bluetooth task of BLE and SPP: blocks in select() on the
+// socket and hands what arrived to onTransportData
+void OBDHandle::socketReaderTask(void* pvParameters) {
+    for (;;) {
+        if (!transport->isConnected()) {
+            vTaskDelay(pdMS_TO_TICKS(SOCKET_POLL_MS));
+            continue;
+        }
+        transport->poll(SOCKET_POLL_MS);
+    }
+}
+
+// Runs on the Bluetooth stack's task (the socket reader for TCP): only copies the notification into the ring
+// and wakes the decoder, parsing and the display/NVS work happen elsewhere.
+void OBDHandle::onTransportData(const uint8_t* data, size_t length, void* context) {
+    uint16_t generation = responseGeneration;
+    if(generation == completedGeneration) {
+        LOG_D(TAG, "Unsolicited data ignored");
         return;
     }
 
-    for (int i = 0; i < length; i++) {
-        lastResponse += (char)pData[i];
+    if (!receiveRing.push(data, length, millis(), generation)) {
+        // The frame this chunk belongs to is incomplete now, the decoder drops it
+        lostGeneration = generation;
+    }
+    xTaskNotifyGive(decoderTask);
+}
+
+// Assembles the chunks of the current command into responseBuffer until the
+// '>' prompt. Chunks tagged with an older generation are late bytes of a
+// command that already completed or timed out and are thrown away.
+void OBDHandle::responseDecoderTask(void* pvParameters) {
+    ReceiveChunk chunk;
+    for(;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (receiveRing.peek(chunk)) {
+            if (chunk.generation != responseGeneration || chunk.generation == completedGeneration) {
+                receiveRing.pop(chunk, nullptr, 0);
+                continue;
+            }
+            if (chunk.generation != bufferGeneration) {
+                bufferGeneration = chunk.generation;
+                responseLength = 0;
+                responseOverflow = false;
+            }
+
+            size_t room = RESPONSE_BUFFER_SIZE - responseLength;
+            char* start = responseBuffer + responseLength;
+            receiveRing.pop(chunk, (uint8_t*)start, room);
+            size_t copied = chunk.length < room ? chunk.length : room;
+
+            const char* prompt = (const char*)memchr(start, '>', copied);
+            if (prompt == nullptr) {
+                if (chunk.length > room) responseOverflow = true;
+                responseLength += copied;
+                continue;
+            }
+            responseLength = (size_t)(prompt - responseBuffer) + 1;
+            completeResponse(chunk.timestampMs);
+        }
     }
-    
-    if(lastResponse.indexOf('>') != -1) {
-        MessageHandle::processAndShowMessage(lastResponse);
-        debugPrint("Message Received: " + lastResponse);
-        messageReceived = true;
-        lastResponse = "";
+}
+
+void OBDHandle::completeResponse(unsigned long receivedAt) {
+    if (responseOverflow) {
+        droppedFrames++;
+        LOG_W(TAG, "Response larger than %u bytes dropped", (unsigned)RESPONSE_BUFFER_SIZE);
+    } else if (lostGeneration == bufferGeneration) {
+        droppedFrames++;
+        LOG_W(TAG, "Receive ring full, incomplete response dropped");
+    } else if (!rawResponse) {
+        MessageHandle::processAndShowMessage(responseBuffer, responseLength, receivedAt);
     }
+    completedGeneration = bufferGeneration;
+    // The prompt means the adapter is idle, wake the engine so the next command goes out now
+    xTaskNotifyGive(engineTask);
 }
 
-void OBDHandle::sendCommand(String command) {
-    if(!command.endsWith("\r")) command += "\r";
-    
-    debugPrint("Sending: " + command);
+// Owns the adapter: takes one command at a time from the queue, writes it and
+// sleeps on a task notification until the decoder sees the '>' prompt or the
+// command's own timeout expires. No polling, so the next queued command is
+// written as soon as the previous response is complete.
+void OBDHandle::commandEngineTask(void* pvParameters) {
+    OBDCommand command;
+    for(;;) {
+        if (xQueueReceive(commandQueue, &command, portMAX_DELAY) != pdTRUE) continue;
 
-    lastResponse = ""; 
-    messageReceived = false;
-    pCharTX->writeValue((uint8_t*)command.c_str(), command.length(), false);
+        unsigned long startTime = millis();
+        bool responded;
+        if (command.pidCount > 0) {
+            command.answered = OBDSession::requestPIDs(link, command.pids, command.pidCount, command.timeoutMs);
+            responded = command.answered != 0;
+        } else {
+            responded = transmit(command.text, command.timeoutMs);
+        }
 
+        if (command.callback != nullptr) {
+            command.callback(command, responded, millis() - startTime);
+        }
+    }
+}
+
+bool OBDHandle::transmit(const char* text, unsigned long timeoutMs) {
+    LOG_D(TAG, "Sending: %.*s", (int)strcspn(text, "\r"), text);
+
+    ulTaskNotifyTake(pdTRUE, 0);
+    uint16_t generation = responseGeneration + 1;
+    if (generation == completedGeneration) generation++;
+    responseGeneration = generation;
+    // AT replies carry no ECU data, they are left as text for exchange()
+    rawResponse = text[0] == 'A' && text[1] == 'T';
     unsigned long startTime = millis();
-    unsigned long timeout = 1000; 
+    transport->write((const uint8_t*)text, strlen(text));
 
-    if (command.startsWith("AT")) {
-        timeout = 3000; 
-    }
-    
-    while (messageReceived == false) {
-        if (millis() - startTime > timeout) {
-            debugPrint("Command timeout after " + String(timeout) + "ms");
-            return;
+    // A wake-up from the previous command's late prompt does not count
+    while (completedGeneration != generation) {
+        unsigned long elapsed = millis() - startTime;
+        if (elapsed >= timeoutMs || ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs - elapsed)) == 0) {
+            completedGeneration = generation;
+            lastRoundTripMs = millis() - startTime;
+            OBDMetrics::recordCommand(lastRoundTripMs, false);
+            LOG_D(TAG, "Command timeout after %lu ms", timeoutMs);
+            return false;
         }
-        delay(10);
-        yield(); 
     }
 
-    debugPrint("Response received in " + String(millis() - startTime) + "ms");
+    lastRoundTripMs = millis() - startTime;
+    // The decoder is done with responseBuffer, the next response needs a new write
+    size_t commandLength = strlen(text) - 1;
+    lastResponseEchoed = responseLength >= commandLength && memcmp(responseBuffer, text, commandLength) == 0;
+    OBDMetrics::recordCommand(lastRoundTripMs, true);
+    LOG_D(TAG, "Response received in %lu ms", lastRoundTripMs);
+    return true;
+}
+
+// OBDSession's commands. On the engine task (PID requests, timing changes)
+// they are written right away, from any other task (the setup, the probes)
+// they are queued behind the pending ones.
+bool OBDHandle::exchange(const char* text, unsigned long timeoutMs, char* reply, size_t size) {
+    const char* source;
+    size_t length;
+    if (xTaskGetCurrentTaskHandle() == engineTask) {
+        if (!transmit(text, timeoutMs)) return false;
+        source = responseBuffer;
+        length = responseLength;
+    } else {
+        if (!sendCommand(text, timeoutMs)) return false;
+        source = blockingReply;
+        length = strlen(blockingReply);
+    }
+    if (reply != nullptr && size > 0) {
+        if (length >= size) length = size - 1;
+        memcpy(reply, source, length);
+        reply[length] = '\0';
+    }
+    return true;
+}
+
+bool OBDHandleLink::exchange(const char* text, uint32_t timeoutMs, char* reply, size_t size) {
+    return OBDHandle::exchange(text, timeoutMs, reply, size);
+}
+
+uint32_t OBDHandleLink::now() {
+    return millis();
+}
+
+bool OBDHandle::submitCommand(const char* text, unsigned long timeoutMs, OBDCommandCallback callback, void* context) {
+    OBDCommand command;
+    size_t length = strlen(text);
+    if (length + 2 > MAX_COMMAND_LENGTH) return false;
+
+    memcpy(command.text, text, length);
+    if (length == 0 || text[length - 1] != '\r') command.text[length++] = '\r';
+    command.text[length] = '\0';
+    command.pidCount = 0;
+    command.answered = 0;
+    command.timeoutMs = timeoutMs;
+    command.callback = callback;
+    command.context = context;
+    return xQueueSend(commandQueue, &command, 0) == pdTRUE;
+}
+
+bool OBDHandle::submitPIDs(const uint8_t* pids, uint8_t count, OBDCommandCallback callback, void* context) {
+    if (count == 0) return false;
+    if (count > MAX_PIDS_PER_REQUEST) count = MAX_PIDS_PER_REQUEST;
+
+    OBDCommand command;
+    OBDSession::buildPIDCommand(command.text, pids, count);
+    memcpy(command.pids, pids, count);
+    command.pidCount = count;
+    command.answered = 0;
+    command.timeoutMs = PID_COMMAND_TIMEOUT_MS;
+    command.callback = callback;
+    command.context = context;
+    return xQueueSend(commandQueue, &command, 0) == pdTRUE;
+}
+
+uint8_t OBDHandle::pendingCommands() {
+    return uxQueueMessagesWaiting(commandQueue);
+}
+
+// Runs on the engine task right after the exchange, while responseBuffer still
+// holds this command's reply
+void OBDHandle::onBlockingCommandDone(const OBDCommand& command, bool responded, unsigned long elapsedMs) {
+    blockingResponded = responded;
+    size_t length = responded ? responseLength : 0;
+    if (length >= AT_REPLY_SIZE) length = AT_REPLY_SIZE - 1;
+    memcpy(blockingReply, responseBuffer, length);
+    blockingReply[length] = '\0';
+    xSemaphoreGive(blockingDone);
+}
+
+// Blocking wrapper for the init sequence and the ECU probe: queues the command
+// behind anything already pending and waits on its completion, not on a flag.
+// Without a timeout AT commands get AT_COMMAND_TIMEOUT_MS, requests PID_COMMAND_TIMEOUT_MS.
+bool OBDHandle::sendCommand(String command, unsigned long timeoutMs) {
+    if (timeoutMs == 0) timeoutMs = command.startsWith("AT") ? AT_COMMAND_TIMEOUT_MS : PID_COMMAND_TIMEOUT_MS;
+    if (!submitCommand(command.c_str(), timeoutMs, onBlockingCommandDone, nullptr)) {
+        LOG_W(TAG, "Command queue full, dropping: %s", command.c_str());
+        return false;
+    }
+    xSemaphoreTake(blockingDone, portMAX_DELAY);
+    return blockingResponded;
+}
+
+void OBDHandle::setBatchEnabled(bool enable) {
+    OBDSession::setBatchEnabled(enable);
+}
+
+bool OBDHandle::isBatchEnabled() {
+    return OBDSession::isBatchEnabled();
+}
+
+void OBDHandle::setResponseCountEnabled(bool enable) {
+    OBDSession::setResponseCountEnabled(enable);
+}
+
+bool OBDHandle::isResponseCountEnabled() {
+    return OBDSession::isResponseCountEnabled();
+}
+
+// The adapter is powered by the OBD port and keeps its settings when the
+// ESP32 restarts or the BLE link drops. Echo is on after every reset
+// (power-on, ATZ, ATWS), so an "ATE0" that comes back without its echo means
+// the starter configuration is still in effect and only the timing is re-sent.
+bool OBDHandle::initAdapter() {
+    ELMProtocol::setConfirmed(false);
+    if (!sendCommand("ATE0")) return false;
+    if (!lastResponseEchoed) {
+        LOG_I(TAG, "Adapter already configured, skipping init");
+        syncTiming();
+        return true;
+    }
+    OBDSession::sendStarterCommands(link);
+    ELMTiming::reset();
+    return true;
 }
 
-void OBDHandle::sendStarterCommand(){
-    OBDHandle::sendCommand("ATZ");    // Reset the chip
-    OBDHandle::sendCommand("ATE0");   // Echo Off
-    OBDHandle::sendCommand("ATH0");   // Headers Off
-    OBDHandle::sendCommand("ATSP1");  // FORD STREET Protocol
-    OBDHandle::sendCommand("ATAT1");  // Adaptive Timing
-    OBDHandle::sendCommand("ATL0");   // Linefeeds Off
+// After an ESP32 restart ELMTiming starts from the defaults while the adapter
+// may still run an older ATST/ATAT2, bring the adapter back in line
+void OBDHandle::syncTiming() {
+    char text[8];
+    snprintf(text, sizeof(text), "ATST%02X", ELMTiming::getTimeoutSetting());
+    sendCommand(text);
+    snprintf(text, sizeof(text), "ATAT%u", ELMTiming::getAdaptiveTiming());
+    sendCommand(text);
 }
 
+// With cached GATT handles and a configured adapter this is the BLE connection
+// plus three short AT commands. Cached handles that get no answer are dropped,
+// the caller's next attempt does the full discovery.
 bool OBDHandle::connect(const char* address) {
-    debugPrint("Attempting to connect to: " + String(address));
-    
-    BLEAddress targetAddress(address);
-
-    if (pClient->connect(targetAddress)) {
-        debugPrint("BLE connection successful");
-        
-        BLERemoteService* pRemoteService = pClient->getService(serviceUUID);
-        if (pRemoteService != nullptr) {
-            debugPrint("Service found");
-            
-            pCharTX = pRemoteService->getCharacteristic(charUUID_TX);
-            pCharRX = pRemoteService->getCharacteristic(charUUID_RX);
-            
-            if (pCharTX != nullptr && pCharRX != nullptr) {
-                debugPrint("Characteristics found");
-                
-                if(pCharRX->canNotify()) {
-                    pCharRX->registerForNotify([](BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify) {
-                        OBDHandle::notifyCallback(pBLERemoteCharacteristic, pData, length, isNotify);
-                    });
-                }
-                sendStarterCommand();
-                debugPrint("Connection established successfully");
-                return true;
-            } else {
-                debugPrint("ERROR: Characteristics not found");
-            }
-        } else {
-            debugPrint("ERROR: Service not found");
+    if (transportKind == ELM_TRANSPORT_TCP && !joinAdapterNetwork()) return false;
+    if (!transport->connect(address)) return false;
+
+    if (!initAdapter()) {
+        if (transport == &bleTransport && bleTransport.isUsingCachedHandles()) {
+            LOG_W(TAG, "No answer through the cached handles, discovering them again");
+            bleTransport.forgetHandles();
         }
-    } else {
-        debugPrint("ERROR: BLE connection failed");
+        transport->disconnect();
+        return false;
+    }
+    LOG_I(TAG, "Connection established");
+    return true;
+}
+
+// WiFi adapters are access points. The station joins it next to the
+// dashboard's own AP, which moves to the adapter's channel (one radio).
+bool OBDHandle::joinAdapterNetwork() {
+    if (WiFi.status() == WL_CONNECTED) return true;
+    if (adapterSSID[0] == '\0') {
+        LOG_E(TAG, "No adapter network configured");
+        return false;
+    }
+    LOG_I(TAG, "Joining %s", adapterSSID);
+    WiFi.mode(WIFI_AP_STA);
+    WiFi.begin(adapterSSID, adapterPassword[0] != '\0' ? adapterPassword : nullptr);
+    unsigned long start = millis();
+    while (WiFi.status() != WL_CONNECTED) {
+        if (millis() - start > WIFI_JOIN_TIMEOUT_MS) {
+            LOG_W(TAG, "Adapter network not reachable");
+            return false;
+        }
+        delay(100);
     }
-    return false;
+    return true;
 }
 
+void OBDHandle::disconnect() {
+    transport->disconnect();
+}
+
+bool OBDHandle::isConnected() {
+    return transport->isConnected();
+}
+
+void OBDHandle::setHandleCache(const BLEHandleCache& cache) {
+    bleTransport.setHandleCache(cache);
+}
+
+const BLEHandleCache& OBDHandle::getHandleCache() {
+    return bleTransport.getHandleCache();
+}
+
+bool OBDHandle::takeHandlesChanged() {
+    return transport == &bleTransport && bleTransport.takeHandlesChanged();
+}
+
+// The setup steps shared with the native runner, see OBDSession
 void OBDHandle::checkECU() {
-    debugPrint("Checking ECU status...");
-    sendCommand("0100\r");
+    OBDSession::probeECU(link);
 }
 
-void OBDHandle::setServiceUUID(const char* uuid) {
-    serviceUUID = BLEUUID(uuid);
+void OBDHandle::detectProtocol() {
+    OBDSession::detectProtocol(link);
 }
 
-void OBDHandle::setCharUUID_TX(const char* uuid) {
-    charUUID_TX = BLEUUID(uuid);
+void OBDHandle::discoverSupportedPIDs() {
+    OBDSession::discoverSupportedPIDs(link);
 }
 
-void OBDHandle::setCharUUID_RX(const char* uuid) {
-    charUUID_RX = BLEUUID(uuid);
+// ATI is answered by the adapter itself, the car is not involved: its round
+// trip is the transport's (radio or socket, adapter UART), once per connection
+void OBDHandle::measureRoundTrip() {
+    uint32_t samples[TRANSPORT_PROBE_COUNT];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < TRANSPORT_PROBE_COUNT; i++) {
+        unsigned long start = micros();
+        if (!sendCommand("ATI")) continue;
+        samples[count++] = micros() - start;
+    }
+    OBDMetrics::recordTransportProbe(transport->getName(), samples, count);
+    LOG_I(TAG, "Round trip over %s: p50 %u us", transport->getName(), (unsigned)OBDMetrics::getTransportRoundTrip().medianUs);
+}
+
+uint32_t OBDHandle::getDroppedFrames() {
+    return droppedFrames;
 }
 
-void OBDHandle::enableDebug(bool enable) {
-    debugEnabled = enable;
+uint32_t OBDHandle::getDroppedNotifications() {
+    return receiveRing.getDropped();
 }
 
-void OBDHandle::setDebugSerial(HardwareSerial* serial) {
-    debugSerial = serial;
-}
\ No newline at end of file
+uint32_t OBDHandle::getReceiveHighWater() {
+    return receiveRing.getHighWater();
+}
+
+void OBDHandle::setServiceUUID(const char* uuid) {
+    bleTransport.setServiceUUID(uuid);
+}
+
+void OBDHandle::setCharUUID_TX(const char* uuid) {
+    bleTransport.setCharUUID_TX(uuid);
+}
+
+void OBDHandle::setCharUUID_RX(const char* uuid) {
+    bleTransport.setCharUUID_RX(uuid);
+}
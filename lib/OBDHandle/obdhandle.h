@@ -2,39 +2,119 @@
 #define OBDHANDLE
 
 #include <Arduino.h>
-#include <BLEDevice.h>
+#include <WiFi.h>
+#include <bletransport.h>
+#include <spptransport.h>
+#include <tcptransport.h>
 #include <messagehandle.h>
+#include <receivering.h>
+#include <obdmetrics.h>
+#include <elmtiming.h>
+#include <elmprotocol.h>
+#include <obdsession.h>
+#include <logring.h>
+
+#define COMMAND_QUEUE_LENGTH 8
+#define TRANSPORT_PROBE_COUNT 8
+#define SOCKET_POLL_MS 100
+#define WIFI_JOIN_TIMEOUT_MS 8000
+
+struct OBDCommand;
+typedef void (*OBDCommandCallback)(const OBDCommand& command, bool responded, unsigned long elapsedMs);
+
+struct OBDCommand {
+    char text[MAX_COMMAND_LENGTH];
+    uint8_t pids[MAX_PIDS_PER_REQUEST];
+    uint8_t pidCount;
+    uint8_t answered;           // bit i set when pids[i] was decoded, filled in before the callback
+    unsigned long timeoutMs;
+    OBDCommandCallback callback;
+    void* context;
+};
+
+// OBDSession's way to the adapter, see OBDHandle::exchange
+class OBDHandleLink : public OBDLink {
+public:
+    bool exchange(const char* text, uint32_t timeoutMs, char* reply, size_t size) override;
+    uint32_t now() override;
+};
 
 class OBDHandle {
 private:
+friend class OBDHandleLink;
 
-static BLEUUID serviceUUID;
-static BLEUUID charUUID_TX;
-static BLEUUID charUUID_RX;
-static BLERemoteCharacteristic* pCharTX;
-static BLERemoteCharacteristic* pCharRX;
+static BLETransport bleTransport;
+static SPPTransport sppTransport;
+static TCPTransport tcpTransport;
+static ELMTransport* transport;
+static uint8_t transportKind;
+static char adapterSSID[ELM_ADAPTER_SSID_SIZE];
+static char adapterPassword[ELM_ADAPTER_PASSWORD_SIZE];
+static char responseBuffer[RESPONSE_BUFFER_SIZE];
+static size_t responseLength;
+static bool responseOverflow;
+static volatile uint16_t responseGeneration;
+static volatile uint16_t completedGeneration;
+static volatile uint16_t lostGeneration;
+static uint16_t bufferGeneration;
+static uint32_t droppedFrames;
+static ReceiveRing receiveRing;
+static OBDHandleLink link;
+static unsigned long lastRoundTripMs;
+static volatile bool lastResponseEchoed;
+static volatile bool rawResponse;
+static char blockingReply[AT_REPLY_SIZE];
 
-static BLEClient* pClient;
-static String lastResponse;
-static bool debugEnabled;
-static HardwareSerial* debugSerial;
-static bool messageReceived;
+static QueueHandle_t commandQueue;
+static TaskHandle_t engineTask;
+static TaskHandle_t decoderTask;
+static TaskHandle_t socketTask;
+static SemaphoreHandle_t blockingDone;
+static volatile bool blockingResponded;
 
-static void notifyCallback(BLERemoteCharacteristic* pBLERemoteCharacteristic, uint8_t* pData, size_t length, bool isNotify);
-static void sendStarterCommand();
-static void debugPrint(String message);
+static void onTransportData(const uint8_t* data, size_t length, void* context);
+static bool initAdapter();
+static void syncTiming();
+static void commandEngineTask(void* pvParameters);
+static void responseDecoderTask(void* pvParameters);
+static void socketReaderTask(void* pvParameters);
+static bool joinAdapterNetwork();
+static void completeResponse(unsigned long receivedAt);
+static bool transmit(const char* text, unsigned long timeoutMs);
+static bool exchange(const char* text, unsigned long timeoutMs, char* reply, size_t size);
+static void onBlockingCommandDone(const OBDCommand& command, bool responded, unsigned long elapsedMs);
 
 
 public:
 static void setServiceUUID(const char* uuid);
 static void setCharUUID_TX(const char* uuid);
 static void setCharUUID_RX(const char* uuid);
+static void setTransport(uint8_t kind);
+static uint8_t getTransport();
+static const char* getTransportName();
+static void setAdapterNetwork(const char* ssid, const char* password);
 static bool begin();
 static bool connect(const char* address);
-static void sendCommand(String command);
+static void disconnect();
+static bool isConnected();
+static void setHandleCache(const BLEHandleCache& cache);
+static const BLEHandleCache& getHandleCache();
+static bool takeHandlesChanged();
+static bool submitCommand(const char* text, unsigned long timeoutMs, OBDCommandCallback callback, void* context);
+static bool submitPIDs(const uint8_t* pids, uint8_t count, OBDCommandCallback callback, void* context);
+static uint8_t pendingCommands();
+static bool sendCommand(String command, unsigned long timeoutMs = 0);
+static void setBatchEnabled(bool enable);
+static bool isBatchEnabled();
+static void setResponseCountEnabled(bool enable);
+static bool isResponseCountEnabled();
 static void checkECU();
-static void enableDebug(bool enable);
-static void setDebugSerial(HardwareSerial* serial);
+static void detectProtocol();
+static void discoverSupportedPIDs();
+static void measureRoundTrip();
+static uint32_t getDroppedFrames();
+static uint32_t getDroppedNotifications();
+static uint32_t getReceiveHighWater();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#include "spptransport.h"
+
+static const char TAG[] = "SPPTransport";
+
+SPPTransport::SPPTransport() : started(false) {}
+
+// Starts the classic Bluetooth stack as master, only when SPP is the chosen transport
+void SPPTransport::begin(const char* deviceName) {
+    started = serial.begin(deviceName, true);
+    serial.setPin(SPP_TRANSPORT_PIN);
+    serial.onData([this](const uint8_t* data, size_t length) {
+        deliver(data, length);
+    });
+}
+
+// "66:1e:32:7a:35:0e" into six bytes
+bool SPPTransport::parseMAC(const char* address, uint8_t* mac) {
+    unsigned int bytes[6];
+    if (sscanf(address, "%2x:%2x:%2x:%2x:%2x:%2x", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5]) != 6) return false;
+    for (uint8_t i = 0; i < 6; i++) mac[i] = (uint8_t)bytes[i];
+    return true;
+}
+
+bool SPPTransport::connect(const char* address) {
+    uint8_t mac[6];
+    if (!started || !parseMAC(address, mac)) {
+        LOG_E(TAG, "Bluetooth not started or bad address %s", address);
+        return false;
+    }
+    LOG_I(TAG, "Connecting to %s", address);
+    if (!serial.connect(mac)) {
+        LOG_W(TAG, "SPP connection failed");
+        return false;
+    }
+    LOG_I(TAG, "SPP connection successful");
+    return true;
+}
+
+void SPPTransport::disconnect() {
+    if (started && serial.connected(0)) serial.disconnect();
+}
+
+bool SPPTransport::isConnected() {
+    return started && serial.connected(0);
+}
+
+bool SPPTransport::write(const uint8_t* data, size_t length) {
+    if (!isConnected()) return false;
+    return serial.write(data, length) == length;
+}
+
+const char* SPPTransport::getName() const {
+    return "spp";
+}
@@ -0,0 +1,32 @@
+#ifndef SPPTRANSPORT_H
+#define SPPTRANSPORT_H
+
+#include <Arduino.h>
+#include <BluetoothSerial.h>
+#include <elmtransport.h>
+#include <logring.h>
+
+#define SPP_TRANSPORT_PIN "1234"
+
+// Classic Bluetooth ELM327 clone (serial port profile). The ESP32 connects as
+// master to the adapter's MAC; what the adapter sends arrives through
+// BluetoothSerial's data callback on the Bluetooth task, in RFCOMM frames of
+// up to a few hundred bytes instead of 20-byte BLE notifications.
+class SPPTransport : public ELMTransport {
+public:
+    SPPTransport();
+    void begin(const char* deviceName);
+    bool connect(const char* address) override;
+    void disconnect() override;
+    bool isConnected() override;
+    bool write(const uint8_t* data, size_t length) override;
+    const char* getName() const override;
+
+    static bool parseMAC(const char* address, uint8_t* mac);
+
+private:
+    BluetoothSerial serial;
+    bool started;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "obdmetrics.h"
+#include <elmparser.h>
+#include <telemetryformat.h>
+#include <stdio.h>
+#include <string.h>
+
+// Upper bounds of the latency buckets. A BLE ELM327 answers a single PID in
+// 50-150 ms, K-line ECUs take several hundred; anything slower is a problem.
+const uint16_t OBDMetrics::LATENCY_BOUNDS_MS[METRICS_LATENCY_BUCKETS] = { 25, 50, 75, 100, 150, 200, 300, 500, 1000, 2000 };
+PIDMetrics OBDMetrics::pids[METRICS_MAX_PIDS];
+uint8_t OBDMetrics::pidCount = 0;
+uint8_t OBDMetrics::slotOf[256];
+PIDMetrics OBDMetrics::commands;
+TransportRoundTrip OBDMetrics::roundTrip;
+
+static const char* const RESULT_NAMES[OBD_RESULT_COUNT] = { "ok", "timeout", "no_data", "error" };
+
+enum METRICS_FAMILY {
+    FAMILY_COMMAND_DURATION,
+    FAMILY_COMMANDS,
+    FAMILY_PID_DURATION,
+    FAMILY_PID_REQUESTS,
+    FAMILY_PID_SAMPLES,
+    FAMILY_PID_TARGET_HZ,
+    FAMILY_PID_ACHIEVED_HZ,
+    FAMILY_POLLING_LOAD,
+    FAMILY_TRANSPORT_RTT,
+    FAMILY_COUNT
+};
+
+// Called during setup, before the polling tasks run
+bool OBDMetrics::registerPID(uint8_t pid) {
+    if (slotOf[pid] != 0) return true;
+    if (pidCount >= METRICS_MAX_PIDS) return false;
+    pids[pidCount].pid = pid;
+    slotOf[pid] = ++pidCount;
+    return true;
+}
+
+void OBDMetrics::recordLatency(PIDMetrics& metrics, uint32_t elapsedMs) {
+    for (uint8_t i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+        if (elapsedMs <= LATENCY_BOUNDS_MS[i]) {
+            metrics.latencyBuckets[i]++;
+            break;
+        }
+    }
+    metrics.latencySumMs += elapsedMs;
+    metrics.latencyCount++;
+}
+
+// Every command sent to the adapter, AT commands and ECU probes included
+void OBDMetrics::recordCommand(uint32_t elapsedMs, bool responded) {
+    if (responded) {
+        recordLatency(commands, elapsedMs);
+        commands.results[OBD_RESULT_OK]++;
+    } else {
+        commands.results[OBD_RESULT_TIMEOUT]++;
+    }
+}
+
+// One mode 01 request, a batch counts for each of its PIDs. Timeouts only say
+// how long the caller gave up after, so they stay out of the histogram.
+void OBDMetrics::recordRequest(const uint8_t* pidList, uint8_t count, uint32_t elapsedMs, OBD_RESULT result) {
+    for (uint8_t i = 0; i < count; i++) {
+        uint8_t slot = slotOf[pidList[i]];
+        if (slot == 0) continue;
+        PIDMetrics& metrics = pids[slot - 1];
+        if (result != OBD_RESULT_TIMEOUT) recordLatency(metrics, elapsedMs);
+        metrics.results[result]++;
+    }
+}
+
+void OBDMetrics::recordSample(uint8_t pid) {
+    uint8_t slot = slotOf[pid];
+    if (slot != 0) pids[slot - 1].samples++;
+}
+
+// A handful of samples per connection: sorted by insertion, the quantiles
+// are the nearest ranks
+void OBDMetrics::recordTransportProbe(const char* transport, const uint32_t* samplesUs, uint8_t count) {
+    uint32_t sorted[METRICS_TRANSPORT_SAMPLES];
+    uint32_t sum = 0;
+    if (count > METRICS_TRANSPORT_SAMPLES) count = METRICS_TRANSPORT_SAMPLES;
+    for (uint8_t i = 0; i < count; i++) {
+        uint32_t value = samplesUs[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > value; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = value;
+        sum += value;
+    }
+    strncpy(roundTrip.transport, transport, sizeof(roundTrip.transport) - 1);
+    roundTrip.transport[sizeof(roundTrip.transport) - 1] = '\0';
+    roundTrip.samples = count;
+    if (count == 0) return;
+    roundTrip.minUs = sorted[0];
+    roundTrip.medianUs = sorted[(count - 1) / 2];
+    roundTrip.p90Us = sorted[(count * 9 + 9) / 10 - 1];
+    roundTrip.maxUs = sorted[count - 1];
+    roundTrip.sumUs = sum;
+}
+
+OBD_RESULT OBDMetrics::classify(bool responded, uint8_t status, uint8_t decodedPIDs) {
+    if (!responded) return OBD_RESULT_TIMEOUT;
+    if (decodedPIDs > 0) return OBD_RESULT_OK;
+    if (status & ELM_STATUS_NO_DATA) return OBD_RESULT_NO_DATA;
+    return OBD_RESULT_ERROR;
+}
+
+const PIDMetrics* OBDMetrics::getPID(uint8_t pid) {
+    uint8_t slot = slotOf[pid];
+    return slot != 0 ? &pids[slot - 1] : nullptr;
+}
+
+const PIDMetrics& OBDMetrics::getCommands() {
+    return commands;
+}
+
+const TransportRoundTrip& OBDMetrics::getTransportRoundTrip() {
+    return roundTrip;
+}
+
+// Prometheus wants seconds, the counters hold milliseconds
+static void appendSeconds(char* buffer, size_t size, size_t& length, uint32_t ms) {
+    TelemetryFormat::append(buffer, size, length, "%u.%03u", (unsigned)(ms / 1000), (unsigned)(ms % 1000));
+}
+
+static void appendMicroseconds(char* buffer, size_t size, size_t& length, uint32_t us) {
+    TelemetryFormat::append(buffer, size, length, "%u.%06u", (unsigned)(us / 1000000), (unsigned)(us % 1000000));
+}
+
+size_t OBDMetrics::formatHistogram(const PIDMetrics& metrics, const char* name, const char* labels, char* buffer, size_t size) {
+    size_t length = 0;
+    // Read while the engine task records: a bucket is bumped before the count,
+    // so the count is raised to the buckets to keep the histogram consistent
+    uint32_t count = metrics.latencyCount;
+    uint32_t sumMs = metrics.latencySumMs;
+    uint32_t cumulative = 0;
+    const char* separator = labels[0] != '\0' ? "," : "";
+    for (uint8_t i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+        cumulative += metrics.latencyBuckets[i];
+        if (cumulative > count) count = cumulative;
+        TelemetryFormat::append(buffer, size, length, "%s_bucket{%s%sle=\"", name, labels, separator);
+        appendSeconds(buffer, size, length, LATENCY_BOUNDS_MS[i]);
+        TelemetryFormat::append(buffer, size, length, "\"} %u\n", (unsigned)cumulative);
+    }
+    TelemetryFormat::append(buffer, size, length, "%s_bucket{%s%sle=\"+Inf\"} %u\n", name, labels, separator, (unsigned)count);
+    char series[24];
+    snprintf(series, sizeof(series), labels[0] != '\0' ? "{%s}" : "%s", labels);
+    TelemetryFormat::append(buffer, size, length, "%s_sum%s ", name, series);
+    appendSeconds(buffer, size, length, sumMs);
+    TelemetryFormat::append(buffer, size, length, "\n%s_count%s %u\n", name, series, (unsigned)count);
+    return length;
+}
+
+// One piece is a family header plus its first series, or one more series of
+// a per-PID family. Returns 0 past the last series of the family.
+size_t OBDMetrics::formatPiece(uint8_t family, uint8_t index, char* buffer, size_t size) {
+    size_t length = 0;
+    char labels[16];
+    uint8_t pid = 0;
+
+    if (family == FAMILY_PID_DURATION || family == FAMILY_PID_REQUESTS || family == FAMILY_PID_SAMPLES) {
+        if (index >= pidCount) return 0;
+        pid = pids[index].pid;
+    } else if (family == FAMILY_PID_TARGET_HZ || family == FAMILY_PID_ACHIEVED_HZ) {
+        if (index >= PIDScheduler::getEntryCount()) return 0;
+        pid = PIDScheduler::getEntry(index).pid;
+    } else if (index > 0 || (family == FAMILY_TRANSPORT_RTT && roundTrip.samples == 0)) {
+        return 0;
+    }
+    snprintf(labels, sizeof(labels), "pid=\"%02X\"", pid);
+
+    switch (family) {
+        case FAMILY_COMMAND_DURATION:
+            TelemetryFormat::append(buffer, size, length, "# HELP obd_command_duration_seconds Time from sending a command to the adapter prompt.\n"
+                                         "# TYPE obd_command_duration_seconds histogram\n");
+            length += formatHistogram(commands, "obd_command_duration_seconds", "", buffer + length, size - length);
+            break;
+        case FAMILY_COMMANDS:
+            TelemetryFormat::append(buffer, size, length, "# HELP obd_commands_total Commands sent to the adapter, AT commands included.\n"
+                                         "# TYPE obd_commands_total counter\n");
+            TelemetryFormat::append(buffer, size, length, "obd_commands_total{result=\"ok\"} %u\n", (unsigned)commands.results[OBD_RESULT_OK]);
+            TelemetryFormat::append(buffer, size, length, "obd_commands_total{result=\"timeout\"} %u\n", (unsigned)commands.results[OBD_RESULT_TIMEOUT]);
+            break;
+        case FAMILY_PID_DURATION:
+            if (index == 0) {
+                TelemetryFormat::append(buffer, size, length, "# HELP obd_pid_request_duration_seconds Round trip of the mode 01 requests carrying the PID.\n"
+                                             "# TYPE obd_pid_request_duration_seconds histogram\n");
+            }
+            length += formatHistogram(pids[index], "obd_pid_request_duration_seconds", labels, buffer + length, size - length);
+            break;
+        case FAMILY_PID_REQUESTS:
+            if (index == 0) {
+                TelemetryFormat::append(buffer, size, length, "# HELP obd_pid_requests_total Mode 01 requests carrying the PID by outcome.\n"
+                                             "# TYPE obd_pid_requests_total counter\n");
+            }
+            for (uint8_t result = 0; result < OBD_RESULT_COUNT; result++) {
+                TelemetryFormat::append(buffer, size, length, "obd_pid_requests_total{%s,result=\"%s\"} %u\n", labels, RESULT_NAMES[result], (unsigned)pids[index].results[result]);
+            }
+            break;
+        case FAMILY_PID_SAMPLES:
+            if (index == 0) {
+                TelemetryFormat::append(buffer, size, length, "# HELP obd_pid_samples_total Values decoded for the PID.\n"
+                                             "# TYPE obd_pid_samples_total counter\n");
+            }
+            TelemetryFormat::append(buffer, size, length, "obd_pid_samples_total{%s} %u\n", labels, (unsigned)pids[index].samples);
+            break;
+        case FAMILY_PID_TARGET_HZ:
+            if (index == 0) {
+                TelemetryFormat::append(buffer, size, length, "# HELP obd_pid_target_hz Requested polling rate.\n"
+                                             "# TYPE obd_pid_target_hz gauge\n");
+            }
+            TelemetryFormat::append(buffer, size, length, "obd_pid_target_hz{%s} %.2f\n", labels, PIDScheduler::getEntry(index).targetHz);
+            break;
+        case FAMILY_PID_ACHIEVED_HZ:
+            if (index == 0) {
+                TelemetryFormat::append(buffer, size, length, "# HELP obd_pid_achieved_hz Polling rate measured over the scheduler window.\n"
+                                             "# TYPE obd_pid_achieved_hz gauge\n");
+            }
+            TelemetryFormat::append(buffer, size, length, "obd_pid_achieved_hz{%s} %.2f\n", labels, PIDScheduler::getEntry(index).achievedHz);
+            break;
+        case FAMILY_POLLING_LOAD:
+            TelemetryFormat::append(buffer, size, length, "# HELP obd_polling_load Share of the bus time the polling plan needs, above 1 every rate is scaled down.\n"
+                                         "# TYPE obd_polling_load gauge\n"
+                                         "obd_polling_load %.3f\n", PIDScheduler::getLoadFactor());
+            break;
+        case FAMILY_TRANSPORT_RTT: {
+            static const char* const QUANTILES[] = { "0", "0.5", "0.9", "1" };
+            const uint32_t values[] = { roundTrip.minUs, roundTrip.medianUs, roundTrip.p90Us, roundTrip.maxUs };
+            TelemetryFormat::append(buffer, size, length, "# HELP obd_transport_rtt_seconds Round trip of ATI, answered by the adapter alone, probed on connect.\n"
+                                         "# TYPE obd_transport_rtt_seconds summary\n");
+            for (uint8_t i = 0; i < 4; i++) {
+                TelemetryFormat::append(buffer, size, length, "obd_transport_rtt_seconds{transport=\"%s\",quantile=\"%s\"} ", roundTrip.transport, QUANTILES[i]);
+                appendMicroseconds(buffer, size, length, values[i]);
+                TelemetryFormat::append(buffer, size, length, "\n");
+            }
+            TelemetryFormat::append(buffer, size, length, "obd_transport_rtt_seconds_sum{transport=\"%s\"} ", roundTrip.transport);
+            appendMicroseconds(buffer, size, length, roundTrip.sumUs);
+            TelemetryFormat::append(buffer, size, length, "\nobd_transport_rtt_seconds_count{transport=\"%s\"} %u\n", roundTrip.transport, (unsigned)roundTrip.samples);
+            break;
+        }
+        default:
+            return 0;
+    }
+    return length;
+}
+
+// Renders the next piece of the exposition into buffer (METRICS_PIECE_SIZE
+// fits any piece) and returns its length, 0 once everything was rendered.
+size_t OBDMetrics::format(MetricsCursor& cursor, char* buffer, size_t size) {
+    while (cursor.family < FAMILY_COUNT) {
+        size_t length = formatPiece(cursor.family, cursor.index, buffer, size);
+        if (length > 0) {
+            cursor.index++;
+            return length;
+        }
+        cursor.family++;
+        cursor.index = 0;
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+#ifndef OBDMETRICS_H
+#define OBDMETRICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pidscheduler.h>
+
+#define METRICS_MAX_PIDS MAX_SCHEDULED_PIDS
+#define METRICS_LATENCY_BUCKETS 10
+#define METRICS_PIECE_SIZE 1280
+#define METRICS_TRANSPORT_NAME_SIZE 12
+#define METRICS_TRANSPORT_SAMPLES 16
+
+enum OBD_RESULT {
+    OBD_RESULT_OK,
+    OBD_RESULT_TIMEOUT,
+    OBD_RESULT_NO_DATA,
+    OBD_RESULT_ERROR,
+    OBD_RESULT_COUNT
+};
+
+// Counters of one PID, or of every command for the command totals. Each field
+// has a single writer task (requests: engine task, samples: decoder task), so
+// plain aligned 32-bit stores are enough and a scrape never blocks polling.
+struct PIDMetrics {
+    uint8_t pid;
+    uint32_t latencyBuckets[METRICS_LATENCY_BUCKETS];  // not cumulative, above the last bound only counts in latencyCount
+    uint32_t latencyCount;
+    uint32_t latencySumMs;
+    uint32_t results[OBD_RESULT_COUNT];
+    uint32_t samples;
+};
+
+// Round trip of a command the adapter answers itself, probed on connect.
+// Written by the loop task once per connection, read by the web task.
+struct TransportRoundTrip {
+    char transport[METRICS_TRANSPORT_NAME_SIZE];
+    uint8_t samples;
+    uint32_t minUs;
+    uint32_t medianUs;
+    uint32_t p90Us;
+    uint32_t maxUs;
+    uint32_t sumUs;
+};
+
+// Position of a paged /metrics rendering, zero-initialised to start
+struct MetricsCursor {
+    uint8_t family;
+    uint8_t index;
+};
+
+// Always-on request instrumentation: fixed-bucket latency histograms, result
+// counts and decoded samples per PID, rendered as Prometheus text exposition.
+// Recording is a handful of increments; PIDs are registered up front so the
+// slot lookup is one table read and slots never move under a scrape.
+class OBDMetrics {
+private:
+    static const uint16_t LATENCY_BOUNDS_MS[METRICS_LATENCY_BUCKETS];
+    static PIDMetrics pids[METRICS_MAX_PIDS];
+    static uint8_t pidCount;
+    static uint8_t slotOf[256];            // slot index + 1, 0 when the PID is not registered
+    static PIDMetrics commands;
+    static TransportRoundTrip roundTrip;
+
+    static void recordLatency(PIDMetrics& metrics, uint32_t elapsedMs);
+    static size_t formatHistogram(const PIDMetrics& metrics, const char* name, const char* labels, char* buffer, size_t size);
+    static size_t formatPiece(uint8_t family, uint8_t index, char* buffer, size_t size);
+
+public:
+    static bool registerPID(uint8_t pid);
+    static void recordCommand(uint32_t elapsedMs, bool responded);
+    static void recordRequest(const uint8_t* pids, uint8_t count, uint32_t elapsedMs, OBD_RESULT result);
+    static void recordSample(uint8_t pid);
+    static void recordTransportProbe(const char* transport, const uint32_t* samplesUs, uint8_t count);
+    static OBD_RESULT classify(bool responded, uint8_t status, uint8_t decodedPIDs);
+    static const PIDMetrics* getPID(uint8_t pid);
+    static const PIDMetrics& getCommands();
+    static const TransportRoundTrip& getTransportRoundTrip();
+    static size_t format(MetricsCursor& cursor, char* buffer, size_t size);
+};
+
+#endif
@@ -0,0 +1,397 @@
+#include "obdsession.h"
+#include <elmparser.h>
+#include <elmprotocol.h>
+#include <elmtiming.h>
+#include <obdmetrics.h>
+#include <pidsupport.h>
+#include <tripcomputer.h>
+#include <tripstats.h>
+#include <logring.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+static const char TAG[] = "OBDSession";
+
+TripStorage* OBDSession::storage = nullptr;
+CharDisplay* OBDSession::display = nullptr;
+OBDValueFunction OBDSession::valueListener = nullptr;
+bool OBDSession::batchEnabled = true;
+bool OBDSession::responseCountEnabled = true;
+bool OBDSession::timingEnabled = true;
+uint8_t OBDSession::expectedPIDs = 1;
+uint8_t OBDSession::decodedPIDs = 0;
+uint32_t OBDSession::decodedSet[8];
+uint8_t OBDSession::lastStatus = 0;
+uint32_t OBDSession::arrivalTime = 0;
+int32_t OBDSession::lastValues[256];
+OBDRequestTotals OBDSession::totals = {};
+
+// storage gives the fuel shown next to the RPM and the totals for TripStats,
+// output is the dashboard; either may be null
+void OBDSession::begin(TripStorage* tripStorage, CharDisplay* output) {
+    storage = tripStorage;
+    display = output;
+}
+
+// Called with every decoded value on the task that decodes, before the
+// trip computer and the dashboard get it
+void OBDSession::setValueListener(OBDValueFunction function) {
+    valueListener = function;
+}
+
+void OBDSession::show(uint8_t column, uint8_t row, const char* format, ...) {
+    if (display == nullptr) return;
+    char text[17];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length > 0) display->write(column, row, text, strlen(text));
+}
+
+// The four live values: LCD field, trip computer and statistics
+void OBDSession::showValue(PIDSlot slot, int32_t value) {
+    switch (slot) {
+        case PID_SLOT_RPM:
+            show(0, 0, "RPM: %4d", (int)value);
+            TripComputer::onRPM(value, arrivalTime);
+            TripStats::onSample(STAT_RPM, value, arrivalTime);
+            break;
+        case PID_SLOT_COOLANT:
+            // 0xDF is the degree sign in the LCD's character ROM
+            show(11, 1, "%3d" "\xDF" "C", (int)value);
+            TripStats::onSample(STAT_COOLANT, value, arrivalTime);
+            break;
+        case PID_SLOT_SPEED:
+            show(0, 1, "%3dkm/h", (int)value);
+            TripComputer::onSpeed(value, arrivalTime);
+            TripStats::onSample(STAT_SPEED, value, arrivalTime);
+            break;
+        case PID_SLOT_LOAD:
+            TripComputer::onEngineLoad(value, arrivalTime);
+            TripStats::onSample(STAT_LOAD, value, arrivalTime);
+            if (storage != nullptr && storage->getTankCapacity() > 0) {
+                show(13, 0, "%2d%%", (int)(storage->getFuel() * 100 / storage->getTankCapacity()));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// The PID's table row says what to do with it: bitmaps go to PIDSupport,
+// values to the listener and, if the row has a live slot, to its consumers
+void OBDSession::dispatchPID(uint8_t pid, const uint8_t* data) {
+    const PIDDescriptor* descriptor = PIDTable::find(pid);
+    if (descriptor == nullptr) return;
+
+    if (descriptor->slot == PID_SLOT_BITMAP) {
+        PIDSupport::onBitmap(pid, data);
+        return;
+    }
+
+    int32_t value = PIDTable::decode(*descriptor, data);
+    lastValues[pid] = value;
+    if (valueListener != nullptr) valueListener(*descriptor, value, arrivalTime);
+    showValue(descriptor->slot, value);
+}
+
+// With headers on (listing the ECUs on CAN) several ECUs answer the same
+// PID, only the selected one's values are used
+void OBDSession::handlePID(uint8_t pid, const uint8_t* data, uint16_t ecu, void* context) {
+    if (ecu != ELM_NO_HEADER && pid == CHECK_ECU_MUX) ELMProtocol::onResponder(ecu, data);
+    if (!ELMProtocol::acceptsFrom(ecu)) return;
+    decodedSet[pid >> 5] |= 1UL << (pid & 31);
+    OBDMetrics::recordSample(pid);
+    dispatchPID(pid, data);
+}
+
+// Decodes the response in place, the buffer is clobbered. receivedAt is when
+// the prompt arrived, so the trip computer integrates over when the data
+// arrived, not when the decoder got to it.
+void OBDSession::decodeResponse(char* response, size_t length, uint32_t receivedAt) {
+    arrivalTime = receivedAt;
+    memset(decodedSet, 0, sizeof(decodedSet));
+    ELMResponse decoded = ELMParser::parse(response, length, PIDTable::dataLength, handlePID, nullptr);
+    // Only the PIDs handlePID took count, not another ECU's answers
+    decodedPIDs = 0;
+    for (uint8_t i = 0; i < 8; i++) decodedPIDs += __builtin_popcount(decodedSet[i]);
+    lastStatus = decoded.status;
+
+    // The trip computer has integrated this response, the statistics take the new totals
+    if (decodedPIDs > 0 && storage != nullptr) {
+        TripStats::onTotals(storage->getDistanceMm(), storage->getTripFuelMicroliters(), arrivalTime);
+    }
+}
+
+// AT command with '\r' appended, false when the adapter gave no answer
+bool OBDSession::sendAT(OBDLink& link, const char* command, char* reply, size_t size) {
+    char text[MAX_COMMAND_LENGTH];
+    snprintf(text, sizeof(text), "%s\r", command);
+    return link.exchange(text, AT_COMMAND_TIMEOUT_MS, reply, size);
+}
+
+// After a reset (power-on, ATZ, ATWS) of the adapter
+void OBDSession::sendStarterCommands(OBDLink& link) {
+    sendAT(link, "ATWS");   // Warm start, quicker than ATZ
+    sendAT(link, "ATE0");   // Echo Off
+    sendAT(link, "ATH0");   // Headers Off
+    sendAT(link, "ATAT1");  // Adaptive Timing
+    sendAT(link, "ATL0");   // Linefeeds Off
+
+    // Search (ATSP0) for an unknown car, otherwise the cached protocol first
+    // (ATSPAn). The ECU filter waits for detectProtocol: a CAN header would
+    // keep another car on K-line from ever answering the probe.
+    char text[16];
+    ELMProtocol::selectCommand(text, sizeof(text));
+    LOG_D(TAG, "Protocol: %s", text);
+    sendAT(link, text);
+}
+
+// ATSH7E0 + ATCRA7E8: requests go to the selected ECU only and only its replies
+// are shown. Nothing is sent off 11-bit CAN or before an ECU was selected.
+void OBDSession::applyECUFilter(OBDLink& link) {
+    char text[16];
+    if (ELMProtocol::headerCommand(text, sizeof(text)) > 0) sendAT(link, text);
+    if (ELMProtocol::receiveCommand(text, sizeof(text)) > 0) sendAT(link, text);
+}
+
+// 0100, the wake-up probe. It waits out a protocol search or a K-line bus
+// init, see ELMProtocol::probeTimeout.
+bool OBDSession::probeECU(OBDLink& link) {
+    LOG_D(TAG, "Checking ECU status");
+    return link.exchange("0100\r", ELMProtocol::probeTimeout(PID_COMMAND_TIMEOUT_MS), nullptr, 0);
+}
+
+// Once per connection, after the ECU answered (the search is over by then):
+// reads the protocol back and, on 11-bit CAN, sets the filter for the cached
+// ECU or picks one. Another protocol than the cached one drops the cached ECU.
+// The caller saves ELMProtocol when it changed.
+void OBDSession::detectProtocol(OBDLink& link) {
+    char reply[AT_REPLY_SIZE];
+    uint8_t protocol;
+    if (!sendAT(link, "ATDPN", reply, sizeof(reply)) || !ELMProtocol::parseDescribe(reply, protocol)) {
+        LOG_W(TAG, "No protocol number from the adapter, asking again on the next wake-up");
+        return;
+    }
+    ELMProtocol::setProtocol(protocol);
+    LOG_I(TAG, "Protocol %X: %s", protocol, ELMProtocol::getName(protocol));
+
+    if (ELMProtocol::hasShortHeaders(protocol)) {
+        if (ELMProtocol::getECU() == ELM_NO_HEADER) {
+            findResponders(link);
+        } else {
+            // The functional probe may have merged several ECUs' bitmaps
+            applyECUFilter(link);
+            probeECU(link);
+        }
+    }
+    ELMProtocol::setConfirmed(true);
+}
+
+// A functional 0100 with headers on lists every ECU that answers (handlePID
+// reports them to ELMProtocol). With one selected, a second 0100 through the
+// filter gives PIDSupport that ECU's bitmap.
+void OBDSession::findResponders(OBDLink& link) {
+    sendAT(link, "ATCRA");
+    sendAT(link, "ATSH7DF");
+    sendAT(link, "ATH1");
+    ELMProtocol::beginDiscovery();
+    link.exchange("0100\r", PID_COMMAND_TIMEOUT_MS, nullptr, 0);
+    sendAT(link, "ATH0");
+
+    uint16_t ecu = ELMProtocol::selectECU();
+    if (ecu == ELM_NO_HEADER) {
+        LOG_I(TAG, "No ECU answered with a header, keeping functional requests");
+        return;
+    }
+    LOG_I(TAG, "%u ECU(s) answered, polling %03X", (unsigned)ELMProtocol::getResponderCount(), ecu);
+    applyECUFilter(link);
+    probeECU(link);
+}
+
+// Asks for the bitmaps after 0100 (which the probe already sent) as long as
+// the previous one says there is a next one. A range the adapter does not
+// answer is taken as empty.
+void OBDSession::discoverSupportedPIDs(OBDLink& link) {
+    uint8_t base;
+    while ((base = PIDSupport::nextMissingRange()) != PID_SUPPORT_NO_RANGE) {
+        char text[8];
+        snprintf(text, sizeof(text), "01%02X\r", base);
+        LOG_D(TAG, "Reading supported PIDs: %.4s", text);
+        link.exchange(text, PID_COMMAND_TIMEOUT_MS, nullptr, 0);
+        if (PIDSupport::nextMissingRange() == base) PIDSupport::markRangeMissing(base);
+    }
+}
+
+// Packs up to MAX_PIDS_PER_REQUEST mode 01 PIDs into one request ("010C0D04").
+// K-line ECUs and some clones only answer the first PID or reject the request,
+// in that case the PIDs missing from the answer are re-sent one by one, and
+// batching is turned off once one of them answers on its own. timeoutMs is
+// the ceiling of the ELMTiming timeouts and the fallback until enough samples
+// exist. Returns the PIDs decoded, bit i for pids[i].
+uint8_t OBDSession::requestPIDs(OBDLink& link, const uint8_t* pids, uint8_t count, uint32_t timeoutMs) {
+    uint8_t all = (uint8_t)((1 << count) - 1);
+    bool batched = batchEnabled && count > 1;
+
+    uint8_t answered = 0;
+    if (batched) {
+        expectedPIDs = count;
+        if (transmitPIDs(link, pids, count, timeoutMs)) answered = getDecodedMask(pids, count);
+        expectedPIDs = 1;
+        if (answered != all) {
+            LOG_I(TAG, "Batch answered %u of %u PIDs, falling back", (unsigned)__builtin_popcount(answered), (unsigned)count);
+        }
+    }
+
+    if (answered != all) {
+        bool singleAnswered = false;
+        for (uint8_t i = 0; i < count; i++) {
+            if (answered & (1 << i)) continue;
+            if (!transmitPIDs(link, &pids[i], 1, timeoutMs)) continue;
+            if (getDecodedMask(&pids[i], 1) != 0) {
+                answered |= 1 << i;
+                singleAnswered = true;
+            }
+        }
+
+        // Only blame the batching when a PID the batch left out answers on its own
+        if (batched && singleAnswered) {
+            LOG_I(TAG, "Batched requests not supported, using single PID requests");
+            batchEnabled = false;
+        }
+    }
+
+    applyTiming(link);
+    return answered;
+}
+
+// Sends one PID request and records it. Adapters older than v1.3 answer '?'
+// to the response count digit, then the digit is dropped and the request re-sent.
+bool OBDSession::transmitPIDs(OBDLink& link, const uint8_t* pids, uint8_t count, uint32_t timeoutMs) {
+    char text[MAX_COMMAND_LENGTH];
+    if (timingEnabled) timeoutMs = ELMTiming::timeoutFor(pids, count, timeoutMs);
+    buildPIDCommand(text, pids, count);
+    // Nothing of the previous reply may count for this one if it times out
+    decodedPIDs = 0;
+    lastStatus = 0;
+    memset(decodedSet, 0, sizeof(decodedSet));
+    uint32_t sentAt = link.now();
+    bool responded = link.exchange(text, timeoutMs, nullptr, 0);
+
+    if (responded && responseCountEnabled && decodedPIDs == 0 && (lastStatus & ELM_STATUS_UNKNOWN_COMMAND)) {
+        LOG_I(TAG, "Adapter rejects the response count, sending requests without it");
+        responseCountEnabled = false;
+        buildPIDCommand(text, pids, count);
+        sentAt = link.now();
+        responded = link.exchange(text, timeoutMs, nullptr, 0);
+    }
+    recordPIDRequest(pids, count, responded, link.now() - sentAt);
+    return responded;
+}
+
+// decodeResponse is done with the reply once the exchange returned, so its
+// status and PID count describe this request (a timeout is decided first)
+void OBDSession::recordPIDRequest(const uint8_t* pids, uint8_t count, bool responded, uint32_t elapsedMs) {
+    totals.requests++;
+    if (responded) {
+        totals.decodedPIDs += decodedPIDs;
+        if (lastStatus & ELM_STATUS_NO_DATA) totals.noDataResponses++;
+    } else {
+        totals.timeouts++;
+    }
+
+    OBD_RESULT result = OBDMetrics::classify(responded, lastStatus, decodedPIDs);
+    OBDMetrics::recordRequest(pids, count, elapsedMs, result);
+    if (result == OBD_RESULT_OK) {
+        ELMTiming::recordReply(pids, count, elapsedMs);
+    } else if (result != OBD_RESULT_ERROR) {
+        ELMTiming::recordMiss(pids, count, elapsedMs, result == OBD_RESULT_TIMEOUT);
+    }
+    if (count == 1 && (result == OBD_RESULT_OK || result == OBD_RESULT_NO_DATA)) {
+        if (PIDSupport::onPIDResult(pids[0], result == OBD_RESULT_NO_DATA)) {
+            LOG_I(TAG, "PID %02X keeps answering NO DATA, leaving it out", pids[0]);
+        }
+    }
+}
+
+// Sends the ATST/ATAT change ELMTiming asks for, between two PID requests so
+// it never lands in the middle of one
+void OBDSession::applyTiming(OBDLink& link) {
+    char text[16];
+    if (!timingEnabled || !ELMTiming::nextTuningCommand(text, sizeof(text))) return;
+
+    LOG_D(TAG, "Timing: %s", text);
+    sendAT(link, text);
+}
+
+// "01" + PIDs, plus the expected response count: with '1' the adapter returns
+// as soon as the ECU answered instead of listening out the ATST window for others
+void OBDSession::buildPIDCommand(char* text, const uint8_t* pids, uint8_t count) {
+    static const char hexDigits[] = "0123456789ABCDEF";
+    size_t length = 0;
+    text[length++] = '0';
+    text[length++] = '1';
+    for (uint8_t i = 0; i < count; i++) {
+        text[length++] = hexDigits[pids[i] >> 4];
+        text[length++] = hexDigits[pids[i] & 0x0F];
+    }
+    if (responseCountEnabled) text[length++] = '1';
+    text[length++] = '\r';
+    text[length] = '\0';
+}
+
+// PIDs in the request being sent, a batch that decodes nothing is not a sleeping ECU
+uint8_t OBDSession::getExpectedPIDs() {
+    return expectedPIDs;
+}
+
+uint8_t OBDSession::getDecodedPIDCount() {
+    return decodedPIDs;
+}
+
+// Which of the requested PIDs the last response carried a value for: bit i
+// for pids[i]. The count alone can't tell which PID an ECU left out.
+uint8_t OBDSession::getDecodedMask(const uint8_t* pids, uint8_t count) {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (decodedSet[pids[i] >> 5] & (1UL << (pids[i] & 31))) mask |= 1 << i;
+    }
+    return mask;
+}
+
+// ELM_STATUS_* flags of the last response
+uint8_t OBDSession::getLastStatus() {
+    return lastStatus;
+}
+
+int32_t OBDSession::getLastValue(uint8_t pid) {
+    return lastValues[pid];
+}
+
+const OBDRequestTotals& OBDSession::getTotals() {
+    return totals;
+}
+
+void OBDSession::setBatchEnabled(bool enable) {
+    batchEnabled = enable;
+}
+
+bool OBDSession::isBatchEnabled() {
+    return batchEnabled;
+}
+
+void OBDSession::setResponseCountEnabled(bool enable) {
+    responseCountEnabled = enable;
+}
+
+bool OBDSession::isResponseCountEnabled() {
+    return responseCountEnabled;
+}
+
+// Off: the caller's fixed timeouts and no ATST/ATAT tuning, the round trips
+// are still measured
+void OBDSession::setTimingEnabled(bool enable) {
+    timingEnabled = enable;
+}
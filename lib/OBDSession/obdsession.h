@@ -0,0 +1,100 @@
+#ifndef OBDSESSION_H
+#define OBDSESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../datadefinition.h"
+#include <chardisplay.h>
+#include <tripstorage.h>
+#include <pidtable.h>
+
+#define MAX_COMMAND_LENGTH 24
+#define PID_COMMAND_TIMEOUT_MS 1000
+#define AT_COMMAND_TIMEOUT_MS 3000
+#define AT_REPLY_SIZE 32
+
+// One command at a time to the adapter behind an ELMTransport. exchange()
+// writes text ('\r' included) and returns once the '>' prompt arrived (true)
+// or timeoutMs passed (false). By then the reply to a request has been handed
+// to OBDSession::decodeResponse; the start of an AT reply is copied to reply.
+// Bytes of a command that timed out never end up in the next reply.
+class OBDLink {
+public:
+    virtual ~OBDLink() {}
+    virtual bool exchange(const char* text, uint32_t timeoutMs, char* reply, size_t size) = 0;
+    virtual uint32_t now() = 0;     // ms, the clock round trips are measured on
+};
+
+typedef void (*OBDValueFunction)(const PIDDescriptor& descriptor, int32_t value, uint32_t receivedAt);
+
+// PID requests sent and what came back, for the runner's summary
+struct OBDRequestTotals {
+    uint32_t requests;
+    uint32_t decodedPIDs;
+    uint32_t noDataResponses;
+    uint32_t timeouts;
+};
+
+// What the firmware and the native runner do with an ELM327 once it is
+// connected: the starter commands, protocol and ECU selection, the supported
+// PID discovery, PID requests with their batch and response count fallbacks
+// and the decoding of the replies into the trip computer, the statistics and
+// the dashboard. Plain C++, shared with the native build; only the OBDLink
+// differs (the firmware's engine and decoder tasks, the native clock).
+//
+// The requests run on one task at a time. decodeResponse runs on whichever
+// task assembles the replies, always before the exchange that sent the
+// request returns.
+class OBDSession {
+private:
+    static TripStorage* storage;
+    static CharDisplay* display;
+    static OBDValueFunction valueListener;
+    static bool batchEnabled;
+    static bool responseCountEnabled;
+    static bool timingEnabled;
+    static uint8_t expectedPIDs;
+    static uint8_t decodedPIDs;
+    static uint32_t decodedSet[8];
+    static uint8_t lastStatus;
+    static uint32_t arrivalTime;
+    static int32_t lastValues[256];
+    static OBDRequestTotals totals;
+
+    static void handlePID(uint8_t pid, const uint8_t* data, uint16_t ecu, void* context);
+    static void dispatchPID(uint8_t pid, const uint8_t* data);
+    static void showValue(PIDSlot slot, int32_t value);
+    static void show(uint8_t column, uint8_t row, const char* format, ...) __attribute__((format(printf, 3, 4)));
+    static bool sendAT(OBDLink& link, const char* command, char* reply = nullptr, size_t size = 0);
+    static bool transmitPIDs(OBDLink& link, const uint8_t* pids, uint8_t count, uint32_t timeoutMs);
+    static void recordPIDRequest(const uint8_t* pids, uint8_t count, bool responded, uint32_t elapsedMs);
+    static void applyTiming(OBDLink& link);
+    static void applyECUFilter(OBDLink& link);
+    static void findResponders(OBDLink& link);
+
+public:
+    static void begin(TripStorage* tripStorage, CharDisplay* output);
+    static void setValueListener(OBDValueFunction function);
+    static void buildPIDCommand(char* text, const uint8_t* pids, uint8_t count);
+    static void decodeResponse(char* response, size_t length, uint32_t receivedAt);
+
+    static void sendStarterCommands(OBDLink& link);
+    static bool probeECU(OBDLink& link);
+    static void detectProtocol(OBDLink& link);
+    static void discoverSupportedPIDs(OBDLink& link);
+    static uint8_t requestPIDs(OBDLink& link, const uint8_t* pids, uint8_t count, uint32_t timeoutMs);
+
+    static uint8_t getExpectedPIDs();
+    static uint8_t getDecodedPIDCount();
+    static uint8_t getDecodedMask(const uint8_t* pids, uint8_t count);
+    static uint8_t getLastStatus();
+    static int32_t getLastValue(uint8_t pid);
+    static const OBDRequestTotals& getTotals();
+    static void setBatchEnabled(bool enable);
+    static bool isBatchEnabled();
+    static void setResponseCountEnabled(bool enable);
+    static bool isResponseCountEnabled();
+    static void setTimingEnabled(bool enable);
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "pidscheduler.h"
+
+PIDScheduleEntry PIDScheduler::entries[MAX_SCHEDULED_PIDS];
+uint8_t PIDScheduler::entryCount = 0;
+unsigned long PIDScheduler::windowStart = 0;
+float PIDScheduler::loadFactor = 0.0;
+
+// Weight of the newest round trip in the smoothed per-sample cost
+static const float COST_SMOOTHING = 0.2;
+
+PIDScheduleEntry* PIDScheduler::find(uint8_t pid) {
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (entries[i].pid == pid) return &entries[i];
+    }
+    return nullptr;
+}
+
+bool PIDScheduler::registerPID(uint8_t pid, float targetHz, uint8_t priority) {
+    PIDScheduleEntry* entry = find(pid);
+    if (entry == nullptr) {
+        if (entryCount >= MAX_SCHEDULED_PIDS) return false;
+        entry = &entries[entryCount++];
+        entry->pid = pid;
+        entry->enabled = true;
+        entry->achievedHz = 0.0;
+        entry->costMs = 0.0;
+        entry->nextDue = 0;
+        entry->windowSamples = 0;
+    }
+    entry->priority = priority;
+    entry->targetHz = targetHz;
+    rebalance();
+    return true;
+}
+
+void PIDScheduler::setTargetRate(uint8_t pid, float targetHz) {
+    PIDScheduleEntry* entry = find(pid);
+    if (entry == nullptr) return;
+    entry->targetHz = targetHz;
+    rebalance();
+}
+
+// A disabled PID is never issued and takes no share of the bus
+void PIDScheduler::setEnabled(uint8_t pid, bool enabled) {
+    PIDScheduleEntry* entry = find(pid);
+    if (entry == nullptr || entry->enabled == enabled) return;
+    entry->enabled = enabled;
+    rebalance();
+}
+
+unsigned long PIDScheduler::periodMs(const PIDScheduleEntry& entry) {
+    return (unsigned long)(1000.0 / entry.effectiveHz);
+}
+
+// Earliest deadline first: the most overdue due PID wins the slot, priority breaks ties.
+// Deadlines advance by one period per issue and may lag at most one period behind,
+// so a PID that could not be served never bursts to catch up afterwards.
+uint8_t PIDScheduler::nextBatch(unsigned long now, uint8_t* pids, uint8_t maxCount) {
+    bool picked[MAX_SCHEDULED_PIDS] = { false };
+    uint8_t count = 0;
+
+    while (count < maxCount) {
+        int best = -1;
+        for (uint8_t i = 0; i < entryCount; i++) {
+            const PIDScheduleEntry& entry = entries[i];
+            if (picked[i] || entry.effectiveHz <= 0.0) continue;
+            if ((long)(now - entry.nextDue) < 0) continue;
+            if (best >= 0) {
+                long lateness = (long)(entry.nextDue - entries[best].nextDue);
+                if (lateness > 0) continue;
+                if (lateness == 0 && entry.priority <= entries[best].priority) continue;
+            }
+            best = i;
+        }
+        if (best < 0) break;
+
+        PIDScheduleEntry& entry = entries[best];
+        unsigned long period = periodMs(entry);
+        if ((long)(now - entry.nextDue) > (long)period) entry.nextDue = now - period;
+        entry.nextDue += period;
+
+        picked[best] = true;
+        pids[count++] = entry.pid;
+    }
+    return count;
+}
+
+// answered has bit i set when pids[i] was decoded. Only those count as a
+// sample and update the cost: a timeout or NO DATA would otherwise make the
+// achieved rate look met while the ECU is silent, and bill the full timeout
+// as the PID's bus time.
+void PIDScheduler::onRequestCompleted(const uint8_t* pids, uint8_t count, uint8_t answered, unsigned long now, unsigned long roundTripMs) {
+    if (count == 0) return;
+
+    float costPerPID = (float)roundTripMs / count;
+    for (uint8_t i = 0; i < count; i++) {
+        if (!(answered & (1 << i))) continue;
+        PIDScheduleEntry* entry = find(pids[i]);
+        if (entry == nullptr) continue;
+        entry->costMs = (entry->costMs == 0.0) ? costPerPID : entry->costMs + COST_SMOOTHING * (costPerPID - entry->costMs);
+        entry->windowSamples++;
+    }
+
+    updateAchievedRates(now);
+    rebalance();
+}
+
+void PIDScheduler::updateAchievedRates(unsigned long now) {
+    if (windowStart == 0) {
+        windowStart = now;
+        return;
+    }
+
+    unsigned long elapsed = now - windowStart;
+    if (elapsed < SCHEDULER_RATE_WINDOW_MS) return;
+
+    for (uint8_t i = 0; i < entryCount; i++) {
+        entries[i].achievedHz = entries[i].windowSamples * 1000.0 / elapsed;
+        entries[i].windowSamples = 0;
+    }
+    windowStart = now;
+}
+
+// Fraction of bus time the requested rates need, from the measured cost of every PID.
+// Above 1.0 every rate is scaled down by the same factor, so all PIDs keep the same
+// share of what they asked for instead of the low priority ones starving.
+void PIDScheduler::rebalance() {
+    loadFactor = 0.0;
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (!entries[i].enabled) continue;
+        loadFactor += entries[i].targetHz * entries[i].costMs / 1000.0;
+    }
+
+    float scale = (loadFactor > 1.0) ? 1.0 / loadFactor : 1.0;
+    for (uint8_t i = 0; i < entryCount; i++) {
+        entries[i].effectiveHz = entries[i].enabled ? entries[i].targetHz * scale : 0.0;
+    }
+}
+
+unsigned long PIDScheduler::msUntilNextDue(unsigned long now) {
+    unsigned long wait = SCHEDULER_RATE_WINDOW_MS;
+    for (uint8_t i = 0; i < entryCount; i++) {
+        if (entries[i].effectiveHz <= 0.0) continue;
+        long remaining = (long)(entries[i].nextDue - now);
+        if (remaining <= 0) return 0;
+        if ((unsigned long)remaining < wait) wait = remaining;
+    }
+    return wait;
+}
+
+float PIDScheduler::getLoadFactor() {
+    return loadFactor;
+}
+
+bool PIDScheduler::isOvercommitted() {
+    return loadFactor > 1.0;
+}
+
+uint8_t PIDScheduler::getEntryCount() {
+    return entryCount;
+}
+
+const PIDScheduleEntry& PIDScheduler::getEntry(uint8_t index) {
+    return entries[index];
+}
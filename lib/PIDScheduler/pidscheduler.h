@@ -0,0 +1,47 @@
+#ifndef PIDSCHEDULER_H
+#define PIDSCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MAX_SCHEDULED_PIDS 16
+#define SCHEDULER_RATE_WINDOW_MS 5000
+
+struct PIDScheduleEntry {
+    uint8_t pid;
+    uint8_t priority;          // higher wins when several PIDs are equally overdue
+    bool enabled;              // false when the ECU does not support the PID
+    float targetHz;            // requested rate
+    float effectiveHz;         // rate the scheduler is currently aiming for
+    float achievedHz;          // measured over the last rate window
+    float costMs;              // smoothed bus time per sample
+    unsigned long nextDue;
+    uint32_t windowSamples;
+};
+
+class PIDScheduler {
+private:
+    static PIDScheduleEntry entries[MAX_SCHEDULED_PIDS];
+    static uint8_t entryCount;
+    static unsigned long windowStart;
+    static float loadFactor;
+
+    static unsigned long periodMs(const PIDScheduleEntry& entry);
+    static void rebalance();
+    static void updateAchievedRates(unsigned long now);
+    static PIDScheduleEntry* find(uint8_t pid);
+
+public:
+    static bool registerPID(uint8_t pid, float targetHz, uint8_t priority);
+    static void setTargetRate(uint8_t pid, float targetHz);
+    static void setEnabled(uint8_t pid, bool enabled);
+    static uint8_t nextBatch(unsigned long now, uint8_t* pids, uint8_t maxCount);
+    static void onRequestCompleted(const uint8_t* pids, uint8_t count, uint8_t answered, unsigned long now, unsigned long roundTripMs);
+    static unsigned long msUntilNextDue(unsigned long now);
+    static float getLoadFactor();
+    static bool isOvercommitted();
+    static uint8_t getEntryCount();
+    static const PIDScheduleEntry& getEntry(uint8_t index);
+};
+
+#endif
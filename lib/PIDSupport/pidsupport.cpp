@@ -0,0 +1,122 @@
+#include "pidsupport.h"
+#include <string.h>
+
+uint8_t PIDSupport::bitmaps[PID_SUPPORT_RANGES][4];
+uint8_t PIDSupport::rangesSeen = 0;
+uint32_t PIDSupport::unavailable[8];
+uint8_t PIDSupport::noDataStreak[256];
+volatile uint32_t PIDSupport::version = 0;
+bool PIDSupport::changed = false;
+
+void PIDSupport::reset() {
+    memset(bitmaps, 0, sizeof(bitmaps));
+    rangesSeen = 0;
+    clearUnavailable();
+    version++;
+}
+
+// basePID is 0x00, 0x20, ... 0xE0 and data the four bytes that followed it
+void PIDSupport::onBitmap(uint8_t basePID, const uint8_t* data) {
+    uint8_t range = basePID / 0x20;
+    uint8_t bit = 1 << range;
+    if ((rangesSeen & bit) && memcmp(bitmaps[range], data, 4) == 0) return;
+
+    // A different first bitmap than the cached one: another car behind the same adapter
+    if (range == 0 && (rangesSeen & bit)) {
+        memset(bitmaps, 0, sizeof(bitmaps));
+        rangesSeen = 0;
+    }
+    memcpy(bitmaps[range], data, 4);
+    rangesSeen |= bit;
+    changed = true;
+    version++;
+}
+
+// The adapter gave no bitmap for the range, take it as empty instead of asking forever
+void PIDSupport::markRangeMissing(uint8_t basePID) {
+    uint8_t range = basePID / 0x20;
+    memset(bitmaps[range], 0, 4);
+    rangesSeen |= 1 << range;
+    changed = true;
+    version++;
+}
+
+// Next bitmap PID to request, PID_SUPPORT_NO_RANGE once all the listed ones are known
+uint8_t PIDSupport::nextMissingRange() {
+    if (!(rangesSeen & 1)) return 0x00;
+    for (uint8_t range = 1; range < PID_SUPPORT_RANGES; range++) {
+        if (rangesSeen & (1 << range)) continue;
+        // The last bit of the previous bitmap is the bitmap PID of this range
+        if (!(bitmaps[range - 1][3] & 0x01)) return PID_SUPPORT_NO_RANGE;
+        return range * 0x20;
+    }
+    return PID_SUPPORT_NO_RANGE;
+}
+
+bool PIDSupport::isDiscovered() {
+    return nextMissingRange() == PID_SUPPORT_NO_RANGE;
+}
+
+bool PIDSupport::inBitmap(uint8_t pid) {
+    uint8_t index = pid - 1;
+    uint8_t range = index / 0x20;
+    uint8_t bit = index % 0x20;
+    if (!(rangesSeen & (1 << range))) return !isDiscovered();
+    return (bitmaps[range][bit / 8] & (0x80 >> (bit % 8))) != 0;
+}
+
+bool PIDSupport::isSupported(uint8_t pid) {
+    if (pid == 0x00) return true;
+    if (unavailable[pid / 32] & (1UL << (pid % 32))) return false;
+    return inBitmap(pid);
+}
+
+// Result of a single-PID request, a batch answered NO DATA says nothing about
+// one PID. Returns true when the PID was just given up on.
+bool PIDSupport::onPIDResult(uint8_t pid, bool noData) {
+    if (!noData) {
+        noDataStreak[pid] = 0;
+        return false;
+    }
+    if (noDataStreak[pid] < PID_SUPPORT_NO_DATA_LIMIT) noDataStreak[pid]++;
+    if (noDataStreak[pid] < PID_SUPPORT_NO_DATA_LIMIT) return false;
+    if (unavailable[pid / 32] & (1UL << (pid % 32))) return false;
+    unavailable[pid / 32] |= 1UL << (pid % 32);
+    version++;
+    return true;
+}
+
+// Called when the ECU wakes up: a PID that was quiet last drive gets another chance
+void PIDSupport::clearUnavailable() {
+    memset(unavailable, 0, sizeof(unavailable));
+    memset(noDataStreak, 0, sizeof(noDataStreak));
+    version++;
+}
+
+// Bumped whenever isSupported() may answer differently
+uint32_t PIDSupport::getVersion() {
+    return version;
+}
+
+// True once after the bitmaps changed, to know when the cache is out of date
+bool PIDSupport::takeChanged() {
+    bool result = changed;
+    changed = false;
+    return result;
+}
+
+bool PIDSupport::restore(const uint8_t* cache, size_t length) {
+    if (length < PID_SUPPORT_CACHE_SIZE) return false;
+    rangesSeen = cache[0];
+    memcpy(bitmaps, cache + 1, sizeof(bitmaps));
+    changed = false;
+    version++;
+    return true;
+}
+
+size_t PIDSupport::save(uint8_t* cache, size_t size) {
+    if (size < PID_SUPPORT_CACHE_SIZE) return 0;
+    cache[0] = rangesSeen;
+    memcpy(cache + 1, bitmaps, sizeof(bitmaps));
+    return PID_SUPPORT_CACHE_SIZE;
+}
@@ -0,0 +1,44 @@
+#ifndef PIDSUPPORT_H
+#define PIDSUPPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PID_SUPPORT_RANGES 8
+#define PID_SUPPORT_NO_RANGE 0xFF
+#define PID_SUPPORT_CACHE_SIZE (1 + PID_SUPPORT_RANGES * 4)
+// Consecutive NO DATA answers to a single-PID request before the PID is left
+// out for the rest of the drive although the ECU lists it
+#define PID_SUPPORT_NO_DATA_LIMIT 3
+
+// Mode 01 PIDs the ECU supports, from the 0100/0120/0140/... bitmaps. Each
+// bitmap covers the 32 PIDs after its own, its last bit says whether the next
+// one exists. Until discovery is complete every PID counts as supported, so
+// an unknown car is polled like before.
+class PIDSupport {
+private:
+    static uint8_t bitmaps[PID_SUPPORT_RANGES][4];
+    static uint8_t rangesSeen;
+    static uint32_t unavailable[8];
+    static uint8_t noDataStreak[256];
+    static volatile uint32_t version;
+    static bool changed;
+
+    static bool inBitmap(uint8_t pid);
+
+public:
+    static void reset();
+    static void onBitmap(uint8_t basePID, const uint8_t* data);
+    static void markRangeMissing(uint8_t basePID);
+    static uint8_t nextMissingRange();
+    static bool isDiscovered();
+    static bool isSupported(uint8_t pid);
+    static bool onPIDResult(uint8_t pid, bool noData);
+    static void clearUnavailable();
+    static uint32_t getVersion();
+    static bool takeChanged();
+    static bool restore(const uint8_t* cache, size_t length);
+    static size_t save(uint8_t* cache, size_t size);
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "pidtable.h"
+#include <stdio.h>
+
+namespace {
+
+// pid, bytes, multiplier, divisor, offset, decimals, slot, rate (Hz), priority, name, unit
+constexpr PIDDescriptor ROWS[] = {
+    { 0x00, 4, 1, 1, 0, 0, PID_SLOT_BITMAP, 0.0f, 0, "pids_01_20", "" },
+    { 0x04, 1, 100, 255, 0, 0, PID_SLOT_LOAD, 4.0f, 2, "engine_load", "%" },
+    { 0x05, 1, 1, 1, -40, 0, PID_SLOT_COOLANT, 0.2f, 1, "coolant_temp", "C" },
+    { 0x06, 1, 1000, 128, -1000, 1, PID_SLOT_NONE, 0.5f, 1, "short_fuel_trim_1", "%" },
+    { 0x07, 1, 1000, 128, -1000, 1, PID_SLOT_NONE, 0.2f, 1, "long_fuel_trim_1", "%" },
+    { 0x0B, 1, 1, 1, 0, 0, PID_SLOT_NONE, 1.0f, 1, "intake_pressure", "kPa" },
+    { 0x0C, 2, 1, 4, 0, 0, PID_SLOT_RPM, 4.0f, 2, "rpm", "rpm" },
+    { 0x0D, 1, 1, 1, 0, 0, PID_SLOT_SPEED, 5.0f, 2, "speed", "km/h" },
+    { 0x0E, 1, 5, 1, -640, 1, PID_SLOT_NONE, 0.5f, 1, "timing_advance", "deg" },
+    { 0x0F, 1, 1, 1, -40, 0, PID_SLOT_NONE, 0.2f, 1, "intake_temp", "C" },
+    { 0x10, 2, 1, 1, 0, 2, PID_SLOT_NONE, 1.0f, 1, "maf", "g/s" },
+    { 0x11, 1, 1000, 255, 0, 1, PID_SLOT_NONE, 1.0f, 1, "throttle", "%" },
+    { 0x20, 4, 1, 1, 0, 0, PID_SLOT_BITMAP, 0.0f, 0, "pids_21_40", "" },
+    { 0x40, 4, 1, 1, 0, 0, PID_SLOT_BITMAP, 0.0f, 0, "pids_41_60", "" },
+    { 0x60, 4, 1, 1, 0, 0, PID_SLOT_BITMAP, 0.0f, 0, "pids_61_80", "" },
+    { 0x80, 4, 1, 1, 0, 0, PID_SLOT_BITMAP, 0.0f, 0, "pids_81_A0", "" },
+    { 0xA0, 4, 1, 1, 0, 0, PID_SLOT_BITMAP, 0.0f, 0, "pids_A1_C0", "" },
+    { 0xC0, 4, 1, 1, 0, 0, PID_SLOT_BITMAP, 0.0f, 0, "pids_C1_E0", "" },
+    { 0xE0, 4, 1, 1, 0, 0, PID_SLOT_BITMAP, 0.0f, 0, "pids_E1_FF", "" }
+};
+
+constexpr uint8_t ROW_COUNT = sizeof(ROWS) / sizeof(ROWS[0]);
+
+static_assert(ROW_COUNT < PID_TABLE_NONE, "PID table larger than the dispatch array can index");
+
+// Row of a PID, PID_TABLE_NONE if it is not in the table (C++11 constexpr: one return)
+constexpr uint8_t rowOf(uint8_t pid, uint8_t row) {
+    return row >= ROW_COUNT ? PID_TABLE_NONE : (ROWS[row].pid == pid ? row : rowOf(pid, row + 1));
+}
+
+constexpr bool validRows(uint8_t row) {
+    return row >= ROW_COUNT ||
+           (ROWS[row].bytes >= 1 && ROWS[row].bytes <= 4 && ROWS[row].divisor != 0 &&
+            rowOf(ROWS[row].pid, 0) == row && validRows(row + 1));
+}
+
+static_assert(validRows(0), "PID listed twice, or a row without data bytes or divisor");
+
+template<size_t... I> struct PIDSequence {};
+template<size_t N, size_t... I> struct MakePIDSequence : MakePIDSequence<N - 1, N - 1, I...> {};
+template<size_t... I> struct MakePIDSequence<0, I...> { typedef PIDSequence<I...> type; };
+
+template<typename Sequence> struct DispatchArray;
+template<size_t... I> struct DispatchArray<PIDSequence<I...> > {
+    static constexpr uint8_t rows[sizeof...(I)] = { rowOf((uint8_t)I, 0)... };
+};
+template<size_t... I> constexpr uint8_t DispatchArray<PIDSequence<I...> >::rows[sizeof...(I)];
+
+typedef DispatchArray<MakePIDSequence<256>::type> Dispatch;
+
+static_assert(Dispatch::rows[0x0C] != PID_TABLE_NONE && Dispatch::rows[0x01] == PID_TABLE_NONE,
+              "dispatch array out of step with the table");
+
+}
+
+const PIDDescriptor* PIDTable::find(uint8_t pid) {
+    uint8_t row = Dispatch::rows[pid];
+    return row != PID_TABLE_NONE ? &ROWS[row] : nullptr;
+}
+
+// ELMPIDLengthFunction for the parser, 0 stops the walk at an unknown PID
+uint8_t PIDTable::dataLength(uint8_t pid) {
+    uint8_t row = Dispatch::rows[pid];
+    return row != PID_TABLE_NONE ? ROWS[row].bytes : 0;
+}
+
+int32_t PIDTable::decode(const PIDDescriptor& descriptor, const uint8_t* data) {
+    int32_t raw = descriptor.bytes == 2 ? (data[0] << 8) | data[1] : data[0];
+    return raw * descriptor.multiplier / descriptor.divisor + descriptor.offset;
+}
+
+// "12.34" for MAF 1234, "-3.1" for a fuel trim of -31
+size_t PIDTable::formatValue(const PIDDescriptor& descriptor, int32_t value, char* text, size_t size) {
+    int length;
+    if (descriptor.decimals == 0) {
+        length = snprintf(text, size, "%ld", (long)value);
+    } else {
+        int32_t scale = 1;
+        for (uint8_t i = 0; i < descriptor.decimals; i++) scale *= 10;
+        uint32_t magnitude = value < 0 ? (uint32_t)-value : (uint32_t)value;
+        length = snprintf(text, size, "%s%lu.%0*lu", value < 0 ? "-" : "", (unsigned long)(magnitude / scale),
+                          (int)descriptor.decimals, (unsigned long)(magnitude % scale));
+    }
+    return length > 0 ? (size_t)length : 0;
+}
+
+// Values of PIDs outside the table are printed as they are
+size_t PIDTable::formatValue(uint8_t pid, int32_t value, char* text, size_t size) {
+    const PIDDescriptor* descriptor = find(pid);
+    if (descriptor != nullptr) return formatValue(*descriptor, value, text, size);
+    int length = snprintf(text, size, "%ld", (long)value);
+    return length > 0 ? (size_t)length : 0;
+}
+
+uint8_t PIDTable::getRowCount() {
+    return ROW_COUNT;
+}
+
+const PIDDescriptor& PIDTable::getRow(uint8_t index) {
+    return ROWS[index];
+}
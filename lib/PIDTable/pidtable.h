@@ -0,0 +1,53 @@
+#ifndef PIDTABLE_H
+#define PIDTABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PID_TABLE_NONE 0xFF
+#define PID_VALUE_TEXT_SIZE 16
+
+// Where a decoded value goes besides the trip log: the four live values have
+// an LCD field and feed the trip computer, statistics and telemetry
+enum PIDSlot : uint8_t {
+    PID_SLOT_NONE,
+    PID_SLOT_BITMAP,        // supported PID bitmap, for PIDSupport
+    PID_SLOT_RPM,
+    PID_SLOT_SPEED,
+    PID_SLOT_LOAD,
+    PID_SLOT_COOLANT
+};
+
+// One mode 01 PID. raw is A for one data byte and 256A+B for two, the value
+// is raw * multiplier / divisor + offset in units of 10^-decimals (MAF 1234 =
+// 12.34 g/s), in integer math so the decoder never touches the FPU.
+struct PIDDescriptor {
+    uint8_t pid;
+    uint8_t bytes;              // data bytes after the PID in the response
+    int32_t multiplier;
+    int32_t divisor;
+    int32_t offset;
+    uint8_t decimals;
+    PIDSlot slot;
+    float rateHz;               // default poll rate, 0 = not polled
+    uint8_t priority;           // PIDScheduler priority
+    const char* name;
+    const char* unit;
+};
+
+// The PIDs the reader knows, as one constexpr table. A 256-entry dispatch
+// array (PID -> row) is generated from it at compile time, so the parser's
+// length lookup and the decoder are one array access per PID. A new PID is a
+// row in pidtable.cpp, nothing else. Plain C++, shared with the native build.
+class PIDTable {
+public:
+    static const PIDDescriptor* find(uint8_t pid);
+    static uint8_t dataLength(uint8_t pid);
+    static int32_t decode(const PIDDescriptor& descriptor, const uint8_t* data);
+    static size_t formatValue(const PIDDescriptor& descriptor, int32_t value, char* text, size_t size);
+    static size_t formatValue(uint8_t pid, int32_t value, char* text, size_t size);
+    static uint8_t getRowCount();
+    static const PIDDescriptor& getRow(uint8_t index);
+};
+
+#endif
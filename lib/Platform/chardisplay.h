@@ -0,0 +1,15 @@
+#ifndef CHARDISPLAY_H
+#define CHARDISPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Character display the dashboard is drawn on (the 16x2 I2C LCD on the car)
+class CharDisplay {
+public:
+    virtual ~CharDisplay() {}
+    virtual void clear() = 0;
+    virtual void write(uint8_t column, uint8_t row, const char* text, size_t length) = 0;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef ELMTRANSPORT_H
+#define ELMTRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef void (*ELMReceiveFunction)(const uint8_t* data, size_t length, void* context);
+
+// How the adapter is reached, chosen at runtime and kept in NVS
+enum ELM_TRANSPORT_KIND : uint8_t {
+    ELM_TRANSPORT_BLE,          // BLE clones: fff0 service, fff2 write, fff1 notify
+    ELM_TRANSPORT_SPP,          // classic Bluetooth serial port
+    ELM_TRANSPORT_TCP,          // WiFi clones: raw socket, usually 192.168.0.10:35000
+    ELM_TRANSPORT_KIND_COUNT
+};
+
+#define ELM_ADAPTER_CONFIG_VERSION 1
+#define ELM_ADAPTER_ADDRESS_SIZE 32
+#define ELM_ADAPTER_SSID_SIZE 33
+#define ELM_ADAPTER_PASSWORD_SIZE 65
+#define ELM_TCP_DEFAULT_ADDRESS "192.168.0.10:35000"
+#define ELM_TCP_DEFAULT_SSID "WiFi_OBDII"
+
+// The adapter to connect to. address is the MAC for BLE and SPP, host:port
+// for TCP; ssid/password are the WiFi adapter's access point.
+struct ELMAdapterConfig {
+    uint8_t version;
+    uint8_t kind;
+    char address[ELM_ADAPTER_ADDRESS_SIZE];
+    char ssid[ELM_ADAPTER_SSID_SIZE];
+    char password[ELM_ADAPTER_PASSWORD_SIZE];
+};
+
+static inline const char* elmTransportName(uint8_t kind) {
+    static const char* const names[ELM_TRANSPORT_KIND_COUNT] = { "ble", "spp", "tcp" };
+    return kind < ELM_TRANSPORT_KIND_COUNT ? names[kind] : "unknown";
+}
+
+// Byte pipe to an ELM327. write() sends a command, whatever the adapter sends
+// back is handed to the receiver in the pieces it arrived in (BLE
+// notifications, socket reads, ...); assembling the '>'-terminated responses
+// is up to the receiver.
+//
+// BLE and SPP deliver from their stack's callbacks. A transport without one
+// (a socket) says so with needsPolling() and delivers from poll(), which its
+// owner calls from a reader task.
+class ELMTransport {
+public:
+    ELMTransport() : receiver(nullptr), receiverContext(nullptr) {}
+    virtual ~ELMTransport() {}
+
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+    virtual bool connect(const char* address) { return true; }
+    virtual void disconnect() {}
+    virtual bool isConnected() { return true; }
+    virtual bool needsPolling() const { return false; }
+    virtual bool poll(uint32_t timeoutMs) { return false; }
+    virtual const char* getName() const { return "simulator"; }
+
+    void setReceiver(ELMReceiveFunction function, void* context) {
+        receiver = function;
+        receiverContext = context;
+    }
+
+protected:
+    void deliver(const uint8_t* data, size_t length) {
+        if (receiver != nullptr) receiver(data, length, receiverContext);
+    }
+
+private:
+    ELMReceiveFunction receiver;
+    void* receiverContext;
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TRIPSTORAGE_H
+#define TRIPSTORAGE_H
+
+#include <stdint.h>
+
+// Fuel and trip values the trip computer reads and updates. They are kept in
+// integer micro-liters and millimeters so small increments are never rounded
+// away on a long trip. On the ESP32 PreferencesHandle keeps them in NVS.
+// The trip computer only ever adds to them: the web interface writes the same
+// values from the other core, a read followed by a set would undo its change.
+class TripStorage {
+public:
+    virtual ~TripStorage() {}
+    virtual int64_t getFuelMicroliters() = 0;         // below zero when more was burnt than the tank held
+    virtual void setFuelMicroliters(int64_t fuel) = 0;
+    virtual void addFuelMicroliters(int64_t delta) = 0;
+    virtual float getTankCapacity() = 0;
+    virtual float getConsumptionFactor() = 0;
+    virtual uint64_t getDistanceMm() = 0;
+    virtual void setDistanceMm(uint64_t distance) = 0;
+    virtual void addDistanceMm(uint64_t distance) = 0;
+    virtual uint64_t getTripFuelMicroliters() = 0;
+    virtual void setTripFuelMicroliters(uint64_t fuel) = 0;
+    virtual void addTripFuelMicroliters(uint64_t fuel) = 0;
+
+    // Liters and kilometers, for the page and the display
+    float getFuel() { return getFuelMicroliters() / 1000000.0f; }
+    void setFuel(float liters) { setFuelMicroliters((int64_t)(liters * 1000000.0f)); }
+    float getDistanceTraveled() { return getDistanceMm() / 1000000.0f; }
+    void setDistanceTraveled(float km) { setDistanceMm(km > 0 ? (uint64_t)(km * 1000000.0f) : 0); }
+    float getTripFuelUsed() { return getTripFuelMicroliters() / 1000000.0f; }
+    void setTripFuelUsed(float liters) { setTripFuelMicroliters(liters > 0 ? (uint64_t)(liters * 1000000.0f) : 0); }
+};
+
+#endif
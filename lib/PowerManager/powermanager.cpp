@@ -0,0 +1,86 @@
+#include "powermanager.h"
+#include <WiFi.h>
+
+POWER_STATE PowerManager::state = POWER_DISCONNECTED;
+unsigned long PowerManager::stateSince = 0;
+uint64_t PowerManager::timeInStateMs[POWER_STATE_COUNT] = {};
+uint32_t PowerManager::transitions[POWER_STATE_COUNT] = {};
+uint32_t PowerManager::probeIntervalMs = POWER_PROBE_MIN_INTERVAL_MS;
+uint32_t PowerManager::probes = 0;
+portMUX_TYPE PowerManager::lock = portMUX_INITIALIZER_UNLOCKED;
+
+void PowerManager::begin() {
+    stateSince = millis();
+    transitions[state]++;
+    applyProfile();
+}
+
+// Returns how long the previous state lasted
+unsigned long PowerManager::setState(POWER_STATE next) {
+    unsigned long now = millis();
+    unsigned long elapsed = now - stateSince;
+    if (next == state) return elapsed;
+
+    portENTER_CRITICAL(&lock);
+    timeInStateMs[state] += elapsed;
+    transitions[next]++;
+    state = next;
+    stateSince = now;
+    portEXIT_CRITICAL(&lock);
+
+    probeIntervalMs = POWER_PROBE_MIN_INTERVAL_MS;
+    applyProfile();
+    return elapsed;
+}
+
+POWER_STATE PowerManager::getState() {
+    return state;
+}
+
+// Also called by the WiFi task once the AP is up: before that the WiFi
+// settings cannot be applied
+void PowerManager::applyProfile() {
+    bool active = state == POWER_ACTIVE;
+    setCpuFrequencyMhz(active ? POWER_ACTIVE_CPU_MHZ : POWER_IDLE_CPU_MHZ);
+    if (WiFi.getMode() == WIFI_MODE_NULL) return;
+    // Modem sleep only acts on the station joined to a WiFi adapter (the AP
+    // never sleeps): off while polling, so a reply is not held until the
+    // next beacon, back on while the ECU sleeps
+    WiFi.setSleep(!active);
+    WiFi.setTxPower(active ? WIFI_POWER_19_5dBm : WIFI_POWER_8_5dBm);
+}
+
+// Wait before the next ECU probe: doubles from POWER_PROBE_MIN_INTERVAL_MS up
+// to POWER_PROBE_MAX_INTERVAL_MS, starting over on every state change
+uint32_t PowerManager::nextProbeDelay() {
+    uint32_t delayMs = probeIntervalMs;
+    probeIntervalMs = probeIntervalMs * 2 > POWER_PROBE_MAX_INTERVAL_MS ? POWER_PROBE_MAX_INTERVAL_MS : probeIntervalMs * 2;
+    probes++;
+    return delayMs;
+}
+
+// Includes the time in the current state so far
+uint64_t PowerManager::getTimeInState(POWER_STATE which) {
+    portENTER_CRITICAL(&lock);
+    uint64_t total = timeInStateMs[which];
+    if (which == state) total += millis() - stateSince;
+    portEXIT_CRITICAL(&lock);
+    return total;
+}
+
+uint32_t PowerManager::getTransitions(POWER_STATE which) {
+    return transitions[which];
+}
+
+uint32_t PowerManager::getProbes() {
+    return probes;
+}
+
+const char* PowerManager::stateName(POWER_STATE which) {
+    switch (which) {
+        case POWER_ACTIVE: return "active";
+        case POWER_ECU_WAIT: return "ecu_wait";
+        case POWER_DISCONNECTED: return "disconnected";
+        default: return "unknown";
+    }
+}
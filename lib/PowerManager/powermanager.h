@@ -0,0 +1,46 @@
+#ifndef POWERMANAGER_H
+#define POWERMANAGER_H
+
+#include <Arduino.h>
+
+#define POWER_ACTIVE_CPU_MHZ 240
+#define POWER_IDLE_CPU_MHZ 80               // lowest clock WiFi and BLE still run at
+#define POWER_PROBE_MIN_INTERVAL_MS 500
+#define POWER_PROBE_MAX_INTERVAL_MS 4000    // worst case from ignition on to the next 0100
+
+enum POWER_STATE {
+    POWER_ACTIVE,           // ECU awake, polling at full speed
+    POWER_ECU_WAIT,         // adapter connected, ECU asleep: probing with backoff
+    POWER_DISCONNECTED,     // no adapter, reconnecting with backoff
+    POWER_STATE_COUNT
+};
+
+// Power profile of the board per state. Outside POWER_ACTIVE the CPU runs at
+// POWER_IDLE_CPU_MHZ, the AP transmits at lower power and the ECU is probed
+// with a backoff (nextProbeDelay). The station link to a WiFi adapter, if
+// any, leaves modem sleep only while polling. The loop task blocks between
+// probes, so the idle task halts the CPU meanwhile. Light sleep is not used:
+// it would drop the BLE link to the adapter and the AP.
+class PowerManager {
+private:
+    static POWER_STATE state;
+    static unsigned long stateSince;
+    static uint64_t timeInStateMs[POWER_STATE_COUNT];
+    static uint32_t transitions[POWER_STATE_COUNT];
+    static uint32_t probeIntervalMs;
+    static uint32_t probes;
+    static portMUX_TYPE lock;
+
+public:
+    static void begin();
+    static unsigned long setState(POWER_STATE next);
+    static POWER_STATE getState();
+    static void applyProfile();
+    static uint32_t nextProbeDelay();
+    static uint64_t getTimeInState(POWER_STATE state);
+    static uint32_t getTransitions(POWER_STATE state);
+    static uint32_t getProbes();
+    static const char* stateName(POWER_STATE state);
+};
+
+#endif
@@ -8,26 +8,54 @@ PreferencesHandle& PreferencesHandle::getInstance() {
     return *instance;
 }
 
-void PreferencesHandle::setFuel(float fuel) {
-    if(fuel == this->fuel) return;
-    this->fuel = fuel;
-    savePreferences();
+template <typename T>
+void PreferencesHandle::setValue(T& field, T value, DirtyKey key) {
+    portENTER_CRITICAL(&lock);
+    if(value != field) {
+        field = value;
+        dirty |= key;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+// Read, add and store in one critical section: the decoder's increments and
+// the web interface's writes (tank reset, +10 L) can't overwrite each other
+template <typename T>
+void PreferencesHandle::addValue(T& field, T delta, DirtyKey key) {
+    if(delta == 0) return;
+    portENTER_CRITICAL(&lock);
+    field += delta;
+    dirty |= key;
+    portEXIT_CRITICAL(&lock);
+}
+
+// The 64-bit values take two loads on the ESP32, the other core could be halfway through a store
+template <typename T>
+T PreferencesHandle::getValue(const T& field) {
+    portENTER_CRITICAL(&lock);
+    T value = field;
+    portEXIT_CRITICAL(&lock);
+    return value;
+}
+
+void PreferencesHandle::setFuelMicroliters(int64_t fuel) {
+    setValue(this->fuelMicroliters, fuel, DIRTY_FUEL);
+}
+
+void PreferencesHandle::addFuelMicroliters(int64_t delta) {
+    addValue(this->fuelMicroliters, delta, DIRTY_FUEL);
 }
 
 void PreferencesHandle::setTankCapacity(float capacity) {
-    if(capacity == this->tankCapacity) return;
-    this->tankCapacity = capacity;
-    savePreferences();
+    setValue(this->tankCapacity, capacity, DIRTY_CAPACITY);
 }
 
 void PreferencesHandle::setConsumptionFactor(float factor) {
-    if(factor == this->consumptionFactor) return;
-    this->consumptionFactor = factor;
-    savePreferences();
+    setValue(this->consumptionFactor, factor, DIRTY_FACTOR);
 }
 
-float PreferencesHandle::getFuel() {
-    return fuel;
+int64_t PreferencesHandle::getFuelMicroliters() {
+    return getValue(fuelMicroliters);
 }
 
 float PreferencesHandle::getTankCapacity() {
@@ -39,41 +67,212 @@ float PreferencesHandle::getConsumptionFactor() {
 }
 
 PreferencesHandle::PreferencesHandle() {
+    flushMutex = xSemaphoreCreateMutex();
     prefs.begin(PREFERENCE_NAMESPACE, true);
-    fuel = prefs.getFloat("fuel", 45.0);
     tankCapacity = prefs.getFloat("capacity", 45.0);
     consumptionFactor = prefs.getFloat("factor", 0.00000000815);
-    distanceTraveled = prefs.getFloat("distance", 0.0);
-    tripFuelUsed = prefs.getFloat("tripFuel", 0.0);
+    // Older firmware kept liters and kilometers as floats under other keys,
+    // they are read once and the integer keys take over from the next flush
+    if(prefs.isKey("fuelUl")) {
+        fuelMicroliters = prefs.getLong64("fuelUl", 45000000);
+        distanceMm = prefs.getULong64("distanceMm", 0);
+        tripFuelMicroliters = prefs.getULong64("tripFuelUl", 0);
+    } else {
+        fuelMicroliters = (int64_t)(prefs.getFloat("fuel", 45.0) * 1000000.0f);
+        float distance = prefs.getFloat("distance", 0.0);
+        float tripFuel = prefs.getFloat("tripFuel", 0.0);
+        distanceMm = distance > 0 ? (uint64_t)(distance * 1000000.0f) : 0;
+        tripFuelMicroliters = tripFuel > 0 ? (uint64_t)(tripFuel * 1000000.0f) : 0;
+        dirty = DIRTY_FUEL | DIRTY_DISTANCE | DIRTY_TRIP_FUEL;
+    }
+    if(prefs.isKey("tripSlots")) {
+        tripSlotsLength = prefs.getBytes("tripSlots", tripSlots, sizeof(tripSlots));
+    }
     prefs.end();
 }
 
-void PreferencesHandle::savePreferences() {
+// Writes only the keys changed since the last flush. The values are copied
+// under the lock so a setter running on the other core is never half-saved.
+// A key whose write fails stays dirty and is tried again on the next flush.
+void PreferencesHandle::flush() {
+    xSemaphoreTake(flushMutex, portMAX_DELAY);
+    portENTER_CRITICAL(&lock);
+    uint8_t keys = dirty;
+    dirty = 0;
+    int64_t fuelValue = fuelMicroliters;
+    float capacityValue = tankCapacity;
+    float factorValue = consumptionFactor;
+    uint64_t distanceValue = distanceMm;
+    uint64_t tripFuelValue = tripFuelMicroliters;
+    uint8_t slotsValue[PREFERENCES_TRIP_SLOTS_SIZE];
+    size_t slotsLength = tripSlotsLength;
+    if(keys & DIRTY_TRIP_SLOTS) memcpy(slotsValue, tripSlots, slotsLength);
+    portEXIT_CRITICAL(&lock);
+
+    lastFlush = millis();
+    if(keys == 0) {
+        xSemaphoreGive(flushMutex);
+        return;
+    }
+
+    uint8_t written = 0;
+    if(prefs.begin(PREFERENCE_NAMESPACE, false)) {
+        if((keys & DIRTY_FUEL) && prefs.putLong64("fuelUl", fuelValue) > 0) written |= DIRTY_FUEL;
+        if((keys & DIRTY_CAPACITY) && prefs.putFloat("capacity", capacityValue) > 0) written |= DIRTY_CAPACITY;
+        if((keys & DIRTY_FACTOR) && prefs.putFloat("factor", factorValue) > 0) written |= DIRTY_FACTOR;
+        if((keys & DIRTY_DISTANCE) && prefs.putULong64("distanceMm", distanceValue) > 0) written |= DIRTY_DISTANCE;
+        if((keys & DIRTY_TRIP_FUEL) && prefs.putULong64("tripFuelUl", tripFuelValue) > 0) written |= DIRTY_TRIP_FUEL;
+        if((keys & DIRTY_TRIP_SLOTS) && prefs.putBytes("tripSlots", slotsValue, slotsLength) > 0) written |= DIRTY_TRIP_SLOTS;
+        prefs.end();
+    }
+    flashWrites += __builtin_popcount(written);
+
+    if(written != keys) {
+        portENTER_CRITICAL(&lock);
+        dirty |= keys & ~written;
+        portEXIT_CRITICAL(&lock);
+    }
+    xSemaphoreGive(flushMutex);
+}
+
+// NVS keys are limited to 15 characters: a prefix and the 12 hex digits of the MAC
+void PreferencesHandle::adapterKey(char prefix, const char* address, char* key) {
+    size_t length = 0;
+    key[length++] = prefix;
+    for(const char* c = address; *c != '\0' && length < 13; c++) {
+        if(isxdigit((unsigned char)*c)) key[length++] = tolower((unsigned char)*c);
+    }
+    key[length] = '\0';
+}
+
+bool PreferencesHandle::loadAdapterBytes(char prefix, const char* address, uint8_t* data, size_t size) {
+    char key[16];
+    adapterKey(prefix, address, key);
+    return loadBytes(key, data, size);
+}
+
+bool PreferencesHandle::loadBytes(const char* key, uint8_t* data, size_t size) {
+    xSemaphoreTake(flushMutex, portMAX_DELAY);
+    prefs.begin(PREFERENCE_NAMESPACE, true);
+    size_t length = prefs.isKey(key) ? prefs.getBytes(key, data, size) : 0;
+    prefs.end();
+    xSemaphoreGive(flushMutex);
+    return length == size;
+}
+
+// Written right away, these only change when the adapter moves to another car
+// or gets another firmware
+void PreferencesHandle::saveAdapterBytes(char prefix, const char* address, const uint8_t* data, size_t size) {
+    char key[16];
+    adapterKey(prefix, address, key);
+    saveBytes(key, data, size);
+}
+
+void PreferencesHandle::saveBytes(const char* key, const uint8_t* data, size_t size) {
+    xSemaphoreTake(flushMutex, portMAX_DELAY);
     prefs.begin(PREFERENCE_NAMESPACE, false);
-    prefs.putFloat("fuel", fuel);
-    prefs.putFloat("capacity", tankCapacity);
-    prefs.putFloat("factor", consumptionFactor);
-    prefs.putFloat("distance", distanceTraveled);
-    prefs.putFloat("tripFuel", tripFuelUsed);
+    prefs.putBytes(key, data, size);
     prefs.end();
+    flashWrites++;
+    xSemaphoreGive(flushMutex);
+}
+
+// Supported PID bitmaps of the car last seen behind the adapter with this MAC
+bool PreferencesHandle::loadSupportedPIDs(const char* address, uint8_t* cache, size_t size) {
+    return loadAdapterBytes('p', address, cache, size);
+}
+
+void PreferencesHandle::saveSupportedPIDs(const char* address, const uint8_t* cache, size_t size) {
+    saveAdapterBytes('p', address, cache, size);
+}
+
+// GATT handles of the adapter's TX/RX characteristics
+bool PreferencesHandle::loadAdapterHandles(const char* address, uint8_t* cache, size_t size) {
+    return loadAdapterBytes('g', address, cache, size);
+}
+
+void PreferencesHandle::saveAdapterHandles(const char* address, const uint8_t* cache, size_t size) {
+    saveAdapterBytes('g', address, cache, size);
+}
+
+// OBD protocol and ECU address of the car behind the adapter
+bool PreferencesHandle::loadProtocol(const char* address, uint8_t* cache, size_t size) {
+    return loadAdapterBytes('v', address, cache, size);
+}
+
+void PreferencesHandle::saveProtocol(const char* address, const uint8_t* cache, size_t size) {
+    saveAdapterBytes('v', address, cache, size);
+}
+
+// Which adapter to connect to and over what. A blob of another version (or
+// none) leaves config as it is, the caller's defaults.
+bool PreferencesHandle::loadAdapterConfig(ELMAdapterConfig& config) {
+    ELMAdapterConfig stored;
+    if (!loadBytes("adapter", (uint8_t*)&stored, sizeof(stored))) return false;
+    if (stored.version != ELM_ADAPTER_CONFIG_VERSION || stored.kind >= ELM_TRANSPORT_KIND_COUNT) return false;
+    stored.address[sizeof(stored.address) - 1] = '\0';
+    stored.ssid[sizeof(stored.ssid) - 1] = '\0';
+    stored.password[sizeof(stored.password) - 1] = '\0';
+    config = stored;
+    return true;
+}
+
+void PreferencesHandle::saveAdapterConfig(const ELMAdapterConfig& config) {
+    saveBytes("adapter", (const uint8_t*)&config, sizeof(config));
+}
+
+void PreferencesHandle::flushIfDue(unsigned long now) {
+    if(now - lastFlush < flushIntervalMs) return;
+    flush();
+}
+
+void PreferencesHandle::setFlushInterval(unsigned long intervalMs) {
+    flushIntervalMs = intervalMs;
+}
+
+uint32_t PreferencesHandle::getFlashWriteCount() {
+    return flashWrites;
+}
+
+void PreferencesHandle::setDistanceMm(uint64_t distance) {
+    setValue(this->distanceMm, distance, DIRTY_DISTANCE);
+}
+
+void PreferencesHandle::addDistanceMm(uint64_t distance) {
+    addValue(this->distanceMm, distance, DIRTY_DISTANCE);
+}
+
+uint64_t PreferencesHandle::getDistanceMm() {
+    return getValue(distanceMm);
+}
+
+uint64_t PreferencesHandle::getTripFuelMicroliters() {
+    return getValue(tripFuelMicroliters);
 }
 
-void PreferencesHandle::setDistanceTraveled(float distance) {
-    if(distance == this->distanceTraveled) return;
-    this->distanceTraveled = distance;
-    savePreferences();
+void PreferencesHandle::setTripFuelMicroliters(uint64_t fuel) {
+    setValue(this->tripFuelMicroliters, fuel, DIRTY_TRIP_FUEL);
 }
 
-float PreferencesHandle::getDistanceTraveled() {
-    return distanceTraveled;
+void PreferencesHandle::addTripFuelMicroliters(uint64_t fuel) {
+    addValue(this->tripFuelMicroliters, fuel, DIRTY_TRIP_FUEL);
 }
 
-float PreferencesHandle::getTripFuelUsed() {
-    return tripFuelUsed;
+// The trip statistics slots are an opaque blob owned by TripStats, saved
+// with the other keys on the next flush
+size_t PreferencesHandle::getTripSlots(uint8_t* data, size_t size) {
+    portENTER_CRITICAL(&lock);
+    size_t length = tripSlotsLength <= size ? tripSlotsLength : 0;
+    memcpy(data, tripSlots, length);
+    portEXIT_CRITICAL(&lock);
+    return length;
 }
 
-void PreferencesHandle::setTripFuelUsed(float fuel) {
-    if(fuel == this->tripFuelUsed) return;
-    this->tripFuelUsed = fuel;
-    savePreferences();
+void PreferencesHandle::setTripSlots(const uint8_t* data, size_t size) {
+    if(size > sizeof(tripSlots)) return;
+    portENTER_CRITICAL(&lock);
+    memcpy(tripSlots, data, size);
+    tripSlotsLength = size;
+    dirty |= DIRTY_TRIP_SLOTS;
+    portEXIT_CRITICAL(&lock);
 }
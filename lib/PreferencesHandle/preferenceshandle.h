@@ -3,32 +3,85 @@
 
 #include <Preferences.h>
 #include "../datadefinition.h"
+#include <tripstorage.h>
+#include <elmtransport.h>
 
-class PreferencesHandle {
+#define PREFERENCES_FLUSH_INTERVAL_MS 60000
+#define PREFERENCES_TRIP_SLOTS_SIZE 256
+
+// Values live in RAM and are written back to NVS by flush(): only the keys
+// that changed since the last flush are written, at most once per interval
+// unless a caller forces it (ECU sleep, trip reset, calibration).
+class PreferencesHandle : public TripStorage {
 public:
     static PreferencesHandle& getInstance();
-    float getFuel();
-    void setFuel(float fuel);
+    int64_t getFuelMicroliters();
+    void setFuelMicroliters(int64_t fuel);
+    void addFuelMicroliters(int64_t delta);
     float getTankCapacity();
     void setTankCapacity(float capacity);
     float getConsumptionFactor();
     void setConsumptionFactor(float factor);
-    float getDistanceTraveled();
-    void setDistanceTraveled(float distance);
-    float getTripFuelUsed();
-    void setTripFuelUsed(float fuel);
+    uint64_t getDistanceMm();
+    void setDistanceMm(uint64_t distance);
+    void addDistanceMm(uint64_t distance);
+    uint64_t getTripFuelMicroliters();
+    void setTripFuelMicroliters(uint64_t fuel);
+    void addTripFuelMicroliters(uint64_t fuel);
+    size_t getTripSlots(uint8_t* data, size_t size);
+    void setTripSlots(const uint8_t* data, size_t size);
+
+    bool loadSupportedPIDs(const char* address, uint8_t* cache, size_t size);
+    void saveSupportedPIDs(const char* address, const uint8_t* cache, size_t size);
+    bool loadAdapterHandles(const char* address, uint8_t* cache, size_t size);
+    void saveAdapterHandles(const char* address, const uint8_t* cache, size_t size);
+    bool loadProtocol(const char* address, uint8_t* cache, size_t size);
+    void saveProtocol(const char* address, const uint8_t* cache, size_t size);
+    bool loadAdapterConfig(ELMAdapterConfig& config);
+    void saveAdapterConfig(const ELMAdapterConfig& config);
+
+    void flush();
+    void flushIfDue(unsigned long now);
+    void setFlushInterval(unsigned long intervalMs);
+    uint32_t getFlashWriteCount();
 
 private:
+    enum DirtyKey : uint8_t {
+        DIRTY_FUEL = 0x01,
+        DIRTY_CAPACITY = 0x02,
+        DIRTY_FACTOR = 0x04,
+        DIRTY_DISTANCE = 0x08,
+        DIRTY_TRIP_FUEL = 0x10,
+        DIRTY_TRIP_SLOTS = 0x20
+    };
+
     static PreferencesHandle *instance;
     PreferencesHandle();
     Preferences prefs;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    SemaphoreHandle_t flushMutex;
 
-    float fuel;
+    int64_t fuelMicroliters;
     float tankCapacity;
     float consumptionFactor;
-    float distanceTraveled;
-    float tripFuelUsed;
-    void savePreferences();
+    uint64_t distanceMm;
+    uint64_t tripFuelMicroliters;
+    uint8_t tripSlots[PREFERENCES_TRIP_SLOTS_SIZE];
+    size_t tripSlotsLength = 0;
+
+    uint8_t dirty = 0;
+    unsigned long flushIntervalMs = PREFERENCES_FLUSH_INTERVAL_MS;
+    unsigned long lastFlush = 0;
+    uint32_t flashWrites = 0;
+
+    static void adapterKey(char prefix, const char* address, char* key);
+    bool loadBytes(const char* key, uint8_t* data, size_t size);
+    void saveBytes(const char* key, const uint8_t* data, size_t size);
+    bool loadAdapterBytes(char prefix, const char* address, uint8_t* data, size_t size);
+    void saveAdapterBytes(char prefix, const char* address, const uint8_t* data, size_t size);
+    template <typename T> void setValue(T& field, T value, DirtyKey key);
+    template <typename T> void addValue(T& field, T delta, DirtyKey key);
+    template <typename T> T getValue(const T& field);
 };
 
 #endif
@@ -0,0 +1,65 @@
+#include "receivering.h"
+
+ReceiveRing::ReceiveRing() : byteHead(0), byteTail(0), chunkHead(0), chunkTail(0), highWater(0), dropped(0) {
+}
+
+// Producer side. A notification that does not fit is dropped whole.
+bool ReceiveRing::push(const uint8_t* data, size_t length, uint32_t timestampMs, uint16_t generation) {
+    uint32_t head = byteHead.load(std::memory_order_relaxed);
+    uint32_t used = head - byteTail.load(std::memory_order_acquire);
+    uint32_t chunk = chunkHead.load(std::memory_order_relaxed);
+
+    if (length > RECEIVE_RING_BYTES - used || chunk - chunkTail.load(std::memory_order_acquire) >= RECEIVE_RING_CHUNKS) {
+        dropped++;
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        bytes[(head + i) & (RECEIVE_RING_BYTES - 1)] = data[i];
+    }
+    ReceiveChunk& slot = chunks[chunk & (RECEIVE_RING_CHUNKS - 1)];
+    slot.timestampMs = timestampMs;
+    slot.length = length;
+    slot.generation = generation;
+
+    byteHead.store(head + length, std::memory_order_release);
+    chunkHead.store(chunk + 1, std::memory_order_release);
+
+    if (used + length > highWater) highWater = used + length;
+    return true;
+}
+
+// Consumer side. Looks at the next chunk without taking it out.
+bool ReceiveRing::peek(ReceiveChunk& chunk) const {
+    uint32_t index = chunkTail.load(std::memory_order_relaxed);
+    if (index == chunkHead.load(std::memory_order_acquire)) return false;
+
+    chunk = chunks[index & (RECEIVE_RING_CHUNKS - 1)];
+    return true;
+}
+
+// Consumer side. Copies at most capacity bytes of the next chunk, the rest of
+// an oversized chunk is skipped; chunk.length keeps the full length.
+bool ReceiveRing::pop(ReceiveChunk& chunk, uint8_t* out, size_t capacity) {
+    uint32_t index = chunkTail.load(std::memory_order_relaxed);
+    if (index == chunkHead.load(std::memory_order_acquire)) return false;
+
+    chunk = chunks[index & (RECEIVE_RING_CHUNKS - 1)];
+    uint32_t tail = byteTail.load(std::memory_order_relaxed);
+    size_t copy = chunk.length < capacity ? chunk.length : capacity;
+    for (size_t i = 0; i < copy; i++) {
+        out[i] = bytes[(tail + i) & (RECEIVE_RING_BYTES - 1)];
+    }
+
+    byteTail.store(tail + chunk.length, std::memory_order_release);
+    chunkTail.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+uint32_t ReceiveRing::getHighWater() const {
+    return highWater;
+}
+
+uint32_t ReceiveRing::getDropped() const {
+    return dropped;
+}
@@ -0,0 +1,42 @@
+#ifndef RECEIVERING_H
+#define RECEIVERING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Both sizes must be powers of two
+#define RECEIVE_RING_BYTES 1024
+#define RECEIVE_RING_CHUNKS 32
+
+struct ReceiveChunk {
+    uint32_t timestampMs;   // millis() when the notification arrived
+    uint16_t length;
+    uint16_t generation;    // command the bytes were received for
+};
+
+// Single-producer/single-consumer ring for BLE notifications: the producer
+// (the BLE callback) copies each notification in and returns, the consumer
+// (the decoder task) takes them out in order. No locks, the head and tail
+// counters are only ever written by one side each.
+class ReceiveRing {
+private:
+    uint8_t bytes[RECEIVE_RING_BYTES];
+    ReceiveChunk chunks[RECEIVE_RING_CHUNKS];
+    std::atomic<uint32_t> byteHead;
+    std::atomic<uint32_t> byteTail;
+    std::atomic<uint32_t> chunkHead;
+    std::atomic<uint32_t> chunkTail;
+    uint32_t highWater;
+    uint32_t dropped;
+
+public:
+    ReceiveRing();
+    bool push(const uint8_t* data, size_t length, uint32_t timestampMs, uint16_t generation);
+    bool peek(ReceiveChunk& chunk) const;
+    bool pop(ReceiveChunk& chunk, uint8_t* out, size_t capacity);
+    uint32_t getHighWater() const;
+    uint32_t getDropped() const;
+};
+
+#endif
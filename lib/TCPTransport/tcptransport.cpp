@@ -0,0 +1,166 @@
+#include "tcptransport.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#include <lwip/netdb.h>
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+TCPTransport::TCPTransport() : socketFd(-1) {}
+
+TCPTransport::~TCPTransport() {
+    disconnect();
+}
+
+// "192.168.0.10:35000", or just the host for the usual port
+bool TCPTransport::parseAddress(const char* address, char* host, size_t hostSize, uint16_t& port) {
+    const char* colon = strrchr(address, ':');
+    size_t length = colon != nullptr ? (size_t)(colon - address) : strlen(address);
+    if (length == 0 || length >= hostSize) return false;
+    memcpy(host, address, length);
+    host[length] = '\0';
+
+    port = TCP_TRANSPORT_DEFAULT_PORT;
+    if (colon != nullptr) {
+        char* end;
+        unsigned long value = strtoul(colon + 1, &end, 10);
+        if (*end != '\0' || value == 0 || value > 65535) return false;
+        port = (uint16_t)value;
+    }
+    return true;
+}
+
+// Non-blocking connect bounded by TCP_TRANSPORT_CONNECT_TIMEOUT_MS, an adapter
+// out of range must not hold the reconnect loop for the stack's 75 s
+bool TCPTransport::connect(const char* address) {
+    disconnect();
+
+    char host[ELM_ADAPTER_ADDRESS_SIZE];
+    uint16_t port;
+    if (!parseAddress(address, host, sizeof(host), port)) return false;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    if (getaddrinfo(host, nullptr, &hints, &result) != 0 || result == nullptr) return false;
+    struct sockaddr_in target;
+    memcpy(&target, result->ai_addr, sizeof(target));
+    freeaddrinfo(result);
+    target.sin_port = htons(port);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+    if (::connect(fd, (struct sockaddr*)&target, sizeof(target)) != 0 && errno != EINPROGRESS) {
+        close(fd);
+        return false;
+    }
+    fd_set writable;
+    FD_ZERO(&writable);
+    FD_SET(fd, &writable);
+    struct timeval timeout = { TCP_TRANSPORT_CONNECT_TIMEOUT_MS / 1000, (TCP_TRANSPORT_CONNECT_TIMEOUT_MS % 1000) * 1000 };
+    int error = 0;
+    socklen_t errorLength = sizeof(error);
+    if (select(fd + 1, nullptr, &writable, nullptr, &timeout) != 1 ||
+        getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength) != 0 || error != 0) {
+        close(fd);
+        return false;
+    }
+
+    fcntl(fd, F_SETFL, flags);
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    std::lock_guard<std::mutex> guard(socketLock);
+    socketFd = fd;
+    return true;
+}
+
+void TCPTransport::disconnect() {
+    std::lock_guard<std::mutex> guard(socketLock);
+    closeSocket();
+}
+
+// socketLock held
+void TCPTransport::closeSocket() {
+    int fd = socketFd;
+    socketFd = -1;
+    if (fd >= 0) close(fd);
+}
+
+bool TCPTransport::isConnected() {
+    return socketFd >= 0;
+}
+
+bool TCPTransport::write(const uint8_t* data, size_t length) {
+    std::lock_guard<std::mutex> guard(socketLock);
+    int fd = socketFd;
+    if (fd < 0) return false;
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            closeSocket();
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+bool TCPTransport::needsPolling() const {
+    return true;
+}
+
+// Waits up to timeoutMs for data and delivers what one read returns. false
+// when nothing arrived; a closed or broken connection is dropped. The wait
+// is outside socketLock, a writer is not held up for it; a socket closed
+// meanwhile is seen under the lock and not read. The receiver is called
+// after the lock is released, it may write the next command.
+bool TCPTransport::poll(uint32_t timeoutMs) {
+    int fd = socketFd;
+    if (fd < 0) return false;
+
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(fd, &readable);
+    struct timeval timeout = { (long)(timeoutMs / 1000), (long)(timeoutMs % 1000) * 1000 };
+    if (select(fd + 1, &readable, nullptr, nullptr, &timeout) != 1) return false;
+
+    uint8_t buffer[TCP_TRANSPORT_READ_SIZE];
+    ssize_t length;
+    {
+        std::lock_guard<std::mutex> guard(socketLock);
+        if (socketFd != fd) return false;
+        // The number may belong to a new connection by now, never block on it
+        length = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+        if (length <= 0) {
+            closeSocket();
+            return false;
+        }
+    }
+    deliver(buffer, (size_t)length);
+    return true;
+}
+
+const char* TCPTransport::getName() const {
+    return "tcp";
+}
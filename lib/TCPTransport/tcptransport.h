@@ -0,0 +1,47 @@
+#ifndef TCPTRANSPORT_H
+#define TCPTRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <elmtransport.h>
+
+#define TCP_TRANSPORT_DEFAULT_PORT 35000
+#define TCP_TRANSPORT_CONNECT_TIMEOUT_MS 3000
+#define TCP_TRANSPORT_READ_SIZE 128
+
+// WiFi ELM327 clone: a plain TCP socket, commands and responses as they are.
+// Whatever arrived is delivered by poll(), so the owner runs a reader task
+// (the firmware) or polls while it waits for the prompt (the native runner).
+// Nagle is off, a 5-byte command must not wait for the previous ACK.
+//
+// The reader task polls while the engine task writes and the loop task
+// reconnects. The socket is only closed with socketLock held, and write()
+// and the read in poll() hold it too, so a close never lands in the middle
+// of a send or a recv, whichever task finds the connection broken.
+//
+// BSD sockets only (lwIP on the ESP32), shared by the firmware and the
+// native build, where it talks to the ELM327 emulator.
+class TCPTransport : public ELMTransport {
+public:
+    TCPTransport();
+    ~TCPTransport();
+    bool connect(const char* address) override;
+    void disconnect() override;
+    bool isConnected() override;
+    bool write(const uint8_t* data, size_t length) override;
+    bool needsPolling() const override;
+    bool poll(uint32_t timeoutMs) override;
+    const char* getName() const override;
+
+    static bool parseAddress(const char* address, char* host, size_t hostSize, uint16_t& port);
+
+private:
+    std::atomic<int> socketFd;      // changed with socketLock held
+    std::mutex socketLock;
+
+    void closeSocket();
+};
+
+#endif
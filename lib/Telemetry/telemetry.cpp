@@ -0,0 +1,102 @@
+#include "telemetry.h"
+
+TelemetrySnapshot Telemetry::state = {};
+TripStatsSnapshot Telemetry::stats = {};
+std::atomic<uint32_t> Telemetry::sequence(0);
+portMUX_TYPE Telemetry::writerLock = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t Telemetry::listener = nullptr;
+
+void Telemetry::beginWrite() {
+    portENTER_CRITICAL(&writerLock);
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void Telemetry::endWrite() {
+    state.version = (sequence.load(std::memory_order_relaxed) + 1) / 2;
+    state.updatedAt = millis();
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    portEXIT_CRITICAL(&writerLock);
+    notifyListener();
+}
+
+void Telemetry::copyPreferences() {
+    PreferencesHandle& prefs = PreferencesHandle::getInstance();
+    state.fuel = prefs.getFuel();
+    state.tankCapacity = prefs.getTankCapacity();
+    state.consumptionFactor = prefs.getConsumptionFactor();
+    state.distanceTraveled = prefs.getDistanceTraveled();
+    state.tripFuelUsed = prefs.getTripFuelUsed();
+    state.kmPerLiter = (state.tripFuelUsed > 0.001) ? (state.distanceTraveled / state.tripFuelUsed) : 0.0;
+}
+
+void Telemetry::copyStats(const TripStatsSnapshot& summary) {
+    stats = summary;
+    state.kmPerLiterMinute = summary.windows[STAT_WINDOW_1MIN].kmPerLiter;
+    state.kmPerLiterHour = summary.windows[STAT_WINDOW_1H].kmPerLiter;
+}
+
+// The statistics are summarized before taking the lock, only the copy is inside it
+void Telemetry::publishLive(int rpm, int speedKmh, int engineLoad, int coolantTemp) {
+    TripStatsSnapshot summary;
+    TripStats::snapshot(summary, millis());
+    beginWrite();
+    copyStats(summary);
+    state.rpm = rpm;
+    state.speedKmh = speedKmh;
+    state.engineLoad = engineLoad;
+    state.coolantTemp = coolantTemp;
+    copyPreferences();
+    endWrite();
+}
+
+// While the ECU sleeps no values come in, but the windows still age: the
+// decoder republishes them on every probe reply so /api/stats empties out
+void Telemetry::publishStats() {
+    TripStatsSnapshot summary;
+    TripStats::snapshot(summary, millis());
+    beginWrite();
+    copyStats(summary);
+    endWrite();
+}
+
+void Telemetry::publishPreferences() {
+    beginWrite();
+    copyPreferences();
+    endWrite();
+}
+
+template <typename T> T Telemetry::read(const T& source) {
+    T copy;
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = sequence.load(std::memory_order_acquire);
+        copy = source;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    return copy;
+}
+
+TelemetrySnapshot Telemetry::snapshot() {
+    return read(state);
+}
+
+TripStatsSnapshot Telemetry::statsSnapshot() {
+    return read(stats);
+}
+
+// Version of the last completed write, cheap to poll for changes
+uint32_t Telemetry::version() {
+    return sequence.load(std::memory_order_acquire) / 2;
+}
+
+// The listener task (the web push) sleeps until a new version is published
+void Telemetry::setListener(TaskHandle_t task) {
+    listener = task;
+}
+
+void Telemetry::notifyListener() {
+    if (listener != nullptr) xTaskNotifyGive(listener);
+}
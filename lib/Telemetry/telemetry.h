@@ -0,0 +1,41 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <preferenceshandle.h>
+#include <telemetryformat.h>
+#include <tripstats.h>
+
+// Seqlock around the values shown on the dashboard. Writers (the decoder on
+// core 1, the web actions on core 0) are serialized by a spinlock and bump the
+// sequence to odd while they write; readers never lock, they copy the whole
+// state and retry if the sequence was odd or moved during the copy. The trip
+// statistics are published under the same sequence by the decoder, which owns
+// TripStats.
+class Telemetry {
+private:
+    static TelemetrySnapshot state;
+    static TripStatsSnapshot stats;
+    static std::atomic<uint32_t> sequence;
+    static portMUX_TYPE writerLock;
+    static TaskHandle_t listener;
+
+    static void beginWrite();
+    static void endWrite();
+    static void copyPreferences();
+    static void copyStats(const TripStatsSnapshot& summary);
+    template <typename T> static T read(const T& source);
+
+public:
+    static void publishLive(int rpm, int speedKmh, int engineLoad, int coolantTemp);
+    static void publishStats();
+    static void publishPreferences();
+    static TelemetrySnapshot snapshot();
+    static TripStatsSnapshot statsSnapshot();
+    static uint32_t version();
+    static void setListener(TaskHandle_t task);
+    static void notifyListener();
+};
+
+#endif
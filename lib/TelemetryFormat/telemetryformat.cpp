@@ -0,0 +1,28 @@
+#include "telemetryformat.h"
+#include <stdio.h>
+#include <stdarg.h>
+
+// Returns the length written, the document is cut (still terminated) when the buffer is short
+size_t TelemetryFormat::toJSON(const TelemetrySnapshot& telemetry, char* buffer, size_t size) {
+    float fuelPercent = (telemetry.tankCapacity > 0) ? (telemetry.fuel / telemetry.tankCapacity) * 100 : 0.0;
+
+    int length = snprintf(buffer, size,
+        "{\"version\":%u,\"rpm\":%d,\"speed\":%d,\"load\":%d,\"coolant\":%d,"
+        "\"fuel\":%.2f,\"fuelPercent\":%.1f,\"factor\":%.12f,"
+        "\"distance\":%.3f,\"tripFuel\":%.4f,\"kmPerLiter\":%.2f,"
+        "\"kmPerLiter1m\":%.2f,\"kmPerLiter1h\":%.2f}",
+        (unsigned)telemetry.version, telemetry.rpm, telemetry.speedKmh, telemetry.engineLoad, telemetry.coolantTemp,
+        telemetry.fuel, fuelPercent, telemetry.consumptionFactor,
+        telemetry.distanceTraveled, telemetry.tripFuelUsed, telemetry.kmPerLiter,
+        telemetry.kmPerLiterMinute, telemetry.kmPerLiterHour);
+    return (length < 0) ? 0 : ((size_t)length < size ? length : size - 1);
+}
+
+void TelemetryFormat::append(char* buffer, size_t size, size_t& length, const char* format, ...) {
+    if (length + 1 >= size) return;
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buffer + length, size - length, format, args);
+    va_end(args);
+    if (written > 0) length += ((size_t)written < size - length) ? written : size - length - 1;
+}
@@ -0,0 +1,36 @@
+#ifndef TELEMETRYFORMAT_H
+#define TELEMETRYFORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct TelemetrySnapshot {
+    uint32_t version;
+    unsigned long updatedAt;
+    int rpm;
+    int speedKmh;
+    int engineLoad;
+    int coolantTemp;
+    float fuel;
+    float tankCapacity;
+    float consumptionFactor;
+    float distanceTraveled;
+    float tripFuelUsed;
+    float kmPerLiter;           // trip mean
+    float kmPerLiterMinute;     // last minute, from TripStats
+    float kmPerLiterHour;       // last hour, from TripStats
+};
+
+// The JSON document behind /api/state and the /ws pushes. Plain C++ so the
+// native benchmark measures exactly what the dashboard gets.
+class TelemetryFormat {
+public:
+    static size_t toJSON(const TelemetrySnapshot& telemetry, char* buffer, size_t size);
+    // printf onto the end of buffer, advancing length. Once the buffer is full
+    // the rest is dropped and the text stays terminated; shared by the
+    // /api/stats and /metrics writers.
+    static void append(char* buffer, size_t size, size_t& length, const char* format, ...)
+        __attribute__((format(printf, 4, 5)));
+};
+
+#endif
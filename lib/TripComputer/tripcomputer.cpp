@@ -0,0 +1,110 @@
+#include "tripcomputer.h"
+
+TripStorage* TripComputer::storage = nullptr;
+
+int TripComputer::lastSpeed = 0;
+unsigned long TripComputer::lastSpeedTime = 0;
+bool TripComputer::speedValid = false;
+uint32_t TripComputer::distanceRemainder = 0;
+
+int TripComputer::currentRPM = 0;
+int TripComputer::currentLoad = 0;
+bool TripComputer::haveRPM = false;
+bool TripComputer::haveLoad = false;
+unsigned long TripComputer::pendingTime = 0;
+bool TripComputer::pending = false;
+uint32_t TripComputer::lastFlow = 0;
+unsigned long TripComputer::lastFlowTime = 0;
+bool TripComputer::flowValid = false;
+uint64_t TripComputer::fuelRemainder = 0;
+float TripComputer::scaledFactor = -1;
+uint64_t TripComputer::fuelScale = 0;
+
+// Fixed-point fraction bits of fuelScale and fuelRemainder
+static const uint8_t FUEL_FRACTION_BITS = 40;
+// Keeps (flow sum x gap) x scale inside 64 bits: 2 x 16383 x 100 x 5000 is
+// below 2^34, so the scale may use up to 29 bits (factors up to ~9.8e-7, the
+// default is 8.15e-9)
+static const uint64_t FUEL_SCALE_LIMIT = (1ULL << 29) - 1;
+
+// Another storage is another trip: the held samples and remainders start over
+void TripComputer::setStorage(TripStorage* tripStorage) {
+    storage = tripStorage;
+    speedValid = false;
+    distanceRemainder = 0;
+    haveRPM = false;
+    haveLoad = false;
+    pending = false;
+    flowValid = false;
+    fuelRemainder = 0;
+    scaledFactor = -1;
+}
+
+// micro-liters = RPM x load% x factor x ms x 1000. The trapezoid sums two flow
+// points instead of averaging them, hence 500 per unit, as a fixed-point number
+// with FUEL_FRACTION_BITS. Recomputed only when the calibration changes.
+uint64_t TripComputer::microlitersScale() {
+    float factor = storage->getConsumptionFactor();
+    if (factor != scaledFactor) {
+        scaledFactor = factor;
+        float scale = factor * 500.0f * (float)(1ULL << FUEL_FRACTION_BITS) + 0.5f;
+        fuelScale = scale <= 0 ? 0 : (scale >= (float)FUEL_SCALE_LIMIT ? FUEL_SCALE_LIMIT : (uint64_t)scale);
+    }
+    return fuelScale;
+}
+
+void TripComputer::onSpeed(int speedKmh, unsigned long timestamp) {
+    if (storage == nullptr) return;
+
+    unsigned long deltaTime = timestamp - lastSpeedTime;
+    if (speedValid && deltaTime > 0 && deltaTime <= TRIP_MAX_GAP_MS) {
+        // (v0 + v1) / 2 km/h over dt ms is (v0 + v1) x dt x 5 / 36 mm
+        distanceRemainder += (uint32_t)(lastSpeed + speedKmh) * deltaTime * 5;
+        uint32_t millimeters = distanceRemainder / 36;
+        distanceRemainder -= millimeters * 36;
+        if (millimeters > 0) storage->addDistanceMm(millimeters);
+    }
+    lastSpeed = speedKmh;
+    lastSpeedTime = timestamp;
+    speedValid = true;
+}
+
+// A sample from a new response closes the flow point of the previous one
+void TripComputer::beginFlowSample(unsigned long timestamp) {
+    if (pending && timestamp != pendingTime) closeFlowSample();
+    pendingTime = timestamp;
+    pending = true;
+}
+
+void TripComputer::closeFlowSample() {
+    if (!haveRPM || !haveLoad) return;
+
+    uint32_t flow = (uint32_t)currentRPM * currentLoad;
+    unsigned long deltaTime = pendingTime - lastFlowTime;
+    if (flowValid && deltaTime > 0 && deltaTime <= TRIP_MAX_GAP_MS) {
+        fuelRemainder += (uint64_t)(lastFlow + flow) * deltaTime * microlitersScale();
+        uint64_t microliters = fuelRemainder >> FUEL_FRACTION_BITS;
+        fuelRemainder -= microliters << FUEL_FRACTION_BITS;
+        if (microliters > 0) {
+            storage->addFuelMicroliters(-(int64_t)microliters);
+            storage->addTripFuelMicroliters(microliters);
+        }
+    }
+    lastFlow = flow;
+    lastFlowTime = pendingTime;
+    flowValid = true;
+}
+
+void TripComputer::onRPM(int rpm, unsigned long timestamp) {
+    if (storage == nullptr) return;
+    beginFlowSample(timestamp);
+    currentRPM = rpm;
+    haveRPM = true;
+}
+
+void TripComputer::onEngineLoad(int loadPercent, unsigned long timestamp) {
+    if (storage == nullptr) return;
+    beginFlowSample(timestamp);
+    currentLoad = loadPercent;
+    haveLoad = true;
+}
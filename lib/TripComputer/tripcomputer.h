@@ -0,0 +1,53 @@
+#ifndef TRIPCOMPUTER_H
+#define TRIPCOMPUTER_H
+
+#include <stdint.h>
+#include <tripstorage.h>
+
+// Samples further apart than this (ECU asleep, adapter reconnecting) are not
+// integrated across, the vehicle state in between is unknown
+#define TRIP_MAX_GAP_MS 5000
+
+// Distance and fuel integration. Plain C++ so it runs unchanged in the native
+// build; the values live in whatever TripStorage it is given.
+//
+// Samples carry the time their response arrived. Speed is integrated with the
+// trapezoidal rule between consecutive samples. Fuel flow is RPM x load x the
+// calibrated factor: the latest RPM and load are held, samples that arrived
+// together (one batched response) are combined into one flow point before
+// the trapezoid up to it is added. Everything is integer maths, with the
+// sub-millimeter and sub-micro-liter remainders carried to the next step.
+class TripComputer {
+private:
+    static TripStorage* storage;
+
+    static int lastSpeed;
+    static unsigned long lastSpeedTime;
+    static bool speedValid;
+    static uint32_t distanceRemainder;
+
+    static int currentRPM;
+    static int currentLoad;
+    static bool haveRPM;
+    static bool haveLoad;
+    static unsigned long pendingTime;
+    static bool pending;
+    static uint32_t lastFlow;
+    static unsigned long lastFlowTime;
+    static bool flowValid;
+    static uint64_t fuelRemainder;
+    static float scaledFactor;
+    static uint64_t fuelScale;
+
+    static void beginFlowSample(unsigned long timestamp);
+    static void closeFlowSample();
+    static uint64_t microlitersScale();
+
+public:
+    static void setStorage(TripStorage* tripStorage);
+    static void onRPM(int rpm, unsigned long timestamp);
+    static void onSpeed(int speedKmh, unsigned long timestamp);
+    static void onEngineLoad(int loadPercent, unsigned long timestamp);
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include "triplogcodec.h"
+
+size_t TripLogCodec::putVarint(uint8_t* out, uint32_t value) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        out[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (uint8_t)value;
+    return length;
+}
+
+// False when the data ends inside the varint or it runs past 5 bytes (a torn block)
+bool TripLogCodec::getVarint(const uint8_t* data, size_t length, size_t& position, uint32_t& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35 && position < length; shift += 7) {
+        uint8_t byte = data[position++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+// out needs TRIP_LOG_MAX_RECORD bytes
+size_t TripLogCodec::putRecord(uint8_t* out, uint8_t pid, uint32_t timeDelta, int32_t valueDelta) {
+    size_t length = 0;
+    out[length++] = pid;
+    length += putVarint(out + length, timeDelta);
+    length += putVarint(out + length, zigzag(valueDelta));
+    return length;
+}
+
+bool TripLogCodec::getRecord(const uint8_t* data, size_t length, size_t& position, uint8_t& pid, uint32_t& timeDelta, int32_t& valueDelta) {
+    if (position >= length) return false;
+    pid = data[position++];
+    uint32_t encoded;
+    if (!getVarint(data, length, position, timeDelta) || !getVarint(data, length, position, encoded)) return false;
+    valueDelta = unzigzag(encoded);
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef TRIPLOGCODEC_H
+#define TRIPLOGCODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// pid + two varints of at most 5 bytes
+#define TRIP_LOG_MAX_RECORD 11
+
+// One trip log record: pid, varint time delta (ms), zigzag varint value delta
+// against the previous value of the same PID. Small deltas, positive or
+// negative, take one byte each. The writer (TripLogger) and the reader
+// (TripLogExport) share this code. Plain C++, shared with the native build.
+class TripLogCodec {
+public:
+    static size_t putVarint(uint8_t* out, uint32_t value);
+    static bool getVarint(const uint8_t* data, size_t length, size_t& position, uint32_t& value);
+    static uint32_t zigzag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+    static int32_t unzigzag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+    static size_t putRecord(uint8_t* out, uint8_t pid, uint32_t timeDelta, int32_t valueDelta);
+    static bool getRecord(const uint8_t* data, size_t length, size_t& position, uint8_t& pid, uint32_t& timeDelta, int32_t& valueDelta);
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "triplogexport.h"
+
+enum ExportStage {
+    STAGE_PROLOGUE,
+    STAGE_SAMPLES,
+    STAGE_EPILOGUE,
+    STAGE_DONE
+};
+
+TripLogExport::TripLogExport(TRIP_LOG_FORMAT format)
+    : format(format), remaining(0), blockLength(0), blockPosition(0), blockSamples(0), time(0),
+      lineLength(0), linePosition(0), stage(STAGE_PROLOGUE), firstSample(true) {
+}
+
+bool TripLogExport::open() {
+    file = LittleFS.open(TRIP_LOG_PATH, FILE_READ);
+    if (!file) return false;
+    remaining = file.size();
+    return true;
+}
+
+bool TripLogExport::loadBlock() {
+    uint8_t header[TRIP_LOG_HEADER_SIZE];
+    if (remaining < TRIP_LOG_HEADER_SIZE) return false;
+    if (file.read(header, TRIP_LOG_HEADER_SIZE) != TRIP_LOG_HEADER_SIZE) return false;
+    remaining -= TRIP_LOG_HEADER_SIZE;
+
+    size_t payload = header[4] | (header[5] << 8);
+    if (header[0] != 'T' || header[1] != 'L' || header[2] != TRIP_LOG_VERSION) return false;
+    if (payload > TRIP_LOG_BLOCK_SIZE - TRIP_LOG_HEADER_SIZE || payload > remaining) return false;
+    if (file.read(block, payload) != payload) return false;
+    remaining -= payload;
+
+    blockLength = payload;
+    blockPosition = 0;
+    blockSamples = header[6] | (header[7] << 8);
+    time = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        time |= (uint32_t)header[8 + i] << (8 * i);
+    }
+    memset(lastValue, 0, sizeof(lastValue));
+    return true;
+}
+
+bool TripLogExport::nextSample(uint32_t& timestamp, uint8_t& pid, int32_t& value) {
+    while (blockSamples == 0) {
+        if (!loadBlock()) return false;
+    }
+
+    uint32_t delta;
+    int32_t valueDelta;
+    if (!TripLogCodec::getRecord(block, blockLength, blockPosition, pid, delta, valueDelta)) return false;
+
+    time += delta;
+    lastValue[pid] += valueDelta;
+    timestamp = time;
+    value = lastValue[pid];
+    blockSamples--;
+    return true;
+}
+
+bool TripLogExport::nextLine() {
+    int length = 0;
+    uint32_t timestamp;
+    uint8_t pid;
+    int32_t value;
+
+    switch (stage) {
+    case STAGE_PROLOGUE:
+        length = snprintf(line, sizeof(line), format == TRIP_LOG_CSV ? "time_ms,pid,value\n" : "{\"columns\":[\"time_ms\",\"pid\",\"value\"],\"samples\":[");
+        stage = STAGE_SAMPLES;
+        break;
+    case STAGE_SAMPLES:
+        if (nextSample(timestamp, pid, value)) {
+            // Scaled like the PID's table row: MAF 1234 is written 12.34
+            char text[PID_VALUE_TEXT_SIZE];
+            PIDTable::formatValue(pid, value, text, sizeof(text));
+            if (format == TRIP_LOG_CSV) {
+                length = snprintf(line, sizeof(line), "%lu,%u,%s\n", (unsigned long)timestamp, pid, text);
+            } else {
+                length = snprintf(line, sizeof(line), "%s[%lu,%u,%s]", firstSample ? "" : ",", (unsigned long)timestamp, pid, text);
+            }
+            firstSample = false;
+            break;
+        }
+        stage = STAGE_EPILOGUE;
+        // fall through
+    case STAGE_EPILOGUE:
+        length = snprintf(line, sizeof(line), format == TRIP_LOG_CSV ? "" : "]}\n");
+        stage = STAGE_DONE;
+        break;
+    default:
+        file.close();
+        return false;
+    }
+
+    lineLength = length;
+    linePosition = 0;
+    return true;
+}
+
+// Fills the buffer with the next part of the document, 0 once it is complete
+size_t TripLogExport::read(uint8_t* buffer, size_t maxLength) {
+    size_t written = 0;
+    while (written < maxLength) {
+        if (linePosition == lineLength && !nextLine()) break;
+
+        size_t count = lineLength - linePosition;
+        if (count > maxLength - written) count = maxLength - written;
+        memcpy(buffer + written, line + linePosition, count);
+        linePosition += count;
+        written += count;
+    }
+    return written;
+}
@@ -0,0 +1,45 @@
+#ifndef TRIPLOGEXPORT_H
+#define TRIPLOGEXPORT_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "triplogger.h"
+#include <pidtable.h>
+
+enum TRIP_LOG_FORMAT {
+    TRIP_LOG_CSV,
+    TRIP_LOG_JSON
+};
+
+// Turns the binary trip log into CSV or JSON a piece at a time, for a chunked
+// HTTP response. Only one block of the file and one formatted line are held in
+// RAM, whatever the size of the log. Blocks appended after open() are not
+// included, a torn block at the end of the file is skipped.
+class TripLogExport {
+private:
+    TRIP_LOG_FORMAT format;
+    File file;
+    size_t remaining;
+    uint8_t block[TRIP_LOG_BLOCK_SIZE];
+    size_t blockLength;
+    size_t blockPosition;
+    uint16_t blockSamples;
+    uint32_t time;
+    int32_t lastValue[256];
+    char line[48];
+    size_t lineLength;
+    size_t linePosition;
+    uint8_t stage;
+    bool firstSample;
+
+    bool loadBlock();
+    bool nextSample(uint32_t& timestamp, uint8_t& pid, int32_t& value);
+    bool nextLine();
+
+public:
+    explicit TripLogExport(TRIP_LOG_FORMAT format);
+    bool open();
+    size_t read(uint8_t* buffer, size_t maxLength);
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "triplogger.h"
+
+static const char TAG[] = "TripLogger";
+
+#define WRITE_QUEUE_RESET 0xFF
+#define NO_BLOCK 0xFE
+
+TripLogBlock TripLogger::blocks[2];
+volatile bool TripLogger::blockBusy[2] = {false, false};
+uint8_t TripLogger::activeBlock = 0;
+int32_t TripLogger::lastValue[256];
+portMUX_TYPE TripLogger::logLock = portMUX_INITIALIZER_UNLOCKED;
+QueueHandle_t TripLogger::writeQueue = nullptr;
+File TripLogger::logFile;
+volatile size_t TripLogger::logSize = 0;
+size_t TripLogger::logLimit = 0;
+volatile bool TripLogger::logFull = false;
+bool TripLogger::ready = false;
+uint32_t TripLogger::recordedSamples = 0;
+uint32_t TripLogger::droppedSamples = 0;
+
+// The log lives in the "spiffs" data partition of huge_app.csv (896 KB)
+bool TripLogger::begin() {
+    if (!LittleFS.begin(true)) {
+        LOG_E(TAG, "LittleFS mount failed, trip log disabled");
+        return false;
+    }
+
+    logFile = LittleFS.open(TRIP_LOG_PATH, FILE_APPEND);
+    if (!logFile) {
+        LOG_E(TAG, "Could not open %s", TRIP_LOG_PATH);
+        return false;
+    }
+    logSize = logFile.size();
+
+    size_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+    logLimit = freeBytes > TRIP_LOG_RESERVE_BYTES ? logSize + freeBytes - TRIP_LOG_RESERVE_BYTES : logSize;
+    logFull = logSize >= logLimit;
+
+    writeQueue = xQueueCreate(4, sizeof(uint8_t));
+    xTaskCreatePinnedToCore(
+        writerTask,
+        "Log_Writer",
+        4096,
+        NULL,
+        1,
+        NULL,
+        0
+    );
+    ready = true;
+    return true;
+}
+
+void TripLogger::startBlock(TripLogBlock& block, uint32_t timestamp) {
+    block.length = TRIP_LOG_HEADER_SIZE;
+    block.samples = 0;
+    block.baseTime = timestamp;
+    block.lastTime = timestamp;
+    memset(lastValue, 0, sizeof(lastValue));
+}
+
+// Called with logLock held. Returns true when a block was queued for writing.
+bool TripLogger::sealActiveBlock() {
+    if (blocks[activeBlock].samples == 0) return false;
+    blockBusy[activeBlock] = true;
+    activeBlock ^= 1;
+    return true;
+}
+
+void TripLogger::record(uint8_t pid, int32_t value, uint32_t timestamp) {
+    if (!ready || logFull) return;
+
+    uint8_t encoded[TRIP_LOG_MAX_RECORD];
+    uint8_t sealed = NO_BLOCK;
+
+    portENTER_CRITICAL(&logLock);
+    if (blockBusy[activeBlock]) {
+        // The writer is still busy with both blocks, flash can't keep up
+        droppedSamples++;
+        portEXIT_CRITICAL(&logLock);
+        return;
+    }
+
+    TripLogBlock* block = &blocks[activeBlock];
+    if (block->samples == 0) startBlock(*block, timestamp);
+
+    size_t length = TripLogCodec::putRecord(encoded, pid, timestamp - block->lastTime, value - lastValue[pid]);
+
+    if (block->length + length > TRIP_LOG_BLOCK_SIZE) {
+        sealed = activeBlock;
+        sealActiveBlock();
+        block = &blocks[activeBlock];
+        if (blockBusy[activeBlock]) {
+            droppedSamples++;
+            portEXIT_CRITICAL(&logLock);
+            xQueueSend(writeQueue, &sealed, 0);
+            return;
+        }
+        startBlock(*block, timestamp);
+        length = TripLogCodec::putRecord(encoded, pid, 0, value);
+    }
+
+    memcpy(block->data + block->length, encoded, length);
+    block->length += length;
+    block->samples++;
+    block->lastTime = timestamp;
+    lastValue[pid] = value;
+    recordedSamples++;
+
+    if (sealed == NO_BLOCK && timestamp - block->baseTime >= TRIP_LOG_FLUSH_MS) {
+        sealed = activeBlock;
+        sealActiveBlock();
+    }
+    portEXIT_CRITICAL(&logLock);
+
+    if (sealed != NO_BLOCK) xQueueSend(writeQueue, &sealed, 0);
+}
+
+// Hands the partly filled block to the writer, e.g. before the ECU sleeps
+void TripLogger::flush() {
+    if (!ready) return;
+
+    uint8_t sealed = NO_BLOCK;
+    portENTER_CRITICAL(&logLock);
+    if (!blockBusy[activeBlock] && sealActiveBlock()) sealed = activeBlock ^ 1;
+    portEXIT_CRITICAL(&logLock);
+
+    if (sealed != NO_BLOCK) xQueueSend(writeQueue, &sealed, 0);
+}
+
+// Starts a new trip: samples still in RAM are discarded and the file is
+// truncated by the writer, after any block queued before the reset.
+void TripLogger::reset() {
+    if (!ready) return;
+
+    portENTER_CRITICAL(&logLock);
+    if (!blockBusy[activeBlock]) blocks[activeBlock].samples = 0;
+    portEXIT_CRITICAL(&logLock);
+
+    uint8_t request = WRITE_QUEUE_RESET;
+    xQueueSend(writeQueue, &request, portMAX_DELAY);
+}
+
+void TripLogger::writerTask(void* pvParameters) {
+    uint8_t request;
+    for(;;) {
+        if (xQueueReceive(writeQueue, &request, portMAX_DELAY) != pdTRUE) continue;
+
+        if (request == WRITE_QUEUE_RESET) {
+            restartLog();
+        } else {
+            writeBlock(request);
+        }
+    }
+}
+
+void TripLogger::writeBlock(uint8_t index) {
+    TripLogBlock& block = blocks[index];
+    size_t payload = block.length - TRIP_LOG_HEADER_SIZE;
+
+    uint8_t* header = block.data;
+    header[0] = 'T';
+    header[1] = 'L';
+    header[2] = TRIP_LOG_VERSION;
+    header[3] = 0;
+    header[4] = payload & 0xFF;
+    header[5] = payload >> 8;
+    header[6] = block.samples & 0xFF;
+    header[7] = block.samples >> 8;
+    for (uint8_t i = 0; i < 4; i++) {
+        header[8 + i] = (block.baseTime >> (8 * i)) & 0xFF;
+    }
+
+    if (logSize + block.length > logLimit) {
+        logFull = true;
+        droppedSamples += block.samples;
+    } else if (logFile.write(block.data, block.length) == block.length) {
+        logFile.flush();
+        logSize += block.length;
+    } else {
+        droppedSamples += block.samples;
+    }
+    block.samples = 0;
+    blockBusy[index] = false;
+}
+
+void TripLogger::restartLog() {
+    logFile.close();
+    LittleFS.remove(TRIP_LOG_PATH);
+    logFile = LittleFS.open(TRIP_LOG_PATH, FILE_APPEND);
+
+    size_t freeBytes = LittleFS.totalBytes() - LittleFS.usedBytes();
+    logSize = 0;
+    logLimit = freeBytes > TRIP_LOG_RESERVE_BYTES ? freeBytes - TRIP_LOG_RESERVE_BYTES : 0;
+    logFull = !logFile;
+}
+
+size_t TripLogger::getLogSize() {
+    return logSize;
+}
+
+size_t TripLogger::getLogCapacity() {
+    return logLimit;
+}
+
+bool TripLogger::isFull() {
+    return logFull;
+}
+
+uint32_t TripLogger::getRecordedSamples() {
+    return recordedSamples;
+}
+
+uint32_t TripLogger::getDroppedSamples() {
+    return droppedSamples;
+}
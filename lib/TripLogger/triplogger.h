@@ -0,0 +1,68 @@
+#ifndef TRIPLOGGER_H
+#define TRIPLOGGER_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <triplogcodec.h>
+#include <logring.h>
+
+#define TRIP_LOG_PATH "/trip.bin"
+#define TRIP_LOG_VERSION 1
+#define TRIP_LOG_BLOCK_SIZE 512
+#define TRIP_LOG_HEADER_SIZE 12
+#define TRIP_LOG_FLUSH_MS 30000
+#define TRIP_LOG_RESERVE_BYTES 16384
+
+// One block of the log, header included. Blocks are self-contained: the time
+// and value deltas restart at every block, so a block torn by a power cut only
+// loses its own samples.
+//
+// Header: 'T' 'L' version 0, uint16 payload length, uint16 samples, uint32 base time (ms)
+// Record: pid, varint time delta (ms), zigzag varint value delta against the same PID (TripLogCodec)
+struct TripLogBlock {
+    uint8_t data[TRIP_LOG_BLOCK_SIZE];
+    size_t length;
+    uint16_t samples;
+    uint32_t baseTime;
+    uint32_t lastTime;
+};
+
+// Records every decoded sample into a delta-encoded binary log on LittleFS.
+// Samples go into one of two RAM blocks; a full (or TRIP_LOG_FLUSH_MS old)
+// block is handed to a low priority task that appends it to the file, so the
+// decoder never waits for flash.
+class TripLogger {
+private:
+    static TripLogBlock blocks[2];
+    static volatile bool blockBusy[2];
+    static uint8_t activeBlock;
+    static int32_t lastValue[256];
+    static portMUX_TYPE logLock;
+    static QueueHandle_t writeQueue;
+    static File logFile;
+    static volatile size_t logSize;
+    static size_t logLimit;
+    static volatile bool logFull;
+    static bool ready;
+    static uint32_t recordedSamples;
+    static uint32_t droppedSamples;
+
+    static void writerTask(void* pvParameters);
+    static void writeBlock(uint8_t index);
+    static void restartLog();
+    static bool sealActiveBlock();
+    static void startBlock(TripLogBlock& block, uint32_t timestamp);
+
+public:
+    static bool begin();
+    static void record(uint8_t pid, int32_t value, uint32_t timestamp);
+    static void flush();
+    static void reset();
+    static size_t getLogSize();
+    static size_t getLogCapacity();
+    static bool isFull();
+    static uint32_t getRecordedSamples();
+    static uint32_t getDroppedSamples();
+};
+
+#endif
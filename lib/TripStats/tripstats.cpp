@@ -0,0 +1,271 @@
+#include "tripstats.h"
+#include <telemetryformat.h>
+#include <stdio.h>
+#include <string.h>
+
+StatBucket TripStats::buckets[10 + 12 + 60];
+StatTier TripStats::tiers[STAT_WINDOW_COUNT];
+TripSlot TripStats::slots[TRIP_SLOT_COUNT];
+std::atomic<uint8_t> TripStats::resetRequests(0);
+uint64_t TripStats::lastDistanceMm = 0;
+uint64_t TripStats::lastFuelMicroliters = 0;
+bool TripStats::haveTotals = false;
+unsigned long TripStats::lastTotalsTime = 0;
+int TripStats::lastSpeed = 0;
+bool TripStats::changed = false;
+
+static const uint8_t tierBuckets[STAT_WINDOW_COUNT] = { 10, 12, 60 };
+static const uint32_t tierBucketMs[STAT_WINDOW_COUNT] = { 1000, 5000, 60000 };
+static const char* const windowNames[STAT_WINDOW_COUNT] = { "10s", "1min", "1h" };
+static const char* const metricNames[STAT_METRIC_COUNT] = { "rpm", "speed", "load", "coolant" };
+static const char* const slotNames[TRIP_SLOT_COUNT] = { "drive", "trip", "tank", "total" };
+
+void TripStats::begin() {
+    memset(buckets, 0, sizeof(buckets));
+    memset(tiers, 0, sizeof(tiers));
+    StatBucket* next = buckets;
+    for (uint8_t i = 0; i < STAT_WINDOW_COUNT; i++) {
+        tiers[i].buckets = next;
+        tiers[i].bucketCount = tierBuckets[i];
+        tiers[i].bucketMs = tierBucketMs[i];
+        next += tierBuckets[i];
+    }
+    haveTotals = false;
+}
+
+void TripStats::recomputeExtremes(StatTier& tier) {
+    for (uint8_t m = 0; m < STAT_METRIC_COUNT; m++) {
+        bool found = false;
+        for (uint8_t b = 0; b < tier.bucketCount; b++) {
+            const StatAggregate& aggregate = tier.buckets[b].metrics[m];
+            if (aggregate.count == 0) continue;
+            if (!found || aggregate.min < tier.mins[m]) tier.mins[m] = aggregate.min;
+            if (!found || aggregate.max > tier.maxs[m]) tier.maxs[m] = aggregate.max;
+            found = true;
+        }
+    }
+}
+
+// Turns the ring until the current bucket holds timestamp. Nothing older than
+// the window is left after a long gap (ECU asleep).
+void TripStats::advance(StatTier& tier, unsigned long timestamp) {
+    if (!tier.started) {
+        tier.started = true;
+        tier.currentStart = timestamp;
+        return;
+    }
+    unsigned long elapsed = timestamp - tier.currentStart;
+    if ((long)elapsed < (long)tier.bucketMs) return;
+
+    unsigned long steps = elapsed / tier.bucketMs;
+    if (steps >= tier.bucketCount) {
+        memset(tier.buckets, 0, sizeof(StatBucket) * tier.bucketCount);
+        memset(tier.counts, 0, sizeof(tier.counts));
+        memset(tier.sums, 0, sizeof(tier.sums));
+        tier.distanceMm = 0;
+        tier.fuelMicroliters = 0;
+    } else {
+        for (unsigned long i = 0; i < steps; i++) {
+            tier.current = (tier.current + 1) % tier.bucketCount;
+            StatBucket& expired = tier.buckets[tier.current];
+            for (uint8_t m = 0; m < STAT_METRIC_COUNT; m++) {
+                tier.counts[m] -= expired.metrics[m].count;
+                tier.sums[m] -= expired.metrics[m].sum;
+            }
+            tier.distanceMm -= expired.distanceMm;
+            tier.fuelMicroliters -= expired.fuelMicroliters;
+            memset(&expired, 0, sizeof(expired));
+        }
+        recomputeExtremes(tier);
+    }
+    tier.currentStart += steps * tier.bucketMs;
+}
+
+// Resets are asked for from other tasks (the web page, loop()) and carried
+// out here, on the task that owns the statistics
+void TripStats::applyResets() {
+    uint8_t requests = resetRequests.exchange(0);
+    if (requests == 0) return;
+    for (uint8_t i = 0; i < TRIP_SLOT_COUNT; i++) {
+        if (requests & (1 << i)) memset(&slots[i], 0, sizeof(TripSlot));
+    }
+    changed = true;
+}
+
+void TripStats::requestReset(TRIP_SLOT slot) {
+    resetRequests.fetch_or(1 << slot);
+}
+
+void TripStats::onSample(STAT_METRIC metric, int value, unsigned long timestamp) {
+    applyResets();
+    if (value > INT16_MAX) value = INT16_MAX;
+    if (value < INT16_MIN) value = INT16_MIN;
+
+    for (uint8_t i = 0; i < STAT_WINDOW_COUNT; i++) {
+        StatTier& tier = tiers[i];
+        advance(tier, timestamp);
+        StatAggregate& aggregate = tier.buckets[tier.current].metrics[metric];
+        if (aggregate.count == 0 || value < aggregate.min) aggregate.min = value;
+        if (aggregate.count == 0 || value > aggregate.max) aggregate.max = value;
+        aggregate.count++;
+        aggregate.sum += value;
+
+        if (tier.counts[metric] == 0 || value < tier.mins[metric]) tier.mins[metric] = value;
+        if (tier.counts[metric] == 0 || value > tier.maxs[metric]) tier.maxs[metric] = value;
+        tier.counts[metric]++;
+        tier.sums[metric] += value;
+    }
+
+    if (metric == STAT_SPEED) {
+        lastSpeed = value;
+        for (uint8_t i = 0; i < TRIP_SLOT_COUNT; i++) {
+            if (value > slots[i].maxSpeedKmh) slots[i].maxSpeedKmh = value;
+        }
+    } else if (metric == STAT_RPM) {
+        for (uint8_t i = 0; i < TRIP_SLOT_COUNT; i++) {
+            slots[i].rpmSum += value;
+            slots[i].rpmSamples++;
+            if (value > slots[i].maxRPM) slots[i].maxRPM = value;
+        }
+    }
+}
+
+// Takes the running distance and fuel totals of the trip computer after each
+// response; only the increase since the previous call is counted, a total
+// that went down (trip reset) just becomes the new reference
+void TripStats::onTotals(uint64_t distanceMm, uint64_t fuelMicroliters, unsigned long timestamp) {
+    applyResets();
+    if (!haveTotals || distanceMm < lastDistanceMm || fuelMicroliters < lastFuelMicroliters) {
+        haveTotals = true;
+        lastDistanceMm = distanceMm;
+        lastFuelMicroliters = fuelMicroliters;
+        lastTotalsTime = timestamp;
+        return;
+    }
+    uint64_t distance = distanceMm - lastDistanceMm;
+    uint64_t fuel = fuelMicroliters - lastFuelMicroliters;
+    unsigned long elapsed = timestamp - lastTotalsTime;
+    bool running = elapsed <= TRIP_STATS_MAX_GAP_MS;
+    lastDistanceMm = distanceMm;
+    lastFuelMicroliters = fuelMicroliters;
+    lastTotalsTime = timestamp;
+
+    for (uint8_t i = 0; i < STAT_WINDOW_COUNT; i++) {
+        StatTier& tier = tiers[i];
+        advance(tier, timestamp);
+        tier.buckets[tier.current].distanceMm += distance;
+        tier.buckets[tier.current].fuelMicroliters += fuel;
+        tier.distanceMm += distance;
+        tier.fuelMicroliters += fuel;
+    }
+    for (uint8_t i = 0; i < TRIP_SLOT_COUNT; i++) {
+        TripSlot& slot = slots[i];
+        slot.distanceMm += distance;
+        slot.fuelMicroliters += fuel;
+        if (running) {
+            slot.drivingMs += elapsed;
+            if (lastSpeed == 0) slot.idleMs += elapsed;
+        }
+    }
+    if (distance > 0 || fuel > 0 || running) changed = true;
+}
+
+// mm per uL is km per L
+static float kmPerLiter(uint64_t distanceMm, uint64_t fuelMicroliters) {
+    return fuelMicroliters > 0 ? (float)((double)distanceMm / (double)fuelMicroliters) : 0.0f;
+}
+
+void TripStats::summarize(const StatTier& tier, StatWindowSnapshot& window) {
+    for (uint8_t m = 0; m < STAT_METRIC_COUNT; m++) {
+        StatSummary& summary = window.metrics[m];
+        summary.count = tier.counts[m];
+        summary.min = summary.count > 0 ? tier.mins[m] : 0;
+        summary.max = summary.count > 0 ? tier.maxs[m] : 0;
+        summary.mean = summary.count > 0 ? (float)tier.sums[m] / summary.count : 0.0f;
+    }
+    window.distanceKm = tier.distanceMm / 1000000.0f;
+    window.fuelLiters = tier.fuelMicroliters / 1000000.0f;
+    window.kmPerLiter = kmPerLiter(tier.distanceMm, tier.fuelMicroliters);
+}
+
+void TripStats::summarize(const TripSlot& slot, TripSlotSnapshot& snapshot) {
+    snapshot.distanceKm = slot.distanceMm / 1000000.0f;
+    snapshot.fuelLiters = slot.fuelMicroliters / 1000000.0f;
+    snapshot.kmPerLiter = kmPerLiter(slot.distanceMm, slot.fuelMicroliters);
+    // mm/ms is m/s
+    snapshot.averageSpeedKmh = slot.drivingMs > 0 ? (float)((double)slot.distanceMm / slot.drivingMs * 3.6) : 0.0f;
+    snapshot.drivingSeconds = slot.drivingMs / 1000;
+    snapshot.idleSeconds = slot.idleMs / 1000;
+    snapshot.meanRPM = slot.rpmSamples > 0 ? slot.rpmSum / slot.rpmSamples : 0;
+    snapshot.maxSpeedKmh = slot.maxSpeedKmh;
+    snapshot.maxRPM = slot.maxRPM;
+}
+
+// Called by the owning task; the windows are first moved up to now so a
+// sleeping ECU empties them instead of freezing the last values
+void TripStats::snapshot(TripStatsSnapshot& snapshot, unsigned long now) {
+    applyResets();
+    for (uint8_t i = 0; i < STAT_WINDOW_COUNT; i++) {
+        if (tiers[i].started) advance(tiers[i], now);
+        summarize(tiers[i], snapshot.windows[i]);
+    }
+    for (uint8_t i = 0; i < TRIP_SLOT_COUNT; i++) {
+        summarize(slots[i], snapshot.slots[i]);
+    }
+}
+
+bool TripStats::takeChanged() {
+    bool result = changed;
+    changed = false;
+    return result;
+}
+
+// Trip slots as a versioned blob for NVS, the windows are not kept
+size_t TripStats::save(uint8_t* cache, size_t size) {
+    if (size < TRIP_STATS_CACHE_SIZE) return 0;
+    cache[0] = TRIP_STATS_CACHE_VERSION;
+    memcpy(cache + 1, slots, sizeof(slots));
+    return TRIP_STATS_CACHE_SIZE;
+}
+
+bool TripStats::restore(const uint8_t* cache, size_t size) {
+    if (size != TRIP_STATS_CACHE_SIZE || cache[0] != TRIP_STATS_CACHE_VERSION) return false;
+    memcpy(slots, cache + 1, sizeof(slots));
+    return true;
+}
+
+// The /api/stats document. Returns the length written, cut (still terminated)
+// when the buffer is short.
+size_t TripStats::toJSON(const TripStatsSnapshot& snapshot, char* buffer, size_t size) {
+    size_t length = 0;
+    if (size == 0) return 0;
+    buffer[0] = '\0';
+
+    TelemetryFormat::append(buffer, size, length, "{\"windows\":{");
+    for (uint8_t i = 0; i < STAT_WINDOW_COUNT; i++) {
+        const StatWindowSnapshot& window = snapshot.windows[i];
+        TelemetryFormat::append(buffer, size, length, "%s\"%s\":{", i > 0 ? "," : "", windowNames[i]);
+        for (uint8_t m = 0; m < STAT_METRIC_COUNT; m++) {
+            const StatSummary& summary = window.metrics[m];
+            if (summary.count == 0) {
+                TelemetryFormat::append(buffer, size, length, "\"%s\":null,", metricNames[m]);
+            } else {
+                TelemetryFormat::append(buffer, size, length, "\"%s\":{\"min\":%d,\"max\":%d,\"mean\":%.1f},",
+                       metricNames[m], summary.min, summary.max, summary.mean);
+            }
+        }
+        TelemetryFormat::append(buffer, size, length, "\"distance\":%.3f,\"fuel\":%.4f,\"kmPerLiter\":%.2f}",
+               window.distanceKm, window.fuelLiters, window.kmPerLiter);
+    }
+    TelemetryFormat::append(buffer, size, length, "},\"slots\":{");
+    for (uint8_t i = 0; i < TRIP_SLOT_COUNT; i++) {
+        const TripSlotSnapshot& slot = snapshot.slots[i];
+        TelemetryFormat::append(buffer, size, length, "%s\"%s\":{\"distance\":%.3f,\"fuel\":%.4f,\"kmPerLiter\":%.2f,\"avgSpeed\":%.1f,"
+               "\"driving\":%u,\"idle\":%u,\"meanRpm\":%u,\"maxSpeed\":%u,\"maxRpm\":%u}",
+               i > 0 ? "," : "", slotNames[i], slot.distanceKm, slot.fuelLiters, slot.kmPerLiter, slot.averageSpeedKmh,
+               (unsigned)slot.drivingSeconds, (unsigned)slot.idleSeconds, (unsigned)slot.meanRPM,
+               (unsigned)slot.maxSpeedKmh, (unsigned)slot.maxRPM);
+    }
+    TelemetryFormat::append(buffer, size, length, "}}");
+    return length;
+}
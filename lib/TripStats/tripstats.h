@@ -0,0 +1,147 @@
+#ifndef TRIPSTATS_H
+#define TRIPSTATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+#define TRIP_STATS_MAX_GAP_MS 5000          // same rule as TRIP_MAX_GAP_MS: longer gaps are not driving time
+#define TRIP_STATS_CACHE_VERSION 1
+#define TRIP_STATS_JSON_SIZE 1536
+
+enum STAT_METRIC {
+    STAT_RPM,
+    STAT_SPEED,
+    STAT_LOAD,
+    STAT_COOLANT,
+    STAT_METRIC_COUNT
+};
+
+enum STAT_WINDOW {
+    STAT_WINDOW_10S,        // 10 buckets of 1 s
+    STAT_WINDOW_1MIN,       // 12 buckets of 5 s
+    STAT_WINDOW_1H,         // 60 buckets of 1 min
+    STAT_WINDOW_COUNT
+};
+
+enum TRIP_SLOT {
+    TRIP_SLOT_DRIVE,        // since the ECU last woke up
+    TRIP_SLOT_TRIP,         // since "Zerar trip"
+    TRIP_SLOT_TANK,         // since the last full tank
+    TRIP_SLOT_TOTAL,        // never reset
+    TRIP_SLOT_COUNT
+};
+
+struct StatAggregate {
+    uint32_t count;
+    int32_t sum;
+    int16_t min;
+    int16_t max;
+};
+
+struct StatBucket {
+    StatAggregate metrics[STAT_METRIC_COUNT];
+    uint32_t distanceMm;
+    uint32_t fuelMicroliters;
+};
+
+// A window is a ring of buckets plus the running totals over all of them:
+// a sample updates one bucket and the totals, the bucket falling out of the
+// window is subtracted when the ring turns. Only min/max can't be subtracted,
+// they are recomputed from the buckets once per turn.
+struct StatTier {
+    StatBucket* buckets;
+    uint8_t bucketCount;
+    uint32_t bucketMs;
+    uint8_t current;
+    unsigned long currentStart;
+    bool started;
+    uint32_t counts[STAT_METRIC_COUNT];
+    int64_t sums[STAT_METRIC_COUNT];
+    int16_t mins[STAT_METRIC_COUNT];
+    int16_t maxs[STAT_METRIC_COUNT];
+    uint64_t distanceMm;
+    uint64_t fuelMicroliters;
+};
+
+struct TripSlot {
+    uint64_t distanceMm;
+    uint64_t fuelMicroliters;
+    uint64_t drivingMs;
+    uint64_t idleMs;            // engine running, standing still
+    uint64_t rpmSum;
+    uint32_t rpmSamples;
+    uint16_t maxSpeedKmh;
+    uint16_t maxRPM;
+};
+
+struct StatSummary {
+    uint32_t count;
+    int16_t min;
+    int16_t max;
+    float mean;
+};
+
+struct StatWindowSnapshot {
+    StatSummary metrics[STAT_METRIC_COUNT];
+    float distanceKm;
+    float fuelLiters;
+    float kmPerLiter;
+};
+
+struct TripSlotSnapshot {
+    float distanceKm;
+    float fuelLiters;
+    float kmPerLiter;
+    float averageSpeedKmh;
+    uint32_t drivingSeconds;
+    uint32_t idleSeconds;
+    uint16_t meanRPM;
+    uint16_t maxSpeedKmh;
+    uint16_t maxRPM;
+};
+
+struct TripStatsSnapshot {
+    StatWindowSnapshot windows[STAT_WINDOW_COUNT];
+    TripSlotSnapshot slots[TRIP_SLOT_COUNT];
+};
+
+#define TRIP_STATS_CACHE_SIZE (1 + sizeof(TripSlot) * TRIP_SLOT_COUNT)
+
+// Fixed-memory statistics over the decoded values: min/max/mean of every
+// metric and km/L over the last 10 s, 1 min and 1 h, and per trip slot.
+// Updated on the decoder task, one O(1) step per sample; readers get a
+// TripStatsSnapshot with everything already divided out. Plain C++, shared by
+// the firmware and the native build.
+class TripStats {
+private:
+    static StatBucket buckets[10 + 12 + 60];
+    static StatTier tiers[STAT_WINDOW_COUNT];
+    static TripSlot slots[TRIP_SLOT_COUNT];
+    static std::atomic<uint8_t> resetRequests;
+    static uint64_t lastDistanceMm;
+    static uint64_t lastFuelMicroliters;
+    static bool haveTotals;
+    static unsigned long lastTotalsTime;
+    static int lastSpeed;
+    static bool changed;
+
+    static void advance(StatTier& tier, unsigned long timestamp);
+    static void recomputeExtremes(StatTier& tier);
+    static void applyResets();
+    static void summarize(const StatTier& tier, StatWindowSnapshot& window);
+    static void summarize(const TripSlot& slot, TripSlotSnapshot& snapshot);
+
+public:
+    static void begin();
+    static void onSample(STAT_METRIC metric, int value, unsigned long timestamp);
+    static void onTotals(uint64_t distanceMm, uint64_t fuelMicroliters, unsigned long timestamp);
+    static void requestReset(TRIP_SLOT slot);
+    static void snapshot(TripStatsSnapshot& snapshot, unsigned long now);
+    static bool takeChanged();
+    static size_t save(uint8_t* cache, size_t size);
+    static bool restore(const uint8_t* cache, size_t size);
+    static size_t toJSON(const TripStatsSnapshot& snapshot, char* buffer, size_t size);
+};
+
+#endif
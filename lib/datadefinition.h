@@ -1,12 +1,28 @@
 #ifndef DATADEFINITION
 #define DATADEFINITION
 
+// Names for the PIDs the code refers to directly. How every PID is decoded,
+// polled and shown is its row in lib/PIDTable.
 #define CHECK_ECU_MUX 0x00
 #define RPM_MUX 0x0C
 #define TEMP_MUX 0x05
 #define ENGINE_LOAD_MUX 0x04
 #define SPEED_MUX 0x0D
 
+// Supported PID bitmaps, each lists the 32 PIDs after it
+#define SUPPORTED_PIDS_21_MUX 0x20
+#define SUPPORTED_PIDS_41_MUX 0x40
+#define SUPPORTED_PIDS_61_MUX 0x60
+#define SUPPORTED_PIDS_81_MUX 0x80
+#define SUPPORTED_PIDS_A1_MUX 0xA0
+#define SUPPORTED_PIDS_C1_MUX 0xC0
+#define SUPPORTED_PIDS_E1_MUX 0xE0
+
+#define OBD_MODE_CURRENT_DATA 0x01
+#define OBD_MODE_CURRENT_DATA_RESPONSE 0x41
+#define MAX_PIDS_PER_REQUEST 6
+#define RESPONSE_BUFFER_SIZE 256
+
 #define PREFERENCE_NAMESPACE "OBD2_READER"
 
 enum class CONNECTION_STATUS {
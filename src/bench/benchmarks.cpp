@@ -0,0 +1,194 @@
+#include "benchmarks.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "../../lib/datadefinition.h"
+#include <elmparser.h>
+#include <pidtable.h>
+#include <telemetryformat.h>
+#include <obdmetrics.h>
+#include <tripcomputer.h>
+#include <tripstats.h>
+#include <logring.h>
+#include "../native/memorytripstorage.h"
+
+#define BENCH_REPETITIONS 5
+
+// What the adapter sends with ATE0/ATH0/ATL0, prompt included
+const char BENCH_FRAME_SINGLE[] = "41 0C 1A F8 \r\r>";
+const char BENCH_FRAME_BATCH[] = "00A\r0: 41 0C 1A F8 0D 32 \r1: 04 59 05 82 00 00 00 \r\r>";
+const char BENCH_FRAME_SEARCHING[] = "SEARCHING...\r41 0D 32 \r\r>";
+const char BENCH_FRAME_NO_DATA[] = "NO DATA\r\r>";
+const char BENCH_FRAME_CAN_HEADERS[] = "7E8 06 41 0C 1A F8 0D 32 \r7E9 03 41 0D 32 \r\r>";
+
+static char frameBuffer[RESPONSE_BUFFER_SIZE];
+static volatile int sink;
+static MemoryTripStorage storage;
+static uint32_t clockMs = 0;
+static uint32_t renderVersion = 0;
+static uint32_t statsClockMs = 0;
+static uint64_t statsDistanceMm = 0;
+static uint64_t statsFuelMicroliters = 0;
+
+BenchRunner::BenchRunner(BenchClock clock, BenchAllocationCount allocations, BenchOutput output)
+    : clock(clock), allocations(allocations), output(output) {
+}
+
+// An untimed pass warms up caches and clocks, then the fastest of
+// BENCH_REPETITIONS passes is reported: the slower ones mostly measure
+// interrupts and whatever else the machine was doing.
+void BenchRunner::run(const char* name, BenchOperation operation, uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations; i++) operation();
+
+    uint64_t best = 0;
+    uint64_t bytes = 0;
+    uint32_t allocated = 0;
+    for (uint8_t pass = 0; pass < BENCH_REPETITIONS; pass++) {
+        uint32_t allocationsBefore = allocations();
+        uint64_t start = clock();
+        for (uint32_t i = 0; i < iterations; i++) {
+            bytes += operation();
+        }
+        uint64_t elapsed = clock() - start;
+        allocated += allocations() - allocationsBefore;
+        if (pass == 0 || elapsed < best) best = elapsed;
+    }
+
+    uint64_t operations = (uint64_t)iterations * BENCH_REPETITIONS;
+    char line[128];
+    snprintf(line, sizeof(line), "BENCH %-20s %12.1f %8.3f %8.1f",
+        name, (double)best / iterations, (double)allocated / operations, (double)bytes / operations);
+    output(line);
+}
+
+// Same table lookup and conversion as MessageHandle, minus the display and NVS side effects
+static void convertPID(uint8_t pid, const uint8_t* data, uint16_t ecu, void* context) {
+    const PIDDescriptor* descriptor = PIDTable::find(pid);
+    if (descriptor != nullptr && descriptor->slot != PID_SLOT_BITMAP) sink = PIDTable::decode(*descriptor, data);
+}
+
+// The parser decodes in place, so every run starts from a fresh copy
+static size_t decodeFrame(const char* frame) {
+    size_t length = strlen(frame);
+    memcpy(frameBuffer, frame, length);
+    ELMResponse response = ELMParser::parse(frameBuffer, length, PIDTable::dataLength, convertPID, nullptr);
+    sink = response.decodedPIDs;
+    return 0;
+}
+
+static size_t decodeSingle() {
+    return decodeFrame(BENCH_FRAME_SINGLE);
+}
+
+static size_t decodeBatch() {
+    return decodeFrame(BENCH_FRAME_BATCH);
+}
+
+static size_t decodeSearching() {
+    return decodeFrame(BENCH_FRAME_SEARCHING);
+}
+
+static size_t decodeNoData() {
+    return decodeFrame(BENCH_FRAME_NO_DATA);
+}
+
+static size_t decodeCANHeaders() {
+    return decodeFrame(BENCH_FRAME_CAN_HEADERS);
+}
+
+// One polling round (RPM, speed, load) 250 ms after the previous one
+static size_t integrate() {
+    clockMs += 250;
+    TripComputer::onRPM(2400, clockMs);
+    TripComputer::onSpeed(90, clockMs);
+    TripComputer::onEngineLoad(35, clockMs);
+    return 0;
+}
+
+// What one answered batch of four PIDs costs the always-on instrumentation
+static size_t recordMetrics() {
+    static const uint8_t pids[] = { RPM_MUX, SPEED_MUX, ENGINE_LOAD_MUX, TEMP_MUX };
+    OBDMetrics::recordCommand(62, true);
+    OBDMetrics::recordRequest(pids, 4, 62, OBDMetrics::classify(true, 0, 4));
+    for (uint8_t i = 0; i < 4; i++) OBDMetrics::recordSample(pids[i]);
+    return 0;
+}
+
+// A debug line as the decoder would log it, formatted into the ring, then
+// taken out again as the drain task does; bytes are the formatted text
+static size_t writeLog() {
+    LogRing::setLevel(LOG_LEVEL_INFO);
+    LOG_I("Bench", "Batch answered %u of %u PIDs, %lu ms", 3u, 4u, 62ul);
+    LogRecord record;
+    return LogRing::read(record) ? strlen(record.text) : 0;
+}
+
+// The same line below the runtime level: one compare, nothing formatted
+static size_t filterLog() {
+    LogRing::setLevel(LOG_LEVEL_WARN);
+    LOG_I("Bench", "Batch answered %u of %u PIDs, %lu ms", 3u, 4u, 62ul);
+    return 0;
+}
+
+// One decoded batch 250 ms after the previous one, as the decoder feeds it
+static size_t updateStats() {
+    statsClockMs += 250;
+    statsDistanceMm += 6250;
+    statsFuelMicroliters += 250;
+    TripStats::onSample(STAT_RPM, 2400, statsClockMs);
+    TripStats::onSample(STAT_SPEED, 90, statsClockMs);
+    TripStats::onSample(STAT_LOAD, 35, statsClockMs);
+    TripStats::onSample(STAT_COOLANT, 91, statsClockMs);
+    TripStats::onTotals(statsDistanceMm, statsFuelMicroliters, statsClockMs);
+    return 0;
+}
+
+// The /api/stats document, summarized from the windows filled by updateStats
+static size_t renderStats() {
+    char buffer[TRIP_STATS_JSON_SIZE];
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, statsClockMs);
+    return TripStats::toJSON(snapshot, buffer, sizeof(buffer));
+}
+
+static size_t renderState() {
+    char buffer[384];
+    TelemetrySnapshot telemetry;
+    telemetry.version = ++renderVersion;
+    telemetry.updatedAt = renderVersion * 250;
+    telemetry.rpm = 2400;
+    telemetry.speedKmh = 90;
+    telemetry.engineLoad = 35;
+    telemetry.coolantTemp = 91;
+    telemetry.fuel = 31.25;
+    telemetry.tankCapacity = 45.0;
+    telemetry.consumptionFactor = 0.00000000815;
+    telemetry.distanceTraveled = 123.456;
+    telemetry.tripFuelUsed = 8.1234;
+    telemetry.kmPerLiter = 15.20;
+    telemetry.kmPerLiterMinute = 12.34;
+    telemetry.kmPerLiterHour = 14.56;
+    return TelemetryFormat::toJSON(telemetry, buffer, sizeof(buffer));
+}
+
+void runCommonBenchmarks(BenchRunner& runner, uint32_t iterations) {
+    TripComputer::setStorage(&storage);
+    OBDMetrics::registerPID(RPM_MUX);
+    OBDMetrics::registerPID(SPEED_MUX);
+    OBDMetrics::registerPID(ENGINE_LOAD_MUX);
+    OBDMetrics::registerPID(TEMP_MUX);
+    TripStats::begin();
+
+    runner.run("decode_single", decodeSingle, iterations);
+    runner.run("decode_batch", decodeBatch, iterations);
+    runner.run("decode_searching", decodeSearching, iterations);
+    runner.run("decode_no_data", decodeNoData, iterations);
+    runner.run("decode_can_headers", decodeCANHeaders, iterations);
+    runner.run("integrate_round", integrate, iterations);
+    runner.run("metrics_record", recordMetrics, iterations);
+    runner.run("render_state_json", renderState, iterations);
+    runner.run("stats_update", updateStats, iterations);
+    runner.run("render_stats_json", renderStats, iterations);
+    runner.run("log_write", writeLog, iterations);
+    runner.run("log_filtered", filterLog, iterations);
+}
@@ -0,0 +1,35 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint64_t (*BenchClock)();               // nanoseconds
+typedef uint32_t (*BenchAllocationCount)();     // allocations made so far
+typedef void (*BenchOutput)(const char* line);
+typedef size_t (*BenchOperation)();             // one operation, returns the bytes it produced
+
+// Times an operation over a number of iterations and prints one line per
+// benchmark that tools/bench_compare.py reads:
+//   BENCH <name> <ns/op> <allocs/op> <bytes/op>
+class BenchRunner {
+public:
+    BenchRunner(BenchClock clock, BenchAllocationCount allocations, BenchOutput output);
+    void run(const char* name, BenchOperation operation, uint32_t iterations);
+
+private:
+    BenchClock clock;
+    BenchAllocationCount allocations;
+    BenchOutput output;
+};
+
+// Benchmarks shared by the host and the device build
+void runCommonBenchmarks(BenchRunner& runner, uint32_t iterations);
+
+// Response fixtures, also used by the device-only benchmarks
+extern const char BENCH_FRAME_SINGLE[];
+extern const char BENCH_FRAME_BATCH[];
+extern const char BENCH_FRAME_SEARCHING[];
+extern const char BENCH_FRAME_NO_DATA[];
+
+#endif
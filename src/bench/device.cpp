@@ -0,0 +1,60 @@
+// Device side of the benchmark suite, results go to the serial monitor:
+//   pio run -e bench-esp32 -t upload && pio device monitor | tee bench.txt
+//   python3 tools/bench_compare.py --target esp32 bench.txt
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include "benchmarks.h"
+#include "../../lib/datadefinition.h"
+#include <messagehandle.h>
+#include <obdsession.h>
+#include <preferenceshandle.h>
+#include <displayhandle.h>
+
+#define DEVICE_ITERATIONS 5000
+
+static char responseBuffer[RESPONSE_BUFFER_SIZE];
+static ECU_STATUS ecuState = ECU_STATUS::AWAKE;
+static FrameDisplay frameDisplay;
+
+// esp_timer has microsecond resolution, enough over thousands of iterations
+static uint64_t deviceClock() {
+    return (uint64_t)esp_timer_get_time() * 1000;
+}
+
+// The heap can't report single allocations without heap tracing, so this is
+// the change in allocated blocks: 0 per op means nothing is held on to, a
+// malloc freed within the same operation is not seen.
+static uint32_t deviceAllocations() {
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+    return info.allocated_blocks;
+}
+
+static void deviceOutput(const char* line) {
+    Serial.println(line);
+}
+
+// The full decoder path: parse, LCD framebuffer, trip computer, telemetry
+static size_t processBatch() {
+    size_t length = strlen(BENCH_FRAME_BATCH);
+    memcpy(responseBuffer, BENCH_FRAME_BATCH, length);
+    MessageHandle::processAndShowMessage(responseBuffer, length, millis());
+    return 0;
+}
+
+void setup() {
+    Serial.begin(115200);
+    delay(2000);
+    OBDSession::begin(&PreferencesHandle::getInstance(), &frameDisplay);
+    MessageHandle::begin(&ecuState);
+
+    Serial.printf("Benchmarks, %u iterations at %u MHz\n", DEVICE_ITERATIONS, (unsigned)getCpuFrequencyMhz());
+    BenchRunner runner(deviceClock, deviceAllocations, deviceOutput);
+    runCommonBenchmarks(runner, DEVICE_ITERATIONS);
+    runner.run("process_batch", processBatch, DEVICE_ITERATIONS);
+    Serial.println("Benchmarks done");
+}
+
+void loop() {
+    delay(1000);
+}
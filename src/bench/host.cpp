@@ -0,0 +1,64 @@
+// Host side of the benchmark suite:
+//   pio run -e bench-native -t exec > bench.txt
+//   python3 tools/bench_compare.py --target native bench.txt
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <new>
+#include "benchmarks.h"
+
+#define HOST_ITERATIONS 200000
+
+static uint32_t allocationCount = 0;
+
+#if defined(__GLIBC__)
+// Counts every heap allocation, including the ones libc makes for itself
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* pointer, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    allocationCount++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocationCount++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* pointer, size_t size) {
+    allocationCount++;
+    return __libc_realloc(pointer, size);
+}
+#else
+// Only C++ allocations are visible elsewhere
+void* operator new(size_t size) {
+    allocationCount++;
+    void* pointer = malloc(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+#endif
+
+static uint64_t hostClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t hostAllocations() {
+    return allocationCount;
+}
+
+static void hostOutput(const char* line) {
+    puts(line);
+}
+
+int main() {
+    BenchRunner runner(hostClock, hostAllocations, hostOutput);
+    runCommonBenchmarks(runner, HOST_ITERATIONS);
+    return 0;
+}
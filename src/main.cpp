@@ -8,11 +8,26 @@
 #include "../lib/datadefinition.h"
 #include <obdhandle.h>
 #include <messagehandle.h>
+#include <obdsession.h>
 #include <htmlinterface.h>
 #include <preferenceshandle.h>
+#include <displayhandle.h>
+#include <lcddisplay.h>
+#include <pidscheduler.h>
+#include <obdmetrics.h>
+#include <pidsupport.h>
+#include <pidtable.h>
+#include <elmprotocol.h>
+#include <telemetry.h>
+#include <triplogger.h>
+#include <tripcomputer.h>
+#include <tripstats.h>
+#include <powermanager.h>
+#include <logger.h>
 
-// sensor address
+// adapter, until another one is set through POST /transport
 static String targetAddress = "66:1e:32:7a:35:0e";
+static ELMAdapterConfig adapter;
 
 // UUIDs
 static String serviceUUID = "0000fff0-0000-1000-8000-00805f9b34fb";
@@ -24,9 +39,33 @@ HTMLInterface htmlInterface;
 
 // LCD
 LiquidCrystal_I2C lcd(0x27, 16, 2);
+LCDDisplay lcdDisplay(lcd);
+FrameDisplay frameDisplay;
 
-// cycle count
-int messagesFromRPM = 0;
+// request pipeline
+#define PIPELINE_DEPTH 2
+
+struct CompletedRequest {
+    uint8_t pids[MAX_PIDS_PER_REQUEST];
+    uint8_t count;
+    uint8_t answered;       // bit i set when pids[i] was decoded, 0 for a timeout or NO DATA
+    unsigned long roundTripMs;
+};
+
+QueueHandle_t completedRequests;
+uint8_t requestsInFlight = 0;
+
+// polling rate report
+#define RATE_REPORT_INTERVAL_MS 10000
+unsigned long lastRateReport = 0;
+
+// reconnect backoff, doubled after every failed attempt
+#define RECONNECT_MIN_DELAY_MS 250
+#define RECONNECT_MAX_DELAY_MS 8000
+unsigned long reconnectDelayMs = 0;
+
+// PIDSupport version the scheduler was last updated with
+uint32_t appliedSupportVersion = 0;
 
 // Var
 CONNECTION_STATUS status = CONNECTION_STATUS::DISCONNECTED;
@@ -36,25 +75,125 @@ void TaskWiFi(void * pvParameters) {
   Serial.print("Run Wifi on Core: ");
     Serial.println(xPortGetCoreID());
     
+    // HTTP requests are served by the async server, this task only pushes live values
+    Telemetry::setListener(xTaskGetCurrentTaskHandle());
     htmlInterface.begin(); 
+    PowerManager::applyProfile();
 
     for(;;) {
-        htmlInterface.handleClient();
-        vTaskDelay(10 / portTICK_PERIOD_MS); // Pequena pausa para o watchdog
+        unsigned long wait = htmlInterface.pushLive();
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait));
+    }
+}
+
+// Runs on the OBD engine task, hands the result back to loop()
+void onRequestCompleted(const OBDCommand& command, bool responded, unsigned long elapsedMs) {
+    CompletedRequest done;
+    memcpy(done.pids, command.pids, command.pidCount);
+    done.count = command.pidCount;
+    done.answered = responded ? command.answered : 0;
+    done.roundTripMs = elapsedMs;
+    xQueueSend(completedRequests, &done, 0);
+}
+
+void reportPollingRates() {
+    Serial.printf("Polling load %.2f%s, NVS writes: %u\n", PIDScheduler::getLoadFactor(), PIDScheduler::isOvercommitted() ? " (bus overcommitted)" : "", (unsigned)PreferencesHandle::getInstance().getFlashWriteCount());
+    Serial.printf("Receive ring: high water %u/%u bytes, %u notifications and %u frames dropped\n", (unsigned)OBDHandle::getReceiveHighWater(), RECEIVE_RING_BYTES, (unsigned)OBDHandle::getDroppedNotifications(), (unsigned)OBDHandle::getDroppedFrames());
+    Serial.printf("Trip log: %u samples, %u/%u bytes%s, %u samples dropped\n", (unsigned)TripLogger::getRecordedSamples(), (unsigned)TripLogger::getLogSize(), (unsigned)TripLogger::getLogCapacity(), TripLogger::isFull() ? " (full)" : "", (unsigned)TripLogger::getDroppedSamples());
+    for(uint8_t i = 0; i < PIDScheduler::getEntryCount(); i++) {
+        const PIDScheduleEntry& entry = PIDScheduler::getEntry(i);
+        if(!entry.enabled) {
+            Serial.printf("  PID %02X: not supported by the ECU\n", entry.pid);
+            continue;
+        }
+        Serial.printf("  PID %02X: %.2f/%.2f Hz (%.0f ms/sample)\n", entry.pid, entry.achievedHz, entry.targetHz, entry.costMs);
+    }
+}
+
+void enterPowerState(POWER_STATE next) {
+    POWER_STATE previous = PowerManager::getState();
+    if(next == previous) return;
+    unsigned long elapsed = PowerManager::setState(next);
+    Serial.printf("Power: %s after %.1f s of %s (total: active %.0f s, ecu_wait %.0f s, disconnected %.0f s)\n",
+                  PowerManager::stateName(next), elapsed / 1000.0, PowerManager::stateName(previous),
+                  PowerManager::getTimeInState(POWER_ACTIVE) / 1000.0, PowerManager::getTimeInState(POWER_ECU_WAIT) / 1000.0,
+                  PowerManager::getTimeInState(POWER_DISCONNECTED) / 1000.0);
+}
+
+// Only PIDs the ECU supports are polled, an unsupported one would cost a full timeout every time
+void applySupportedPIDs() {
+    appliedSupportVersion = PIDSupport::getVersion();
+    for(uint8_t i = 0; i < PIDScheduler::getEntryCount(); i++) {
+        uint8_t pid = PIDScheduler::getEntry(i).pid;
+        PIDScheduler::setEnabled(pid, PIDSupport::isSupported(pid));
+    }
+}
+
+// First answer on this connection: the protocol search is over, read back
+// which one the adapter uses (and on CAN which ECU is polled) and keep it
+// for the next start
+void confirmProtocol() {
+    OBDHandle::detectProtocol();
+    if(ELMProtocol::takeChanged()) {
+        uint8_t cache[ELM_PROTOCOL_CACHE_SIZE];
+        ELMProtocol::save(cache, sizeof(cache));
+        PreferencesHandle::getInstance().saveProtocol(adapter.address, cache, sizeof(cache));
     }
+    if(ELMProtocol::getECU() != ELM_NO_HEADER) {
+        Serial.printf("Protocol: %s, polling ECU %03X\n", ELMProtocol::getName(ELMProtocol::getProtocol()), ELMProtocol::getECU());
+    } else {
+        Serial.printf("Protocol: %s\n", ELMProtocol::getName(ELMProtocol::getProtocol()));
+    }
+}
+
+// The 0100 wake-up probe brought the first bitmap. The others come from the
+// cache when it is the same car as last time, otherwise they are read now.
+void updateSupportedPIDs() {
+    PIDSupport::clearUnavailable();
+    if(!PIDSupport::isDiscovered()) {
+        OBDHandle::discoverSupportedPIDs();
+    }
+    if(PIDSupport::takeChanged()) {
+        uint8_t cache[PID_SUPPORT_CACHE_SIZE];
+        PIDSupport::save(cache, sizeof(cache));
+        PreferencesHandle::getInstance().saveSupportedPIDs(adapter.address, cache, sizeof(cache));
+        Serial.println("Supported PIDs saved for this adapter");
+    }
+    applySupportedPIDs();
+}
+
+void loadAdapterConfig() {
+    memset(&adapter, 0, sizeof(adapter));
+    adapter.version = ELM_ADAPTER_CONFIG_VERSION;
+    adapter.kind = ELM_TRANSPORT_BLE;
+    strlcpy(adapter.address, targetAddress.c_str(), sizeof(adapter.address));
+    PreferencesHandle::getInstance().loadAdapterConfig(adapter);
+    Serial.printf("Adapter: %s %s\n", elmTransportName(adapter.kind), adapter.address);
+}
+
+// ATI round trip of this connection, the transport's share of every request
+void reportTransport() {
+    OBDHandle::measureRoundTrip();
+    const TransportRoundTrip& roundTrip = OBDMetrics::getTransportRoundTrip();
+    if(roundTrip.samples == 0) return;
+    Serial.printf("Transport %s: round trip min %.1f / p50 %.1f / p90 %.1f / max %.1f ms\n", roundTrip.transport,
+                  roundTrip.minUs / 1000.0, roundTrip.medianUs / 1000.0, roundTrip.p90Us / 1000.0, roundTrip.maxUs / 1000.0);
 }
 
 void setup() {
     Serial.begin(115200);
+    // Warnings and errors by default. More detail, up to the build's
+    // LOG_LEVEL: LogRing::setLevel(LOG_LEVEL_DEBUG) here or POST /log
+    Logger::begin(&Serial);
     Wire.setClock(100000); // 400kHz I2C
     lcd.init();
     delay(1000);
     lcd.backlight();
+    DisplayHandle::begin(&lcdDisplay);
+    PowerManager::begin();
 
-    lcd.setCursor(0, 0);
     Serial.println("--- System Started ---");
-    lcd.setCursor(0, 0);
-    lcd.print("-System Started-");
+    DisplayHandle::print(0, 0, "-System Started-");
 
     xTaskCreatePinnedToCore(
         TaskWiFi,      
@@ -66,69 +205,142 @@ void setup() {
         0              
     );
  
-    // Enable debug for OBDHandle
-    OBDHandle::setDebugSerial(&Serial);
-    //OBDHandle::enableDebug(true);
-
+    loadAdapterConfig();
+    OBDHandle::setTransport(adapter.kind);
+    OBDHandle::setAdapterNetwork(adapter.ssid, adapter.password);
     OBDHandle::setServiceUUID(serviceUUID.c_str());
     OBDHandle::setCharUUID_TX(charUUID_TX.c_str());
     OBDHandle::setCharUUID_RX(charUUID_RX.c_str());
     OBDHandle::begin();
+    BLEHandleCache handles;
+    if(adapter.kind == ELM_TRANSPORT_BLE &&
+       PreferencesHandle::getInstance().loadAdapterHandles(adapter.address, (uint8_t*)&handles, sizeof(handles))) {
+        OBDHandle::setHandleCache(handles);
+    }
+    uint8_t protocolCache[ELM_PROTOCOL_CACHE_SIZE];
+    if(PreferencesHandle::getInstance().loadProtocol(adapter.address, protocolCache, sizeof(protocolCache))) {
+        ELMProtocol::restore(protocolCache, sizeof(protocolCache));
+    }
+    completedRequests = xQueueCreate(COMMAND_QUEUE_LENGTH, sizeof(CompletedRequest));
     
-    //MessageHandle::enableDebug(true);
-    MessageHandle::setDebugSerial(&Serial);
+    OBDSession::begin(&PreferencesHandle::getInstance(), &frameDisplay);
+    MessageHandle::begin(&ecu_state);
+    TripComputer::setStorage(&PreferencesHandle::getInstance());
+    TripStats::begin();
+    uint8_t tripSlots[TRIP_STATS_CACHE_SIZE];
+    size_t tripSlotsLength = PreferencesHandle::getInstance().getTripSlots(tripSlots, sizeof(tripSlots));
+    if(tripSlotsLength > 0 && !TripStats::restore(tripSlots, tripSlotsLength)) {
+      Serial.println("Trip statistics: saved slots from another firmware, starting over");
+    }
+    Telemetry::publishPreferences();
+    TripLogger::begin();
 
-    MessageHandle::setLCD(&lcd);
-    MessageHandle::setECUState(&ecu_state);
+    // Target rate (Hz) and priority of every polled PID come from its table row
+    for (uint8_t i = 0; i < PIDTable::getRowCount(); i++) {
+        const PIDDescriptor& row = PIDTable::getRow(i);
+        if (row.rateHz > 0) PIDScheduler::registerPID(row.pid, row.rateHz, row.priority);
+    }
+    for (uint8_t i = 0; i < PIDScheduler::getEntryCount(); i++) {
+        OBDMetrics::registerPID(PIDScheduler::getEntry(i).pid);
+    }
 }
 
 void loop() {
+  if(status == CONNECTION_STATUS::CONNECTED && !OBDHandle::isConnected()) {
+    Serial.println("OBD adapter connection lost");
+    status = CONNECTION_STATUS::DISCONNECTED;
+    ecu_state = ECU_STATUS::SLEEP;
+    enterPowerState(POWER_DISCONNECTED);
+  }
+
   if(status == CONNECTION_STATUS::DISCONNECTED)
   {
+    if(reconnectDelayMs > 0) delay(reconnectDelayMs);
     Serial.println("Trying to connect with OBD...");
-    lcd.setCursor(0, 0);
-    lcd.print("Connecting OBD...");
+    DisplayHandle::print(0, 0, "Connecting OBD...");
     
-    if(OBDHandle::connect(targetAddress.c_str()))
+    unsigned long startedAt = millis();
+    if(OBDHandle::connect(adapter.address))
     {
+      Serial.printf("OBD connected in %lu ms\n", millis() - startedAt);
       status = CONNECTION_STATUS::CONNECTED;
+      reconnectDelayMs = 0;
+      if(OBDHandle::takeHandlesChanged()) {
+        const BLEHandleCache& handles = OBDHandle::getHandleCache();
+        PreferencesHandle::getInstance().saveAdapterHandles(adapter.address, (const uint8_t*)&handles, sizeof(handles));
+      }
+      reportTransport();
+      uint8_t cache[PID_SUPPORT_CACHE_SIZE];
+      PIDSupport::reset();
+      if(PreferencesHandle::getInstance().loadSupportedPIDs(adapter.address, cache, sizeof(cache))) {
+        PIDSupport::restore(cache, sizeof(cache));
+      }
+    }
+    else
+    {
+      // Adapter off or out of range: back off instead of hammering the radio
+      reconnectDelayMs = reconnectDelayMs == 0 ? RECONNECT_MIN_DELAY_MS : reconnectDelayMs * 2;
+      if(reconnectDelayMs > RECONNECT_MAX_DELAY_MS) reconnectDelayMs = RECONNECT_MAX_DELAY_MS;
     }
     
-    lcd.clear();
+    DisplayHandle::clear();
     return;
   }
 
   if(ecu_state == ECU_STATUS::SLEEP) {
-    lcd.clear();
-    Serial.println("Connect with OBD, Wait ECU.");
-    lcd.setCursor(0, 0);
-    lcd.print("Connect with OBD");
-    lcd.setCursor(0, 1);
-    lcd.print(" Wait ECU...   ");
-    while (ecu_state == ECU_STATUS::SLEEP) {
-      OBDHandle::checkECU();
-    }
-    lcd.setCursor(0, 1);
-    lcd.print("   ECU Awake!   ");
-    delay(1000);
-    lcd.clear();
+    if(PowerManager::getState() != POWER_ECU_WAIT) {
+      // Ignition off: persist the trip before the power may go away
+      PreferencesHandle::getInstance().flush();
+      TripLogger::flush();
+      DisplayHandle::clear();
+      Serial.println("Connect with OBD, Wait ECU.");
+      DisplayHandle::print(0, 0, "Connect with OBD");
+      DisplayHandle::print(0, 1, " Wait ECU...   ");
+      enterPowerState(POWER_ECU_WAIT);
+    }
+
+    // One probe per pass, further apart the longer the ECU sleeps
+    OBDHandle::checkECU();
+    if(ecu_state == ECU_STATUS::SLEEP) {
+      delay(PowerManager::nextProbeDelay());
+      return;
+    }
+    enterPowerState(POWER_ACTIVE);
+    TripStats::requestReset(TRIP_SLOT_DRIVE);
+    DisplayHandle::print(0, 1, "   ECU Awake!   ");
+    if(!ELMProtocol::isConfirmed()) {
+        confirmProtocol();
+    }
+    updateSupportedPIDs();
+    DisplayHandle::clear();
   }
 
-  if(messagesFromRPM % 4 == 0) {
-    OBDHandle::sendCommand("010C"); // RPM
-  } else if(messagesFromRPM % 4 == 1) {
-    OBDHandle::sendCommand("010D"); // Speed - mais frequente
-  } else if(messagesFromRPM % 4 == 2) {
-    OBDHandle::sendCommand("0104"); // Engine Load
-  } else {
-    OBDHandle::sendCommand("010D"); // Speed novamente
+  if(PIDSupport::getVersion() != appliedSupportVersion) {
+    applySupportedPIDs();
   }
 
-  // Temperatura menos frequente
-  if(messagesFromRPM % 30 == 0) {
-    messagesFromRPM = 0;
-    OBDHandle::sendCommand("0105"); // Temperature
+  CompletedRequest done;
+  while(xQueueReceive(completedRequests, &done, 0) == pdTRUE) {
+    requestsInFlight--;
+    PIDScheduler::onRequestCompleted(done.pids, done.count, done.answered, millis(), done.roundTripMs);
   }
 
-  messagesFromRPM++;
-}
\ No newline at end of file
+  // Keep the adapter saturated: the next request is already queued when the current one completes
+  while(requestsInFlight < PIPELINE_DEPTH) {
+    uint8_t pids[MAX_PIDS_PER_REQUEST];
+    uint8_t count = PIDScheduler::nextBatch(millis(), pids, OBDHandle::isBatchEnabled() ? MAX_PIDS_PER_REQUEST : 1);
+    if(count == 0 || !OBDHandle::submitPIDs(pids, count, onRequestCompleted, nullptr)) break;
+    requestsInFlight++;
+  }
+
+  PreferencesHandle::getInstance().flushIfDue(millis());
+
+  if(millis() - lastRateReport >= RATE_REPORT_INTERVAL_MS) {
+    lastRateReport = millis();
+    reportPollingRates();
+  }
+
+  // Sleep until a request completes or the next PID is due
+  unsigned long wait = (requestsInFlight < PIPELINE_DEPTH) ? PIDScheduler::msUntilNextDue(millis()) : PID_COMMAND_TIMEOUT_MS;
+  xQueuePeek(completedRequests, &done, pdMS_TO_TICKS(wait));
+}
@@ -0,0 +1,43 @@
+#ifndef CONSOLEDISPLAY_H
+#define CONSOLEDISPLAY_H
+
+#include <stdio.h>
+#include <string.h>
+#include <chardisplay.h>
+
+// 16x2 character display kept in memory and printed to stdout on demand
+class ConsoleDisplay : public CharDisplay {
+public:
+    ConsoleDisplay() {
+        clear();
+    }
+
+    void clear() override {
+        memset(cells, ' ', sizeof(cells));
+    }
+
+    void write(uint8_t column, uint8_t row, const char* text, size_t length) override {
+        if (row >= 2) return;
+        for (size_t i = 0; i < length && column + i < 16; i++) {
+            cells[row][column + i] = text[i];
+        }
+    }
+
+    void show() const {
+        printf("+----------------+\n");
+        for (int row = 0; row < 2; row++) {
+            putchar('|');
+            for (int column = 0; column < 16; column++) {
+                // 0xDF is the degree sign in the LCD's character ROM
+                putchar(cells[row][column] == '\xDF' ? 'o' : cells[row][column]);
+            }
+            printf("|\n");
+        }
+        printf("+----------------+\n");
+    }
+
+private:
+    char cells[2][16];
+};
+
+#endif
@@ -0,0 +1,481 @@
+// Native (Linux) build: drives the scheduler, the ELM327 parser and the trip
+// computer against the in-process ELM327 simulator on a simulated clock, so
+// thousands of requests run in a fraction of a second. --serve puts the
+// simulator behind a socket as a WiFi ELM327, --tcp polls one on the real
+// clock through TCPTransport, the firmware's WiFi transport.
+//
+//   pio run -e native && .pio/build/native/program --requests 50000 --nodata 2
+//   .pio/build/native/program --serve 35000 &
+//   .pio/build/native/program --tcp 127.0.0.1:35000 --requests 500
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+
+#include "../../lib/datadefinition.h"
+#include <elmparser.h>
+#include <elmsimulator.h>
+#include <tcptransport.h>
+#include <pidscheduler.h>
+#include <obdmetrics.h>
+#include <pidsupport.h>
+#include <pidtable.h>
+#include <elmtiming.h>
+#include <elmprotocol.h>
+#include <tripcomputer.h>
+#include <tripstats.h>
+#include <obdsession.h>
+#include <logring.h>
+#include "memorytripstorage.h"
+#include "consoledisplay.h"
+#include "tcpemulator.h"
+
+#define PID_TIMEOUT_MS 1000
+#define DRIVE_CYCLE_MS 120000
+#define LATE_REPLY_MS 5000
+#define PROBE_COUNT 8
+
+struct Options {
+    uint32_t requests;
+    uint8_t batch;
+    uint32_t seed;
+    bool metrics;
+    bool fixedTiming;
+    bool stats;
+    bool cachedProtocol;
+    bool cachedCAN;             // the cache is from another car, on CAN
+    const char* tcpAddress;     // poll this adapter instead of the simulator
+    uint16_t servePort;         // run the emulator instead
+    ELMSimulatorConfig simulator;
+};
+
+static ELMSimulator simulator;
+static TCPTransport socketTransport;
+static ELMTransport* adapter = &simulator;
+static bool realClock = false;
+static std::chrono::steady_clock::time_point clockStart;
+static MemoryTripStorage storage;
+static ConsoleDisplay display;
+
+static char responseBuffer[RESPONSE_BUFFER_SIZE];
+static size_t responseLength = 0;
+static bool responseComplete = false;
+static bool responseOverflow = false;
+static uint32_t now = 0;
+
+static void onAdapterData(const uint8_t* data, size_t length, void* context) {
+    if (responseComplete) return;
+
+    const uint8_t* prompt = (const uint8_t*)memchr(data, '>', length);
+    size_t chunk = prompt != nullptr ? (size_t)(prompt - data) + 1 : length;
+    if (responseLength + chunk > RESPONSE_BUFFER_SIZE) {
+        responseOverflow = true;
+        chunk = RESPONSE_BUFFER_SIZE - responseLength;
+    }
+    memcpy(responseBuffer + responseLength, data, chunk);
+    responseLength += chunk;
+    responseComplete = prompt != nullptr;
+}
+
+static uint64_t clockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+// Idle time: skipped on the simulated clock, slept on the real one
+static void waitMs(uint32_t ms) {
+    if (realClock) {
+        usleep(ms * 1000);
+        now = (uint32_t)(clockUs() / 1000);
+    } else {
+        now += ms;
+    }
+}
+
+// Over the socket: polls until the prompt. A late reply is still waited for
+// (LATE_REPLY_MS at most) so it can't end up in the next response.
+static bool exchangeSocket(const char* text, uint32_t timeoutMs) {
+    uint32_t sentAt = (uint32_t)(clockUs() / 1000);
+    if (!socketTransport.write((const uint8_t*)text, strlen(text))) return false;
+    for (;;) {
+        now = (uint32_t)(clockUs() / 1000);
+        uint32_t elapsed = now - sentAt;
+        if (responseComplete || elapsed >= timeoutMs + LATE_REPLY_MS || !socketTransport.isConnected()) break;
+        socketTransport.poll(timeoutMs + LATE_REPLY_MS - elapsed);
+    }
+    bool responded = now - sentAt <= timeoutMs && responseComplete && !responseOverflow;
+    OBDMetrics::recordCommand(responded ? now - sentAt : timeoutMs, responded);
+    return responded;
+}
+
+// Writes one command and runs the clock until its prompt. A response later
+// than the timeout still has to be waited for (the simulator refuses new
+// commands meanwhile) but counts as a timeout and is thrown away.
+static bool exchange(const char* text, uint32_t timeoutMs) {
+    responseLength = 0;
+    responseComplete = false;
+    responseOverflow = false;
+    if (realClock) return exchangeSocket(text, timeoutMs);
+    simulator.advance(now);
+    if (!simulator.write((const uint8_t*)text, strlen(text))) return false;
+
+    uint32_t dueAt = simulator.getResponseDueAt();
+    bool inTime = dueAt - now <= timeoutMs;
+    uint32_t elapsed = dueAt - now;
+    now = dueAt;
+    simulator.advance(now);
+    bool responded = inTime && responseComplete && !responseOverflow;
+    OBDMetrics::recordCommand(responded ? elapsed : timeoutMs, responded);
+    return responded;
+}
+
+// The runner's side of OBDSession: the simulator on the simulated clock, the
+// socket on the real one. Replies to requests are decoded right here.
+class NativeLink : public OBDLink {
+public:
+    bool exchange(const char* text, uint32_t timeoutMs, char* reply, size_t size) override {
+        if (!::exchange(text, timeoutMs)) return false;
+        if (text[0] != 'A' || text[1] != 'T') {
+            OBDSession::decodeResponse(responseBuffer, responseLength, ::now);
+        } else if (reply != nullptr && size > 0) {
+            size_t length = responseLength < size ? responseLength : size - 1;
+            memcpy(reply, responseBuffer, length);
+            reply[length] = '\0';
+        }
+        return true;
+    }
+
+    uint32_t now() override {
+        return ::now;
+    }
+};
+
+static NativeLink adapterLink;
+
+static uint32_t logClock() {
+    return now;
+}
+
+// OBDSession reports through LogRing like on the device, here to stdout
+static void drainLog() {
+    LogRecord record;
+    char line[LOG_LINE_SIZE];
+    while (LogRing::read(record)) {
+        size_t length = LogRing::formatLine(record, line, sizeof(line));
+        fwrite(line, 1, length, stdout);
+    }
+}
+
+static int interpolate(int from, int to, uint32_t elapsed, uint32_t span) {
+    return from + (int)((int64_t)(to - from) * elapsed / span);
+}
+
+// Two minute city loop: idle, accelerate to 90 km/h, cruise, brake, idle.
+// The coolant warms up over the first ten minutes.
+static ELMSimulatedEngine driveCycle(uint32_t time) {
+    ELMSimulatedEngine engine;
+    uint32_t t = time % DRIVE_CYCLE_MS;
+
+    if (t < 20000) {
+        engine.rpm = 800; engine.speedKmh = 0; engine.loadPercent = 20;
+    } else if (t < 40000) {
+        engine.rpm = interpolate(1500, 3500, t - 20000, 20000);
+        engine.speedKmh = interpolate(0, 90, t - 20000, 20000);
+        engine.loadPercent = 70;
+    } else if (t < 90000) {
+        engine.rpm = 2400; engine.speedKmh = 90; engine.loadPercent = 35;
+    } else if (t < 110000) {
+        engine.rpm = interpolate(1800, 900, t - 90000, 20000);
+        engine.speedKmh = interpolate(90, 0, t - 90000, 20000);
+        engine.loadPercent = 10;
+    } else {
+        engine.rpm = 800; engine.speedKmh = 0; engine.loadPercent = 20;
+    }
+    engine.coolantC = time >= 600000 ? 90 : interpolate(20, 90, time, 600000);
+    engine.awake = true;
+    return engine;
+}
+
+// ATI is answered by the adapter alone, like OBDHandle::measureRoundTrip.
+// On the simulated clock this is ELM_SIMULATOR_AT_MS.
+static void measureRoundTrip() {
+    uint32_t samples[PROBE_COUNT];
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+        uint64_t start = realClock ? clockUs() : (uint64_t)now * 1000;
+        if (!exchange("ATI\r", 3000)) continue;
+        samples[count++] = (uint32_t)((realClock ? clockUs() : (uint64_t)now * 1000) - start);
+    }
+    OBDMetrics::recordTransportProbe(adapter->getName(), samples, count);
+    const TransportRoundTrip& roundTrip = OBDMetrics::getTransportRoundTrip();
+    if (count > 0) {
+        printf("Transport %s: round trip min %.2f / p50 %.2f / p90 %.2f / max %.2f ms\n", roundTrip.transport,
+               roundTrip.minUs / 1000.0, roundTrip.medianUs / 1000.0, roundTrip.p90Us / 1000.0, roundTrip.maxUs / 1000.0);
+    }
+}
+
+// Only PIDs the ECU supports are polled, like applySupportedPIDs on the device.
+// Returns how many of the scheduled PIDs are left.
+static uint8_t applySupportedPIDs() {
+    uint8_t enabledPIDs = 0;
+    for (uint8_t i = 0; i < PIDScheduler::getEntryCount(); i++) {
+        uint8_t pid = PIDScheduler::getEntry(i).pid;
+        PIDScheduler::setEnabled(pid, PIDSupport::isSupported(pid));
+        if (PIDSupport::isSupported(pid)) enabledPIDs++;
+    }
+    return enabledPIDs;
+}
+
+static void usage() {
+    printf("usage: program [--requests N] [--batch N] [--latency MS] [--jitter MS]\n"
+           "               [--nodata PERCENT] [--kline] [--no-search] [--chunk BYTES] [--seed N]\n"
+           "               [--metrics] [--stats] [--no-count] [--fixed-timing] [--ecus N] [--cached]\n"
+           "               [--cached-can] [--tcp HOST:PORT] [--serve PORT]\n");
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    options.requests = 20000;
+    options.batch = 4;
+    options.seed = 1;
+    options.metrics = false;
+    options.fixedTiming = false;
+    options.stats = false;
+    options.cachedProtocol = false;
+    options.cachedCAN = false;
+    options.tcpAddress = nullptr;
+    options.servePort = 0;
+    options.simulator.latencyMs = 40;
+    options.simulator.jitterMs = 20;
+    options.simulator.noDataPercent = 0;
+    options.simulator.searching = true;
+    options.simulator.searchMs = 1500;
+    options.simulator.bus = ELM_SIMULATOR_CAN;
+    options.simulator.chunkSize = 20;
+    options.simulator.responseCount = true;
+    options.simulator.secondECU = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(option, "--kline") == 0) {
+            options.simulator.bus = ELM_SIMULATOR_KLINE;
+        } else if (strcmp(option, "--no-search") == 0) {
+            options.simulator.searching = false;
+        } else if (strcmp(option, "--metrics") == 0) {
+            options.metrics = true;
+        } else if (strcmp(option, "--stats") == 0) {
+            options.stats = true;
+        } else if (strcmp(option, "--no-count") == 0) {
+            options.simulator.responseCount = false;
+        } else if (strcmp(option, "--fixed-timing") == 0) {
+            options.fixedTiming = true;
+        } else if (strcmp(option, "--cached") == 0) {
+            options.cachedProtocol = true;
+        } else if (strcmp(option, "--cached-can") == 0) {
+            options.cachedProtocol = true;
+            options.cachedCAN = true;
+        } else if (hasValue && strcmp(option, "--tcp") == 0) {
+            options.tcpAddress = argv[++i];
+        } else if (hasValue && strcmp(option, "--serve") == 0) {
+            options.servePort = (uint16_t)atoi(argv[++i]);
+        } else if (hasValue && strcmp(option, "--ecus") == 0) {
+            options.simulator.secondECU = atoi(argv[++i]) > 1;
+        } else if (hasValue && strcmp(option, "--requests") == 0) {
+            options.requests = strtoul(argv[++i], nullptr, 10);
+        } else if (hasValue && strcmp(option, "--batch") == 0) {
+            options.batch = (uint8_t)atoi(argv[++i]);
+        } else if (hasValue && strcmp(option, "--latency") == 0) {
+            options.simulator.latencyMs = strtoul(argv[++i], nullptr, 10);
+        } else if (hasValue && strcmp(option, "--jitter") == 0) {
+            options.simulator.jitterMs = strtoul(argv[++i], nullptr, 10);
+        } else if (hasValue && strcmp(option, "--nodata") == 0) {
+            options.simulator.noDataPercent = (uint8_t)atoi(argv[++i]);
+        } else if (hasValue && strcmp(option, "--chunk") == 0) {
+            options.simulator.chunkSize = (uint8_t)atoi(argv[++i]);
+        } else if (hasValue && strcmp(option, "--seed") == 0) {
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    if (options.batch < 1) options.batch = 1;
+    if (options.batch > MAX_PIDS_PER_REQUEST) options.batch = MAX_PIDS_PER_REQUEST;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 1;
+    }
+
+    simulator.configure(options.simulator);
+    simulator.seed(options.seed);
+    if (options.servePort != 0) {
+        TCPEmulator emulator(simulator, driveCycle);
+        if (!emulator.listen(options.servePort)) {
+            printf("Can't listen on port %u\n", options.servePort);
+            return 1;
+        }
+        printf("ELM327 emulator on 127.0.0.1:%u\n", options.servePort);
+        fflush(stdout);
+        emulator.serve();
+    }
+
+    if (options.tcpAddress != nullptr) {
+        clockStart = std::chrono::steady_clock::now();
+        realClock = true;
+        adapter = &socketTransport;
+        if (!socketTransport.connect(options.tcpAddress)) {
+            printf("Can't connect to %s\n", options.tcpAddress);
+            return 1;
+        }
+    }
+    adapter->setReceiver(onAdapterData, nullptr);
+    LogRing::setClock(logClock);
+    LogRing::setLevel(LOG_LEVEL_INFO);
+    OBDSession::begin(&storage, &display);
+    OBDSession::setTimingEnabled(!options.fixedTiming);
+    TripComputer::setStorage(&storage);
+    TripStats::begin();
+
+    for (uint8_t i = 0; i < PIDTable::getRowCount(); i++) {
+        const PIDDescriptor& row = PIDTable::getRow(i);
+        if (row.rateHz > 0) PIDScheduler::registerPID(row.pid, row.rateHz, row.priority);
+    }
+    for (uint8_t i = 0; i < PIDScheduler::getEntryCount(); i++) {
+        OBDMetrics::registerPID(PIDScheduler::getEntry(i).pid);
+    }
+
+    if (options.cachedProtocol) {
+        // What an earlier connection to this car (or to a CAN car) saved
+        bool kline = options.simulator.bus == ELM_SIMULATOR_KLINE && !options.cachedCAN;
+        uint8_t cache[ELM_PROTOCOL_CACHE_SIZE] = { ELM_PROTOCOL_CACHE_VERSION, (uint8_t)(kline ? 3 : 6),
+                                                   (uint8_t)(kline ? 0 : 0x07), (uint8_t)(kline ? 0 : 0xE8) };
+        ELMProtocol::restore(cache, sizeof(cache));
+    }
+
+    char select[16];
+    ELMProtocol::selectCommand(select, sizeof(select));
+    OBDSession::sendStarterCommands(adapterLink);
+    measureRoundTrip();
+
+    // Wake-up probe, the adapter searches for the protocol if it has to
+    uint32_t connectStart = now;
+    OBDSession::probeECU(adapterLink);
+    uint32_t firstAnswerMs = now - connectStart;
+    OBDSession::detectProtocol(adapterLink);
+    drainLog();
+    printf("Protocol: %s (%s), %s%u ms to the first answer\n", ELMProtocol::getName(ELMProtocol::getProtocol()),
+           select, options.cachedProtocol ? "cached, " : "", firstAnswerMs);
+    if (ELMProtocol::getResponderCount() > 0) {
+        printf("ECUs answering 0100: %u, polling %03X\n", ELMProtocol::getResponderCount(), ELMProtocol::getECU());
+    } else if (ELMProtocol::getECU() != ELM_NO_HEADER) {
+        printf("Polling %03X\n", ELMProtocol::getECU());
+    }
+
+    // Same discovery as the firmware when the ECU wakes up: 0100, then every bitmap it announces
+    OBDSession::discoverSupportedPIDs(adapterLink);
+    drainLog();
+    printf("Supported PIDs:");
+    for (int pid = 0x01; pid <= 0xFF; pid++) {
+        if (PIDSupport::isSupported(pid)) printf(" %02X", pid);
+    }
+    printf("\n");
+    uint8_t enabledPIDs = applySupportedPIDs();
+    uint32_t supportVersion = PIDSupport::getVersion();
+    if (enabledPIDs == 0) {
+        printf("None of the scheduled PIDs is supported, nothing to poll\n");
+        return 1;
+    }
+
+    ELMTiming::reset();
+    OBDSession::setResponseCountEnabled(!options.fixedTiming);
+
+    const OBDRequestTotals& totals = OBDSession::getTotals();
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    while (totals.requests < options.requests) {
+        simulator.setEngine(driveCycle(now));
+
+        uint8_t pids[MAX_PIDS_PER_REQUEST];
+        uint8_t count = PIDScheduler::nextBatch(now, pids, OBDSession::isBatchEnabled() ? options.batch : 1);
+        if (count == 0) {
+            unsigned long wait = PIDScheduler::msUntilNextDue(now);
+            waitMs(wait > 0 ? wait : 1);
+            continue;
+        }
+
+        uint32_t sentAt = now;
+        uint8_t answered = OBDSession::requestPIDs(adapterLink, pids, count, PID_TIMEOUT_MS);
+        PIDScheduler::onRequestCompleted(pids, count, answered, now, now - sentAt);
+        drainLog();
+        if (PIDSupport::getVersion() != supportVersion) {
+            // A PID that kept answering NO DATA was left out
+            supportVersion = PIDSupport::getVersion();
+            applySupportedPIDs();
+        }
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    printf("\n%u requests, %u PIDs decoded, %u NO DATA, %u timeouts\n", totals.requests, totals.decodedPIDs, totals.noDataResponses, totals.timeouts);
+    if (realClock) {
+        printf("Polled %s for %.1f s (%.0f requests/s)\n", options.tcpAddress, wallSeconds, totals.requests / wallSeconds);
+    } else {
+        printf("Simulated %.1f s of driving in %.3f s (%.0f requests/s)\n", now / 1000.0, wallSeconds, totals.requests / wallSeconds);
+    }
+    if (!options.fixedTiming) {
+        printf("Timing: ATST%02X ATAT%u, response count %s\n", ELMTiming::getTimeoutSetting(), ELMTiming::getAdaptiveTiming(), OBDSession::isResponseCountEnabled() ? "on" : "off");
+    }
+    printf("Polling load %.2f%s\n", PIDScheduler::getLoadFactor(), PIDScheduler::isOvercommitted() ? " (bus overcommitted)" : "");
+    for (uint8_t i = 0; i < PIDScheduler::getEntryCount(); i++) {
+        const PIDScheduleEntry& entry = PIDScheduler::getEntry(i);
+        const PIDDescriptor* descriptor = PIDTable::find(entry.pid);
+        if (!entry.enabled) {
+            printf("  PID %02X %-17s not supported by the ECU\n", entry.pid, descriptor->name);
+            continue;
+        }
+        char value[PID_VALUE_TEXT_SIZE];
+        PIDTable::formatValue(*descriptor, OBDSession::getLastValue(entry.pid), value, sizeof(value));
+        printf("  PID %02X %-17s %.2f/%.2f Hz (%.0f ms/sample, p50 %u ms, p99 %u ms), last %s %s\n", entry.pid, descriptor->name,
+               entry.achievedHz, entry.targetHz, entry.costMs,
+               ELMTiming::getPercentile(entry.pid, 50), ELMTiming::getPercentile(entry.pid, 99), value, descriptor->unit);
+    }
+
+    float tripFuel = storage.getTripFuelUsed();
+    float distance = storage.getDistanceTraveled();
+    printf("Trip: %.2f km, %.3f L", distance, tripFuel);
+    if (tripFuel > 0) printf(", %.1f km/L", distance / tripFuel);
+    printf("\n");
+
+    TripStatsSnapshot stats;
+    TripStats::snapshot(stats, now);
+    printf("km/L: last 10 s %.1f, 1 min %.1f, 1 h %.1f, trip %.1f (avg %.1f km/h, %u s idle of %u s)\n",
+           stats.windows[STAT_WINDOW_10S].kmPerLiter, stats.windows[STAT_WINDOW_1MIN].kmPerLiter,
+           stats.windows[STAT_WINDOW_1H].kmPerLiter, stats.slots[TRIP_SLOT_TRIP].kmPerLiter,
+           stats.slots[TRIP_SLOT_TRIP].averageSpeedKmh, (unsigned)stats.slots[TRIP_SLOT_TRIP].idleSeconds,
+           (unsigned)stats.slots[TRIP_SLOT_TRIP].drivingSeconds);
+
+    // OBDSession kept the dashboard up to date
+    display.show();
+
+    if (options.stats) {
+        // The /api/stats document
+        char json[TRIP_STATS_JSON_SIZE];
+        size_t length = TripStats::toJSON(stats, json, sizeof(json));
+        printf("\n%s\n(%u bytes)\n", json, (unsigned)length);
+    }
+
+    if (options.metrics) {
+        // Same text the firmware serves on /metrics, minus the system counters
+        printf("\n");
+        MetricsCursor cursor = {};
+        char piece[METRICS_PIECE_SIZE];
+        size_t length;
+        while ((length = OBDMetrics::format(cursor, piece, sizeof(piece))) > 0) {
+            fwrite(piece, 1, length, stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,32 @@
+#ifndef MEMORYTRIPSTORAGE_H
+#define MEMORYTRIPSTORAGE_H
+
+#include <tripstorage.h>
+
+// TripStorage kept in RAM, with the same defaults as PreferencesHandle
+class MemoryTripStorage : public TripStorage {
+public:
+    MemoryTripStorage()
+        : fuelMicroliters(45000000), tankCapacity(45.0), consumptionFactor(0.00000000815), distanceMm(0), tripFuelMicroliters(0) {}
+
+    int64_t getFuelMicroliters() override { return fuelMicroliters; }
+    void setFuelMicroliters(int64_t value) override { fuelMicroliters = value; }
+    void addFuelMicroliters(int64_t delta) override { fuelMicroliters += delta; }
+    float getTankCapacity() override { return tankCapacity; }
+    float getConsumptionFactor() override { return consumptionFactor; }
+    uint64_t getDistanceMm() override { return distanceMm; }
+    void setDistanceMm(uint64_t value) override { distanceMm = value; }
+    void addDistanceMm(uint64_t value) override { distanceMm += value; }
+    uint64_t getTripFuelMicroliters() override { return tripFuelMicroliters; }
+    void setTripFuelMicroliters(uint64_t value) override { tripFuelMicroliters = value; }
+    void addTripFuelMicroliters(uint64_t value) override { tripFuelMicroliters += value; }
+
+private:
+    int64_t fuelMicroliters;
+    float tankCapacity;
+    float consumptionFactor;
+    uint64_t distanceMm;
+    uint64_t tripFuelMicroliters;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef TCPEMULATOR_H
+#define TCPEMULATOR_H
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <chrono>
+#include <elmsimulator.h>
+
+#define TCP_EMULATOR_IDLE_MS 100
+
+typedef ELMSimulatedEngine (*EngineFunction)(uint32_t time);
+
+// WiFi ELM327 for the native TCP transport and for phone apps on this
+// machine: ELMSimulator on the real clock behind a listening socket, one
+// client at a time. The adapter state survives a reconnect like a real one
+// that stays powered by the OBD port. Listens on the loopback interface only.
+class TCPEmulator {
+public:
+    TCPEmulator(ELMSimulator& simulator, EngineFunction engine)
+        : simulator(simulator), engine(engine), listenFd(-1), clientFd(-1),
+          started(std::chrono::steady_clock::now()) {}
+
+    ~TCPEmulator() {
+        if (clientFd >= 0) close(clientFd);
+        if (listenFd >= 0) close(listenFd);
+    }
+
+    bool listen(uint16_t port) {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listenFd < 0) return false;
+        int reuse = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || ::listen(listenFd, 1) != 0) return false;
+        simulator.setReceiver(onSimulatorData, this);
+        return true;
+    }
+
+    // Does not return: accepts a client, serves it until it closes, repeats
+    void serve() {
+        for (;;) {
+            clientFd = accept(listenFd, nullptr, nullptr);
+            if (clientFd < 0) continue;
+            int noDelay = 1;
+            setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            printf("Client connected\n");
+            fflush(stdout);
+            serveClient();
+            close(clientFd);
+            clientFd = -1;
+            printf("Client disconnected, %u PID requests so far\n", (unsigned)simulator.getRequests());
+            fflush(stdout);
+        }
+    }
+
+private:
+    ELMSimulator& simulator;
+    EngineFunction engine;
+    int listenFd;
+    int clientFd;
+    std::chrono::steady_clock::time_point started;
+
+    uint32_t clockMs() const {
+        return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    // Sleeps in select() until the client writes or the pending response is due
+    void serveClient() {
+        for (;;) {
+            uint32_t now = clockMs();
+            simulator.setEngine(engine(now));
+            simulator.advance(now);
+
+            uint32_t waitMs = TCP_EMULATOR_IDLE_MS;
+            if (simulator.isBusy()) {
+                int32_t due = (int32_t)(simulator.getResponseDueAt() - now);
+                waitMs = due > 0 ? (uint32_t)due : 0;
+            }
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(clientFd, &readable);
+            struct timeval timeout = { (time_t)(waitMs / 1000), (suseconds_t)((waitMs % 1000) * 1000) };
+            int ready = select(clientFd + 1, &readable, nullptr, nullptr, &timeout);
+            if (ready < 0) return;
+            if (ready == 0) continue;
+
+            uint8_t data[128];
+            ssize_t received = recv(clientFd, data, sizeof(data), 0);
+            if (received <= 0) return;
+            simulator.advance(clockMs());
+            simulator.write(data, (size_t)received);
+        }
+    }
+
+    static void onSimulatorData(const uint8_t* data, size_t length, void* context) {
+        TCPEmulator* emulator = (TCPEmulator*)context;
+        if (emulator->clientFd >= 0) send(emulator->clientFd, data, length, MSG_NOSIGNAL);
+    }
+};
+
+#endif
@@ -0,0 +1,192 @@
+// ELMParser against captured ELM327 responses, and the allocation count of the
+// decode path: pio test -e native -f test_elmparser
+#include <unity.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <elmparser.h>
+#include <pidtable.h>
+#include "../../lib/datadefinition.h"
+
+// Every heap allocation of the test program is counted (operator new, and
+// malloc itself where glibc lets it be wrapped), the decode path must not add any
+static volatile size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* block = malloc(size);
+    if (block == nullptr) throw std::bad_alloc();
+    return block;
+}
+
+void operator delete(void* block) noexcept {
+    free(block);
+}
+
+#ifdef __GLIBC__
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* block, size_t size);
+
+extern "C" void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* block, size_t size) {
+    allocations++;
+    return __libc_realloc(block, size);
+}
+#endif
+
+struct DecodedPID {
+    uint8_t pid;
+    uint16_t ecu;
+    int32_t value;
+};
+
+struct Decoded {
+    DecodedPID pids[8];
+    uint8_t count;
+};
+
+static Decoded decoded;
+static char buffer[RESPONSE_BUFFER_SIZE];
+
+// Same work as MessageHandle per PID: table lookup and integer conversion
+static void onPID(uint8_t pid, const uint8_t* data, uint16_t ecu, void* context) {
+    Decoded* out = (Decoded*)context;
+    const PIDDescriptor* descriptor = PIDTable::find(pid);
+    if (descriptor == nullptr || out->count >= 8) return;
+    DecodedPID& entry = out->pids[out->count++];
+    entry.pid = pid;
+    entry.ecu = ecu;
+    entry.value = descriptor->slot == PID_SLOT_BITMAP ? 0 : PIDTable::decode(*descriptor, data);
+}
+
+// The parser decodes in place, so every run works on a fresh copy
+static ELMResponse parse(const char* text) {
+    size_t length = strlen(text);
+    memcpy(buffer, text, length);
+    memset(&decoded, 0, sizeof(decoded));
+    return ELMParser::parse(buffer, length, PIDTable::dataLength, onPID, &decoded);
+}
+
+static const char SINGLE[] = "41 0C 1A F8 \r\r>";
+static const char LINES[] = "41 0C 1A F8\r41 0D 32\r41 04 3F\r\r>";
+static const char CAN_MULTI[] = "00A\r0: 41 0C 1A F8 0D 32\r1: 04 3F 05 82 00 00 00\r\r>";
+static const char CAN_HEADERS[] = "7E8 10 0A 41 0C 1A F8 0D 32\r7E8 21 04 3F 05 82 00 00 00\r\r>";
+static const char TWO_ECUS[] = "7E8 06 41 00 BE 3F A8 13\r7E9 06 41 00 98 18 80 01\r\r>";
+static const char SEARCHING[] = "SEARCHING...\r41 0D 32\r\r>";
+static const char NO_DATA[] = "NO DATA\r\r>";
+static const char UNABLE[] = "UNABLE TO CONNECT\r\r>";
+static const char REJECTED[] = "?\r\r>";
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_single_frame(void) {
+    ELMResponse response = parse(SINGLE);
+    TEST_ASSERT_EQUAL_UINT8(0, response.status);
+    TEST_ASSERT_EQUAL_HEX8(0x41, response.mode);
+    TEST_ASSERT_EQUAL_UINT8(1, response.decodedPIDs);
+    TEST_ASSERT_EQUAL_HEX8(0x0C, decoded.pids[0].pid);
+    TEST_ASSERT_EQUAL_INT32(1726, decoded.pids[0].value);
+    TEST_ASSERT_EQUAL_UINT16(ELM_NO_HEADER, decoded.pids[0].ecu);
+}
+
+void test_one_frame_per_line(void) {
+    ELMResponse response = parse(LINES);
+    TEST_ASSERT_EQUAL_UINT8(3, response.decodedPIDs);
+    TEST_ASSERT_EQUAL_INT32(1726, decoded.pids[0].value);
+    TEST_ASSERT_EQUAL_INT32(50, decoded.pids[1].value);
+    TEST_ASSERT_EQUAL_INT32(24, decoded.pids[2].value);
+}
+
+// The byte count trims the padding of the last segment, 05 82 must not become a sixth PID
+void test_can_multi_frame(void) {
+    ELMResponse response = parse(CAN_MULTI);
+    TEST_ASSERT_EQUAL_UINT8(4, response.decodedPIDs);
+    TEST_ASSERT_EQUAL_HEX8(0x0C, decoded.pids[0].pid);
+    TEST_ASSERT_EQUAL_HEX8(0x0D, decoded.pids[1].pid);
+    TEST_ASSERT_EQUAL_HEX8(0x04, decoded.pids[2].pid);
+    TEST_ASSERT_EQUAL_HEX8(0x05, decoded.pids[3].pid);
+    TEST_ASSERT_EQUAL_INT32(90, decoded.pids[3].value);
+}
+
+void test_can_headers_multi_frame(void) {
+    ELMResponse response = parse(CAN_HEADERS);
+    TEST_ASSERT_EQUAL_UINT8(4, response.decodedPIDs);
+    TEST_ASSERT_EQUAL_UINT16(0x7E8, decoded.pids[0].ecu);
+    TEST_ASSERT_EQUAL_INT32(1726, decoded.pids[0].value);
+    TEST_ASSERT_EQUAL_INT32(90, decoded.pids[3].value);
+}
+
+void test_can_headers_two_ecus(void) {
+    ELMResponse response = parse(TWO_ECUS);
+    TEST_ASSERT_EQUAL_UINT8(2, response.decodedPIDs);
+    TEST_ASSERT_EQUAL_UINT16(0x7E8, decoded.pids[0].ecu);
+    TEST_ASSERT_EQUAL_UINT16(0x7E9, decoded.pids[1].ecu);
+}
+
+void test_searching_is_progress_text(void) {
+    ELMResponse response = parse(SEARCHING);
+    TEST_ASSERT_EQUAL_UINT8(0, response.status);
+    TEST_ASSERT_EQUAL_UINT8(1, response.decodedPIDs);
+    TEST_ASSERT_EQUAL_INT32(50, decoded.pids[0].value);
+}
+
+void test_status_lines(void) {
+    TEST_ASSERT_EQUAL_UINT8(ELM_STATUS_NO_DATA, parse(NO_DATA).status);
+    TEST_ASSERT_EQUAL_UINT8(ELM_STATUS_ERROR, parse(UNABLE).status);
+    TEST_ASSERT_EQUAL_UINT8(ELM_STATUS_UNKNOWN_COMMAND, parse(REJECTED).status);
+    TEST_ASSERT_EQUAL_UINT8(0, parse(NO_DATA).decodedPIDs);
+}
+
+// An unknown PID has no length, the walk stops there instead of misreading the rest
+void test_unknown_pid_stops_the_frame(void) {
+    ELMResponse response = parse("41 0C 1A F8 9A 01 02\r\r>");
+    TEST_ASSERT_EQUAL_UINT8(1, response.decodedPIDs);
+}
+
+void test_decode_path_does_not_allocate(void) {
+    static const char* const RESPONSES[] = { SINGLE, LINES, CAN_MULTI, CAN_HEADERS, TWO_ECUS, SEARCHING, NO_DATA, UNABLE, REJECTED };
+    size_t before = allocations;
+    uint32_t frames = 0;
+    for (uint16_t round = 0; round < 100; round++) {
+        for (size_t i = 0; i < sizeof(RESPONSES) / sizeof(RESPONSES[0]); i++) {
+            frames += parse(RESPONSES[i]).decodedPIDs;
+        }
+    }
+    size_t counted = allocations - before;
+    TEST_ASSERT_EQUAL_UINT32(1500, frames);
+    TEST_ASSERT_EQUAL_size_t(0, counted);
+}
+
+// The hook must see allocations, or the test above proves nothing
+void test_allocation_hook_counts(void) {
+    size_t before = allocations;
+    char* volatile block = new char[16];
+    delete[] block;
+    TEST_ASSERT_TRUE(allocations > before);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_allocation_hook_counts);
+    RUN_TEST(test_single_frame);
+    RUN_TEST(test_one_frame_per_line);
+    RUN_TEST(test_can_multi_frame);
+    RUN_TEST(test_can_headers_multi_frame);
+    RUN_TEST(test_can_headers_two_ecus);
+    RUN_TEST(test_searching_is_progress_text);
+    RUN_TEST(test_status_lines);
+    RUN_TEST(test_unknown_pid_stops_the_frame);
+    RUN_TEST(test_decode_path_does_not_allocate);
+    return UNITY_END();
+}
@@ -0,0 +1,171 @@
+// ELMProtocol: ATDPN parsing, ECU selection, the reply filter, the setup
+// commands and the cache: pio test -e native -f test_elmprotocol
+#include <unity.h>
+#include <string.h>
+#include <elmprotocol.h>
+
+static const uint8_t ENGINE_BITMAP[4] = { 0xBE, 0x3F, 0xA8, 0x13 };    // 18 PIDs
+static const uint8_t GEARBOX_BITMAP[4] = { 0x00, 0x08, 0x00, 0x00 };   // 1 PID
+static const uint8_t BODY_BITMAP[4] = { 0x80, 0x00, 0x00, 0x01 };      // 2 PIDs
+
+void setUp(void) {
+    ELMProtocol::reset();
+    ELMProtocol::takeChanged();
+}
+
+void tearDown(void) {}
+
+void test_parse_describe(void) {
+    uint8_t number = 0;
+    TEST_ASSERT_TRUE(ELMProtocol::parseDescribe("A6\r\r>", number));
+    TEST_ASSERT_EQUAL_UINT8(6, number);
+    TEST_ASSERT_TRUE(ELMProtocol::parseDescribe("3\r\r>", number));
+    TEST_ASSERT_EQUAL_UINT8(3, number);
+    // The echoed command is skipped
+    TEST_ASSERT_TRUE(ELMProtocol::parseDescribe("ATDPN\rAC\r\r>", number));
+    TEST_ASSERT_EQUAL_UINT8(0x0C, number);
+
+    // Automatic without a result yet, out of range, garbage
+    number = 0x55;
+    TEST_ASSERT_FALSE(ELMProtocol::parseDescribe("A0\r\r>", number));
+    TEST_ASSERT_FALSE(ELMProtocol::parseDescribe("D\r\r>", number));
+    TEST_ASSERT_FALSE(ELMProtocol::parseDescribe("?\r\r>", number));
+    TEST_ASSERT_FALSE(ELMProtocol::parseDescribe("", number));
+    TEST_ASSERT_EQUAL_UINT8(0x55, number);
+}
+
+void test_protocol_kinds(void) {
+    TEST_ASSERT_FALSE(ELMProtocol::isCAN(3));
+    TEST_ASSERT_TRUE(ELMProtocol::isCAN(6));
+    TEST_ASSERT_TRUE(ELMProtocol::hasShortHeaders(6));
+    TEST_ASSERT_FALSE(ELMProtocol::hasShortHeaders(7));
+    TEST_ASSERT_TRUE(ELMProtocol::hasShortHeaders(8));
+    TEST_ASSERT_EQUAL_STRING("ISO 9141-2", ELMProtocol::getName(3));
+    TEST_ASSERT_EQUAL_STRING("unknown", ELMProtocol::getName(0x0D));
+}
+
+// Until the protocol is confirmed on CAN the probe waits out a search
+void test_probe_timeout(void) {
+    ELMProtocol::setProtocol(6);
+    TEST_ASSERT_EQUAL_UINT32(ELM_PROTOCOL_SEARCH_TIMEOUT_MS, ELMProtocol::probeTimeout(300));
+    ELMProtocol::setConfirmed(true);
+    TEST_ASSERT_EQUAL_UINT32(300, ELMProtocol::probeTimeout(300));
+    ELMProtocol::setProtocol(3);
+    TEST_ASSERT_EQUAL_UINT32(ELM_PROTOCOL_SEARCH_TIMEOUT_MS, ELMProtocol::probeTimeout(300));
+}
+
+// The engine ECU wins even when another one lists more PIDs
+void test_engine_ecu_is_selected(void) {
+    ELMProtocol::setProtocol(6);
+    ELMProtocol::beginDiscovery();
+    ELMProtocol::onResponder(0x7EA, ENGINE_BITMAP);
+    ELMProtocol::onResponder(0x7E9, GEARBOX_BITMAP);
+    ELMProtocol::onResponder(ELM_PROTOCOL_ENGINE_ECU, GEARBOX_BITMAP);
+    ELMProtocol::onResponder(0x7E9, GEARBOX_BITMAP);
+    TEST_ASSERT_EQUAL_UINT8(3, ELMProtocol::getResponderCount());
+    ELMProtocol::takeChanged();
+    TEST_ASSERT_EQUAL_HEX16(ELM_PROTOCOL_ENGINE_ECU, ELMProtocol::selectECU());
+    TEST_ASSERT_TRUE(ELMProtocol::takeChanged());
+
+    // Selecting the same ECU again is no change to save
+    ELMProtocol::selectECU();
+    TEST_ASSERT_FALSE(ELMProtocol::takeChanged());
+}
+
+void test_most_pids_without_engine_ecu(void) {
+    ELMProtocol::setProtocol(6);
+    ELMProtocol::beginDiscovery();
+    ELMProtocol::onResponder(0x7E9, GEARBOX_BITMAP);
+    ELMProtocol::onResponder(0x7EB, BODY_BITMAP);
+    ELMProtocol::onResponder(0x7EA, GEARBOX_BITMAP);
+    TEST_ASSERT_EQUAL_HEX16(0x7EB, ELMProtocol::selectECU());
+
+    // Nobody answered with a header
+    ELMProtocol::beginDiscovery();
+    TEST_ASSERT_EQUAL_HEX16(ELM_NO_HEADER, ELMProtocol::selectECU());
+}
+
+void test_responders_are_limited(void) {
+    ELMProtocol::beginDiscovery();
+    for (uint16_t address = 0x7E8; address < 0x7E8 + ELM_PROTOCOL_MAX_RESPONDERS + 2; address++) {
+        ELMProtocol::onResponder(address, GEARBOX_BITMAP);
+    }
+    TEST_ASSERT_EQUAL_UINT8(ELM_PROTOCOL_MAX_RESPONDERS, ELMProtocol::getResponderCount());
+}
+
+// Before an ECU is selected only headerless values are taken, after it only its own
+void test_accepts_from(void) {
+    TEST_ASSERT_TRUE(ELMProtocol::acceptsFrom(ELM_NO_HEADER));
+    TEST_ASSERT_FALSE(ELMProtocol::acceptsFrom(0x7E8));
+
+    ELMProtocol::setProtocol(6);
+    ELMProtocol::beginDiscovery();
+    ELMProtocol::onResponder(0x7E8, ENGINE_BITMAP);
+    ELMProtocol::selectECU();
+    TEST_ASSERT_TRUE(ELMProtocol::acceptsFrom(0x7E8));
+    TEST_ASSERT_FALSE(ELMProtocol::acceptsFrom(0x7E9));
+    TEST_ASSERT_TRUE(ELMProtocol::acceptsFrom(ELM_NO_HEADER));
+}
+
+void test_setup_commands(void) {
+    char text[16];
+    TEST_ASSERT_EQUAL_size_t(5, ELMProtocol::selectCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATSP0", text);
+    TEST_ASSERT_EQUAL_size_t(0, ELMProtocol::headerCommand(text, sizeof(text)));
+
+    ELMProtocol::setProtocol(6);
+    ELMProtocol::beginDiscovery();
+    ELMProtocol::onResponder(0x7E8, ENGINE_BITMAP);
+    ELMProtocol::selectECU();
+    ELMProtocol::selectCommand(text, sizeof(text));
+    TEST_ASSERT_EQUAL_STRING("ATSPA6", text);
+    TEST_ASSERT_EQUAL_size_t(7, ELMProtocol::headerCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATSH7E0", text);
+    TEST_ASSERT_EQUAL_size_t(8, ELMProtocol::receiveCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATCRA7E8", text);
+
+    // Another protocol is another car, its ECU is not known yet
+    ELMProtocol::setProtocol(7);
+    TEST_ASSERT_EQUAL_HEX16(ELM_NO_HEADER, ELMProtocol::getECU());
+    TEST_ASSERT_EQUAL_size_t(0, ELMProtocol::receiveCommand(text, sizeof(text)));
+}
+
+void test_cache_round_trip(void) {
+    ELMProtocol::setProtocol(6);
+    ELMProtocol::beginDiscovery();
+    ELMProtocol::onResponder(0x7E8, ENGINE_BITMAP);
+    ELMProtocol::selectECU();
+    ELMProtocol::setConfirmed(true);
+
+    uint8_t cache[ELM_PROTOCOL_CACHE_SIZE];
+    TEST_ASSERT_EQUAL_size_t(0, ELMProtocol::save(cache, sizeof(cache) - 1));
+    TEST_ASSERT_EQUAL_size_t(ELM_PROTOCOL_CACHE_SIZE, ELMProtocol::save(cache, sizeof(cache)));
+
+    ELMProtocol::reset();
+    TEST_ASSERT_TRUE(ELMProtocol::restore(cache, sizeof(cache)));
+    TEST_ASSERT_EQUAL_UINT8(6, ELMProtocol::getProtocol());
+    TEST_ASSERT_EQUAL_HEX16(0x7E8, ELMProtocol::getECU());
+    // A restored protocol still has to be read back on the new connection
+    TEST_ASSERT_FALSE(ELMProtocol::isConfirmed());
+    TEST_ASSERT_FALSE(ELMProtocol::takeChanged());
+
+    cache[1] = ELM_PROTOCOL_MAX + 1;
+    TEST_ASSERT_FALSE(ELMProtocol::restore(cache, sizeof(cache)));
+    cache[1] = 6;
+    cache[0] = ELM_PROTOCOL_CACHE_VERSION + 1;
+    TEST_ASSERT_FALSE(ELMProtocol::restore(cache, sizeof(cache)));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_describe);
+    RUN_TEST(test_protocol_kinds);
+    RUN_TEST(test_probe_timeout);
+    RUN_TEST(test_engine_ecu_is_selected);
+    RUN_TEST(test_most_pids_without_engine_ecu);
+    RUN_TEST(test_responders_are_limited);
+    RUN_TEST(test_accepts_from);
+    RUN_TEST(test_setup_commands);
+    RUN_TEST(test_cache_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,206 @@
+// ELMSimulator: AT timing, CAN and K-line answers, SEARCHING..., NO DATA and
+// the response count digit: pio test -e native -f test_elmsimulator
+#include <unity.h>
+#include <string.h>
+#include <elmsimulator.h>
+
+static char received[512];
+static size_t receivedLength;
+static int deliveries;
+
+static void collect(const uint8_t* data, size_t length, void* context) {
+    deliveries++;
+    if (receivedLength + length >= sizeof(received)) return;
+    memcpy(received + receivedLength, data, length);
+    receivedLength += length;
+    received[receivedLength] = '\0';
+}
+
+static ELMSimulatorConfig quietConfig(ELM_SIMULATOR_BUS bus) {
+    ELMSimulatorConfig config;
+    config.latencyMs = 40;
+    config.jitterMs = 0;
+    config.noDataPercent = 0;
+    config.searching = false;
+    config.searchMs = 1500;
+    config.bus = bus;
+    config.chunkSize = 20;
+    config.responseCount = true;
+    config.secondECU = false;
+    return config;
+}
+
+// Sends one command and runs the clock until its response is delivered
+static const char* exchange(ELMSimulator& simulator, const char* command, uint32_t& now) {
+    receivedLength = 0;
+    received[0] = '\0';
+    TEST_ASSERT_TRUE(simulator.write((const uint8_t*)command, strlen(command)));
+    now = simulator.getResponseDueAt();
+    simulator.advance(now);
+    TEST_ASSERT_FALSE(simulator.isBusy());
+    return received;
+}
+
+void setUp(void) {
+    deliveries = 0;
+    receivedLength = 0;
+    received[0] = '\0';
+}
+
+void tearDown(void) {}
+
+void test_at_commands_answer_without_the_car(void) {
+    ELMSimulator simulator;
+    simulator.configure(quietConfig(ELM_SIMULATOR_CAN));
+    simulator.setReceiver(collect, nullptr);
+
+    TEST_ASSERT_TRUE(simulator.write((const uint8_t*)"ATE0\r", 5));
+    TEST_ASSERT_TRUE(simulator.isBusy());
+    TEST_ASSERT_EQUAL_UINT32(ELM_SIMULATOR_AT_MS, simulator.getResponseDueAt());
+    simulator.advance(ELM_SIMULATOR_AT_MS - 1);
+    TEST_ASSERT_EQUAL_size_t(0, receivedLength);
+    simulator.advance(ELM_SIMULATOR_AT_MS);
+    TEST_ASSERT_EQUAL_STRING("ATE0\rOK\r\r>", received);
+
+    uint32_t now = 0;
+    TEST_ASSERT_EQUAL_STRING("?\r\r>", exchange(simulator, "XYZ\r", now));
+}
+
+// A command written before the previous response is out is refused
+void test_write_while_busy_is_refused(void) {
+    ELMSimulator simulator;
+    simulator.configure(quietConfig(ELM_SIMULATOR_CAN));
+    simulator.setReceiver(collect, nullptr);
+
+    TEST_ASSERT_TRUE(simulator.write((const uint8_t*)"010C\r", 5));
+    TEST_ASSERT_FALSE(simulator.write((const uint8_t*)"010D\r", 5));
+    TEST_ASSERT_EQUAL_UINT32(1, simulator.getRequests());
+}
+
+void test_can_answers_a_batch(void) {
+    ELMSimulator simulator;
+    simulator.configure(quietConfig(ELM_SIMULATOR_CAN));
+    simulator.setReceiver(collect, nullptr);
+    ELMSimulatedEngine engine = { 2000, 50, 20, 90, true };
+    simulator.setEngine(engine);
+
+    uint32_t now = 0;
+    exchange(simulator, "ATE0\r", now);
+    // 41 0C 1F 40 0D 32 05 82: 8 bytes, printed as ISO-TP segments
+    TEST_ASSERT_EQUAL_STRING("008\r0: 41 0C 1F 40 0D 32 \r1: 05 82 00 00 00 00 00 \r\r>",
+                             exchange(simulator, "010C0D052\r", now));
+    TEST_ASSERT_EQUAL_STRING("41 0C 1F 40 \r\r>", exchange(simulator, "010C1\r", now));
+}
+
+// ISO 9141 only answers the first PID of a request
+void test_kline_answers_the_first_pid(void) {
+    ELMSimulator simulator;
+    simulator.configure(quietConfig(ELM_SIMULATOR_KLINE));
+    simulator.setReceiver(collect, nullptr);
+    ELMSimulatedEngine engine = { 2000, 50, 20, 90, true };
+    simulator.setEngine(engine);
+
+    uint32_t now = 0;
+    exchange(simulator, "ATE0\r", now);
+    TEST_ASSERT_EQUAL_STRING("41 0C 1F 40 \r\r>", exchange(simulator, "010C0D\r", now));
+}
+
+void test_first_request_searches(void) {
+    ELMSimulatorConfig config = quietConfig(ELM_SIMULATOR_CAN);
+    config.searching = true;
+    ELMSimulator simulator;
+    simulator.configure(config);
+    simulator.setReceiver(collect, nullptr);
+
+    uint32_t now = 0;
+    exchange(simulator, "ATE0\r", now);
+    exchange(simulator, "ATSP0\r", now);
+    uint32_t sentAt = now;
+    TEST_ASSERT_EQUAL_STRING("SEARCHING...\r41 0D 00 \r\r>", exchange(simulator, "010D1\r", now));
+    TEST_ASSERT_TRUE(now - sentAt >= config.searchMs);
+    TEST_ASSERT_EQUAL_STRING("A6\r\r>", exchange(simulator, "ATDPN\r", now));
+    TEST_ASSERT_EQUAL_STRING("41 0D 00 \r\r>", exchange(simulator, "010D1\r", now));
+}
+
+// A fixed protocol the car doesn't speak never connects
+void test_wrong_fixed_protocol_cannot_connect(void) {
+    ELMSimulator simulator;
+    simulator.configure(quietConfig(ELM_SIMULATOR_KLINE));
+    simulator.setReceiver(collect, nullptr);
+
+    uint32_t now = 0;
+    exchange(simulator, "ATE0\r", now);
+    exchange(simulator, "ATSP6\r", now);
+    TEST_ASSERT_EQUAL_STRING("UNABLE TO CONNECT\r\r>", exchange(simulator, "010C\r", now));
+}
+
+void test_asleep_engine_is_no_data(void) {
+    ELMSimulator simulator;
+    simulator.configure(quietConfig(ELM_SIMULATOR_CAN));
+    simulator.setReceiver(collect, nullptr);
+    ELMSimulatedEngine engine = { 0, 0, 0, 20, false };
+    simulator.setEngine(engine);
+
+    uint32_t now = 0;
+    exchange(simulator, "ATE0\r", now);
+    uint32_t sentAt = now;
+    TEST_ASSERT_EQUAL_STRING("NO DATA\r\r>", exchange(simulator, "010C\r", now));
+    // The adapter listened for the whole timeout before giving up
+    TEST_ASSERT_TRUE(now - sentAt >= simulator.getListenTimeout());
+    TEST_ASSERT_EQUAL_UINT32(1, simulator.getNoDataResponses());
+}
+
+void test_no_data_percent(void) {
+    ELMSimulatorConfig config = quietConfig(ELM_SIMULATOR_CAN);
+    config.noDataPercent = 100;
+    ELMSimulator simulator;
+    simulator.configure(config);
+    simulator.setReceiver(collect, nullptr);
+
+    uint32_t now = 0;
+    for (int i = 0; i < 10; i++) {
+        TEST_ASSERT_NOT_NULL(strstr(exchange(simulator, "010C1\r", now), "NO DATA"));
+    }
+    TEST_ASSERT_EQUAL_UINT32(10, simulator.getRequests());
+    TEST_ASSERT_EQUAL_UINT32(10, simulator.getNoDataResponses());
+}
+
+// Clones without the response count digit answer '?'
+void test_response_count_unsupported(void) {
+    ELMSimulatorConfig config = quietConfig(ELM_SIMULATOR_CAN);
+    config.responseCount = false;
+    ELMSimulator simulator;
+    simulator.configure(config);
+    simulator.setReceiver(collect, nullptr);
+
+    uint32_t now = 0;
+    exchange(simulator, "ATE0\r", now);
+    TEST_ASSERT_EQUAL_STRING("?\r\r>", exchange(simulator, "010C1\r", now));
+}
+
+void test_response_is_delivered_in_chunks(void) {
+    ELMSimulatorConfig config = quietConfig(ELM_SIMULATOR_CAN);
+    config.chunkSize = 3;
+    ELMSimulator simulator;
+    simulator.configure(config);
+    simulator.setReceiver(collect, nullptr);
+
+    uint32_t now = 0;
+    TEST_ASSERT_EQUAL_STRING("ATE0\rOK\r\r>", exchange(simulator, "ATE0\r", now));
+    TEST_ASSERT_EQUAL_INT(4, deliveries);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_at_commands_answer_without_the_car);
+    RUN_TEST(test_write_while_busy_is_refused);
+    RUN_TEST(test_can_answers_a_batch);
+    RUN_TEST(test_kline_answers_the_first_pid);
+    RUN_TEST(test_first_request_searches);
+    RUN_TEST(test_wrong_fixed_protocol_cannot_connect);
+    RUN_TEST(test_asleep_engine_is_no_data);
+    RUN_TEST(test_no_data_percent);
+    RUN_TEST(test_response_count_unsupported);
+    RUN_TEST(test_response_is_delivered_in_chunks);
+    return UNITY_END();
+}
@@ -0,0 +1,132 @@
+// ELMTiming: the per-request timeout from the p99 and its bounds, and the
+// ATST/ATAT steps taken every ELM_TIMING_RETUNE_SAMPLES round trips:
+// pio test -e native -f test_elmtiming
+#include <unity.h>
+#include <elmtiming.h>
+
+static const uint8_t RPM[1] = { 0x0C };
+static const uint8_t SPEED[1] = { 0x0D };
+
+static void replies(const uint8_t* pid, int count, uint32_t elapsedMs) {
+    for (int i = 0; i < count; i++) ELMTiming::recordReply(pid, 1, elapsedMs);
+}
+
+void setUp(void) {
+    ELMTiming::clear();
+}
+
+void tearDown(void) {}
+
+// Too few round trips to trust a p99: the caller's timeout stands
+void test_fallback_below_min_samples(void) {
+    replies(RPM, ELM_TIMING_MIN_SAMPLES - 1, 100);
+    TEST_ASSERT_EQUAL_UINT32(1000, ELMTiming::timeoutFor(RPM, 1, 1000));
+    replies(RPM, 1, 100);
+    TEST_ASSERT_TRUE(ELMTiming::timeoutFor(RPM, 1, 1000) < 1000);
+
+    // One PID of the batch not known yet is enough to fall back
+    const uint8_t batch[2] = { 0x0C, 0x0D };
+    TEST_ASSERT_EQUAL_UINT32(1000, ELMTiming::timeoutFor(batch, 2, 1000));
+}
+
+// 1.5 x p99 + 50 would be 200 ms, but the adapter listens ATST32 = 204 ms first
+void test_atst_floor(void) {
+    replies(RPM, ELM_TIMING_MIN_SAMPLES, 100);
+    TEST_ASSERT_EQUAL_UINT16(100, ELMTiming::getPercentile(0x0C, 99));
+    TEST_ASSERT_EQUAL_UINT32(ELM_TIMING_DEFAULT_ST * 4096UL / 1000 + 50, ELMTiming::timeoutFor(RPM, 1, 1000));
+}
+
+// A slow ECU is never given more than the fixed timeout, the slowest PID of a batch counts
+void test_fallback_ceiling(void) {
+    replies(RPM, ELM_TIMING_MIN_SAMPLES, 300);
+    replies(SPEED, ELM_TIMING_MIN_SAMPLES, 900);
+    TEST_ASSERT_EQUAL_UINT32(300 + 150 + 50, ELMTiming::timeoutFor(RPM, 1, 1000));
+    const uint8_t batch[2] = { 0x0C, 0x0D };
+    TEST_ASSERT_EQUAL_UINT32(1000, ELMTiming::timeoutFor(batch, 2, 1000));
+}
+
+// Quick replies shorten ATST to twice the p99, misses near the end of the
+// window grow it again and the shorter value becomes the floor
+void test_atst_shrinks_and_grows(void) {
+    char text[8];
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES - 1, 20);
+    TEST_ASSERT_FALSE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    replies(RPM, 1, 20);
+    TEST_ASSERT_TRUE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATST0A", text);                   // 40 ms in 4.096 ms units
+    TEST_ASSERT_EQUAL_UINT8(0x0A, ELMTiming::getTimeoutSetting());
+
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES - 4, 35);
+    for (int i = 0; i < 4; i++) ELMTiming::recordMiss(RPM, 1, 40, true);
+    TEST_ASSERT_TRUE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATST10", text);
+    TEST_ASSERT_EQUAL_UINT8(0x10, ELMTiming::getTimeoutSetting());
+
+    // The same quick replies again: ATST stays at the floor the misses set,
+    // the steady ECU gets the aggressive adaptive timing instead
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES, 20);
+    TEST_ASSERT_TRUE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATAT2", text);
+    TEST_ASSERT_EQUAL_UINT8(0x10, ELMTiming::getTimeoutSetting());
+}
+
+// A steady ECU gets ATAT2 once; misses take it back to ATAT1 for the rest of
+// the connection
+void test_atat2_only_once(void) {
+    char text[8];
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES, 100);              // ATST32 already fits 2 x 100 ms
+    TEST_ASSERT_TRUE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATAT2", text);
+    TEST_ASSERT_EQUAL_UINT8(2, ELMTiming::getAdaptiveTiming());
+
+    // 4 of 64 is 6 %, over ELM_TIMING_MISS_PERCENT
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES - 4, 100);
+    for (int i = 0; i < 4; i++) ELMTiming::recordMiss(RPM, 1, 0, false);
+    TEST_ASSERT_TRUE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATAT1", text);
+    TEST_ASSERT_EQUAL_UINT8(1, ELMTiming::getAdaptiveTiming());
+
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES, 100);
+    TEST_ASSERT_FALSE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_UINT8(1, ELMTiming::getAdaptiveTiming());
+
+    // A new connection may try it again
+    ELMTiming::reset();
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES, 100);
+    TEST_ASSERT_TRUE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATAT2", text);
+}
+
+// 5 % is still tolerated, NO DATA far from the end of the window changes nothing
+void test_misses_at_the_limit(void) {
+    char text[8];
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES, 100);
+    TEST_ASSERT_TRUE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATAT2", text);
+
+    replies(RPM, 76, 100);
+    for (int i = 0; i < 4; i++) ELMTiming::recordMiss(RPM, 1, 0, false);
+    TEST_ASSERT_FALSE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_UINT8(2, ELMTiming::getAdaptiveTiming());
+
+    // Back at ATAT1 the misses are the ECU's own NO DATA, waiting longer won't help
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES - 8, 100);
+    for (int i = 0; i < 8; i++) ELMTiming::recordMiss(RPM, 1, 0, false);
+    TEST_ASSERT_TRUE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("ATAT1", text);
+    replies(RPM, ELM_TIMING_RETUNE_SAMPLES - 8, 100);
+    for (int i = 0; i < 8; i++) ELMTiming::recordMiss(RPM, 1, 0, false);
+    TEST_ASSERT_FALSE(ELMTiming::nextTuningCommand(text, sizeof(text)));
+    TEST_ASSERT_EQUAL_UINT8(ELM_TIMING_DEFAULT_ST, ELMTiming::getTimeoutSetting());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fallback_below_min_samples);
+    RUN_TEST(test_atst_floor);
+    RUN_TEST(test_fallback_ceiling);
+    RUN_TEST(test_atst_shrinks_and_grows);
+    RUN_TEST(test_atat2_only_once);
+    RUN_TEST(test_misses_at_the_limit);
+    return UNITY_END();
+}
@@ -0,0 +1,158 @@
+// LogRing: level filtering, the line format, a full ring dropping records and
+// several producer threads against the drain: pio test -e native -f test_logring
+#include <unity.h>
+#include <string.h>
+#include <stdio.h>
+#include <thread>
+#include <logring.h>
+
+static uint32_t fakeNow;
+
+static uint32_t fakeClock() {
+    return fakeNow;
+}
+
+void setUp(void) {
+    LogRecord record;
+    while (LogRing::read(record)) {}
+    LogRing::setClock(fakeClock);
+    LogRing::setLevel(LOG_LEVEL_VERBOSE);
+    fakeNow = 0;
+}
+
+void tearDown(void) {}
+
+void test_records_come_out_in_order(void) {
+    fakeNow = 12345;
+    LOG_I("OBDHandle", "Sending: %s", "010C1");
+    fakeNow = 12400;
+    LOG_E("BLE", "lost %d", 3);
+
+    LogRecord record;
+    TEST_ASSERT_TRUE(LogRing::read(record));
+    TEST_ASSERT_EQUAL_UINT32(12345, record.timestampMs);
+    TEST_ASSERT_EQUAL_UINT8(LOG_LEVEL_INFO, record.level);
+    TEST_ASSERT_EQUAL_STRING("OBDHandle", record.tag);
+    TEST_ASSERT_EQUAL_STRING("Sending: 010C1", record.text);
+
+    char line[LOG_LINE_SIZE];
+    size_t length = LogRing::formatLine(record, line, sizeof(line));
+    TEST_ASSERT_EQUAL_STRING("[  12.345] I OBDHandle: Sending: 010C1\n", line);
+    TEST_ASSERT_EQUAL_size_t(strlen(line), length);
+
+    TEST_ASSERT_TRUE(LogRing::read(record));
+    TEST_ASSERT_EQUAL_STRING("lost 3", record.text);
+    TEST_ASSERT_EQUAL_STRING("E", LogRing::levelName(record.level));
+    TEST_ASSERT_FALSE(LogRing::read(record));
+}
+
+// The runtime level filters, levels above LOG_LEVEL are not even compiled in
+void test_level_filtering(void) {
+    LogRing::setLevel(LOG_LEVEL_WARN);
+    LOG_I("test", "filtered");
+    LOG_W("test", "kept");
+    LogRing::setLevel(LOG_LEVEL_VERBOSE);
+#if LOG_LEVEL < LOG_LEVEL_DEBUG
+    LOG_D("test", "compiled out");
+#endif
+
+    LogRecord record;
+    TEST_ASSERT_TRUE(LogRing::read(record));
+    TEST_ASSERT_EQUAL_STRING("kept", record.text);
+    TEST_ASSERT_FALSE(LogRing::read(record));
+    TEST_ASSERT_EQUAL_STRING("?", LogRing::levelName(LOG_LEVEL_VERBOSE + 1));
+}
+
+// A full ring drops the newest records and counts them, the older ones stay
+void test_full_ring_drops_new_records(void) {
+    uint32_t dropped = LogRing::getDropped();
+    for (int i = 0; i < LOG_RING_RECORDS + 3; i++) {
+        LogRing::write(LOG_LEVEL_INFO, "test", "%d", i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(dropped + 3, LogRing::getDropped());
+
+    LogRecord record;
+    char expected[8];
+    for (int i = 0; i < LOG_RING_RECORDS; i++) {
+        TEST_ASSERT_TRUE(LogRing::read(record));
+        snprintf(expected, sizeof(expected), "%d", i);
+        TEST_ASSERT_EQUAL_STRING(expected, record.text);
+    }
+    TEST_ASSERT_FALSE(LogRing::read(record));
+
+    LogRing::write(LOG_LEVEL_INFO, "test", "again");
+    TEST_ASSERT_TRUE(LogRing::read(record));
+    TEST_ASSERT_EQUAL_STRING("again", record.text);
+}
+
+void test_long_text_is_cut(void) {
+    char text[LOG_MESSAGE_SIZE * 2];
+    memset(text, 'x', sizeof(text) - 1);
+    text[sizeof(text) - 1] = '\0';
+    LogRing::write(LOG_LEVEL_INFO, "test", "%s", text);
+
+    LogRecord record;
+    TEST_ASSERT_TRUE(LogRing::read(record));
+    TEST_ASSERT_EQUAL_size_t(LOG_MESSAGE_SIZE - 1, strlen(record.text));
+
+    // A short line buffer is cut and terminated too
+    char line[16];
+    TEST_ASSERT_EQUAL_size_t(sizeof(line) - 1, LogRing::formatLine(record, line, sizeof(line)));
+    TEST_ASSERT_EQUAL_size_t(sizeof(line) - 1, strlen(line));
+}
+
+// Producers race for slots while the drain runs: every record is read whole
+// or counted as dropped, and each producer's records keep their order
+void test_producer_threads(void) {
+    const int PRODUCERS = 4;
+    const int RECORDS = 20000;
+    uint32_t droppedBefore = LogRing::getDropped();
+    int read = 0;
+    int last[PRODUCERS];
+    for (int p = 0; p < PRODUCERS; p++) last[p] = -1;
+    bool ordered = true;
+    bool whole = true;
+
+    std::thread producers[PRODUCERS];
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers[p] = std::thread([p, RECORDS]() {
+            for (int i = 0; i < RECORDS; i++) LogRing::write(LOG_LEVEL_INFO, "test", "%d %d %d", p, i, p ^ i);
+        });
+    }
+    std::atomic<bool> done(false);
+    std::thread joiner([&]() {
+        for (int p = 0; p < PRODUCERS; p++) producers[p].join();
+        done.store(true);
+    });
+
+    LogRecord record;
+    while (true) {
+        bool finished = done.load();
+        while (LogRing::read(record)) {
+            int p, i, check;
+            if (sscanf(record.text, "%d %d %d", &p, &i, &check) != 3 || p < 0 || p >= PRODUCERS || check != (p ^ i)) {
+                whole = false;
+                continue;
+            }
+            if (i <= last[p]) ordered = false;
+            last[p] = i;
+            read++;
+        }
+        if (finished) break;
+    }
+    joiner.join();
+
+    TEST_ASSERT_TRUE(whole);
+    TEST_ASSERT_TRUE(ordered);
+    TEST_ASSERT_EQUAL_UINT32(PRODUCERS * RECORDS, read + LogRing::getDropped() - droppedBefore);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_records_come_out_in_order);
+    RUN_TEST(test_level_filtering);
+    RUN_TEST(test_full_ring_drops_new_records);
+    RUN_TEST(test_long_text_is_cut);
+    RUN_TEST(test_producer_threads);
+    return UNITY_END();
+}
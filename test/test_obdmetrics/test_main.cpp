@@ -0,0 +1,147 @@
+// OBDMetrics: histogram buckets, result counts, round trip quantiles and the
+// paged Prometheus text: pio test -e native -f test_obdmetrics
+#include <unity.h>
+#include <string.h>
+#include <elmparser.h>
+#include <obdmetrics.h>
+
+// The metrics are static and shared by every test, each one uses its own PIDs
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_register_is_idempotent(void) {
+    TEST_ASSERT_TRUE(OBDMetrics::registerPID(0x04));
+    TEST_ASSERT_TRUE(OBDMetrics::registerPID(0x04));
+    TEST_ASSERT_NOT_NULL(OBDMetrics::getPID(0x04));
+    TEST_ASSERT_EQUAL_HEX8(0x04, OBDMetrics::getPID(0x04)->pid);
+    TEST_ASSERT_NULL(OBDMetrics::getPID(0x5E));
+
+    // Requests for a PID never registered are not counted anywhere
+    const uint8_t pid = 0x5E;
+    OBDMetrics::recordRequest(&pid, 1, 40, OBD_RESULT_OK);
+    OBDMetrics::recordSample(pid);
+    TEST_ASSERT_NULL(OBDMetrics::getPID(0x5E));
+}
+
+// Bucket i counts latencies up to its bound and above the previous one, slower
+// requests only show in the count; timeouts stay out of the histogram
+void test_latency_buckets(void) {
+    const uint8_t pid = 0x05;
+    OBDMetrics::registerPID(pid);
+    OBDMetrics::recordRequest(&pid, 1, 25, OBD_RESULT_OK);
+    OBDMetrics::recordRequest(&pid, 1, 26, OBD_RESULT_OK);
+    OBDMetrics::recordRequest(&pid, 1, 2500, OBD_RESULT_NO_DATA);
+    OBDMetrics::recordRequest(&pid, 1, 3000, OBD_RESULT_TIMEOUT);
+
+    const PIDMetrics* metrics = OBDMetrics::getPID(pid);
+    TEST_ASSERT_EQUAL_UINT32(1, metrics->latencyBuckets[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, metrics->latencyBuckets[1]);
+    uint32_t bucketed = 0;
+    for (uint8_t i = 0; i < METRICS_LATENCY_BUCKETS; i++) bucketed += metrics->latencyBuckets[i];
+    TEST_ASSERT_EQUAL_UINT32(2, bucketed);
+    TEST_ASSERT_EQUAL_UINT32(3, metrics->latencyCount);
+    TEST_ASSERT_EQUAL_UINT32(25 + 26 + 2500, metrics->latencySumMs);
+    TEST_ASSERT_EQUAL_UINT32(2, metrics->results[OBD_RESULT_OK]);
+    TEST_ASSERT_EQUAL_UINT32(1, metrics->results[OBD_RESULT_NO_DATA]);
+    TEST_ASSERT_EQUAL_UINT32(1, metrics->results[OBD_RESULT_TIMEOUT]);
+}
+
+// A batch counts once for each of its PIDs, samples only for the decoded ones
+void test_batch_counts_each_pid(void) {
+    const uint8_t batch[] = { 0x0C, 0x0D, 0x10 };
+    for (uint8_t i = 0; i < 3; i++) OBDMetrics::registerPID(batch[i]);
+    OBDMetrics::recordRequest(batch, 3, 80, OBD_RESULT_OK);
+    OBDMetrics::recordSample(0x0C);
+    OBDMetrics::recordSample(0x0D);
+
+    for (uint8_t i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_UINT32(1, OBDMetrics::getPID(batch[i])->results[OBD_RESULT_OK]);
+        TEST_ASSERT_EQUAL_UINT32(1, OBDMetrics::getPID(batch[i])->latencyBuckets[3]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(1, OBDMetrics::getPID(0x0C)->samples);
+    TEST_ASSERT_EQUAL_UINT32(0, OBDMetrics::getPID(0x10)->samples);
+}
+
+void test_classify(void) {
+    TEST_ASSERT_EQUAL_INT(OBD_RESULT_TIMEOUT, OBDMetrics::classify(false, 0, 0));
+    TEST_ASSERT_EQUAL_INT(OBD_RESULT_OK, OBDMetrics::classify(true, 0, 2));
+    // A decoded value wins over a status line from another ECU
+    TEST_ASSERT_EQUAL_INT(OBD_RESULT_OK, OBDMetrics::classify(true, ELM_STATUS_NO_DATA, 1));
+    TEST_ASSERT_EQUAL_INT(OBD_RESULT_NO_DATA, OBDMetrics::classify(true, ELM_STATUS_NO_DATA, 0));
+    TEST_ASSERT_EQUAL_INT(OBD_RESULT_ERROR, OBDMetrics::classify(true, ELM_STATUS_ERROR, 0));
+    TEST_ASSERT_EQUAL_INT(OBD_RESULT_ERROR, OBDMetrics::classify(true, 0, 0));
+}
+
+void test_commands(void) {
+    uint32_t ok = OBDMetrics::getCommands().results[OBD_RESULT_OK];
+    uint32_t timeouts = OBDMetrics::getCommands().results[OBD_RESULT_TIMEOUT];
+    uint32_t count = OBDMetrics::getCommands().latencyCount;
+    OBDMetrics::recordCommand(10, true);
+    OBDMetrics::recordCommand(5000, false);
+    TEST_ASSERT_EQUAL_UINT32(ok + 1, OBDMetrics::getCommands().results[OBD_RESULT_OK]);
+    TEST_ASSERT_EQUAL_UINT32(timeouts + 1, OBDMetrics::getCommands().results[OBD_RESULT_TIMEOUT]);
+    TEST_ASSERT_EQUAL_UINT32(count + 1, OBDMetrics::getCommands().latencyCount);
+}
+
+// Nearest-rank quantiles of the unsorted samples
+void test_transport_round_trip(void) {
+    const uint32_t samples[] = { 500, 100, 400, 1000, 200, 900, 300, 800, 700, 600 };
+    OBDMetrics::recordTransportProbe("ble", samples, 10);
+    const TransportRoundTrip& roundTrip = OBDMetrics::getTransportRoundTrip();
+    TEST_ASSERT_EQUAL_STRING("ble", roundTrip.transport);
+    TEST_ASSERT_EQUAL_UINT8(10, roundTrip.samples);
+    TEST_ASSERT_EQUAL_UINT32(100, roundTrip.minUs);
+    TEST_ASSERT_EQUAL_UINT32(500, roundTrip.medianUs);
+    TEST_ASSERT_EQUAL_UINT32(900, roundTrip.p90Us);
+    TEST_ASSERT_EQUAL_UINT32(1000, roundTrip.maxUs);
+    TEST_ASSERT_EQUAL_UINT32(5500, roundTrip.sumUs);
+}
+
+// Every piece fits METRICS_PIECE_SIZE, and the pieces together are the exposition
+void test_format_pages_the_exposition(void) {
+    const uint8_t pid = 0x0B;
+    OBDMetrics::registerPID(pid);
+    OBDMetrics::recordRequest(&pid, 1, 45, OBD_RESULT_OK);
+
+    static char text[32768];
+    size_t textLength = 0;
+    char piece[METRICS_PIECE_SIZE];
+    MetricsCursor cursor = {};
+    size_t length;
+    while ((length = OBDMetrics::format(cursor, piece, sizeof(piece))) > 0) {
+        TEST_ASSERT_TRUE(length < sizeof(piece) - 1);
+        TEST_ASSERT_TRUE(textLength + length < sizeof(text));
+        memcpy(text + textLength, piece, length);
+        textLength += length;
+    }
+    text[textLength] = '\0';
+
+    TEST_ASSERT_NOT_NULL(strstr(text, "# TYPE obd_pid_request_duration_seconds histogram\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "obd_pid_request_duration_seconds_bucket{pid=\"0B\",le=\"0.025\"} 0\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "obd_pid_request_duration_seconds_bucket{pid=\"0B\",le=\"0.050\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "obd_pid_request_duration_seconds_bucket{pid=\"0B\",le=\"+Inf\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "obd_pid_request_duration_seconds_sum{pid=\"0B\"} 0.045\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "obd_pid_requests_total{pid=\"0B\",result=\"ok\"} 1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "obd_transport_rtt_seconds{transport=\"ble\",quantile=\"0.5\"} 0.000500\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "obd_polling_load "));
+    // One header per family
+    const char* first = strstr(text, "# HELP obd_pid_samples_total");
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NULL(strstr(first + 1, "# HELP obd_pid_samples_total"));
+
+    // A finished cursor stays finished
+    TEST_ASSERT_EQUAL_size_t(0, OBDMetrics::format(cursor, piece, sizeof(piece)));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_register_is_idempotent);
+    RUN_TEST(test_latency_buckets);
+    RUN_TEST(test_batch_counts_each_pid);
+    RUN_TEST(test_classify);
+    RUN_TEST(test_commands);
+    RUN_TEST(test_transport_round_trip);
+    RUN_TEST(test_format_pages_the_exposition);
+    return UNITY_END();
+}
@@ -0,0 +1,196 @@
+// OBDSession against ELMSimulator: protocol and ECU selection, batch and
+// response count fallbacks: pio test -e native -f test_obdsession
+#include <unity.h>
+#include <string.h>
+#include <obdsession.h>
+#include <elmsimulator.h>
+#include <elmprotocol.h>
+#include <elmtiming.h>
+#include <pidsupport.h>
+#include <tripstats.h>
+
+static ELMSimulator simulator;
+static char responseBuffer[RESPONSE_BUFFER_SIZE];
+static size_t responseLength;
+static bool responseComplete;
+static char sent[512];          // every command, '\r' separated
+static size_t sentLength;
+
+static void collect(const uint8_t* data, size_t length, void* context) {
+    if (responseLength + length > sizeof(responseBuffer)) length = sizeof(responseBuffer) - responseLength;
+    memcpy(responseBuffer + responseLength, data, length);
+    responseLength += length;
+    responseComplete = memchr(responseBuffer, '>', responseLength) != nullptr;
+}
+
+// The native runner's link on the simulated clock
+class SimulatorLink : public OBDLink {
+public:
+    uint32_t clock = 0;
+
+    bool exchange(const char* text, uint32_t timeoutMs, char* reply, size_t size) override {
+        size_t length = strlen(text);
+        if (sentLength + length < sizeof(sent)) {
+            memcpy(sent + sentLength, text, length + 1);
+            sentLength += length;
+        }
+        responseLength = 0;
+        responseComplete = false;
+        simulator.advance(clock);
+        if (!simulator.write((const uint8_t*)text, length)) return false;
+        uint32_t elapsed = simulator.getResponseDueAt() - clock;
+        clock = simulator.getResponseDueAt();
+        simulator.advance(clock);
+        if (elapsed > timeoutMs || !responseComplete) return false;
+
+        if (text[0] != 'A' || text[1] != 'T') {
+            OBDSession::decodeResponse(responseBuffer, responseLength, clock);
+        } else if (reply != nullptr && size > 0) {
+            size_t copied = responseLength < size ? responseLength : size - 1;
+            memcpy(reply, responseBuffer, copied);
+            reply[copied] = '\0';
+        }
+        return true;
+    }
+
+    uint32_t now() override {
+        return clock;
+    }
+};
+
+static SimulatorLink simulatorLink;
+
+static void startSimulator(ELM_SIMULATOR_BUS bus, bool secondECU, bool responseCount) {
+    ELMSimulatorConfig config;
+    config.latencyMs = 40;
+    config.jitterMs = 0;
+    config.noDataPercent = 0;
+    config.searching = true;
+    config.searchMs = 1500;
+    config.bus = bus;
+    config.chunkSize = 20;
+    config.responseCount = responseCount;
+    config.secondECU = secondECU;
+    simulator = ELMSimulator();
+    simulator.configure(config);
+    simulator.setReceiver(collect, nullptr);
+    ELMSimulatedEngine engine = { 2400, 90, 35, 85, true };
+    simulator.setEngine(engine);
+}
+
+// What an earlier connection saved: protocol 6, polling 7E8
+static void restoreCANCache() {
+    uint8_t cache[ELM_PROTOCOL_CACHE_SIZE] = { ELM_PROTOCOL_CACHE_VERSION, 6, 0x07, 0xE8 };
+    TEST_ASSERT_TRUE(ELMProtocol::restore(cache, sizeof(cache)));
+}
+
+// Starter commands, wake-up probe, ATDPN and the bitmaps, as on a connection
+static void connect() {
+    OBDSession::sendStarterCommands(simulatorLink);
+    TEST_ASSERT_TRUE(OBDSession::probeECU(simulatorLink));
+    OBDSession::detectProtocol(simulatorLink);
+    OBDSession::discoverSupportedPIDs(simulatorLink);
+}
+
+void setUp(void) {
+    simulatorLink.clock = 0;
+    sentLength = 0;
+    sent[0] = '\0';
+    ELMProtocol::reset();
+    PIDSupport::reset();
+    ELMTiming::clear();
+    OBDSession::begin(nullptr, nullptr);
+    OBDSession::setBatchEnabled(true);
+    OBDSession::setResponseCountEnabled(true);
+    OBDSession::setTimingEnabled(true);
+}
+
+void tearDown(void) {}
+
+// The adapter moved to a K-line car: no CAN header may go out before ATDPN
+// says which protocol the search found
+void test_cached_can_car_is_kline(void) {
+    startSimulator(ELM_SIMULATOR_KLINE, false, true);
+    restoreCANCache();
+    connect();
+
+    TEST_ASSERT_EQUAL_UINT8(3, ELMProtocol::getProtocol());
+    TEST_ASSERT_EQUAL_UINT16(ELM_NO_HEADER, ELMProtocol::getECU());
+    TEST_ASSERT_TRUE(ELMProtocol::isConfirmed());
+    TEST_ASSERT_NULL(strstr(sent, "ATSH7E0"));
+    TEST_ASSERT_NULL(strstr(sent, "ATCRA7E8"));
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(RPM_MUX));
+
+    static const uint8_t rpm = RPM_MUX;
+    TEST_ASSERT_EQUAL_UINT8(1, OBDSession::requestPIDs(simulatorLink, &rpm, 1, PID_COMMAND_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL_INT32(2400, OBDSession::getLastValue(RPM_MUX));
+}
+
+// Same car again: the cached ECU's filter goes on once ATDPN confirmed CAN
+void test_cached_can_car_gets_the_filter_after_atdpn(void) {
+    startSimulator(ELM_SIMULATOR_CAN, true, true);
+    restoreCANCache();
+    connect();
+
+    TEST_ASSERT_EQUAL_UINT8(6, ELMProtocol::getProtocol());
+    TEST_ASSERT_EQUAL_UINT16(0x7E8, ELMProtocol::getECU());
+    const char* describe = strstr(sent, "ATDPN");
+    const char* header = strstr(sent, "ATSH7E0");
+    TEST_ASSERT_NOT_NULL(describe);
+    TEST_ASSERT_NOT_NULL(header);
+    TEST_ASSERT_TRUE(header > describe);
+    TEST_ASSERT_NOT_NULL(strstr(header, "ATCRA7E8"));
+}
+
+// Unknown car with two ECUs: the one with the most PIDs is picked and polled alone
+void test_search_selects_the_engine_ecu(void) {
+    startSimulator(ELM_SIMULATOR_CAN, true, true);
+    connect();
+
+    TEST_ASSERT_EQUAL_UINT8(6, ELMProtocol::getProtocol());
+    TEST_ASSERT_EQUAL_UINT8(2, ELMProtocol::getResponderCount());
+    TEST_ASSERT_EQUAL_UINT16(0x7E8, ELMProtocol::getECU());
+
+    static const uint8_t speed = SPEED_MUX;
+    TEST_ASSERT_EQUAL_UINT8(1, OBDSession::requestPIDs(simulatorLink, &speed, 1, PID_COMMAND_TIMEOUT_MS));
+    TEST_ASSERT_EQUAL_UINT8(1, OBDSession::getDecodedPIDCount());
+}
+
+// K-line answers the first PID of a batch only: the rest go alone, batching ends
+void test_kline_batch_falls_back_to_single_pids(void) {
+    startSimulator(ELM_SIMULATOR_KLINE, false, true);
+    connect();
+
+    static const uint8_t pids[] = { RPM_MUX, SPEED_MUX, ENGINE_LOAD_MUX };
+    TEST_ASSERT_EQUAL_UINT8(0x07, OBDSession::requestPIDs(simulatorLink, pids, 3, PID_COMMAND_TIMEOUT_MS));
+    TEST_ASSERT_FALSE(OBDSession::isBatchEnabled());
+    TEST_ASSERT_EQUAL_INT32(90, OBDSession::getLastValue(SPEED_MUX));
+}
+
+// '?' to "010C1": the digit is dropped and the request answered without it
+void test_response_count_is_dropped_when_rejected(void) {
+    startSimulator(ELM_SIMULATOR_CAN, false, false);
+    connect();
+
+    static const uint8_t rpm = RPM_MUX;
+    OBDRequestTotals before = OBDSession::getTotals();
+    TEST_ASSERT_EQUAL_UINT8(1, OBDSession::requestPIDs(simulatorLink, &rpm, 1, PID_COMMAND_TIMEOUT_MS));
+    TEST_ASSERT_FALSE(OBDSession::isResponseCountEnabled());
+    TEST_ASSERT_EQUAL_UINT32(before.requests + 1, OBDSession::getTotals().requests);
+    TEST_ASSERT_EQUAL_UINT32(before.decodedPIDs + 1, OBDSession::getTotals().decodedPIDs);
+
+    char text[MAX_COMMAND_LENGTH];
+    OBDSession::buildPIDCommand(text, &rpm, 1);
+    TEST_ASSERT_EQUAL_STRING("010C\r", text);
+}
+
+int main(int argc, char** argv) {
+    TripStats::begin();
+    UNITY_BEGIN();
+    RUN_TEST(test_cached_can_car_is_kline);
+    RUN_TEST(test_cached_can_car_gets_the_filter_after_atdpn);
+    RUN_TEST(test_search_selects_the_engine_ecu);
+    RUN_TEST(test_kline_batch_falls_back_to_single_pids);
+    RUN_TEST(test_response_count_is_dropped_when_rejected);
+    return UNITY_END();
+}
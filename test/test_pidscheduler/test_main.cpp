@@ -0,0 +1,127 @@
+// PIDScheduler: earliest deadline first, load factor and the samples that
+// count toward the achieved rates: pio test -e native -f test_pidscheduler
+#include <unity.h>
+#include <pidscheduler.h>
+
+// The scheduler is static, every test registers its own PIDs. Registering one
+// again only updates it, so each test uses PIDs no other test has touched.
+void setUp(void) {}
+void tearDown(void) {}
+
+static uint8_t indexOf(uint8_t pid) {
+    for (uint8_t i = 0; i < PIDScheduler::getEntryCount(); i++) {
+        if (PIDScheduler::getEntry(i).pid == pid) return i;
+    }
+    return 0xFF;
+}
+
+static void disableAllBut(uint8_t first, uint8_t second) {
+    for (uint8_t i = 0; i < PIDScheduler::getEntryCount(); i++) {
+        uint8_t pid = PIDScheduler::getEntry(i).pid;
+        PIDScheduler::setEnabled(pid, pid == first || pid == second);
+    }
+}
+
+void test_most_overdue_goes_first(void) {
+    PIDScheduler::registerPID(0x10, 1.0, 1);
+    PIDScheduler::registerPID(0x11, 4.0, 1);
+    disableAllBut(0x10, 0x11);
+
+    uint8_t pids[4];
+    // Both due at 0: equal deadline, same priority, table order
+    TEST_ASSERT_EQUAL_UINT8(2, PIDScheduler::nextBatch(0, pids, 4));
+    // 250 ms later only the 4 Hz PID is due again
+    TEST_ASSERT_EQUAL_UINT8(1, PIDScheduler::nextBatch(250, pids, 4));
+    TEST_ASSERT_EQUAL_HEX8(0x11, pids[0]);
+    TEST_ASSERT_EQUAL_UINT8(0, PIDScheduler::nextBatch(260, pids, 4));
+    TEST_ASSERT_EQUAL_UINT32(240, PIDScheduler::msUntilNextDue(260));
+}
+
+void test_priority_breaks_ties(void) {
+    PIDScheduler::registerPID(0x20, 2.0, 1);
+    PIDScheduler::registerPID(0x21, 2.0, 3);
+    disableAllBut(0x20, 0x21);
+
+    uint8_t pids[1];
+    TEST_ASSERT_EQUAL_UINT8(1, PIDScheduler::nextBatch(100000, pids, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x21, pids[0]);
+    TEST_ASSERT_EQUAL_UINT8(1, PIDScheduler::nextBatch(100000, pids, 1));
+    TEST_ASSERT_EQUAL_HEX8(0x20, pids[0]);
+}
+
+// A PID that could not be served lags at most one period: after a long gap it
+// is issued twice, not once per missed period
+void test_late_pid_does_not_burst(void) {
+    PIDScheduler::registerPID(0x30, 10.0, 1);
+    disableAllBut(0x30, 0x30);
+
+    uint8_t pids[1];
+    TEST_ASSERT_EQUAL_UINT8(1, PIDScheduler::nextBatch(200000, pids, 1));
+    TEST_ASSERT_EQUAL_UINT8(1, PIDScheduler::nextBatch(200000, pids, 1));
+    TEST_ASSERT_EQUAL_UINT8(0, PIDScheduler::nextBatch(200000, pids, 1));
+    TEST_ASSERT_EQUAL_UINT32(100, PIDScheduler::msUntilNextDue(200000));
+}
+
+// 5 Hz x 100 ms + 5 Hz x 200 ms = 1.5 of the bus: both rates scale by 1/1.5
+void test_load_factor_scales_all_rates(void) {
+    PIDScheduler::registerPID(0x40, 5.0, 1);
+    PIDScheduler::registerPID(0x41, 5.0, 1);
+    disableAllBut(0x40, 0x41);
+
+    uint8_t pids[] = { 0x40 };
+    PIDScheduler::onRequestCompleted(pids, 1, 0x01, 300000, 100);
+    pids[0] = 0x41;
+    PIDScheduler::onRequestCompleted(pids, 1, 0x01, 300000, 200);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.5, PIDScheduler::getLoadFactor());
+    TEST_ASSERT_TRUE(PIDScheduler::isOvercommitted());
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 5.0 / 1.5, PIDScheduler::getEntry(indexOf(0x40)).effectiveHz);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 5.0 / 1.5, PIDScheduler::getEntry(indexOf(0x41)).effectiveHz);
+}
+
+void test_disabled_pid_takes_no_share(void) {
+    PIDScheduler::registerPID(0x50, 5.0, 1);
+    disableAllBut(0x50, 0x50);
+    uint8_t pids[] = { 0x50 };
+    PIDScheduler::onRequestCompleted(pids, 1, 0x01, 400000, 100);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.5, PIDScheduler::getLoadFactor());
+
+    PIDScheduler::setEnabled(0x50, false);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.0, PIDScheduler::getLoadFactor());
+    TEST_ASSERT_EQUAL_UINT8(0, PIDScheduler::nextBatch(500000, pids, 1));
+}
+
+// Only decoded PIDs are samples: a timeout or NO DATA neither counts toward
+// the achieved rate nor bills its round trip as bus time
+void test_only_decoded_pids_count(void) {
+    PIDScheduler::registerPID(0x60, 2.0, 1);
+    PIDScheduler::registerPID(0x61, 2.0, 1);
+    disableAllBut(0x60, 0x61);
+
+    uint8_t pids[] = { 0x60, 0x61 };
+    // Closes the rate window the earlier tests left open, a new one starts here
+    unsigned long now = 600000;
+    PIDScheduler::onRequestCompleted(pids, 2, 0x03, now, 100);
+    for (uint8_t i = 1; i <= 10; i++) {
+        // 0x61 never answers, every other request is a timeout
+        PIDScheduler::onRequestCompleted(pids, 2, (i % 2) ? 0x01 : 0x00, now + i * SCHEDULER_RATE_WINDOW_MS / 10, 1000);
+    }
+
+    const PIDScheduleEntry& answered = PIDScheduler::getEntry(indexOf(0x60));
+    const PIDScheduleEntry& missing = PIDScheduler::getEntry(indexOf(0x61));
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 1.0, answered.achievedHz);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 0.0, missing.achievedHz);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 50.0, missing.costMs);
+    TEST_ASSERT_TRUE(answered.costMs > 50.0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_most_overdue_goes_first);
+    RUN_TEST(test_priority_breaks_ties);
+    RUN_TEST(test_late_pid_does_not_burst);
+    RUN_TEST(test_load_factor_scales_all_rates);
+    RUN_TEST(test_disabled_pid_takes_no_share);
+    RUN_TEST(test_only_decoded_pids_count);
+    return UNITY_END();
+}
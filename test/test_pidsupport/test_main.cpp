@@ -0,0 +1,135 @@
+// PIDSupport: bitmap discovery, another car behind the cached adapter, ranges
+// the adapter does not answer, PIDs given up after NO DATA and the cache:
+// pio test -e native -f test_pidsupport
+#include <unity.h>
+#include <pidsupport.h>
+
+// 0100 of a common petrol car: 0x04, 0x05, 0x0C, 0x0D, 0x0F, 0x10, 0x11 and 0x20 (next range)
+static const uint8_t RANGE_00[4] = { 0x18, 0x1B, 0x80, 0x01 };
+// 0120 listing 0x21 and nothing further
+static const uint8_t RANGE_20[4] = { 0x80, 0x00, 0x00, 0x00 };
+// Another car: 0x0C and 0x0D only, no next range
+static const uint8_t OTHER_00[4] = { 0x00, 0x18, 0x00, 0x00 };
+
+void setUp(void) {
+    PIDSupport::reset();
+    PIDSupport::takeChanged();
+}
+
+void tearDown(void) {}
+
+// Until the bitmaps are in every PID counts as supported, afterwards only the listed ones
+void test_discovery(void) {
+    TEST_ASSERT_EQUAL_HEX8(0x00, PIDSupport::nextMissingRange());
+    TEST_ASSERT_FALSE(PIDSupport::isDiscovered());
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x2F));
+
+    PIDSupport::onBitmap(0x00, RANGE_00);
+    TEST_ASSERT_EQUAL_HEX8(0x20, PIDSupport::nextMissingRange());
+    TEST_ASSERT_FALSE(PIDSupport::isDiscovered());
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x0C));
+    TEST_ASSERT_FALSE(PIDSupport::isSupported(0x0E));
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x2F));
+
+    PIDSupport::onBitmap(0x20, RANGE_20);
+    TEST_ASSERT_EQUAL_HEX8(PID_SUPPORT_NO_RANGE, PIDSupport::nextMissingRange());
+    TEST_ASSERT_TRUE(PIDSupport::isDiscovered());
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x21));
+    TEST_ASSERT_FALSE(PIDSupport::isSupported(0x2F));
+    TEST_ASSERT_FALSE(PIDSupport::isSupported(0x46));
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x00));
+    TEST_ASSERT_TRUE(PIDSupport::takeChanged());
+    TEST_ASSERT_FALSE(PIDSupport::takeChanged());
+}
+
+// The same bitmap again is no change, a version bump or a cache write
+void test_same_bitmap_is_no_change(void) {
+    PIDSupport::onBitmap(0x00, RANGE_00);
+    PIDSupport::takeChanged();
+    uint32_t version = PIDSupport::getVersion();
+    PIDSupport::onBitmap(0x00, RANGE_00);
+    TEST_ASSERT_EQUAL_UINT32(version, PIDSupport::getVersion());
+    TEST_ASSERT_FALSE(PIDSupport::takeChanged());
+}
+
+// A different 0100 than the cached one: the cached ranges belong to another car
+void test_other_car_resets_the_ranges(void) {
+    PIDSupport::onBitmap(0x00, RANGE_00);
+    PIDSupport::onBitmap(0x20, RANGE_20);
+    TEST_ASSERT_TRUE(PIDSupport::isDiscovered());
+
+    PIDSupport::onBitmap(0x00, OTHER_00);
+    TEST_ASSERT_TRUE(PIDSupport::isDiscovered());
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x0D));
+    TEST_ASSERT_FALSE(PIDSupport::isSupported(0x05));
+    TEST_ASSERT_FALSE(PIDSupport::isSupported(0x21));
+}
+
+// No answer to 0120 is an empty range, discovery does not ask for it forever
+void test_missing_range(void) {
+    PIDSupport::onBitmap(0x00, RANGE_00);
+    uint32_t version = PIDSupport::getVersion();
+    PIDSupport::markRangeMissing(0x20);
+    TEST_ASSERT_TRUE(PIDSupport::isDiscovered());
+    TEST_ASSERT_FALSE(PIDSupport::isSupported(0x21));
+    TEST_ASSERT_TRUE(PIDSupport::getVersion() != version);
+    TEST_ASSERT_TRUE(PIDSupport::takeChanged());
+}
+
+// PID_SUPPORT_NO_DATA_LIMIT NO DATA in a row give a listed PID up until the next wake-up
+void test_no_data_gives_up(void) {
+    PIDSupport::onBitmap(0x00, RANGE_00);
+    PIDSupport::markRangeMissing(0x20);
+    PIDSupport::takeChanged();
+
+    TEST_ASSERT_FALSE(PIDSupport::onPIDResult(0x10, true));
+    TEST_ASSERT_FALSE(PIDSupport::onPIDResult(0x10, true));
+    // A value in between starts the count over
+    TEST_ASSERT_FALSE(PIDSupport::onPIDResult(0x10, false));
+    for (int i = 0; i < PID_SUPPORT_NO_DATA_LIMIT - 1; i++) TEST_ASSERT_FALSE(PIDSupport::onPIDResult(0x10, true));
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x10));
+
+    uint32_t version = PIDSupport::getVersion();
+    TEST_ASSERT_TRUE(PIDSupport::onPIDResult(0x10, true));
+    TEST_ASSERT_FALSE(PIDSupport::isSupported(0x10));
+    TEST_ASSERT_TRUE(PIDSupport::getVersion() != version);
+    // Given up once, further NO DATA is not news; the bitmaps, and so the cache, stay
+    TEST_ASSERT_FALSE(PIDSupport::onPIDResult(0x10, true));
+    TEST_ASSERT_FALSE(PIDSupport::takeChanged());
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x0C));
+
+    PIDSupport::clearUnavailable();
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x10));
+    TEST_ASSERT_FALSE(PIDSupport::onPIDResult(0x10, true));
+}
+
+void test_cache_round_trip(void) {
+    PIDSupport::onBitmap(0x00, RANGE_00);
+    PIDSupport::onBitmap(0x20, RANGE_20);
+    uint8_t cache[PID_SUPPORT_CACHE_SIZE];
+    TEST_ASSERT_EQUAL_size_t(0, PIDSupport::save(cache, sizeof(cache) - 1));
+    TEST_ASSERT_EQUAL_size_t(PID_SUPPORT_CACHE_SIZE, PIDSupport::save(cache, sizeof(cache)));
+
+    PIDSupport::reset();
+    TEST_ASSERT_FALSE(PIDSupport::isDiscovered());
+    TEST_ASSERT_FALSE(PIDSupport::restore(cache, sizeof(cache) - 1));
+    uint32_t version = PIDSupport::getVersion();
+    TEST_ASSERT_TRUE(PIDSupport::restore(cache, sizeof(cache)));
+    TEST_ASSERT_TRUE(PIDSupport::getVersion() != version);
+    TEST_ASSERT_TRUE(PIDSupport::isDiscovered());
+    TEST_ASSERT_TRUE(PIDSupport::isSupported(0x21));
+    TEST_ASSERT_FALSE(PIDSupport::isSupported(0x0E));
+    // What came from the cache is not a change to save again
+    TEST_ASSERT_FALSE(PIDSupport::takeChanged());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_discovery);
+    RUN_TEST(test_same_bitmap_is_no_change);
+    RUN_TEST(test_other_car_resets_the_ranges);
+    RUN_TEST(test_missing_range);
+    RUN_TEST(test_no_data_gives_up);
+    RUN_TEST(test_cache_round_trip);
+    return UNITY_END();
+}
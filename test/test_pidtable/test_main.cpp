@@ -0,0 +1,94 @@
+// PIDTable: lookup, data lengths, the integer decoding of every formula kind
+// and the fixed-point text: pio test -e native -f test_pidtable
+#include <unity.h>
+#include <string.h>
+#include <pidtable.h>
+
+static int32_t decode(uint8_t pid, uint8_t a, uint8_t b = 0) {
+    const uint8_t data[2] = { a, b };
+    const PIDDescriptor* descriptor = PIDTable::find(pid);
+    TEST_ASSERT_NOT_NULL(descriptor);
+    return PIDTable::decode(*descriptor, data);
+}
+
+static const char* format(uint8_t pid, int32_t value) {
+    static char text[PID_VALUE_TEXT_SIZE];
+    PIDTable::formatValue(pid, value, text, sizeof(text));
+    return text;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_find_and_data_length(void) {
+    TEST_ASSERT_EQUAL_HEX8(0x0C, PIDTable::find(0x0C)->pid);
+    TEST_ASSERT_EQUAL_STRING("rpm", PIDTable::find(0x0C)->name);
+    TEST_ASSERT_NULL(PIDTable::find(0x01));
+    TEST_ASSERT_NULL(PIDTable::find(0xFF));
+
+    TEST_ASSERT_EQUAL_UINT8(4, PIDTable::dataLength(0x00));
+    TEST_ASSERT_EQUAL_UINT8(2, PIDTable::dataLength(0x0C));
+    TEST_ASSERT_EQUAL_UINT8(1, PIDTable::dataLength(0x0D));
+    TEST_ASSERT_EQUAL_UINT8(2, PIDTable::dataLength(0x10));
+    // 0 stops the parser at a PID it can't size
+    TEST_ASSERT_EQUAL_UINT8(0, PIDTable::dataLength(0x01));
+}
+
+// Every row can be found again through the dispatch array
+void test_rows_match_dispatch(void) {
+    for (uint8_t i = 0; i < PIDTable::getRowCount(); i++) {
+        const PIDDescriptor& row = PIDTable::getRow(i);
+        TEST_ASSERT_TRUE(PIDTable::find(row.pid) == &row);
+        TEST_ASSERT_EQUAL_UINT8(row.bytes, PIDTable::dataLength(row.pid));
+    }
+    uint16_t known = 0;
+    for (uint16_t pid = 0; pid < 256; pid++) {
+        if (PIDTable::find((uint8_t)pid) != nullptr) known++;
+    }
+    TEST_ASSERT_EQUAL_UINT16(PIDTable::getRowCount(), known);
+}
+
+void test_decode(void) {
+    TEST_ASSERT_EQUAL_INT32(1726, decode(0x0C, 0x1A, 0xF8));       // (256A+B)/4
+    TEST_ASSERT_EQUAL_INT32(16383, decode(0x0C, 0xFF, 0xFF));
+    TEST_ASSERT_EQUAL_INT32(50, decode(0x0D, 50));
+    TEST_ASSERT_EQUAL_INT32(-40, decode(0x05, 0));                  // A-40
+    TEST_ASSERT_EQUAL_INT32(90, decode(0x05, 130));
+    TEST_ASSERT_EQUAL_INT32(100, decode(0x04, 255));                // 100A/255
+    TEST_ASSERT_EQUAL_INT32(1234, decode(0x10, 0x04, 0xD2));        // 0.01 g/s
+    TEST_ASSERT_EQUAL_INT32(-1000, decode(0x06, 0));                // 100A/128-100 in 0.1 %
+    TEST_ASSERT_EQUAL_INT32(0, decode(0x06, 128));
+    TEST_ASSERT_EQUAL_INT32(-32, decode(0x07, 124));
+    TEST_ASSERT_EQUAL_INT32(-640, decode(0x0E, 0));                 // A/2-64 in 0.1 deg
+    TEST_ASSERT_EQUAL_INT32(1000, decode(0x11, 255));
+}
+
+void test_format_value(void) {
+    TEST_ASSERT_EQUAL_STRING("12.34", format(0x10, 1234));
+    TEST_ASSERT_EQUAL_STRING("0.05", format(0x10, 5));
+    TEST_ASSERT_EQUAL_STRING("-3.1", format(0x06, -31));
+    TEST_ASSERT_EQUAL_STRING("-0.5", format(0x06, -5));
+    TEST_ASSERT_EQUAL_STRING("0.0", format(0x06, 0));
+    TEST_ASSERT_EQUAL_STRING("-64.0", format(0x0E, -640));
+    TEST_ASSERT_EQUAL_STRING("1726", format(0x0C, 1726));
+    TEST_ASSERT_EQUAL_STRING("-40", format(0x05, -40));
+    // Outside the table the value is printed as it is
+    TEST_ASSERT_EQUAL_STRING("-7", format(0x01, -7));
+}
+
+// snprintf semantics: the full length is returned, the text is cut and terminated
+void test_format_short_buffer(void) {
+    char text[4];
+    TEST_ASSERT_EQUAL_size_t(5, PIDTable::formatValue(0x10, 1234, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("12.", text);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_find_and_data_length);
+    RUN_TEST(test_rows_match_dispatch);
+    RUN_TEST(test_decode);
+    RUN_TEST(test_format_value);
+    RUN_TEST(test_format_short_buffer);
+    return UNITY_END();
+}
@@ -0,0 +1,127 @@
+// ReceiveRing: chunk order, wrap-around, overflow and the producer/consumer
+// hand-off across threads: pio test -e native -f test_receivering
+#include <unity.h>
+#include <string.h>
+#include <thread>
+#include <receivering.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_chunks_come_out_in_order(void) {
+    ReceiveRing ring;
+    TEST_ASSERT_TRUE(ring.push((const uint8_t*)"41 0C", 5, 100, 7));
+    TEST_ASSERT_TRUE(ring.push((const uint8_t*)" 1A F8>", 7, 105, 7));
+
+    ReceiveChunk chunk;
+    uint8_t out[16];
+    TEST_ASSERT_TRUE(ring.peek(chunk));
+    TEST_ASSERT_EQUAL_UINT16(5, chunk.length);
+    TEST_ASSERT_TRUE(ring.pop(chunk, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_MEMORY("41 0C", out, 5);
+    TEST_ASSERT_EQUAL_UINT32(100, chunk.timestampMs);
+    TEST_ASSERT_EQUAL_UINT16(7, chunk.generation);
+    TEST_ASSERT_TRUE(ring.pop(chunk, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_MEMORY(" 1A F8>", out, 7);
+    TEST_ASSERT_EQUAL_UINT32(105, chunk.timestampMs);
+    TEST_ASSERT_FALSE(ring.pop(chunk, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT32(12, ring.getHighWater());
+}
+
+// A notification that does not fit is dropped whole, the ring stays usable
+void test_full_ring_drops_whole_chunks(void) {
+    ReceiveRing ring;
+    uint8_t data[RECEIVE_RING_BYTES / 2];
+    memset(data, 'A', sizeof(data));
+    TEST_ASSERT_TRUE(ring.push(data, sizeof(data), 0, 0));
+    TEST_ASSERT_TRUE(ring.push(data, sizeof(data), 0, 0));
+    TEST_ASSERT_FALSE(ring.push(data, 1, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, ring.getDropped());
+
+    ReceiveChunk chunk;
+    uint8_t out[RECEIVE_RING_BYTES / 2];
+    TEST_ASSERT_TRUE(ring.pop(chunk, out, sizeof(out)));
+    TEST_ASSERT_TRUE(ring.push(data, 1, 0, 0));
+}
+
+void test_chunk_slots_are_limited(void) {
+    ReceiveRing ring;
+    for (uint8_t i = 0; i < RECEIVE_RING_CHUNKS; i++) {
+        TEST_ASSERT_TRUE(ring.push(&i, 1, i, 0));
+    }
+    uint8_t extra = 0;
+    TEST_ASSERT_FALSE(ring.push(&extra, 1, 0, 0));
+    TEST_ASSERT_EQUAL_UINT32(1, ring.getDropped());
+}
+
+// The byte counters run past the buffer size, chunks straddling the end come out intact
+void test_wrap_around(void) {
+    ReceiveRing ring;
+    ReceiveChunk chunk;
+    uint8_t data[100];
+    uint8_t out[100];
+    for (uint16_t round = 0; round < 50; round++) {
+        for (uint8_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(round + i);
+        TEST_ASSERT_TRUE(ring.push(data, sizeof(data), round, round));
+        TEST_ASSERT_TRUE(ring.pop(chunk, out, sizeof(out)));
+        TEST_ASSERT_EQUAL_UINT16(round, chunk.generation);
+        TEST_ASSERT_EQUAL_MEMORY(data, out, sizeof(data));
+    }
+}
+
+// The rest of an oversized chunk is skipped, the next chunk starts where it should
+void test_oversized_chunk_is_truncated(void) {
+    ReceiveRing ring;
+    ReceiveChunk chunk;
+    uint8_t out[4];
+    TEST_ASSERT_TRUE(ring.push((const uint8_t*)"0123456789", 10, 0, 0));
+    TEST_ASSERT_TRUE(ring.push((const uint8_t*)"AB", 2, 0, 0));
+    TEST_ASSERT_TRUE(ring.pop(chunk, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_UINT16(10, chunk.length);
+    TEST_ASSERT_EQUAL_MEMORY("0123", out, 4);
+    TEST_ASSERT_TRUE(ring.pop(chunk, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_MEMORY("AB", out, 2);
+}
+
+// One producer thread, one consumer: every byte arrives once and in order,
+// a push that finds the ring full is retried so every chunk can be checked
+void test_producer_consumer_threads(void) {
+    static ReceiveRing ring;
+    const uint32_t CHUNKS = 200000;
+    std::thread producer([] {
+        uint8_t data[13];
+        for (uint32_t i = 0; i < CHUNKS; i++) {
+            uint8_t length = 1 + i % sizeof(data);
+            for (uint8_t j = 0; j < length; j++) data[j] = (uint8_t)(i + j);
+            while (!ring.push(data, length, i, (uint16_t)i)) std::this_thread::yield();
+        }
+    });
+
+    uint32_t received = 0;
+    uint32_t corrupt = 0;
+    ReceiveChunk chunk;
+    uint8_t out[16];
+    while (received < CHUNKS) {
+        if (!ring.pop(chunk, out, sizeof(out))) {
+            std::this_thread::yield();
+            continue;
+        }
+        bool ok = chunk.timestampMs == received && chunk.length == 1 + received % 13;
+        for (uint8_t j = 0; ok && j < chunk.length; j++) ok = out[j] == (uint8_t)(received + j);
+        if (!ok) corrupt++;
+        received++;
+    }
+    producer.join();
+    TEST_ASSERT_EQUAL_UINT32(0, corrupt);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_chunks_come_out_in_order);
+    RUN_TEST(test_full_ring_drops_whole_chunks);
+    RUN_TEST(test_chunk_slots_are_limited);
+    RUN_TEST(test_wrap_around);
+    RUN_TEST(test_oversized_chunk_is_truncated);
+    RUN_TEST(test_producer_consumer_threads);
+    return UNITY_END();
+}
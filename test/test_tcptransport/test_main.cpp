@@ -0,0 +1,233 @@
+// TCPTransport against a loopback adapter: addresses, a command and its reply,
+// and a reader, a writer and a reconnecting owner on three threads while the
+// adapter keeps dropping the connection: pio test -e native -f test_tcptransport
+#include <unity.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <atomic>
+#include <thread>
+#include <tcptransport.h>
+
+// Answers every '\r'-terminated command with "OK\r\r>" and hangs up after
+// closeAfter commands (0: never)
+class LoopbackAdapter {
+public:
+    LoopbackAdapter(uint32_t closeAfter) : closeAfter(closeAfter), listenFd(-1), stopping(false), hangups(0) {}
+
+    uint16_t start() {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if (bind(listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 4) != 0 ||
+            getsockname(listenFd, (struct sockaddr*)&address, &length) != 0) {
+            return 0;
+        }
+        server = std::thread([this]() { serve(); });
+        return ntohs(address.sin_port);
+    }
+
+    void stop() {
+        stopping = true;
+        server.join();
+        close(listenFd);
+    }
+
+    uint32_t getHangups() const { return hangups; }
+
+private:
+    uint32_t closeAfter;
+    int listenFd;
+    std::atomic<bool> stopping;
+    std::atomic<uint32_t> hangups;
+    std::thread server;
+
+    static bool readable(int fd) {
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(fd, &set);
+        struct timeval timeout = { 0, 10000 };
+        return select(fd + 1, &set, nullptr, nullptr, &timeout) == 1;
+    }
+
+    void serve() {
+        while (!stopping) {
+            if (!readable(listenFd)) continue;
+            int client = accept(listenFd, nullptr, nullptr);
+            if (client < 0) continue;
+            uint32_t commands = 0;
+            char buffer[64];
+            while (!stopping) {
+                if (!readable(client)) continue;
+                ssize_t length = recv(client, buffer, sizeof(buffer), 0);
+                if (length <= 0) break;
+                for (ssize_t i = 0; i < length; i++) {
+                    if (buffer[i] != '\r') continue;
+                    send(client, "OK\r\r>", 5, MSG_NOSIGNAL);
+                    commands++;
+                }
+                if (closeAfter > 0 && commands >= closeAfter) break;
+            }
+            close(client);
+            hangups++;
+        }
+    }
+};
+
+static char received[256];
+static std::atomic<size_t> receivedLength;
+static std::atomic<uint32_t> prompts;
+
+static void collect(const uint8_t* data, size_t length, void* context) {
+    size_t offset = receivedLength;
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] == '>') prompts++;
+        if (offset + i < sizeof(received) - 1) received[offset + i] = (char)data[i];
+    }
+    receivedLength = offset + length;
+}
+
+void setUp(void) {
+    memset(received, 0, sizeof(received));
+    receivedLength = 0;
+    prompts = 0;
+}
+
+void tearDown(void) {}
+
+void test_parse_address(void) {
+    char host[ELM_ADAPTER_ADDRESS_SIZE];
+    uint16_t port = 0;
+    TEST_ASSERT_TRUE(TCPTransport::parseAddress("192.168.0.10:35000", host, sizeof(host), port));
+    TEST_ASSERT_EQUAL_STRING("192.168.0.10", host);
+    TEST_ASSERT_EQUAL_UINT16(35000, port);
+    TEST_ASSERT_TRUE(TCPTransport::parseAddress("192.168.0.10", host, sizeof(host), port));
+    TEST_ASSERT_EQUAL_UINT16(TCP_TRANSPORT_DEFAULT_PORT, port);
+
+    TEST_ASSERT_FALSE(TCPTransport::parseAddress(":35000", host, sizeof(host), port));
+    TEST_ASSERT_FALSE(TCPTransport::parseAddress("host:0", host, sizeof(host), port));
+    TEST_ASSERT_FALSE(TCPTransport::parseAddress("host:70000", host, sizeof(host), port));
+    TEST_ASSERT_FALSE(TCPTransport::parseAddress("host:35x", host, sizeof(host), port));
+    TEST_ASSERT_FALSE(TCPTransport::parseAddress("a-rather-long-host-name:35000", host, 8, port));
+}
+
+void test_command_and_reply(void) {
+    LoopbackAdapter adapter(0);
+    uint16_t port = adapter.start();
+    TEST_ASSERT_TRUE(port != 0);
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%u", (unsigned)port);
+
+    TCPTransport transport;
+    transport.setReceiver(collect, nullptr);
+    TEST_ASSERT_FALSE(transport.isConnected());
+    TEST_ASSERT_FALSE(transport.write((const uint8_t*)"ATZ\r", 4));
+    TEST_ASSERT_TRUE(transport.connect(address));
+    TEST_ASSERT_TRUE(transport.isConnected());
+    TEST_ASSERT_TRUE(transport.write((const uint8_t*)"ATE0\r", 5));
+    for (int i = 0; i < 100 && prompts == 0; i++) transport.poll(20);
+    TEST_ASSERT_EQUAL_STRING("OK\r\r>", received);
+
+    // Nothing more arrives, poll just times out
+    TEST_ASSERT_FALSE(transport.poll(10));
+    transport.disconnect();
+    TEST_ASSERT_FALSE(transport.isConnected());
+    TEST_ASSERT_FALSE(transport.poll(10));
+    adapter.stop();
+}
+
+// The adapter hanging up is noticed by the reader, the next write fails
+void test_hangup_is_noticed(void) {
+    LoopbackAdapter adapter(1);
+    uint16_t port = adapter.start();
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%u", (unsigned)port);
+
+    TCPTransport transport;
+    transport.setReceiver(collect, nullptr);
+    TEST_ASSERT_TRUE(transport.connect(address));
+    TEST_ASSERT_TRUE(transport.write((const uint8_t*)"0100\r", 5));
+    for (int i = 0; i < 100 && transport.isConnected(); i++) transport.poll(20);
+    TEST_ASSERT_FALSE(transport.isConnected());
+    TEST_ASSERT_EQUAL_UINT32(1, prompts);
+    TEST_ASSERT_FALSE(transport.write((const uint8_t*)"010C\r", 5));
+    adapter.stop();
+}
+
+void test_nobody_listening(void) {
+    LoopbackAdapter adapter(0);
+    uint16_t port = adapter.start();
+    adapter.stop();
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%u", (unsigned)port);
+
+    TCPTransport transport;
+    TEST_ASSERT_FALSE(transport.connect(address));
+    TEST_ASSERT_FALSE(transport.isConnected());
+    TEST_ASSERT_FALSE(transport.connect("127.0.0.1:notaport"));
+}
+
+// The firmware's three tasks: the socket reader polls, the engine writes and
+// the loop reconnects whenever the adapter hangs up. A socket closed by one of
+// them must never be written or read by another (run it under a sanitizer).
+void test_reader_writer_and_reconnect(void) {
+    LoopbackAdapter adapter(5);
+    uint16_t port = adapter.start();
+    char address[32];
+    snprintf(address, sizeof(address), "127.0.0.1:%u", (unsigned)port);
+
+    TCPTransport transport;
+    transport.setReceiver(collect, nullptr);
+    TEST_ASSERT_TRUE(transport.connect(address));
+
+    std::atomic<bool> running(true);
+    std::atomic<uint32_t> written(0);
+    std::thread reader([&]() {
+        while (running) {
+            if (!transport.isConnected()) {
+                usleep(1000);
+                continue;
+            }
+            transport.poll(5);
+        }
+    });
+    std::thread writer([&]() {
+        while (running) {
+            if (transport.write((const uint8_t*)"010C\r", 5)) written++;
+            usleep(200);
+        }
+    });
+
+    uint32_t reconnects = 0;
+    for (int i = 0; i < 2000 && reconnects < 20; i++) {
+        if (!transport.isConnected() && transport.connect(address)) reconnects++;
+        usleep(1000);
+    }
+    running = false;
+    reader.join();
+    writer.join();
+    transport.disconnect();
+    adapter.stop();
+
+    TEST_ASSERT_TRUE(reconnects >= 20);
+    TEST_ASSERT_TRUE(adapter.getHangups() >= 20);
+    TEST_ASSERT_TRUE(written >= 100);
+    TEST_ASSERT_TRUE(prompts > 0);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_address);
+    RUN_TEST(test_command_and_reply);
+    RUN_TEST(test_hangup_is_noticed);
+    RUN_TEST(test_nobody_listening);
+    RUN_TEST(test_reader_writer_and_reconnect);
+    return UNITY_END();
+}
@@ -0,0 +1,138 @@
+// TripComputer: distance and fuel integration against the closed forms, the
+// remainders carried across 1 ms steps, gaps, batched flow points and the
+// clamped fuel scale: pio test -e native -f test_tripcomputer
+#include <unity.h>
+#include <tripcomputer.h>
+
+class TestStorage : public TripStorage {
+public:
+    int64_t fuel;
+    float factor;
+    uint64_t distance;
+    uint64_t tripFuel;
+
+    int64_t getFuelMicroliters() override { return fuel; }
+    void setFuelMicroliters(int64_t value) override { fuel = value; }
+    void addFuelMicroliters(int64_t delta) override { fuel += delta; }
+    float getTankCapacity() override { return 45.0f; }
+    float getConsumptionFactor() override { return factor; }
+    uint64_t getDistanceMm() override { return distance; }
+    void setDistanceMm(uint64_t value) override { distance = value; }
+    void addDistanceMm(uint64_t value) override { distance += value; }
+    uint64_t getTripFuelMicroliters() override { return tripFuel; }
+    void setTripFuelMicroliters(uint64_t value) override { tripFuel = value; }
+    void addTripFuelMicroliters(uint64_t value) override { tripFuel += value; }
+};
+
+static const float DEFAULT_FACTOR = 0.00000000815f;
+static const int64_t TANK_MICROLITERS = 45000000;
+
+static TestStorage storage;
+
+// One batched response: RPM and load arrive together
+static void flow(int rpm, int load, unsigned long timestamp) {
+    TripComputer::onRPM(rpm, timestamp);
+    TripComputer::onEngineLoad(load, timestamp);
+}
+
+void setUp(void) {
+    storage.fuel = TANK_MICROLITERS;
+    storage.factor = DEFAULT_FACTOR;
+    storage.distance = 0;
+    storage.tripFuel = 0;
+    TripComputer::setStorage(&storage);
+}
+
+void tearDown(void) {}
+
+// 90 km/h for 10 h is 900 km, to the millimeter
+void test_constant_speed_distance(void) {
+    const unsigned long HOURS_MS = 10UL * 3600 * 1000;
+    for (unsigned long t = 0; t <= HOURS_MS; t += 1000) TripComputer::onSpeed(90, t);
+    TEST_ASSERT_EQUAL_UINT64(900000000ULL, storage.distance);
+}
+
+// Constant RPM x load: micro-liters = RPM x load x factor x ms x 1000. The
+// flow point of a response is closed by the next one, so the last second
+// only counts once another sample comes in.
+void test_constant_flow_fuel(void) {
+    const unsigned long HOUR_MS = 3600UL * 1000;
+    for (unsigned long t = 0; t <= HOUR_MS + 1000; t += 1000) flow(2000, 50, t);
+    double expected = 2000.0 * 50 * DEFAULT_FACTOR * HOUR_MS * 1000;       // 2.934 L
+    TEST_ASSERT_FLOAT_WITHIN(expected * 0.001, expected, (double)storage.tripFuel);
+    TEST_ASSERT_EQUAL_INT64(TANK_MICROLITERS - (int64_t)storage.tripFuel, storage.fuel);
+}
+
+// A 1 ms step is far below a millimeter and a micro-liter, the remainders
+// carry it to the next step instead of dropping it
+void test_remainders_on_1ms_steps(void) {
+    for (unsigned long t = 0; t <= 36000; t++) TripComputer::onSpeed(1, t);
+    TEST_ASSERT_EQUAL_UINT64(10000, storage.distance);                      // 1 km/h for 36 s
+
+    for (unsigned long t = 0; t <= 60001; t++) flow(800, 20, t);
+    double expected = 800.0 * 20 * DEFAULT_FACTOR * 60000 * 1000;           // 0.13 uL a step
+    TEST_ASSERT_FLOAT_WITHIN(expected * 0.001 + 1, expected, (double)storage.tripFuel);
+}
+
+// Nothing is integrated across a gap longer than TRIP_MAX_GAP_MS, the next
+// step counts from the sample after it
+void test_gaps_are_skipped(void) {
+    TripComputer::onSpeed(36, 0);
+    TripComputer::onSpeed(36, TRIP_MAX_GAP_MS);
+    TEST_ASSERT_EQUAL_UINT64(50000, storage.distance);                      // 36 km/h is 10 mm/ms
+    TripComputer::onSpeed(36, 2 * TRIP_MAX_GAP_MS + 1);
+    TEST_ASSERT_EQUAL_UINT64(50000, storage.distance);
+    TripComputer::onSpeed(36, 2 * TRIP_MAX_GAP_MS + 1001);
+    TEST_ASSERT_EQUAL_UINT64(60000, storage.distance);
+
+    flow(2000, 50, 0);
+    flow(2000, 50, TRIP_MAX_GAP_MS + 1);
+    flow(2000, 50, TRIP_MAX_GAP_MS + 1001);
+    TEST_ASSERT_EQUAL_UINT64(0, storage.tripFuel);
+    TripComputer::onRPM(2000, TRIP_MAX_GAP_MS + 2001);
+    TEST_ASSERT_FLOAT_WITHIN(1, 2000.0 * 50 * DEFAULT_FACTOR * 1000 * 1000, (double)storage.tripFuel);
+}
+
+// RPM and load of one response are one flow point: the trapezoid runs from
+// 2000 x 50 to 4000 x 100, not through a point with the new RPM and the old load
+void test_batch_is_one_flow_point(void) {
+    flow(2000, 50, 0);
+    flow(4000, 100, 1000);
+    TEST_ASSERT_EQUAL_UINT64(0, storage.tripFuel);
+    TripComputer::onRPM(4000, 2000);
+    double expected = (2000.0 * 50 + 4000.0 * 100) / 2 * DEFAULT_FACTOR * 1000 * 1000;
+    TEST_ASSERT_FLOAT_WITHIN(1, expected, (double)storage.tripFuel);
+}
+
+// An absurd calibration is clamped to FUEL_SCALE_LIMIT instead of overflowing
+// 64 bits, even for the largest flow over the longest step
+void test_fuel_scale_is_clamped(void) {
+    const double LIMIT = (double)((1ULL << 29) - 1) / (1ULL << 40);         // per flow sum and ms
+    storage.factor = 0.001f;
+    flow(16383, 100, 0);
+    flow(16383, 100, TRIP_MAX_GAP_MS);
+    TripComputer::onRPM(16383, TRIP_MAX_GAP_MS + 1);
+    double expected = 2.0 * 16383 * 100 * TRIP_MAX_GAP_MS * LIMIT;
+    TEST_ASSERT_FLOAT_WITHIN(1, expected, (double)storage.tripFuel);
+    TEST_ASSERT_TRUE(storage.tripFuel < 16383ULL * 100 * TRIP_MAX_GAP_MS);
+}
+
+void test_no_calibration_burns_nothing(void) {
+    storage.factor = 0;
+    flow(2000, 50, 0);
+    flow(2000, 50, 1000);
+    TripComputer::onRPM(2000, 2000);
+    TEST_ASSERT_EQUAL_UINT64(0, storage.tripFuel);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_constant_speed_distance);
+    RUN_TEST(test_constant_flow_fuel);
+    RUN_TEST(test_remainders_on_1ms_steps);
+    RUN_TEST(test_gaps_are_skipped);
+    RUN_TEST(test_batch_is_one_flow_point);
+    RUN_TEST(test_fuel_scale_is_clamped);
+    RUN_TEST(test_no_calibration_burns_nothing);
+    return UNITY_END();
+}
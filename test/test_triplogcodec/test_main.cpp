@@ -0,0 +1,94 @@
+// Trip log record encoding: varint lengths, zigzag, round trips and torn
+// records: pio test -e native -f test_triplogcodec
+#include <unity.h>
+#include <triplogcodec.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_varint_lengths(void) {
+    uint8_t out[5];
+    TEST_ASSERT_EQUAL_size_t(1, TripLogCodec::putVarint(out, 0));
+    TEST_ASSERT_EQUAL_size_t(1, TripLogCodec::putVarint(out, 127));
+    TEST_ASSERT_EQUAL_size_t(2, TripLogCodec::putVarint(out, 128));
+    TEST_ASSERT_EQUAL_HEX8(0x80, out[0]);
+    TEST_ASSERT_EQUAL_HEX8(0x01, out[1]);
+    TEST_ASSERT_EQUAL_size_t(3, TripLogCodec::putVarint(out, 16384));
+    TEST_ASSERT_EQUAL_size_t(5, TripLogCodec::putVarint(out, 0xFFFFFFFF));
+}
+
+// Small deltas of either sign stay small
+void test_zigzag(void) {
+    TEST_ASSERT_EQUAL_UINT32(0, TripLogCodec::zigzag(0));
+    TEST_ASSERT_EQUAL_UINT32(1, TripLogCodec::zigzag(-1));
+    TEST_ASSERT_EQUAL_UINT32(2, TripLogCodec::zigzag(1));
+    TEST_ASSERT_EQUAL_UINT32(3, TripLogCodec::zigzag(-2));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFF, TripLogCodec::zigzag(INT32_MIN));
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFFFE, TripLogCodec::zigzag(INT32_MAX));
+
+    const int32_t values[] = { 0, 1, -1, 63, -64, 64, 1000000, -1000000, INT32_MAX, INT32_MIN };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        TEST_ASSERT_EQUAL_INT32(values[i], TripLogCodec::unzigzag(TripLogCodec::zigzag(values[i])));
+    }
+}
+
+// An RPM change of -3 two hundred ms later: pid, 200 as two bytes, -3 as one
+void test_record_layout(void) {
+    uint8_t out[TRIP_LOG_MAX_RECORD];
+    TEST_ASSERT_EQUAL_size_t(4, TripLogCodec::putRecord(out, 0x0C, 200, -3));
+    const uint8_t expected[] = { 0x0C, 0xC8, 0x01, 0x05 };
+    TEST_ASSERT_EQUAL_MEMORY(expected, out, sizeof(expected));
+    TEST_ASSERT_EQUAL_size_t(TRIP_LOG_MAX_RECORD, TripLogCodec::putRecord(out, 0xFF, 0xFFFFFFFF, INT32_MIN));
+}
+
+void test_records_round_trip(void) {
+    uint8_t block[512];
+    size_t length = 0;
+    uint32_t seed = 12345;
+    for (uint16_t i = 0; i < 40; i++) {
+        seed = seed * 1103515245 + 12345;
+        length += TripLogCodec::putRecord(block + length, (uint8_t)i, seed >> 20, (int32_t)seed);
+    }
+
+    size_t position = 0;
+    seed = 12345;
+    for (uint16_t i = 0; i < 40; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t pid;
+        uint32_t timeDelta;
+        int32_t valueDelta;
+        TEST_ASSERT_TRUE(TripLogCodec::getRecord(block, length, position, pid, timeDelta, valueDelta));
+        TEST_ASSERT_EQUAL_UINT8(i, pid);
+        TEST_ASSERT_EQUAL_UINT32(seed >> 20, timeDelta);
+        TEST_ASSERT_EQUAL_INT32((int32_t)seed, valueDelta);
+    }
+    TEST_ASSERT_EQUAL_size_t(length, position);
+}
+
+// A block torn by a power cut ends inside a record, which must not be read
+void test_torn_record_is_rejected(void) {
+    uint8_t out[TRIP_LOG_MAX_RECORD];
+    size_t length = TripLogCodec::putRecord(out, 0x0D, 1000, 100000);
+    uint8_t pid;
+    uint32_t timeDelta;
+    int32_t valueDelta;
+    for (size_t cut = 0; cut < length; cut++) {
+        size_t position = 0;
+        TEST_ASSERT_FALSE(TripLogCodec::getRecord(out, cut, position, pid, timeDelta, valueDelta));
+    }
+
+    // Six continuation bytes are not a varint
+    const uint8_t endless[] = { 0x0C, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+    size_t position = 0;
+    TEST_ASSERT_FALSE(TripLogCodec::getRecord(endless, sizeof(endless), position, pid, timeDelta, valueDelta));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_varint_lengths);
+    RUN_TEST(test_zigzag);
+    RUN_TEST(test_record_layout);
+    RUN_TEST(test_records_round_trip);
+    RUN_TEST(test_torn_record_is_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,172 @@
+// TripStats: window aggregates, buckets expiring, distance/fuel deltas, trip
+// slots and their cache: pio test -e native -f test_tripstats
+#include <unity.h>
+#include <string.h>
+#include <tripstats.h>
+
+// The statistics are static: clear the slots through a reset, then the windows
+void setUp(void) {
+    TripStats::begin();
+    for (uint8_t i = 0; i < TRIP_SLOT_COUNT; i++) TripStats::requestReset((TRIP_SLOT)i);
+    TripStats::onSample(STAT_SPEED, 0, 0);
+    TripStats::begin();
+    TripStats::takeChanged();
+}
+
+void tearDown(void) {}
+
+void test_window_min_max_mean(void) {
+    TripStats::onSample(STAT_RPM, 1000, 0);
+    TripStats::onSample(STAT_RPM, 2000, 100);
+    TripStats::onSample(STAT_RPM, 3000, 1200);
+
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 1500);
+    for (uint8_t i = 0; i < STAT_WINDOW_COUNT; i++) {
+        const StatSummary& rpm = snapshot.windows[i].metrics[STAT_RPM];
+        TEST_ASSERT_EQUAL_UINT32(3, rpm.count);
+        TEST_ASSERT_EQUAL_INT(1000, rpm.min);
+        TEST_ASSERT_EQUAL_INT(3000, rpm.max);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, 2000.0f, rpm.mean);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.windows[STAT_WINDOW_10S].metrics[STAT_LOAD].count);
+}
+
+// The bucket falling out of the window takes its samples, and its extreme, along
+void test_old_buckets_expire(void) {
+    TripStats::onSample(STAT_RPM, 5000, 0);
+    TripStats::onSample(STAT_RPM, 1000, 5000);
+
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 10000);
+    const StatSummary& recent = snapshot.windows[STAT_WINDOW_10S].metrics[STAT_RPM];
+    TEST_ASSERT_EQUAL_UINT32(1, recent.count);
+    TEST_ASSERT_EQUAL_INT(1000, recent.max);
+    const StatSummary& minute = snapshot.windows[STAT_WINDOW_1MIN].metrics[STAT_RPM];
+    TEST_ASSERT_EQUAL_UINT32(2, minute.count);
+    TEST_ASSERT_EQUAL_INT(5000, minute.max);
+
+    // A sleeping ECU empties the short windows instead of freezing them
+    TripStats::snapshot(snapshot, 100000);
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.windows[STAT_WINDOW_10S].metrics[STAT_RPM].count);
+    TEST_ASSERT_EQUAL_UINT32(0, snapshot.windows[STAT_WINDOW_1MIN].metrics[STAT_RPM].count);
+    TEST_ASSERT_EQUAL_UINT32(2, snapshot.windows[STAT_WINDOW_1H].metrics[STAT_RPM].count);
+}
+
+void test_values_are_clamped_to_int16(void) {
+    TripStats::onSample(STAT_COOLANT, 100000, 0);
+    TripStats::onSample(STAT_COOLANT, -100000, 10);
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 20);
+    TEST_ASSERT_EQUAL_INT(INT16_MAX, snapshot.windows[STAT_WINDOW_10S].metrics[STAT_COOLANT].max);
+    TEST_ASSERT_EQUAL_INT(INT16_MIN, snapshot.windows[STAT_WINDOW_10S].metrics[STAT_COOLANT].min);
+}
+
+// Only the increase of the totals counts, gaps longer than
+// TRIP_STATS_MAX_GAP_MS are not driving time
+void test_totals_feed_distance_fuel_and_time(void) {
+    TripStats::onSample(STAT_SPEED, 60, 0);
+    TripStats::onTotals(5000000, 800000, 0);
+    TripStats::onTotals(6000000, 900000, 1000);
+    TripStats::onTotals(6000000, 900000, 1000 + TRIP_STATS_MAX_GAP_MS + 1);
+    TEST_ASSERT_TRUE(TripStats::takeChanged());
+
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 7000);
+    const TripSlotSnapshot& trip = snapshot.slots[TRIP_SLOT_TRIP];
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1.0f, trip.distanceKm);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.1f, trip.fuelLiters);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, trip.kmPerLiter);
+    TEST_ASSERT_EQUAL_UINT32(1, trip.drivingSeconds);
+    TEST_ASSERT_EQUAL_UINT32(0, trip.idleSeconds);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 3600.0f, trip.averageSpeedKmh);
+    TEST_ASSERT_EQUAL_UINT16(60, trip.maxSpeedKmh);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 10.0f, snapshot.windows[STAT_WINDOW_1H].kmPerLiter);
+}
+
+void test_standing_still_is_idle(void) {
+    TripStats::onSample(STAT_SPEED, 0, 0);
+    TripStats::onTotals(0, 0, 0);
+    TripStats::onTotals(0, 500, 2000);
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 2000);
+    TEST_ASSERT_EQUAL_UINT32(2, snapshot.slots[TRIP_SLOT_DRIVE].idleSeconds);
+    TEST_ASSERT_EQUAL_UINT32(2, snapshot.slots[TRIP_SLOT_DRIVE].drivingSeconds);
+}
+
+// A total that went down (trip reset) becomes the new reference
+void test_totals_going_down_are_a_new_reference(void) {
+    TripStats::onTotals(3000000, 300000, 0);
+    TripStats::onTotals(1000, 100, 1000);
+    TripStats::onTotals(2000, 200, 2000);
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 2000);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, 0.001f, snapshot.slots[TRIP_SLOT_TOTAL].distanceKm);
+}
+
+// A reset asked for from another task clears that slot only, on the next update
+void test_reset_clears_one_slot(void) {
+    TripStats::onSample(STAT_RPM, 2500, 0);
+    TripStats::requestReset(TRIP_SLOT_TRIP);
+    TripStats::onSample(STAT_RPM, 1500, 10);
+
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 10);
+    TEST_ASSERT_EQUAL_UINT16(1500, snapshot.slots[TRIP_SLOT_TRIP].maxRPM);
+    TEST_ASSERT_EQUAL_UINT16(1500, snapshot.slots[TRIP_SLOT_TRIP].meanRPM);
+    TEST_ASSERT_EQUAL_UINT16(2500, snapshot.slots[TRIP_SLOT_TANK].maxRPM);
+    TEST_ASSERT_EQUAL_UINT16(2000, snapshot.slots[TRIP_SLOT_TANK].meanRPM);
+}
+
+void test_cache_round_trip(void) {
+    TripStats::onSample(STAT_RPM, 3200, 0);
+    uint8_t cache[TRIP_STATS_CACHE_SIZE];
+    TEST_ASSERT_EQUAL_size_t(0, TripStats::save(cache, sizeof(cache) - 1));
+    TEST_ASSERT_EQUAL_size_t(TRIP_STATS_CACHE_SIZE, TripStats::save(cache, sizeof(cache)));
+
+    for (uint8_t i = 0; i < TRIP_SLOT_COUNT; i++) TripStats::requestReset((TRIP_SLOT)i);
+    TripStats::onSample(STAT_LOAD, 10, 10);
+    TEST_ASSERT_TRUE(TripStats::restore(cache, sizeof(cache)));
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 10);
+    TEST_ASSERT_EQUAL_UINT16(3200, snapshot.slots[TRIP_SLOT_TOTAL].maxRPM);
+
+    // Another layout is not restored
+    cache[0] = TRIP_STATS_CACHE_VERSION + 1;
+    TEST_ASSERT_FALSE(TripStats::restore(cache, sizeof(cache)));
+    TEST_ASSERT_FALSE(TripStats::restore(cache, sizeof(cache) - 1));
+}
+
+void test_json(void) {
+    TripStats::onSample(STAT_SPEED, 42, 0);
+    TripStatsSnapshot snapshot;
+    TripStats::snapshot(snapshot, 0);
+
+    char json[TRIP_STATS_JSON_SIZE];
+    size_t length = TripStats::toJSON(snapshot, json, sizeof(json));
+    TEST_ASSERT_EQUAL_size_t(strlen(json), length);
+    TEST_ASSERT_TRUE(length < sizeof(json) - 1);
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"10s\":{\"rpm\":null,\"speed\":{\"min\":42,\"max\":42,\"mean\":42.0},"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"total\":{\"distance\":0.000,"));
+    TEST_ASSERT_EQUAL_INT('}', json[length - 1]);
+
+    // A short buffer is cut, still terminated
+    char shortJSON[32];
+    length = TripStats::toJSON(snapshot, shortJSON, sizeof(shortJSON));
+    TEST_ASSERT_EQUAL_size_t(sizeof(shortJSON) - 1, length);
+    TEST_ASSERT_EQUAL_size_t(length, strlen(shortJSON));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_window_min_max_mean);
+    RUN_TEST(test_old_buckets_expire);
+    RUN_TEST(test_values_are_clamped_to_int16);
+    RUN_TEST(test_totals_feed_distance_fuel_and_time);
+    RUN_TEST(test_standing_still_is_idle);
+    RUN_TEST(test_totals_going_down_are_a_new_reference);
+    RUN_TEST(test_reset_clears_one_slot);
+    RUN_TEST(test_cache_round_trip);
+    RUN_TEST(test_json);
+    return UNITY_END();
+}
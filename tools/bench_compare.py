@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+"""Compares benchmark results with the recorded baseline.
+
+Reads the "BENCH <name> <ns/op> <allocs/op> <bytes/op>" lines printed by the
+bench-native program or by the bench-esp32 firmware on the serial monitor:
+    pio run -e bench-native -t exec > bench.txt
+    python3 tools/bench_compare.py --target native bench.txt
+
+Save the output first rather than piping it: on a single core machine the
+interpreter starting up would be timed along with the first benchmark.
+
+Exits with 1 when a benchmark got slower than the threshold or allocates
+more than before. --update records the results as the new baseline.
+"""
+import argparse
+import json
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BASELINE = os.path.join(ROOT, "tools", "bench_baseline.json")
+
+# Differences below this are timer noise on the short benchmarks
+MIN_DELTA_NS = 10.0
+
+
+def read_results(stream):
+    results = {}
+    for line in stream:
+        fields = line.split()
+        if len(fields) != 5 or fields[0] != "BENCH":
+            continue
+        results[fields[1]] = {
+            "ns": float(fields[2]),
+            "allocs": float(fields[3]),
+            "bytes": float(fields[4]),
+        }
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--target", required=True, help="baseline to compare with, e.g. native or esp32")
+    parser.add_argument("--threshold", type=float, help="allowed slowdown as a fraction (default from the baseline file)")
+    parser.add_argument("--update", action="store_true", help="store these results as the baseline")
+    parser.add_argument("results", nargs="?", help="file with the benchmark output (default stdin)")
+    args = parser.parse_args()
+
+    with open(args.results) if args.results else sys.stdin as stream:
+        current = read_results(stream)
+    if not current:
+        print("no BENCH lines found")
+        return 1
+
+    with open(BASELINE, encoding="utf-8") as f:
+        baseline = json.load(f)
+
+    if args.update:
+        target = baseline["targets"].setdefault(args.target, {})
+        target["results"] = current
+        with open(BASELINE, "w", encoding="utf-8") as f:
+            json.dump(baseline, f, indent=2, sort_keys=True)
+            f.write("\n")
+        print("baseline for %s updated with %d benchmarks" % (args.target, len(current)))
+        return 0
+
+    threshold = args.threshold if args.threshold is not None else baseline["threshold"]
+    recorded = baseline["targets"].get(args.target, {}).get("results", {})
+    if not recorded:
+        print("no baseline recorded for %s, run with --update first" % args.target)
+
+    failed = False
+    print("%-20s %12s %12s %8s %9s %9s  %s" % ("benchmark", "base ns/op", "ns/op", "change", "allocs/op", "bytes/op", "status"))
+    for name, result in current.items():
+        base = recorded.get(name)
+        status = "new"
+        change = ""
+        if base is not None:
+            delta = result["ns"] - base["ns"]
+            change = "%+.1f%%" % (100.0 * delta / base["ns"]) if base["ns"] > 0 else ""
+            status = "ok"
+            if delta > MIN_DELTA_NS and delta > threshold * base["ns"]:
+                status = "SLOWER"
+                failed = True
+            if result["allocs"] > base["allocs"] + 0.001:
+                status = "MORE ALLOCATIONS"
+                failed = True
+        print("%-20s %12s %12.1f %8s %9.3f %9.1f  %s" % (
+            name, "%.1f" % base["ns"] if base else "-", result["ns"], change, result["allocs"], result["bytes"], status))
+
+    for name in recorded:
+        if name not in current:
+            print("%-20s missing from the results" % name)
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Gzips web/dashboard.html into lib/HTMLInterface/dashboard.h.
+
+Run from the repository root after editing the page:
+    python3 tools/embed_dashboard.py
+"""
+import gzip
+import hashlib
+import os
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCE = os.path.join(ROOT, "web", "dashboard.html")
+TARGET = os.path.join(ROOT, "lib", "HTMLInterface", "dashboard.h")
+
+
+def minify(html):
+    lines = (line.strip() for line in html.splitlines())
+    return "\n".join(line for line in lines if line)
+
+
+def main():
+    with open(SOURCE, encoding="utf-8") as f:
+        page = minify(f.read()).encode("utf-8")
+
+    # mtime=0 keeps the output (and the ETag) stable between runs
+    compressed = gzip.compress(page, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(page).hexdigest()[:16]
+
+    rows = []
+    for i in range(0, len(compressed), 16):
+        rows.append("    " + ", ".join("0x%02x" % b for b in compressed[i:i + 16]))
+
+    with open(TARGET, "w", encoding="utf-8") as f:
+        f.write("// Generated by tools/embed_dashboard.py from web/dashboard.html, do not edit.\n")
+        f.write("#ifndef DASHBOARD_H\n#define DASHBOARD_H\n\n")
+        f.write("#include <Arduino.h>\n\n")
+        f.write("#define DASHBOARD_ETAG \"\\\"%s\\\"\"\n" % etag)
+        f.write("#define DASHBOARD_HTML_GZ_LENGTH %d\n\n" % len(compressed))
+        f.write("static const uint8_t DASHBOARD_HTML_GZ[] PROGMEM = {\n")
+        f.write(",\n".join(rows))
+        f.write("\n};\n\n#endif\n")
+
+    print("%s: %d bytes -> %d bytes gzip" % (os.path.relpath(TARGET, ROOT), len(page), len(compressed)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Request latency of the web interface under concurrent clients.
+
+Connect to the ESP32_PAINEL access point, then:
+    python3 tools/http_latency.py --clients 4 --requests 200
+
+Every client hits the routes in turn with its own connection and the
+latencies (ms) are reported per route as p50/p95/max.
+
+--update records the run in tools/http_latency_baseline.json, with the
+conditions it was measured under (what the board was doing, how many
+browsers had the dashboard open, signal strength...):
+    python3 tools/http_latency.py --clients 4 --requests 200 --update \
+        --conditions "polling BLE adapter at 14 req/s, 1 dashboard on /ws, phone 2 m away"
+"""
+import argparse
+import datetime
+import json
+import os
+import subprocess
+import sys
+import threading
+import time
+import urllib.request
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+BASELINE = os.path.join(ROOT, "tools", "http_latency_baseline.json")
+
+ROUTES = [
+    ("GET", "/"),
+    ("GET", "/api/state"),
+    ("GET", "/api/stats"),
+    ("GET", "/metrics"),
+]
+
+
+def worker(base, requests, results, lock):
+    for i in range(requests):
+        method, path = ROUTES[i % len(ROUTES)]
+        request = urllib.request.Request(base + path, method=method, headers={"Accept-Encoding": "gzip"})
+        start = time.perf_counter()
+        try:
+            with urllib.request.urlopen(request, timeout=5) as response:
+                response.read()
+            elapsed = (time.perf_counter() - start) * 1000.0
+        except Exception:
+            elapsed = None
+        with lock:
+            results.setdefault(path, []).append(elapsed)
+
+
+def percentile(values, fraction):
+    index = min(len(values) - 1, int(round(fraction * (len(values) - 1))))
+    return values[index]
+
+
+def summarize(results):
+    summary = {}
+    for path, samples in sorted(results.items()):
+        ok = sorted(s for s in samples if s is not None)
+        entry = {"n": len(ok), "failed": len(samples) - len(ok)}
+        if ok:
+            entry.update(p50=round(percentile(ok, 0.5), 1), p95=round(percentile(ok, 0.95), 1), max=round(ok[-1], 1))
+        summary[path] = entry
+    return summary
+
+
+def firmware_commit():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "--short", "HEAD"], cwd=ROOT, text=True).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def record(args, summary, total):
+    with open(BASELINE) as f:
+        baseline = json.load(f)
+    baseline["device"] = {
+        "date": datetime.date.today().isoformat(),
+        "commit": firmware_commit(),
+        "host": args.host,
+        "clients": args.clients,
+        "requests_per_client": args.requests,
+        "seconds": round(total, 1),
+        "conditions": args.conditions,
+        "routes": summary,
+    }
+    with open(BASELINE, "w") as f:
+        json.dump(baseline, f, indent=2, sort_keys=True)
+        f.write("\n")
+    print("Recorded in %s" % os.path.relpath(BASELINE, ROOT))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="192.168.4.1")
+    parser.add_argument("--clients", type=int, default=4)
+    parser.add_argument("--requests", type=int, default=100, help="requests per client")
+    parser.add_argument("--update", action="store_true", help="record the results in %s" % os.path.relpath(BASELINE, ROOT))
+    parser.add_argument("--conditions", help="what the board and the network were doing, required with --update")
+    args = parser.parse_args()
+    if args.update and not args.conditions:
+        parser.error("--update needs --conditions")
+
+    base = "http://" + args.host
+    results = {}
+    lock = threading.Lock()
+    threads = [threading.Thread(target=worker, args=(base, args.requests, results, lock)) for _ in range(args.clients)]
+
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    total = time.perf_counter() - start
+
+    print("%d clients x %d requests in %.1f s" % (args.clients, args.requests, total))
+    summary = summarize(results)
+    for path, entry in summary.items():
+        if entry["n"] == 0:
+            print("%-12s all %d failed" % (path, entry["failed"]))
+            continue
+        print("%-12s n=%-5d p50=%7.1f  p95=%7.1f  max=%7.1f ms  failed=%d"
+              % (path, entry["n"], entry["p50"], entry["p95"], entry["max"], entry["failed"]))
+
+    if args.update:
+        if any(entry["n"] == 0 for entry in summary.values()):
+            print("Not recorded: a route never answered", file=sys.stderr)
+            return 1
+        record(args, summary, total)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())